@@ -0,0 +1,455 @@
+#include <stdio.h>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include "audiomixer.h"
+#include "audiostats.h"
+#include "mmlplayer.h"
+#include "sfxplayer.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && 2<=_M_IX86_FP)
+	#define AUDIOMIXER_USE_SSE2
+	#include <emmintrin.h>
+#endif
+
+
+
+AudioMixer::Source::~Source()
+{
+}
+
+void AudioMixer::Voice::Clear(void)
+{
+	active=false;
+	loop=false;
+	pcm=nullptr;
+	numSamples=0;
+	pos=0;
+	src=nullptr;
+	gain=GAIN_ONE;
+	latencyPending=false;
+}
+
+////////////////////////////////////////////////////////////
+
+// accum[i]+=(src[i]*gain)>>12
+static void AudioMixer_AccumulateWithGain(int32_t accum[],const int16_t src[],unsigned int numValues,int gain)
+{
+	if(0==gain)
+	{
+		return;
+	}
+
+	unsigned int i=0;
+#ifdef AUDIOMIXER_USE_SSE2
+	if(AudioMixer::GAIN_ONE==gain)
+	{
+		for(; i+8<=numValues; i+=8)
+		{
+			__m128i x=_mm_loadu_si128((const __m128i *)(src+i));
+			__m128i x0=_mm_srai_epi32(_mm_unpacklo_epi16(x,x),16);
+			__m128i x1=_mm_srai_epi32(_mm_unpackhi_epi16(x,x),16);
+			__m128i a0=_mm_loadu_si128((const __m128i *)(accum+i));
+			__m128i a1=_mm_loadu_si128((const __m128i *)(accum+i+4));
+			_mm_storeu_si128((__m128i *)(accum+i),  _mm_add_epi32(a0,x0));
+			_mm_storeu_si128((__m128i *)(accum+i+4),_mm_add_epi32(a1,x1));
+		}
+	}
+	else
+	{
+		const __m128i g=_mm_set1_epi16((short)gain);
+		for(; i+8<=numValues; i+=8)
+		{
+			__m128i x=_mm_loadu_si128((const __m128i *)(src+i));
+			__m128i lo=_mm_mullo_epi16(x,g);
+			__m128i hi=_mm_mulhi_epi16(x,g);
+			__m128i p0=_mm_srai_epi32(_mm_unpacklo_epi16(lo,hi),12);
+			__m128i p1=_mm_srai_epi32(_mm_unpackhi_epi16(lo,hi),12);
+			__m128i a0=_mm_loadu_si128((const __m128i *)(accum+i));
+			__m128i a1=_mm_loadu_si128((const __m128i *)(accum+i+4));
+			_mm_storeu_si128((__m128i *)(accum+i),  _mm_add_epi32(a0,p0));
+			_mm_storeu_si128((__m128i *)(accum+i+4),_mm_add_epi32(a1,p1));
+		}
+	}
+#endif
+	for(; i<numValues; ++i)
+	{
+		accum[i]+=(src[i]*gain)>>12;
+	}
+}
+
+AudioMixer::AudioMixer(unsigned int numVoices,unsigned int samplingRate)
+{
+	this->samplingRate=(0<samplingRate ? samplingRate : (unsigned int)SAMPLING_RATE);
+	voices.resize(std::max<unsigned int>(1,numVoices));
+	SetLimiter(LIMITER_THRESHOLD_DEFAULT,LIMITER_RELEASE_MILLISEC_DEFAULT);
+}
+
+unsigned int AudioMixer::GetSamplingRate(void) const
+{
+	return samplingRate;
+}
+
+int AudioMixer::PlayPCM(const int16_t stereo[],size_t numSamples,bool loop,int gain)
+{
+	if(nullptr==stereo || 0==numSamples)
+	{
+		return -1;
+	}
+
+	auto voiceNum=AllocateVoice();
+	if(0<=voiceNum)
+	{
+		auto &v=voices[voiceNum];
+		v.active=true;
+		v.loop=loop;
+		v.pcm=stereo;
+		v.numSamples=numSamples;
+		v.pos=0;
+		v.gain=std::max(0,std::min<int>(GAIN_MAX,gain));
+		if(nullptr!=stats)
+		{
+			v.latencyPending=true;
+			v.requestedMicrosec=AudioStats::NowInMicrosec();
+		}
+	}
+	return voiceNum;
+}
+
+int AudioMixer::PlayStream(Source *src,int gain)
+{
+	if(nullptr==src)
+	{
+		return -1;
+	}
+
+	auto voiceNum=AllocateVoice();
+	if(0<=voiceNum)
+	{
+		auto &v=voices[voiceNum];
+		v.active=true;
+		v.src=src;
+		v.gain=std::max(0,std::min<int>(GAIN_MAX,gain));
+		if(nullptr!=stats)
+		{
+			v.latencyPending=true;
+			v.requestedMicrosec=AudioStats::NowInMicrosec();
+		}
+	}
+	return voiceNum;
+}
+
+int AudioMixer::AllocateVoice(void)
+{
+	int voiceNum=-1;
+	for(unsigned int i=0; i<voices.size(); ++i)
+	{
+		if(true!=voices[i].active)
+		{
+			voiceNum=i;
+			break;
+		}
+	}
+	if(voiceNum<0)
+	{
+		// Steal the oldest one-shot PCM voice.  Streams are never stolen, or the music would stop silently.
+		for(unsigned int i=0; i<voices.size(); ++i)
+		{
+			if(nullptr==voices[i].src && true!=voices[i].loop &&
+			   (voiceNum<0 || voices[i].startCount<voices[voiceNum].startCount))
+			{
+				voiceNum=i;
+			}
+		}
+	}
+	if(0<=voiceNum)
+	{
+		voices[voiceNum].Clear();
+		voices[voiceNum].startCount=startCount++;
+	}
+	return voiceNum;
+}
+
+void AudioMixer::Stop(int voice)
+{
+	if(0<=voice && voice<(int)voices.size())
+	{
+		voices[voice].Clear();
+	}
+}
+
+void AudioMixer::StopAll(void)
+{
+	for(auto &v : voices)
+	{
+		v.Clear();
+	}
+}
+
+void AudioMixer::SetGain(int voice,int gain)
+{
+	if(0<=voice && voice<(int)voices.size())
+	{
+		voices[voice].gain=std::max(0,std::min<int>(GAIN_MAX,gain));
+	}
+}
+
+bool AudioMixer::IsPlaying(int voice) const
+{
+	return (0<=voice && voice<(int)voices.size() && true==voices[voice].active);
+}
+
+unsigned int AudioMixer::GetNumVoices(void) const
+{
+	return (unsigned int)voices.size();
+}
+
+unsigned int AudioMixer::GetNumActiveVoices(void) const
+{
+	unsigned int n=0;
+	for(auto &v : voices)
+	{
+		if(true==v.active)
+		{
+			++n;
+		}
+	}
+	return n;
+}
+
+void AudioMixer::SetLimiter(int threshold,unsigned int releaseMillisec)
+{
+	limiterThreshold=std::max(1,std::min(32767,threshold));
+	float releaseBlocks=(float)samplingRate*(float)releaseMillisec/(1000.0f*LIMITER_BLOCK_SAMPLES);
+	limiterRelease=(1.0f<releaseBlocks ? 1.0f/releaseBlocks : 1.0f);
+}
+
+void AudioMixer::Mix(int16_t stereo[],unsigned int numSamples)
+{
+	const unsigned int numValues=numSamples*2;
+	if(accum.size()<numValues)
+	{
+		accum.resize(numValues);
+		srcBuf.resize(numValues);
+	}
+	std::memset(accum.data(),0,numValues*sizeof(int32_t));
+
+	uint64_t mixStart=0,streamMicrosec=0;
+	unsigned int numActive=0;
+	if(nullptr!=stats)
+	{
+		mixStart=AudioStats::NowInMicrosec();
+	}
+
+	for(auto &v : voices)
+	{
+		if(true!=v.active)
+		{
+			continue;
+		}
+
+		++numActive;
+		if(nullptr!=stats && true==v.latencyPending)
+		{
+			// The samples mixed now are heard after the samples queued in the device.
+			auto queued=(uint64_t)stats->GetLastFillLevel()*1000000/samplingRate;
+			stats->latency.Add(mixStart-std::min(mixStart,v.requestedMicrosec)+queued);
+			v.latencyPending=false;
+		}
+
+		if(nullptr!=v.src)
+		{
+			uint64_t t0=0;
+			if(nullptr!=stats)
+			{
+				t0=AudioStats::NowInMicrosec();
+			}
+			auto n=v.src->GetSamples(srcBuf.data(),numSamples);
+			if(nullptr!=stats)
+			{
+				streamMicrosec+=AudioStats::NowInMicrosec()-t0;
+			}
+			AudioMixer_AccumulateWithGain(accum.data(),srcBuf.data(),n*2,v.gain);
+			if(n<numSamples)
+			{
+				v.Clear();
+			}
+		}
+		else if(0==v.numSamples)
+		{
+			// Nothing to play.  Would stay active forever otherwise.
+			v.Clear();
+		}
+		else
+		{
+			unsigned int filled=0;
+			while(filled<numSamples && true==v.active)
+			{
+				auto n=(unsigned int)std::min<size_t>(numSamples-filled,v.numSamples-v.pos);
+				AudioMixer_AccumulateWithGain(accum.data()+filled*2,v.pcm+v.pos*2,n*2,v.gain);
+				filled+=n;
+				v.pos+=n;
+				if(v.numSamples<=v.pos)
+				{
+					if(true==v.loop)
+					{
+						v.pos=0;
+					}
+					else
+					{
+						v.Clear();
+					}
+				}
+			}
+		}
+	}
+
+	LimitAndSaturate(stereo,accum.data(),numValues);
+
+	if(nullptr!=stats)
+	{
+		auto renderMicrosec=AudioStats::NowInMicrosec()-mixStart;
+		stats->renderTime.Add(renderMicrosec);
+		if(0<numSamples)
+		{
+			// Period is numSamples*1000000/samplingRate microseconds.
+			stats->renderLoad.Add(renderMicrosec*samplingRate/((uint64_t)numSamples*1000));
+		}
+		stats->streamTime.Add(streamMicrosec);
+		stats->activeVoices.Add(numActive);
+		stats->numPeriods.fetch_add(1,std::memory_order_relaxed);
+	}
+}
+
+void AudioMixer::SetStats(AudioStats *stats)
+{
+	this->stats=stats;
+}
+
+AudioStats *AudioMixer::GetStats(void) const
+{
+	return stats;
+}
+
+void AudioMixer::LimitAndSaturate(int16_t stereo[],const int32_t accum[],unsigned int numValues)
+{
+	for(unsigned int blk=0; blk<numValues; blk+=LIMITER_BLOCK_SAMPLES*2)
+	{
+		const unsigned int blkEnd=std::min<unsigned int>(numValues,blk+LIMITER_BLOCK_SAMPLES*2);
+
+		int32_t peak=0;
+		for(unsigned int i=blk; i<blkEnd; ++i)
+		{
+			peak=std::max(peak,std::abs(accum[i]));
+		}
+
+		// Attack is immediate so that the block never exceeds the threshold.
+		limiterGain=std::min(1.0f,limiterGain+limiterRelease);
+		if(limiterThreshold<peak)
+		{
+			limiterGain=std::min(limiterGain,(float)limiterThreshold/(float)peak);
+		}
+
+		unsigned int i=blk;
+		if(1.0f<=limiterGain)
+		{
+		#ifdef AUDIOMIXER_USE_SSE2
+			for(; i+8<=blkEnd; i+=8)
+			{
+				__m128i a0=_mm_loadu_si128((const __m128i *)(accum+i));
+				__m128i a1=_mm_loadu_si128((const __m128i *)(accum+i+4));
+				_mm_storeu_si128((__m128i *)(stereo+i),_mm_packs_epi32(a0,a1));
+			}
+		#endif
+			for(; i<blkEnd; ++i)
+			{
+				stereo[i]=(int16_t)std::max(-32768,std::min(32767,accum[i]));
+			}
+		}
+		else
+		{
+		#ifdef AUDIOMIXER_USE_SSE2
+			const __m128 g=_mm_set1_ps(limiterGain);
+			for(; i+8<=blkEnd; i+=8)
+			{
+				__m128 f0=_mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)(accum+i))),g);
+				__m128 f1=_mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)(accum+i+4))),g);
+				_mm_storeu_si128((__m128i *)(stereo+i),_mm_packs_epi32(_mm_cvttps_epi32(f0),_mm_cvttps_epi32(f1)));
+			}
+		#endif
+			for(; i<blkEnd; ++i)
+			{
+				int32_t s=(int32_t)((float)accum[i]*limiterGain);
+				stereo[i]=(int16_t)std::max(-32768,std::min(32767,s));
+			}
+		}
+	}
+}
+
+static void AudioMixer_SetDword(unsigned char ptr[],uint32_t value)
+{
+	ptr[0]=(unsigned char)value;
+	ptr[1]=(unsigned char)(value>>8);
+	ptr[2]=(unsigned char)(value>>16);
+	ptr[3]=(unsigned char)(value>>24);
+}
+
+/* static */ bool AudioMixer::SaveWav(const char fn[],const std::vector <int16_t> &stereo,unsigned int samplingRate)
+{
+	FILE *fp=fopen(fn,"wb");
+	if(nullptr==fp)
+	{
+		return false;
+	}
+
+	const uint32_t dataSize=(uint32_t)(stereo.size()*sizeof(int16_t));
+	const uint32_t bytesPerSec=samplingRate*4;
+	unsigned char hdr[44]=
+	{
+		'R','I','F','F',0,0,0,0,'W','A','V','E',
+		'f','m','t',' ',16,0,0,0,
+		1,0,   // PCM
+		2,0,   // Stereo
+		0,0,0,0,
+		0,0,0,0,
+		4,0,   // Block align
+		16,0,  // Bits per sample
+		'd','a','t','a',0,0,0,0,
+	};
+	AudioMixer_SetDword(hdr+4,36+dataSize);
+	AudioMixer_SetDword(hdr+24,samplingRate);
+	AudioMixer_SetDword(hdr+28,bytesPerSec);
+	AudioMixer_SetDword(hdr+40,dataSize);
+
+	std::vector <unsigned char> data;
+	data.resize(dataSize);
+	for(size_t i=0; i<stereo.size(); ++i)
+	{
+		data[i*2  ]=(unsigned char)stereo[i];
+		data[i*2+1]=(unsigned char)(((uint16_t)stereo[i])>>8);
+	}
+
+	bool res=(1==fwrite(hdr,44,1,fp) && (0==dataSize || 1==fwrite(data.data(),dataSize,1,fp)));
+	fclose(fp);
+	return res;
+}
+
+////////////////////////////////////////////////////////////
+
+MMLPlayerSource::MMLPlayerSource(MMLPlayer *player)
+{
+	this->player=player;
+}
+unsigned int MMLPlayerSource::GetSamples(int16_t stereo[],unsigned int numSamples)
+{
+	return (unsigned int)player->MakeWaveForNSamples((unsigned char *)stereo,numSamples,true);
+}
+
+SFXPlayerSource::SFXPlayerSource(SFXPlayer *player)
+{
+	this->player=player;
+}
+unsigned int SFXPlayerSource::GetSamples(int16_t stereo[],unsigned int numSamples)
+{
+	return (unsigned int)player->MakeWaveForNSamples((unsigned char *)stereo,numSamples);
+}
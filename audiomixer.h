@@ -0,0 +1,175 @@
+#ifndef AUDIOMIXER_IS_INCLUDED
+#define AUDIOMIXER_IS_INCLUDED
+/* { */
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+class MMLPlayer;
+class SFXPlayer;
+class AudioStats;
+
+/*! Software mixer for 16-bit stereo sources of the same sampling rate.
+    Sources are PCM arrays owned by the caller (such as loaded WAV data), or streams that
+    generate samples on demand (such as MMLPlayer and SFXPlayer).
+
+    The voice pool is allocated on construction and does not grow.  Voices are mixed
+    into a 32-bit buffer so that the limiter sees the true peak, and then saturated to
+    16 bit.  Mixing and conversion use SSE2 if available.
+*/
+class AudioMixer
+{
+public:
+	enum
+	{
+		SAMPLING_RATE=44100,
+		NUM_VOICES_DEFAULT=64,
+
+		GAIN_ONE=4096,          // Gain is in 4096 scale.
+		GAIN_MAX=32767,
+
+		LIMITER_THRESHOLD_DEFAULT=32000,
+		LIMITER_RELEASE_MILLISEC_DEFAULT=200,
+		LIMITER_BLOCK_SAMPLES=64,
+	};
+
+	/*! Stream source.
+	*/
+	class Source
+	{
+	public:
+		virtual ~Source();
+
+		/*! Writes up to numSamples 16-bit stereo samples to stereo[], and returns the number of samples written.
+		    Returning less than numSamples means the end of the stream.
+		*/
+		virtual unsigned int GetSamples(int16_t stereo[],unsigned int numSamples)=0;
+	};
+
+private:
+	class Voice
+	{
+	public:
+		bool active=false;
+		bool loop=false;
+		const int16_t *pcm=nullptr;  // Stereo.
+		size_t numSamples=0,pos=0;
+		Source *src=nullptr;
+		int gain=GAIN_ONE;
+		uint64_t startCount=0;
+		bool latencyPending=false;    // True until the first period of the voice is mixed.
+		uint64_t requestedMicrosec=0;
+
+		void Clear(void);
+	};
+
+	std::vector <Voice> voices;
+	std::vector <int32_t> accum;
+	std::vector <int16_t> srcBuf;
+	uint64_t startCount=0;
+	unsigned int samplingRate=SAMPLING_RATE;
+
+	int limiterThreshold=LIMITER_THRESHOLD_DEFAULT;
+	float limiterRelease;  // Gain recovery per block.
+	float limiterGain=1.0f;
+
+	AudioStats *stats=nullptr;
+
+public:
+	/*! samplingRate is the rate of the device.  Sources must be made at the same rate, such as by
+	    MMLPlayer::SetSamplingRate.
+	*/
+	AudioMixer(unsigned int numVoices=NUM_VOICES_DEFAULT,unsigned int samplingRate=SAMPLING_RATE);
+
+	/*!
+	*/
+	unsigned int GetSamplingRate(void) const;
+
+	/*! Starts playing 16-bit stereo PCM.  The array is not copied, and it must stay
+	    valid while the voice is playing.
+	    If all voices are busy, the oldest one-shot PCM voice is stolen.  Looping voices and streams are not stolen.
+	    Returns the voice number, or -1 if stereo is nullptr, numSamples is zero, or no voice can be stolen.
+	*/
+	int PlayPCM(const int16_t stereo[],size_t numSamples,bool loop,int gain=GAIN_ONE);
+
+	/*! Starts playing a stream.  The mixer does not take the ownership.
+	    The voice stops when the source returns less samples than requested.
+	    Returns the voice number, or -1 if src is nullptr or no voice can be stolen.  A stream voice is never stolen.
+	*/
+	int PlayStream(Source *src,int gain=GAIN_ONE);
+
+	/*!
+	*/
+	void Stop(int voice);
+
+	/*!
+	*/
+	void StopAll(void);
+
+	/*!
+	*/
+	void SetGain(int voice,int gain);
+
+	/*!
+	*/
+	bool IsPlaying(int voice) const;
+
+	/*!
+	*/
+	unsigned int GetNumVoices(void) const;
+
+	/*!
+	*/
+	unsigned int GetNumActiveVoices(void) const;
+
+	/*! Output is kept under threshold.  The gain recovers to 1.0 in releaseMillisec after a peak.
+	*/
+	void SetLimiter(int threshold,unsigned int releaseMillisec);
+
+	/*! Mixes numSamples stereo samples of all active voices into stereo[].
+	*/
+	void Mix(int16_t stereo[],unsigned int numSamples);
+
+	/*! Records timing of every Mix to stats, which the mixer does not own.  nullptr stops recording.
+	    Latency of a voice is from PlayPCM/PlayStream to the first mix of the voice, plus the fill
+	    level last reported to stats, which is how long the mixed samples wait in the device.
+	*/
+	void SetStats(AudioStats *stats);
+	AudioStats *GetStats(void) const;
+
+	/*! Saves 16-bit stereo samples as a WAV file.
+	*/
+	static bool SaveWav(const char fn[],const std::vector <int16_t> &stereo,unsigned int samplingRate);
+
+private:
+	int AllocateVoice(void);
+	void LimitAndSaturate(int16_t stereo[],const int32_t accum[],unsigned int numValues);
+};
+
+
+
+/*! Stream source from MMLPlayer.  The stream ends when the MML is done.
+*/
+class MMLPlayerSource : public AudioMixer::Source
+{
+public:
+	MMLPlayer *player=nullptr;
+
+	MMLPlayerSource(MMLPlayer *player);
+	unsigned int GetSamples(int16_t stereo[],unsigned int numSamples) override;
+};
+
+/*! Stream source from SFXPlayer.  The stream never ends.
+*/
+class SFXPlayerSource : public AudioMixer::Source
+{
+public:
+	SFXPlayer *player=nullptr;
+
+	SFXPlayerSource(SFXPlayer *player);
+	unsigned int GetSamples(int16_t stereo[],unsigned int numSamples) override;
+};
+
+/* } */
+#endif
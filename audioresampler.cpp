@@ -0,0 +1,342 @@
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include "audioresampler.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && 2<=_M_IX86_FP)
+	#define AUDIORESAMPLER_USE_SSE2
+	#include <emmintrin.h>
+#endif
+
+
+
+static const double AudioResampler_StopBandDB=90.0;
+static const double AudioResampler_KaiserBeta=0.1102*(AudioResampler_StopBandDB-8.7);
+static const double AudioResampler_PI=3.14159265358979323846;
+
+// Modified Bessel function of the first kind, order 0.
+static double AudioResampler_I0(double x)
+{
+	double sum=1.0,term=1.0;
+	for(int k=1; k<64 && sum*1e-12<term; ++k)
+	{
+		term*=(x/(2.0*k))*(x/(2.0*k));
+		sum+=term;
+	}
+	return sum;
+}
+
+AudioResampler::AudioResampler()
+{
+}
+
+void AudioResampler::SetRate(unsigned int inputRate,unsigned int outputRate)
+{
+	if(0==inputRate || 0==outputRate)
+	{
+		return;
+	}
+	if(this->inputRate!=inputRate || this->outputRate!=outputRate)
+	{
+		this->inputRate=inputRate;
+		this->outputRate=outputRate;
+		MakeFilter();
+	}
+	Reset();
+}
+
+unsigned int AudioResampler::GetInputRate(void) const
+{
+	return inputRate;
+}
+unsigned int AudioResampler::GetOutputRate(void) const
+{
+	return outputRate;
+}
+
+void AudioResampler::MakeFilter(void)
+{
+	// Transition band of the Kaiser window is about (A-8)/(14.36*TAPS) of the input rate.
+	// It is placed right below the lower Nyquist frequency, so that nothing above it aliases.
+	const double transition=(AudioResampler_StopBandDB-8.0)/(14.36*TAPS);
+	const double nyquist=0.5*std::min(1.0,(double)outputRate/(double)inputRate);
+	const double cutOff=nyquist-transition/2.0;  // Cycles per input sample.
+	const double I0Beta=AudioResampler_I0(AudioResampler_KaiserBeta);
+
+	coeff.resize((NUM_PHASES+1)*TAPS);
+	coeffFloat.resize((NUM_PHASES+1)*TAPS);
+	for(unsigned int phase=0; phase<=NUM_PHASES; ++phase)
+	{
+		// Tap TAPS/2-1 is the input sample at the output position when phase is zero.
+		const double frac=(double)phase/(double)NUM_PHASES;
+		double h[TAPS],sum=0.0;
+		for(int t=0; t<TAPS; ++t)
+		{
+			const double x=(double)(t-(TAPS/2-1))-frac;
+			const double u=x/(double)(TAPS/2);
+			const double w=(u*u<1.0 ? AudioResampler_I0(AudioResampler_KaiserBeta*sqrt(1.0-u*u))/I0Beta : 0.0);
+			const double arg=2.0*AudioResampler_PI*cutOff*x;
+			const double sinc=(0.0==x ? 1.0 : sin(arg)/arg);
+			h[t]=2.0*cutOff*sinc*w;
+			sum+=h[t];
+		}
+
+		// Normalize so that DC gain is exactly one after quantization.
+		int16_t *c=coeff.data()+phase*TAPS;
+		float *cf=coeffFloat.data()+phase*TAPS;
+		int total=0,peak=0;
+		for(int t=0; t<TAPS; ++t)
+		{
+			c[t]=(int16_t)floor(h[t]/sum*(double)(1<<COEFF_SHIFT)+0.5);
+			cf[t]=(float)(h[t]/sum);
+			total+=c[t];
+			if(c[peak]<c[t])
+			{
+				peak=t;
+			}
+		}
+		c[peak]+=(int16_t)((1<<COEFF_SHIFT)-total);
+	}
+}
+
+void AudioResampler::Reset(void)
+{
+	// Silence before the stream so that the first output can be centered at the first input.
+	numBuffered=TAPS/2-1;
+	bufL.assign(numBuffered,0);
+	bufR.assign(numBuffered,0);
+	bufFloatL.assign(numBuffered,0.0f);
+	bufFloatR.assign(numBuffered,0.0f);
+	pos=0;
+}
+
+void AudioResampler::UseFloat(bool floatStream)
+{
+	if(this->floatStream!=floatStream)
+	{
+		this->floatStream=floatStream;
+		Reset();
+	}
+}
+
+unsigned int AudioResampler::GetNumInputNeeded(unsigned int numOutput) const
+{
+	if(0==numOutput || 0==outputRate)
+	{
+		return 0;
+	}
+	uint64_t last=(pos+(uint64_t)(numOutput-1)*inputRate)/outputRate;
+	uint64_t need=last+TAPS;
+	return (numBuffered<need ? (unsigned int)(need-numBuffered) : 0);
+}
+
+unsigned int AudioResampler::Resample(int16_t output[],unsigned int maxOutput,const int16_t input[],unsigned int numInput)
+{
+	if(0==outputRate)
+	{
+		return 0;
+	}
+	UseFloat(false);
+	Append(input,numInput);
+	auto numOutput=Filter(output,maxOutput,~0u);
+	DiscardUsedInput();
+	return numOutput;
+}
+
+unsigned int AudioResampler::Flush(int16_t output[],unsigned int maxOutput)
+{
+	if(0==outputRate)
+	{
+		return 0;
+	}
+	UseFloat(false);
+	const unsigned int inputEnd=numBuffered;
+	AppendSilence(TAPS/2);
+	auto numOutput=Filter(output,maxOutput,inputEnd);
+	Reset();
+	return numOutput;
+}
+
+unsigned int AudioResampler::Resample(float outputLeft[],float outputRight[],unsigned int maxOutput,const float inputLeft[],const float inputRight[],unsigned int numInput)
+{
+	if(0==outputRate)
+	{
+		return 0;
+	}
+	UseFloat(true);
+	Append(inputLeft,inputRight,numInput);
+	auto numOutput=Filter(outputLeft,outputRight,maxOutput,~0u);
+	DiscardUsedInput();
+	return numOutput;
+}
+
+unsigned int AudioResampler::Flush(float outputLeft[],float outputRight[],unsigned int maxOutput)
+{
+	if(0==outputRate)
+	{
+		return 0;
+	}
+	UseFloat(true);
+	const unsigned int inputEnd=numBuffered;
+	AppendSilence(TAPS/2);
+	auto numOutput=Filter(outputLeft,outputRight,maxOutput,inputEnd);
+	Reset();
+	return numOutput;
+}
+
+void AudioResampler::Append(const int16_t input[],unsigned int numInput)
+{
+	bufL.resize(numBuffered+numInput);
+	bufR.resize(numBuffered+numInput);
+	int16_t *l=bufL.data()+numBuffered,*r=bufR.data()+numBuffered;
+	for(unsigned int i=0; i<numInput; ++i)
+	{
+		l[i]=input[i*2];
+		r[i]=input[i*2+1];
+	}
+	numBuffered+=numInput;
+}
+
+void AudioResampler::Append(const float inputLeft[],const float inputRight[],unsigned int numInput)
+{
+	bufFloatL.insert(bufFloatL.end(),inputLeft,inputLeft+numInput);
+	bufFloatR.insert(bufFloatR.end(),inputRight,inputRight+numInput);
+	numBuffered+=numInput;
+}
+
+void AudioResampler::AppendSilence(unsigned int numInput)
+{
+	if(true==floatStream)
+	{
+		bufFloatL.resize(numBuffered+numInput,0.0f);
+		bufFloatR.resize(numBuffered+numInput,0.0f);
+	}
+	else
+	{
+		bufL.resize(numBuffered+numInput,0);
+		bufR.resize(numBuffered+numInput,0);
+	}
+	numBuffered+=numInput;
+}
+
+bool AudioResampler::NextOutput(unsigned int &top,unsigned int &phase,unsigned int inputEnd) const
+{
+	const uint64_t t=pos/outputRate;
+	if(numBuffered<t+TAPS || inputEnd<=t+TAPS/2-1)
+	{
+		return false;
+	}
+	const uint64_t frac=pos%outputRate;
+	top=(unsigned int)t;
+	phase=(unsigned int)((frac*NUM_PHASES*2+outputRate)/(outputRate*2));
+	return true;
+}
+
+unsigned int AudioResampler::Filter(int16_t output[],unsigned int maxOutput,unsigned int inputEnd)
+{
+	unsigned int numOutput=0,top,phase;
+	while(numOutput<maxOutput && true==NextOutput(top,phase,inputEnd))
+	{
+		const int16_t *c=coeff.data()+phase*TAPS;
+		const int16_t *x=bufL.data()+top,*y=bufR.data()+top;
+
+	#ifdef AUDIORESAMPLER_USE_SSE2
+		__m128i sumL=_mm_setzero_si128(),sumR=_mm_setzero_si128();
+		for(int t=0; t<TAPS; t+=8)
+		{
+			__m128i cc=_mm_loadu_si128((const __m128i *)(c+t));
+			sumL=_mm_add_epi32(sumL,_mm_madd_epi16(_mm_loadu_si128((const __m128i *)(x+t)),cc));
+			sumR=_mm_add_epi32(sumR,_mm_madd_epi16(_mm_loadu_si128((const __m128i *)(y+t)),cc));
+		}
+		// (L0+L2,R0+R2,L1+L3,R1+R3) then fold the upper half.
+		__m128i sum=_mm_add_epi32(_mm_unpacklo_epi32(sumL,sumR),_mm_unpackhi_epi32(sumL,sumR));
+		sum=_mm_add_epi32(sum,_mm_shuffle_epi32(sum,_MM_SHUFFLE(1,0,3,2)));
+		sum=_mm_add_epi32(sum,_mm_set1_epi32(1<<(COEFF_SHIFT-1)));
+		sum=_mm_srai_epi32(sum,COEFF_SHIFT);
+		sum=_mm_packs_epi32(sum,sum);
+		int32_t lr=_mm_cvtsi128_si32(sum);
+		memcpy(output+numOutput*2,&lr,4);
+	#else
+		int32_t sumL=0,sumR=0;
+		for(int t=0; t<TAPS; ++t)
+		{
+			sumL+=x[t]*c[t];
+			sumR+=y[t]*c[t];
+		}
+		sumL=(sumL+(1<<(COEFF_SHIFT-1)))>>COEFF_SHIFT;
+		sumR=(sumR+(1<<(COEFF_SHIFT-1)))>>COEFF_SHIFT;
+		output[numOutput*2  ]=(int16_t)std::max(-32768,std::min(32767,sumL));
+		output[numOutput*2+1]=(int16_t)std::max(-32768,std::min(32767,sumR));
+	#endif
+
+		++numOutput;
+		pos+=inputRate;
+	}
+	return numOutput;
+}
+
+unsigned int AudioResampler::Filter(float outputLeft[],float outputRight[],unsigned int maxOutput,unsigned int inputEnd)
+{
+	float *outL=outputLeft,*outR=(nullptr!=outputRight ? outputRight : outputLeft+1);
+	const unsigned int step=(nullptr!=outputRight ? 1 : 2);
+
+	unsigned int numOutput=0,top,phase;
+	while(numOutput<maxOutput && true==NextOutput(top,phase,inputEnd))
+	{
+		const float *c=coeffFloat.data()+phase*TAPS;
+		const float *x=bufFloatL.data()+top,*y=bufFloatR.data()+top;
+
+		// Four partial sums per channel, added in the same order with or without SSE.
+	#ifdef AUDIORESAMPLER_USE_SSE2
+		__m128 sumL=_mm_setzero_ps(),sumR=_mm_setzero_ps();
+		for(int t=0; t<TAPS; t+=4)
+		{
+			__m128 cc=_mm_loadu_ps(c+t);
+			sumL=_mm_add_ps(sumL,_mm_mul_ps(_mm_loadu_ps(x+t),cc));
+			sumR=_mm_add_ps(sumR,_mm_mul_ps(_mm_loadu_ps(y+t),cc));
+		}
+		__m128 sum=_mm_add_ps(_mm_unpacklo_ps(sumL,sumR),_mm_unpackhi_ps(sumL,sumR));
+		sum=_mm_add_ps(sum,_mm_movehl_ps(sum,sum));
+		float lr[4];
+		_mm_storeu_ps(lr,sum);
+		outL[numOutput*step]=lr[0];
+		outR[numOutput*step]=lr[1];
+	#else
+		float sumL[4]={0.0f,0.0f,0.0f,0.0f},sumR[4]={0.0f,0.0f,0.0f,0.0f};
+		for(int t=0; t<TAPS; t+=4)
+		{
+			for(int k=0; k<4; ++k)
+			{
+				sumL[k]+=x[t+k]*c[t+k];
+				sumR[k]+=y[t+k]*c[t+k];
+			}
+		}
+		outL[numOutput*step]=(sumL[0]+sumL[2])+(sumL[1]+sumL[3]);
+		outR[numOutput*step]=(sumR[0]+sumR[2])+(sumR[1]+sumR[3]);
+	#endif
+
+		++numOutput;
+		pos+=inputRate;
+	}
+	return numOutput;
+}
+
+void AudioResampler::DiscardUsedInput(void)
+{
+	const unsigned int used=(unsigned int)std::min<uint64_t>(pos/outputRate,numBuffered);
+	if(0<used)
+	{
+		if(true==floatStream)
+		{
+			bufFloatL.erase(bufFloatL.begin(),bufFloatL.begin()+used);
+			bufFloatR.erase(bufFloatR.begin(),bufFloatR.begin()+used);
+		}
+		else
+		{
+			bufL.erase(bufL.begin(),bufL.begin()+used);
+			bufR.erase(bufR.begin(),bufR.begin()+used);
+		}
+		numBuffered-=used;
+		pos-=(uint64_t)used*outputRate;
+	}
+}
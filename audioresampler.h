@@ -0,0 +1,92 @@
+#ifndef AUDIORESAMPLER_IS_INCLUDED
+#define AUDIORESAMPLER_IS_INCLUDED
+/* { */
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/*! Polyphase FIR resampler for a 16-bit stereo stream.
+    The filter is a Kaiser-windowed sinc of TAPS taps, tabulated for NUM_PHASES+1 sub-sample
+    positions, and cuts off below the lower of the input and output Nyquist frequencies.
+    The read position is kept as an exact fraction of the two rates, so that it does not drift
+    however long the stream is.  Filtering uses SSE2 if available.
+
+    Output sample n is taken at input position n*inputRate/outputRate without delay.  Instead,
+    TAPS/2 input samples ahead of the output must be given.  GetNumInputNeeded tells how many.
+
+    A stream is either 16-bit or float.  Calling the functions of the other type resets the stream.
+*/
+class AudioResampler
+{
+public:
+	enum
+	{
+		TAPS=64,
+		NUM_PHASES=512,
+		COEFF_SHIFT=14,   // Coefficients of a phase add up to 1<<COEFF_SHIFT.
+	};
+
+private:
+	unsigned int inputRate=0,outputRate=0;
+	std::vector <int16_t> coeff;      // (NUM_PHASES+1)*TAPS
+	std::vector <float> coeffFloat;   // Same as coeff before quantization.
+	std::vector <int16_t> bufL,bufR;  // Input de-interleaved.
+	std::vector <float> bufFloatL,bufFloatR;
+	bool floatStream=false;
+	unsigned int numBuffered=0;
+	uint64_t pos=0;  // Position of the next output in 1/outputRate input samples from bufL[0].
+
+public:
+	AudioResampler();
+
+	/*! Makes the filter and resets the stream.
+	*/
+	void SetRate(unsigned int inputRate,unsigned int outputRate);
+
+	unsigned int GetInputRate(void) const;
+	unsigned int GetOutputRate(void) const;
+
+	/*! Discards buffered input.  The next input is taken as the beginning of a stream preceded by silence.
+	*/
+	void Reset(void);
+
+	/*! Returns the number of input samples that need to be given to Resample for making numOutput samples.
+	*/
+	unsigned int GetNumInputNeeded(unsigned int numOutput) const;
+
+	/*! Takes all numInput samples in input[], and writes up to maxOutput samples to output[].
+	    Both are 16-bit stereo interleaved.  Input not used yet is kept for the next call.
+	    Returns the number of samples written.
+	*/
+	unsigned int Resample(int16_t output[],unsigned int maxOutput,const int16_t input[],unsigned int numInput);
+
+	/*! Writes output up to the end of the input given so far, assuming silence after it, and resets the stream.
+	    Up to maxOutput samples are written, and output that does not fit is discarded.
+	    Returns the number of samples written.
+	*/
+	unsigned int Flush(int16_t output[],unsigned int maxOutput);
+
+	/*! Float version of Resample.  Input is planar.  If outputRight is nullptr, outputLeft receives
+	    interleaved L,R.  Otherwise output is planar.  Output is not clipped.
+	*/
+	unsigned int Resample(float outputLeft[],float outputRight[],unsigned int maxOutput,const float inputLeft[],const float inputRight[],unsigned int numInput);
+
+	/*! Float version of Flush.
+	*/
+	unsigned int Flush(float outputLeft[],float outputRight[],unsigned int maxOutput);
+
+private:
+	void MakeFilter(void);
+	void UseFloat(bool floatStream);
+	void Append(const int16_t input[],unsigned int numInput);
+	void Append(const float inputLeft[],const float inputRight[],unsigned int numInput);
+	void AppendSilence(unsigned int numInput);
+	bool NextOutput(unsigned int &top,unsigned int &phase,unsigned int inputEnd) const;
+	unsigned int Filter(int16_t output[],unsigned int maxOutput,unsigned int inputEnd);
+	unsigned int Filter(float outputLeft[],float outputRight[],unsigned int maxOutput,unsigned int inputEnd);
+	void DiscardUsedInput(void);
+};
+
+/* } */
+#endif
@@ -0,0 +1,338 @@
+#include <stdio.h>
+#include <chrono>
+#include "audiostats.h"
+
+
+
+AudioHistogram::AudioHistogram()
+{
+	Clear();
+}
+
+void AudioHistogram::Add(uint64_t value)
+{
+	bucket[GetBucketIndex(value)].fetch_add(1,std::memory_order_relaxed);
+	count.fetch_add(1,std::memory_order_relaxed);
+	sum.fetch_add(value,std::memory_order_relaxed);
+
+	auto prev=minValue.load(std::memory_order_relaxed);
+	while(value<prev && true!=minValue.compare_exchange_weak(prev,value,std::memory_order_relaxed))
+	{
+	}
+	prev=maxValue.load(std::memory_order_relaxed);
+	while(prev<value && true!=maxValue.compare_exchange_weak(prev,value,std::memory_order_relaxed))
+	{
+	}
+}
+
+void AudioHistogram::Clear(void)
+{
+	for(auto &b : bucket)
+	{
+		b.store(0,std::memory_order_relaxed);
+	}
+	count.store(0,std::memory_order_relaxed);
+	sum.store(0,std::memory_order_relaxed);
+	minValue.store(~(uint64_t)0,std::memory_order_relaxed);
+	maxValue.store(0,std::memory_order_relaxed);
+}
+
+uint64_t AudioHistogram::GetCount(void) const
+{
+	return count.load(std::memory_order_relaxed);
+}
+
+uint64_t AudioHistogram::GetMin(void) const
+{
+	return (0<GetCount() ? minValue.load(std::memory_order_relaxed) : 0);
+}
+
+uint64_t AudioHistogram::GetMax(void) const
+{
+	return maxValue.load(std::memory_order_relaxed);
+}
+
+double AudioHistogram::GetMean(void) const
+{
+	auto n=GetCount();
+	return (0<n ? (double)sum.load(std::memory_order_relaxed)/(double)n : 0.0);
+}
+
+uint64_t AudioHistogram::GetPercentile(double fraction) const
+{
+	uint64_t n=0;
+	uint64_t counts[NUM_BUCKETS];
+	for(unsigned int i=0; i<NUM_BUCKETS; ++i)
+	{
+		counts[i]=GetBucketCount(i);
+		n+=counts[i];
+	}
+	if(0==n)
+	{
+		return 0;
+	}
+
+	auto target=(uint64_t)(fraction*(double)n+0.999999);
+	target=(0<target ? target : 1);
+	uint64_t accum=0;
+	for(unsigned int i=0; i<NUM_BUCKETS; ++i)
+	{
+		accum+=counts[i];
+		if(target<=accum)
+		{
+			auto high=GetBucketHigh(i);
+			auto max=GetMax();
+			return (max<high ? max : high);
+		}
+	}
+	return GetMax();
+}
+
+uint64_t AudioHistogram::GetBucketCount(unsigned int bucketIdx) const
+{
+	return bucket[bucketIdx].load(std::memory_order_relaxed);
+}
+
+/* static */ unsigned int AudioHistogram::GetBucketIndex(uint64_t value)
+{
+	if(value<SUB_BUCKETS)
+	{
+		return (unsigned int)value;
+	}
+
+	unsigned int msb=0;
+	uint64_t v=value;
+	if(0!=(v>>32))
+	{
+		msb+=32;
+		v>>=32;
+	}
+	if(0!=(v>>16))
+	{
+		msb+=16;
+		v>>=16;
+	}
+	if(0!=(v>>8))
+	{
+		msb+=8;
+		v>>=8;
+	}
+	if(0!=(v>>4))
+	{
+		msb+=4;
+		v>>=4;
+	}
+	if(0!=(v>>2))
+	{
+		msb+=2;
+		v>>=2;
+	}
+	if(0!=(v>>1))
+	{
+		msb+=1;
+	}
+
+	auto shift=msb-SUB_BUCKET_BITS;
+	return (shift+1)*SUB_BUCKETS+(unsigned int)((value>>shift)-SUB_BUCKETS);
+}
+
+/* static */ uint64_t AudioHistogram::GetBucketLow(unsigned int bucketIdx)
+{
+	if(bucketIdx<SUB_BUCKETS)
+	{
+		return bucketIdx;
+	}
+	auto shift=bucketIdx/SUB_BUCKETS-1;
+	return (uint64_t)(SUB_BUCKETS+bucketIdx%SUB_BUCKETS)<<shift;
+}
+
+/* static */ uint64_t AudioHistogram::GetBucketHigh(unsigned int bucketIdx)
+{
+	if(bucketIdx<SUB_BUCKETS)
+	{
+		return bucketIdx;
+	}
+	auto shift=bucketIdx/SUB_BUCKETS-1;
+	return GetBucketLow(bucketIdx)+(((uint64_t)1<<shift)-1);
+}
+
+
+
+////////////////////////////////////////////////////////////
+
+
+
+AudioStats::AudioStats()
+{
+	Clear();
+}
+
+/* static */ uint64_t AudioStats::NowInMicrosec(void)
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void AudioStats::SetFillLevel(unsigned int numSamples)
+{
+	fillLevel.Add(numSamples);
+	lastFillLevel.store(numSamples,std::memory_order_relaxed);
+}
+
+unsigned int AudioStats::GetLastFillLevel(void) const
+{
+	return lastFillLevel.load(std::memory_order_relaxed);
+}
+
+void AudioStats::CountUnderrun(void)
+{
+	numUnderruns.fetch_add(1,std::memory_order_relaxed);
+}
+
+void AudioStats::CountOverrun(void)
+{
+	numOverruns.fetch_add(1,std::memory_order_relaxed);
+}
+
+void AudioStats::Clear(void)
+{
+	renderTime.Clear();
+	renderLoad.Clear();
+	streamTime.Clear();
+	activeVoices.Clear();
+	fillLevel.Clear();
+	latency.Clear();
+	numPeriods.store(0,std::memory_order_relaxed);
+	numUnderruns.store(0,std::memory_order_relaxed);
+	numOverruns.store(0,std::memory_order_relaxed);
+	lastFillLevel.store(0,std::memory_order_relaxed);
+}
+
+static void AudioStats_AppendSummaryCSV(std::string &csv,const char name[],const AudioHistogram &hist)
+{
+	char line[256];
+	snprintf(line,sizeof(line),"%s,%llu,%llu,%.1lf,%llu,%llu,%llu,%llu\n",
+	    name,
+	    (unsigned long long)hist.GetCount(),
+	    (unsigned long long)hist.GetMin(),
+	    hist.GetMean(),
+	    (unsigned long long)hist.GetPercentile(0.5),
+	    (unsigned long long)hist.GetPercentile(0.99),
+	    (unsigned long long)hist.GetPercentile(0.999),
+	    (unsigned long long)hist.GetMax());
+	csv+=line;
+}
+
+static void AudioStats_AppendBucketsCSV(std::string &csv,const char name[],const AudioHistogram &hist)
+{
+	for(unsigned int i=0; i<AudioHistogram::NUM_BUCKETS; ++i)
+	{
+		auto n=hist.GetBucketCount(i);
+		if(0<n)
+		{
+			char line[256];
+			snprintf(line,sizeof(line),"%s,%llu,%llu,%llu\n",
+			    name,
+			    (unsigned long long)AudioHistogram::GetBucketLow(i),
+			    (unsigned long long)AudioHistogram::GetBucketHigh(i),
+			    (unsigned long long)n);
+			csv+=line;
+		}
+	}
+}
+
+static void AudioStats_AppendJSON(std::string &json,const char name[],const AudioHistogram &hist)
+{
+	char str[256];
+	snprintf(str,sizeof(str),
+	    ",\n  \"%s\":{\"count\":%llu,\"min\":%llu,\"mean\":%.1lf,\"p50\":%llu,\"p99\":%llu,\"p999\":%llu,\"max\":%llu,\"buckets\":[",
+	    name,
+	    (unsigned long long)hist.GetCount(),
+	    (unsigned long long)hist.GetMin(),
+	    hist.GetMean(),
+	    (unsigned long long)hist.GetPercentile(0.5),
+	    (unsigned long long)hist.GetPercentile(0.99),
+	    (unsigned long long)hist.GetPercentile(0.999),
+	    (unsigned long long)hist.GetMax());
+	json+=str;
+
+	bool first=true;
+	for(unsigned int i=0; i<AudioHistogram::NUM_BUCKETS; ++i)
+	{
+		auto n=hist.GetBucketCount(i);
+		if(0<n)
+		{
+			snprintf(str,sizeof(str),"%s[%llu,%llu,%llu]",
+			    (true==first ? "" : ","),
+			    (unsigned long long)AudioHistogram::GetBucketLow(i),
+			    (unsigned long long)AudioHistogram::GetBucketHigh(i),
+			    (unsigned long long)n);
+			json+=str;
+			first=false;
+		}
+	}
+	json+="]}";
+}
+
+std::string AudioStats::FormatCSV(void) const
+{
+	std::string csv;
+	char line[256];
+	snprintf(line,sizeof(line),"periods,%llu\nunderruns,%llu\noverruns,%llu\n",
+	    (unsigned long long)numPeriods.load(std::memory_order_relaxed),
+	    (unsigned long long)numUnderruns.load(std::memory_order_relaxed),
+	    (unsigned long long)numOverruns.load(std::memory_order_relaxed));
+	csv+=line;
+
+	csv+="histogram,count,min,mean,p50,p99,p999,max\n";
+	AudioStats_AppendSummaryCSV(csv,"renderTimeMicrosec",renderTime);
+	AudioStats_AppendSummaryCSV(csv,"renderLoadPermille",renderLoad);
+	AudioStats_AppendSummaryCSV(csv,"streamTimeMicrosec",streamTime);
+	AudioStats_AppendSummaryCSV(csv,"activeVoices",activeVoices);
+	AudioStats_AppendSummaryCSV(csv,"fillLevelSamples",fillLevel);
+	AudioStats_AppendSummaryCSV(csv,"latencyMicrosec",latency);
+
+	csv+="histogram,low,high,count\n";
+	AudioStats_AppendBucketsCSV(csv,"renderTimeMicrosec",renderTime);
+	AudioStats_AppendBucketsCSV(csv,"renderLoadPermille",renderLoad);
+	AudioStats_AppendBucketsCSV(csv,"streamTimeMicrosec",streamTime);
+	AudioStats_AppendBucketsCSV(csv,"activeVoices",activeVoices);
+	AudioStats_AppendBucketsCSV(csv,"fillLevelSamples",fillLevel);
+	AudioStats_AppendBucketsCSV(csv,"latencyMicrosec",latency);
+	return csv;
+}
+
+std::string AudioStats::FormatJSON(void) const
+{
+	std::string json;
+	char str[256];
+	snprintf(str,sizeof(str),"{\n  \"periods\":%llu,\n  \"underruns\":%llu,\n  \"overruns\":%llu",
+	    (unsigned long long)numPeriods.load(std::memory_order_relaxed),
+	    (unsigned long long)numUnderruns.load(std::memory_order_relaxed),
+	    (unsigned long long)numOverruns.load(std::memory_order_relaxed));
+	json+=str;
+
+	AudioStats_AppendJSON(json,"renderTimeMicrosec",renderTime);
+	AudioStats_AppendJSON(json,"renderLoadPermille",renderLoad);
+	AudioStats_AppendJSON(json,"streamTimeMicrosec",streamTime);
+	AudioStats_AppendJSON(json,"activeVoices",activeVoices);
+	AudioStats_AppendJSON(json,"fillLevelSamples",fillLevel);
+	AudioStats_AppendJSON(json,"latencyMicrosec",latency);
+	json+="\n}\n";
+	return json;
+}
+
+bool AudioStats::Save(const char fn[]) const
+{
+	std::string name(fn);
+	bool json=(5<=name.size() && 0==name.compare(name.size()-5,5,".json"));
+
+	FILE *fp=fopen(fn,"w");
+	if(nullptr==fp)
+	{
+		return false;
+	}
+	auto str=(true==json ? FormatJSON() : FormatCSV());
+	bool ok=(str.size()==fwrite(str.data(),1,str.size(),fp));
+	fclose(fp);
+	return ok;
+}
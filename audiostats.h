@@ -0,0 +1,121 @@
+#ifndef AUDIOSTATS_IS_INCLUDED
+#define AUDIOSTATS_IS_INCLUDED
+/* { */
+
+#include <atomic>
+#include <string>
+#include <cstdint>
+
+/*! Histogram of non-negative integers that can be added from the audio thread while another
+    thread reads it.  Add only increments atomic counters, and never locks or allocates.
+
+    Values below SUB_BUCKETS have their own buckets.  Above that, each power of two is split into
+    SUB_BUCKETS buckets, so that a bucket is within 1/SUB_BUCKETS of its value.
+*/
+class AudioHistogram
+{
+public:
+	enum
+	{
+		SUB_BUCKET_BITS=3,
+		SUB_BUCKETS=1<<SUB_BUCKET_BITS,
+		NUM_BUCKETS=(64-SUB_BUCKET_BITS+1)*SUB_BUCKETS,
+	};
+
+private:
+	std::atomic <uint64_t> bucket[NUM_BUCKETS];
+	std::atomic <uint64_t> count,sum,minValue,maxValue;
+
+	AudioHistogram(const AudioHistogram &);
+	AudioHistogram &operator=(const AudioHistogram &);
+
+public:
+	AudioHistogram();
+
+	/*! Audio thread.
+	*/
+	void Add(uint64_t value);
+
+	/*! Not thread-safe against Add.  Values added at the same time may be lost or half cleared.
+	*/
+	void Clear(void);
+
+	uint64_t GetCount(void) const;
+	uint64_t GetMin(void) const;
+	uint64_t GetMax(void) const;
+	double GetMean(void) const;
+
+	/*! Returns the upper bound of the bucket where the fraction (0.0 to 1.0) of the values fall below.
+	*/
+	uint64_t GetPercentile(double fraction) const;
+
+	uint64_t GetBucketCount(unsigned int bucketIdx) const;
+	static unsigned int GetBucketIndex(uint64_t value);
+	static uint64_t GetBucketLow(unsigned int bucketIdx);
+	static uint64_t GetBucketHigh(unsigned int bucketIdx);  // Inclusive.
+};
+
+/*! Timing of the audio path per period, for telling whether dropouts come from the synthesis load
+    or from sound-effect bursts.
+    AudioMixer records render time, stream time, and event-to-sound latency.  The code that feeds the
+    audio device (feedAudioStream of demo_game.cpp) reports the fill level and underruns/overruns,
+    which only it can see.
+    Everything can be recorded from the audio thread and read from another thread at the same time.
+*/
+class AudioStats
+{
+public:
+	AudioHistogram renderTime;    // Microseconds to mix one period.
+	AudioHistogram renderLoad;    // Render time in 1/1000 of the period length.
+	AudioHistogram streamTime;    // Microseconds in stream sources (YM2612 synthesis, WAV streaming) per period.
+	AudioHistogram activeVoices;  // Voices playing per period.
+	AudioHistogram fillLevel;     // Samples queued in the device when a period is mixed.
+	AudioHistogram latency;       // Microseconds from PlayPCM/PlayStream to when the first sample reaches the speaker.
+
+	std::atomic <uint64_t> numPeriods;
+	std::atomic <uint64_t> numUnderruns;  // Device ran out of samples.
+	std::atomic <uint64_t> numOverruns;   // Period was dropped because the device buffer was full.
+
+private:
+	std::atomic <unsigned int> lastFillLevel;
+
+	AudioStats(const AudioStats &);
+	AudioStats &operator=(const AudioStats &);
+
+public:
+	AudioStats();
+
+	/*! Microseconds of a monotonic clock.
+	*/
+	static uint64_t NowInMicrosec(void);
+
+	/*! Device side.  Number of samples queued in the device before the next period is mixed.
+	*/
+	void SetFillLevel(unsigned int numSamples);
+	unsigned int GetLastFillLevel(void) const;
+
+	/*! Device side.
+	*/
+	void CountUnderrun(void);
+	void CountOverrun(void);
+
+	/*! Not thread-safe against recording.
+	*/
+	void Clear(void);
+
+	/*! One line per non-empty bucket: histogram,low,high,count.
+	    Summary lines (histogram,count,min,mean,p50,p99,p999,max) come first.
+	*/
+	std::string FormatCSV(void) const;
+
+	/*! Counters, and summary and non-empty buckets of each histogram.
+	*/
+	std::string FormatJSON(void) const;
+
+	/*! Saves FormatJSON if the file name ends with .json, FormatCSV otherwise.
+	*/
+	bool Save(const char fn[]) const;
+};
+
+/* } */
+#endif
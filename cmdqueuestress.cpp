@@ -0,0 +1,203 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "mmlplayer.h"
+
+/*
+YM2612::CommandQueue stress test.  Runs without an audio device.
+
+  cmdqueuestress [numBlocks] [samplesPerBlock] [queueCapacity]
+
+The game thread pushes key-on/off and F-number writes for channels 1,2,4,5 into a small queue,
+retrying when the queue is full, and stays at most 16 blocks ahead of queue.GetRenderedSamples().
+The audio thread makes the wave through an MMLPlayer that plays MML on channels 0 and 3 and drains the queue
+by SetCommandQueue, up to samplesPerBlock samples at a time but not past the commands pushed so far.
+The wave is compared with the wave made block by block from the same commands in one thread.
+
+Build with -fsanitize=thread to check the queue for data races, for example:
+
+  g++ -std=c++17 -O1 -g -fsanitize=thread -pthread cmdqueuestress.cpp mmlplayer.cpp audioresampler.cpp
+*/
+
+class QueuedWrite
+{
+public:
+	unsigned long long int sample;
+	unsigned int chBase,reg,value;
+};
+
+static void AddWrite(std::vector <QueuedWrite> &writes,unsigned long long int sample,unsigned int chBase,unsigned int reg,unsigned int value)
+{
+	QueuedWrite w;
+	w.sample=sample;
+	w.chBase=chBase;
+	w.reg=reg;
+	w.value=value;
+	writes.push_back(w);
+}
+
+static std::vector <QueuedWrite> MakeWrites(unsigned long long int numSamples)
+{
+	static const unsigned int queueCh[]={1,2,4,5};
+	std::vector <QueuedWrite> writes;
+
+	// Simple sine-ish tone on each channel.  One write per sample so that a small queue can take them.
+	unsigned long long int sample=0;
+	for(auto ch : queueCh)
+	{
+		unsigned int chBase=(ch<3 ? 0 : 3),chLow=ch%3;
+		AddWrite(writes,sample++,chBase,YM2612::REG_FB_CNCT+chLow,0x07);
+		AddWrite(writes,sample++,chBase,YM2612::REG_LR_AMS_PMS+chLow,0xC0);
+		for(unsigned int slot=0; slot<4; ++slot)
+		{
+			unsigned int slotOffset=chLow+slot*4;
+			AddWrite(writes,sample++,chBase,YM2612::REG_DT_MULTI+slotOffset,0x01);
+			AddWrite(writes,sample++,chBase,YM2612::REG_TL      +slotOffset,(3==slot ? 0x10 : 0x7F));
+			AddWrite(writes,sample++,chBase,YM2612::REG_KS_AR   +slotOffset,0x1F);
+			AddWrite(writes,sample++,chBase,YM2612::REG_AM_DR   +slotOffset,0x08);
+			AddWrite(writes,sample++,chBase,YM2612::REG_SR      +slotOffset,0x04);
+			AddWrite(writes,sample++,chBase,YM2612::REG_SL_RR   +slotOffset,0x2F);
+		}
+	}
+
+	// Notes at pseudo-random intervals, mostly shorter than a block so that blocks carry several writes.
+	uint32_t rnd=12345;
+	for(;;)
+	{
+		rnd=rnd*1103515245+12345;
+		sample+=1+(rnd>>16)%300;
+		if(numSamples<=sample)
+		{
+			break;
+		}
+
+		auto ch=queueCh[(rnd>>8)&3];
+		unsigned int chBase=(ch<3 ? 0 : 3),chLow=ch%3;
+		unsigned int keyOnOffCh=(ch<3 ? ch : ch+1);
+		unsigned int block=2+(rnd>>4)%4;
+		unsigned int fnum=600+(rnd>>20)%500;
+
+		AddWrite(writes,sample,0,YM2612::REG_KEY_ON_OFF,keyOnOffCh);
+		AddWrite(writes,sample,chBase,YM2612::REG_FNUM2+chLow,(block<<3)|(fnum>>8));
+		AddWrite(writes,sample,chBase,YM2612::REG_FNUM1+chLow,fnum&255);
+		AddWrite(writes,sample,0,YM2612::REG_KEY_ON_OFF,0xF0|keyOnOffCh);
+	}
+	return writes;
+}
+
+static void StartMML(MMLPlayer &player)
+{
+	for(int i=0; i<8; ++i)
+	{
+		player.AddMML(0,"T120@3V12O4L8CDEFGAB>C<BAGFEDC");
+		player.AddMML(3,"T120@14V10O3L4CEGEFAGE");
+	}
+}
+
+int main(int ac,char *av[])
+{
+	unsigned int numBlocks=(2<=ac ? atoi(av[1]) : 2000);
+	unsigned int samplesPerBlock=(3<=ac ? atoi(av[2]) : 256);
+	unsigned int queueCapacity=(4<=ac ? atoi(av[3]) : 64);
+
+	// Up to four commands are stamped at the same sample.
+	if(numBlocks<1 || samplesPerBlock<1 || queueCapacity<8)
+	{
+		printf("Usage: cmdqueuestress [numBlocks] [samplesPerBlock] [queueCapacity]\n");
+		return 1;
+	}
+
+	const unsigned long long int numSamples=(unsigned long long int)numBlocks*samplesPerBlock;
+	const unsigned long long int maxAhead=(unsigned long long int)samplesPerBlock*16;
+	auto writes=MakeWrites(numSamples);
+
+	// Reference.  All commands are queued before the wave is made.
+	std::vector <unsigned char> refWave((size_t)numSamples*4);
+	{
+		YM2612::CommandQueue queue(writes.size());
+		for(auto &w : writes)
+		{
+			queue.Push(w.sample,w.chBase,w.reg,w.value);
+		}
+
+		MMLPlayer player;
+		player.SetCommandQueue(&queue);
+		StartMML(player);
+		for(unsigned int b=0; b<numBlocks; ++b)
+		{
+			player.MakeWaveForNSamples(refWave.data()+(size_t)b*samplesPerBlock*4,samplesPerBlock,false);
+		}
+	}
+
+	// Game thread and audio thread.
+	std::vector <unsigned char> wave((size_t)numSamples*4);
+	YM2612::CommandQueue queue(queueCapacity);
+	// Samples before pushedUpTo have all of their commands in the queue.
+	std::atomic <unsigned long long int> pushedUpTo(0);
+	unsigned long long int numFull=0;
+
+	std::thread gameThread([&]
+	{
+		size_t next=0;
+		unsigned long long int stamp=0;
+		while(stamp<numSamples)
+		{
+			// Stamp the next block of commands ahead of the audio thread, as the game would.
+			stamp=std::min(numSamples,queue.GetRenderedSamples()+maxAhead);
+			for(; next<writes.size() && writes[next].sample<stamp; ++next)
+			{
+				auto &w=writes[next];
+				while(true!=queue.Push(w.sample,w.chBase,w.reg,w.value))
+				{
+					++numFull;
+					pushedUpTo.store(w.sample,std::memory_order_release);
+					std::this_thread::yield();
+				}
+			}
+			pushedUpTo.store(stamp,std::memory_order_release);
+			std::this_thread::yield();
+		}
+	});
+
+	std::thread audioThread([&]
+	{
+		MMLPlayer player;
+		player.SetCommandQueue(&queue);
+		StartMML(player);
+		unsigned long long int rendered=0;
+		while(rendered<numSamples)
+		{
+			// A late command would be written at the beginning of the wave, and the wave would not match.
+			// Make the wave only up to the commands in the queue.
+			auto upTo=std::min(numSamples,pushedUpTo.load(std::memory_order_acquire));
+			if(upTo<=rendered)
+			{
+				std::this_thread::yield();
+				continue;
+			}
+			auto n=std::min<unsigned long long int>(upTo-rendered,samplesPerBlock);
+			player.MakeWaveForNSamples(wave.data()+(size_t)rendered*4,n,false);
+			rendered+=n;
+		}
+	});
+
+	gameThread.join();
+	audioThread.join();
+
+	printf("Blocks:%u  Samples/Block:%u  Queue capacity:%u  Commands:%u  Queue full:%llu times\n",
+	    numBlocks,samplesPerBlock,queueCapacity,(unsigned int)writes.size(),numFull);
+
+	for(size_t i=0; i<wave.size(); ++i)
+	{
+		if(wave[i]!=refWave[i])
+		{
+			printf("Mismatch at sample %llu\n",(unsigned long long int)(i/4));
+			return 1;
+		}
+	}
+	printf("Identical to the single-thread wave.\n");
+	return 0;
+}
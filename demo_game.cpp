@@ -1,6 +1,10 @@
 #include "ysglfontdata.h"
 #include "fssimplewindow.h"
 #include "yssimplesound.h"
+#include "audiomixer.h"
+#include "audiostats.h"
+#include "sfxplayer.h"
+#include "wavstream.h"
 #include <vector>
 #include <cmath>
 #include <cstdlib> // for rand and srand
@@ -32,6 +36,8 @@ const int WALL_GAP = WINDOW_HEIGHT - WINDOW_HEIGHT / 3; // Distance between sets
 const double SPEED = 1.5; // Define the speed of the walls and enemies
 double globalSpeedMultiplier = 1;
 
+const unsigned int AUDIO_SEGMENT_MILLISEC = 40; // Length of the mixed wave given to the sound player at a time
+
 class SpeedPowerUp {
 public:
     double x, y; // position of the speed up
@@ -382,6 +388,49 @@ void generateSet(std::vector<Wall>& walls, std::vector<Enemy>& enemies, std::vec
 
 }
 
+// The stream player does not tell how many samples it has queued.  They are counted here
+// as the samples given to the player minus the samples that the clock says have been played.
+struct AudioFeedState {
+    uint64_t startMicrosec = 0; // When the first sample given after startMicrosec starts playing
+    uint64_t numGiven = 0;      // Samples given to the player since startMicrosec
+};
+
+// Mixes the next segment and gives it to the stream player when the player can take it.
+// The device queue depth, underruns, and dropped segments are recorded in stats.
+void feedAudioStream(YsSoundPlayer &player, YsSoundPlayer::Stream &stream, AudioMixer &mixer,
+                     AudioStats &stats, AudioFeedState &feed) {
+    YsSoundPlayer::SoundData segment;
+    if (YSTRUE == player.StreamPlayerReadyToAcceptNextSegment(stream, segment)) {
+        const unsigned int numSamples = mixer.GetSamplingRate() * AUDIO_SEGMENT_MILLISEC / 1000;
+
+        const uint64_t now = AudioStats::NowInMicrosec();
+        const uint64_t numPlayed = (now - feed.startMicrosec) * mixer.GetSamplingRate() / 1000000;
+        if (0 < feed.numGiven && feed.numGiven < numPlayed) {
+            // The player ran out of samples before this segment.  Count from now again.
+            stats.CountUnderrun();
+            feed.numGiven = 0;
+        }
+        if (0 == feed.numGiven) {
+            feed.startMicrosec = now;
+            stats.SetFillLevel(0);
+        }
+        else {
+            stats.SetFillLevel((unsigned int)(feed.numGiven - numPlayed));
+        }
+
+        std::vector<unsigned char> wave(numSamples * 4);
+        mixer.Mix((int16_t *)wave.data(), numSamples);
+        segment.CreateFromSigned16bitStereo(mixer.GetSamplingRate(), wave);
+        if (YSOK == player.AddNextStreamingSegment(stream, segment)) {
+            feed.numGiven += numSamples;
+        }
+        else {
+            // The player did not take the mixed period, and it is lost.
+            stats.CountOverrun();
+        }
+    }
+}
+
 int main() {
     bool gameEnded = false;
 
@@ -391,18 +440,26 @@ int main() {
     int enemiesDefeated = 0; // eneny defeated
 
     YsSoundPlayer player;
-    YsSoundPlayer::SoundData bgmData;
 
-    if (YSOK != bgmData.LoadWav("source/bgm.wav")) {
+    // Background music is streamed from the mapped file, so that it is not loaded in memory.
+    WavStream bgm;
+    if (true != bgm.Open("source/bgm.wav")) {
         printf("Failed to read background music\n");
         return 1;
     }
-
-    YsSoundPlayer::SoundData hitSound;
-    if (YSOK != hitSound.LoadWav("source/hit.wav")) {
-        printf("Failed to read hit sound\n");
-        return 1;
-    }
+    bgm.SetLoop(true);
+
+    // The mixer runs at the rate of the music.  Sound effects are synthesized by SFXPlayer at the same rate.
+    AudioMixer mixer(AudioMixer::NUM_VOICES_DEFAULT, bgm.GetSamplingRate());
+    mixer.PlayStream(&bgm);
+    SFXPlayer sfx;
+    sfx.SetSamplingRate(mixer.GetSamplingRate());
+    SFXPlayerSource sfxSource(&sfx);
+    mixer.PlayStream(&sfxSource);
+    AudioStats audioStats;
+    mixer.SetStats(&audioStats);
+    AudioFeedState audioFeed;
+    YsSoundPlayer::Stream audioStream;
 
     srand(time(0)); // Seed the random number generator
     int windowWidth = WINDOW_WIDTH;
@@ -438,8 +495,9 @@ int main() {
 
     // play music
     player.Start();
-    player.PlayBackground(bgmData);
+    player.StartStreaming(audioStream);
     while (FsInkey() != FSKEY_ESC) {
+        feedAudioStream(player, audioStream, mixer, audioStats, audioFeed);
 
         if (gameEnded) {
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -595,6 +653,7 @@ int main() {
                     abs(soldier.y - bulletSpeedPowerUp.y) < bulletSpeedPowerUp.radius) {
                     bulletShootingFrequency = std::max(100, bulletShootingFrequency - 100);
                     bulletSpeedPowerUpVisible = false;
+                    sfx.Play(SFXPlayer::SFX_POWER_UP);
                     break;
                 }
             }
@@ -632,6 +691,7 @@ int main() {
         }
 
         if (speedupflag == true) {
+            sfx.Play(SFXPlayer::SFX_POWER_UP);
             globalSpeedMultiplier *= 1.25;
             if (globalSpeedMultiplier > 4) {
                 globalSpeedMultiplier = 4;
@@ -654,7 +714,7 @@ int main() {
                     isHit = true;
                     jt = enemies.erase(jt);
 
-                    player.PlayOneShot(hitSound);
+                    sfx.Play(SFXPlayer::SFX_HIT);
                     enemiesDefeated++;
                 }
                 else {
@@ -808,6 +868,7 @@ int main() {
             if (wall.isPassed && !wall.operationPerformed && soldiers.size() > 0 && soldiers[0].y <= wall.y1 && soldiers[0].x >= wall.x1 && soldiers[0].x <= wall.x2) {
                 int numSoldiers = soldiers.size();
                 int newNumSoldiers = wall.performOperation(numSoldiers);
+                sfx.Play(SFXPlayer::SFX_WALL_ADD + wall.operation); // Effects are in the order of the operations
 
                 // Add new soldiers if the number of soldiers increased
                 while (soldiers.size() < newNumSoldiers) {
@@ -909,6 +970,16 @@ int main() {
         FsSwapBuffers();
         FsSleep(25);
     }
+    player.StopStreaming(audioStream);
     player.End();
+
+    // Timing of the audio path, for telling where dropouts came from.
+    printf("Audio: %llu periods  %llu underruns  %llu overruns  Render p99 %lluus  Latency p99 %lluus\n",
+           (unsigned long long)audioStats.numPeriods.load(),
+           (unsigned long long)audioStats.numUnderruns.load(),
+           (unsigned long long)audioStats.numOverruns.load(),
+           (unsigned long long)audioStats.renderTime.GetPercentile(0.99),
+           (unsigned long long)audioStats.latency.GetPercentile(0.99));
+    audioStats.Save("audiostats.csv");
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,138 @@
+#include "mappedfile.h"
+
+#ifdef _WIN32
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
+
+
+
+MappedFile::MappedFile()
+{
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Open(const char fn[])
+{
+	Close();
+
+#ifdef _WIN32
+	HANDLE file=CreateFileA(fn,GENERIC_READ,FILE_SHARE_READ,NULL,OPEN_EXISTING,FILE_FLAG_SEQUENTIAL_SCAN,NULL);
+	if(INVALID_HANDLE_VALUE==file)
+	{
+		return false;
+	}
+	LARGE_INTEGER fileSize;
+	if(TRUE!=GetFileSizeEx(file,&fileSize) || 0==fileSize.QuadPart)
+	{
+		CloseHandle(file);
+		return false;
+	}
+	HANDLE mapping=CreateFileMappingA(file,NULL,PAGE_READONLY,0,0,NULL);
+	if(NULL==mapping)
+	{
+		CloseHandle(file);
+		return false;
+	}
+	void *ptr=MapViewOfFile(mapping,FILE_MAP_READ,0,0,0);
+	if(NULL==ptr)
+	{
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+	hFile=file;
+	hMapping=mapping;
+	dat=(const unsigned char *)ptr;
+	size=(size_t)fileSize.QuadPart;
+#else
+	int fd=open(fn,O_RDONLY);
+	if(fd<0)
+	{
+		return false;
+	}
+	struct stat st;
+	if(0!=fstat(fd,&st) || 0==st.st_size)
+	{
+		close(fd);
+		return false;
+	}
+	void *ptr=mmap(nullptr,(size_t)st.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+	close(fd);  // Mapping stays valid after closing the file.
+	if(MAP_FAILED==ptr)
+	{
+		return false;
+	}
+	madvise(ptr,(size_t)st.st_size,MADV_SEQUENTIAL);
+	dat=(const unsigned char *)ptr;
+	size=(size_t)st.st_size;
+#endif
+	return true;
+}
+
+void MappedFile::Close(void)
+{
+	if(nullptr!=dat)
+	{
+	#ifdef _WIN32
+		UnmapViewOfFile(dat);
+		CloseHandle((HANDLE)hMapping);
+		CloseHandle((HANDLE)hFile);
+		hMapping=nullptr;
+		hFile=nullptr;
+	#else
+		munmap((void *)dat,size);
+	#endif
+	}
+	dat=nullptr;
+	size=0;
+}
+
+bool MappedFile::IsOpen(void) const
+{
+	return nullptr!=dat;
+}
+
+const unsigned char *MappedFile::GetData(void) const
+{
+	return dat;
+}
+
+size_t MappedFile::GetSize(void) const
+{
+	return size;
+}
+
+size_t MappedFile::ReleasePages(size_t from,size_t to)
+{
+#ifdef _WIN32
+	SYSTEM_INFO sysInfo;
+	GetSystemInfo(&sysInfo);
+	const size_t pageSize=(size_t)sysInfo.dwPageSize;
+#else
+	const size_t pageSize=(size_t)sysconf(_SC_PAGESIZE);
+#endif
+	from=from/pageSize*pageSize;
+	to=to/pageSize*pageSize;
+	if(nullptr!=dat && from<to && to<=size)
+	{
+	#ifdef _WIN32
+		// Unlocking pages that are not locked removes them from the working set.
+		VirtualUnlock((LPVOID)(dat+from),to-from);
+	#else
+		madvise((void *)(dat+from),to-from,MADV_DONTNEED);
+	#endif
+	}
+	return to;
+}
@@ -0,0 +1,51 @@
+#ifndef MAPPEDFILE_IS_INCLUDED
+#define MAPPEDFILE_IS_INCLUDED
+/* { */
+
+#include <cstddef>
+
+/*! Read-only memory map of a whole file.  Used by the PNG decoder and WavStream.
+    The OS is told that the file is read sequentially.
+*/
+class MappedFile
+{
+private:
+	const unsigned char *dat=nullptr;
+	size_t size=0;
+#ifdef _WIN32
+	void *hFile=nullptr,*hMapping=nullptr;
+#endif
+
+	MappedFile(const MappedFile &);
+	MappedFile &operator=(const MappedFile &);
+
+public:
+	MappedFile();
+	~MappedFile();
+
+	/*! Maps the file.  Returns false if the file cannot be opened or mapped, or if it is empty.
+	*/
+	bool Open(const char fn[]);
+
+	/*!
+	*/
+	void Close(void);
+
+	/*!
+	*/
+	bool IsOpen(void) const;
+
+	/*! Returns nullptr if the file is not open.
+	*/
+	const unsigned char *GetData(void) const;
+	size_t GetSize(void) const;
+
+	/*! Returns the pages between the offsets from and to to the OS.  from and to are rounded down to the page size.
+	    The data stays readable.  The pages are read from the file again if touched.
+	    Returns the offset up to which the pages are released.
+	*/
+	size_t ReleasePages(size_t from,size_t to);
+};
+
+/* } */
+#endif
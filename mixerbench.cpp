@@ -0,0 +1,128 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+#include "audiomixer.h"
+#include "audiostats.h"
+#include "sfxplayer.h"
+
+/*
+Mixer benchmark.  Runs without an audio device.
+
+  mixerbench [numVoices] [numPeriods] [samplesPerPeriod] [output.wav] [stats.csv|stats.json]
+
+numVoices-1 looping PCM voices of the sound effects with different gains and offsets,
+plus one SFXPlayer stream triggering a hit every 10 periods, are mixed.
+Mixing time per period is printed.  If output.wav is given, the mix is saved.
+If a stats file is given, AudioStats histograms are saved as CSV, or JSON if it ends with .json.
+*/
+
+int main(int ac,char *av[])
+{
+	unsigned int numVoices=(2<=ac ? atoi(av[1]) : 64);
+	unsigned int numPeriods=(3<=ac ? atoi(av[2]) : 2000);
+	unsigned int samplesPerPeriod=(4<=ac ? atoi(av[3]) : 512);
+	const char *outFn=(5<=ac ? av[4] : nullptr);
+	const char *statsFn=(6<=ac ? av[5] : nullptr);
+
+	if(numVoices<1 || numPeriods<1 || samplesPerPeriod<1)
+	{
+		printf("Usage: mixerbench [numVoices] [numPeriods] [samplesPerPeriod] [output.wav] [stats.csv|stats.json]\n");
+		return 1;
+	}
+
+	// Render each effect once as PCM.
+	std::vector <std::vector <int16_t> > pcm;
+	for(int sfx=0; sfx<SFXPlayer::NUM_SFX; ++sfx)
+	{
+		SFXPlayer player;
+		player.Play(sfx);
+		auto wave=player.GenerateWave(400);
+
+		std::vector <int16_t> stereo;
+		stereo.resize(wave.size()/2);
+		for(size_t i=0; i<stereo.size(); ++i)
+		{
+			stereo[i]=(int16_t)(wave[i*2]|(wave[i*2+1]<<8));
+		}
+		pcm.push_back(stereo);
+	}
+
+	AudioMixer mixer(numVoices);
+	AudioStats stats;
+	mixer.SetStats(&stats);
+
+	SFXPlayer sfxStream;
+	SFXPlayerSource sfxSource(&sfxStream);
+	mixer.PlayStream(&sfxSource);
+
+	for(unsigned int i=1; i<numVoices; ++i)
+	{
+		auto &src=pcm[i%pcm.size()];
+		int gain=AudioMixer::GAIN_ONE/4+(i*997)%AudioMixer::GAIN_ONE;
+		auto offset=(i*7919)%(src.size()/2);
+		// Loop from an offset so that the voices are not aligned.
+		mixer.PlayPCM(src.data()+offset*2,src.size()/2-offset,true,gain);
+	}
+
+	std::vector <int16_t> period,all;
+	period.resize(samplesPerPeriod*2);
+	if(nullptr!=outFn)
+	{
+		all.reserve((size_t)numPeriods*samplesPerPeriod*2);
+	}
+
+	long long int totalNanosec=0,maxNanosec=0;
+	for(unsigned int p=0; p<numPeriods; ++p)
+	{
+		if(0==p%10)
+		{
+			sfxStream.Play(SFXPlayer::SFX_HIT);
+		}
+
+		auto t0=std::chrono::high_resolution_clock::now();
+		mixer.Mix(period.data(),samplesPerPeriod);
+		auto t1=std::chrono::high_resolution_clock::now();
+
+		auto nanosec=std::chrono::duration_cast<std::chrono::nanoseconds>(t1-t0).count();
+		totalNanosec+=nanosec;
+		maxNanosec=std::max<long long int>(maxNanosec,nanosec);
+
+		if(nullptr!=outFn)
+		{
+			all.insert(all.end(),period.begin(),period.end());
+		}
+	}
+
+	double periodSec=(double)samplesPerPeriod/(double)mixer.GetSamplingRate();
+	double avgSec=(double)totalNanosec/(double)numPeriods/1000000000.0;
+	printf("Voices:%u  Periods:%u  Samples/Period:%u\n",mixer.GetNumActiveVoices(),numPeriods,samplesPerPeriod);
+	printf("Average %.1lfus  Max %.1lfus per period (%.2lf%% of the period)\n",
+	    avgSec*1000000.0,(double)maxNanosec/1000.0,100.0*avgSec/periodSec);
+	printf("p50 %lluus  p99 %lluus  p99.9 %lluus  Stream sources %.1lfus on average\n",
+	    (unsigned long long)stats.renderTime.GetPercentile(0.5),
+	    (unsigned long long)stats.renderTime.GetPercentile(0.99),
+	    (unsigned long long)stats.renderTime.GetPercentile(0.999),
+	    stats.streamTime.GetMean());
+
+	if(nullptr!=statsFn)
+	{
+		if(true!=stats.Save(statsFn))
+		{
+			printf("Cannot write %s\n",statsFn);
+			return 1;
+		}
+		printf("Saved %s\n",statsFn);
+	}
+
+	if(nullptr!=outFn)
+	{
+		if(true!=AudioMixer::SaveWav(outFn,all,mixer.GetSamplingRate()))
+		{
+			printf("Cannot write %s\n",outFn);
+			return 1;
+		}
+		printf("Saved %s\n",outFn);
+	}
+	return 0;
+}
@@ -0,0 +1,392 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include "mmlplayer.h"
+#include "audiomixer.h"
+
+/*
+Offline MML to WAV renderer.
+
+  mml2wav [options]
+    -ch N MML     MML for channel N (0 to 5).  Rendered by MMLPlayer.
+    -seg MML      Adds a segment.  MML of the channels are separated by '|'.  Rendered by MMLSegmentPlayer.
+    -segfile FILE Adds segments from a file.  One segment per line in the same format as -seg.
+    -fmb FILE     FMB (tone definition, 6152 bytes).  Default FMB is used if not given.
+    -o FILE       Writes 16-bit stereo WAV.
+    -rate N       Output sampling rate.  Default 44100.
+    -synth N      YM2612 sampling rate.  If different from -rate, the wave is resampled.  Default same as -rate.
+    -native       Same as -synth 50000 (YM2612::NATIVE_SAMPLING_RATE).
+    -repeat N     Renders N times and reports the best time.
+    -bench        Renders the built-in corpus and reports the performance of each piece.
+                  The corpus is rendered at 44100Hz directly, at 48000Hz directly, and from the native rate to 48000Hz.
+
+Rendering time, samples per second, and realtime factor are printed.
+*/
+
+
+
+class MMLPiece
+{
+public:
+	const char *label;
+	bool segmented;
+	std::vector <std::string> mml;  // Channels, or segments separated by '|'.
+};
+
+class SamplingRate
+{
+public:
+	unsigned int output=YM2612::WAVE_SAMPLING_RATE;
+	unsigned int synthesis=0;  // 0 means same as output.
+};
+
+// Fixed corpus for tracking the performance.  Don't change, or the numbers won't be comparable.
+static std::vector <MMLPiece> MakeCorpus(void)
+{
+	std::vector <MMLPiece> corpus;
+
+	MMLPiece piece;
+
+	piece.label="sparse-melody";
+	piece.segmented=false;
+	piece.mml={
+		"T100@1V13L4O4CR8DR8ER8FR8GR2AR2BR2>C1R1",
+	};
+	corpus.push_back(piece);
+
+	piece.label="six-channel";
+	piece.segmented=false;
+	piece.mml={
+		"T150@1V15L16O5C4E4G4>C2<B-8A8G8&G8F8E8D8C2R4C4E4G4>C2<B-8A8G8&G8F8E8D8C2R4",
+		"T150@13O2L8CCGGAAG4FFEEDDC4CCGGAAG4FFEEDDC4",
+		"T150@14L16O3CRCRCRCRC8C8R4CRCRCRCRC8C8R4CRCRCRCRC8C8R4",
+		"T150@3O4Q4L32CDEFGAB>CDEFGAB>C<<CDEFGAB>CDEFGAB>C",
+		"T150@16O6L4C.D.E.F.C.D.E.F.",
+		"T150@5O5V8L64CDEFGAB>CDEFGAB>CDEFGAB>C<<<CDEFGAB>CDEFGAB>CDEFGAB>C",
+	};
+	corpus.push_back(piece);
+
+	piece.label="dense-L64";
+	piece.segmented=false;
+	piece.mml={
+		"T240@2V13L64O4CDEFGAB>CDEFGAB>CDEFGAB>C<<<CDEFGAB>CDEFGAB>CDEFGAB>C<<<CDEFGAB>CDEFGAB>CDEFGAB>C<<<CDEFGAB>CDEFGAB>CDEFGAB>C",
+		"T240@10V12L64O3C>C<C>C<C>C<C>C<C>C<C>C<C>C<C>C<C>C<C>C<C>C<C>C<C>C<C>C<C>C<C>C<C>C<C>C<C>C<C>C<C>C<C>C<C>C<C>C<C>C",
+		"T240@27V12L64O5CEGCEGCEGCEGCEGCEGCEGCEGCEGCEGCEGCEGCEGCEGCEGCEGCEGCEGCEGCEGCEGCEGCEG",
+	};
+	corpus.push_back(piece);
+
+	piece.label="segments";
+	piece.segmented=true;
+	piece.mml={
+		"T150@1V15L16O5C4E4G4>C2<B-8A8G8&G8F8E8D8C2R4|T150@13O2L8CCGGAAG4FFEEDDC4|T150@14L16O3CRCRCRCRC8C8R4",
+		"T120L8O4CDEFGAB>C|T120L8O3@2EGB>DF#A",
+		"C4E4G4>C2<B-8A8G8&G8F8E8D8C2R4|CCGGAAG4FFEEDDC4|CRCRCRCRC8C8R4",
+		"O4CDEFGAB>C|O3EGB>DF#A",
+	};
+	corpus.push_back(piece);
+
+	return corpus;
+}
+
+static std::vector <std::string> SplitSegment(const std::string &seg)
+{
+	std::vector <std::string> ch;
+	ch.push_back("");
+	for(auto c : seg)
+	{
+		if('|'==c)
+		{
+			ch.push_back("");
+		}
+		else if('\r'!=c && '\n'!=c)
+		{
+			ch.back().push_back(c);
+		}
+	}
+	return ch;
+}
+
+/*! Renders the piece and returns the wave.  Returns false if the MML has an error.
+*/
+static bool Render(std::vector <unsigned char> &wave,const MMLPiece &piece,const std::vector <unsigned char> &fmb,SamplingRate rate)
+{
+	const uint64_t periodInMillisec=100;
+	wave.clear();
+	if(true!=piece.segmented)
+	{
+		MMLPlayer player;
+		player.SetSamplingRate(rate.output,rate.synthesis);
+		if(0<fmb.size())
+		{
+			player.LoadFMB(fmb.data());
+		}
+		for(unsigned int ch=0; ch<piece.mml.size() && ch<MMLPlayer::NUM_CHANNELS; ++ch)
+		{
+			if(true!=player.AddMML(ch,piece.mml[ch]))
+			{
+				for(auto str : player.GetLastError().Format())
+				{
+					printf("%s\n",str.c_str());
+				}
+				return false;
+			}
+		}
+		while(true!=player.PlayDone())
+		{
+			auto wavePiece=player.GenerateWave(periodInMillisec);
+			if(0==wavePiece.size())
+			{
+				break;
+			}
+			wave.insert(wave.end(),wavePiece.begin(),wavePiece.end());
+		}
+	}
+	else
+	{
+		MMLSegmentPlayer player;
+		player.SetWaveCacheBudget(0);  // Measure the synthesis.
+		player.SetSamplingRate(rate.output,rate.synthesis);
+		if(0<fmb.size())
+		{
+			player.LoadFMB(fmb.data());
+		}
+		for(auto &seg : piece.mml)
+		{
+			auto ch=SplitSegment(seg);
+			ch.resize(MMLPlayer::NUM_CHANNELS);
+			if(true!=player.AddSegment(ch[0],ch[1],ch[2],ch[3],ch[4],ch[5]))
+			{
+				for(auto str : player.GetLastError().Format())
+				{
+					printf("%s\n",str.c_str());
+				}
+				return false;
+			}
+		}
+		while(true!=player.PlayDone())
+		{
+			auto wavePiece=player.GenerateWave(periodInMillisec);
+			wave.insert(wave.end(),wavePiece.begin(),wavePiece.end());
+		}
+	}
+	return true;
+}
+
+/*! Renders the piece repeat times, and prints the best time.
+*/
+static bool RenderAndReport(std::vector <unsigned char> &wave,const MMLPiece &piece,const std::vector <unsigned char> &fmb,SamplingRate rate,int repeat)
+{
+	double bestSec=0.0;
+	for(int i=0; i<repeat; ++i)
+	{
+		auto t0=std::chrono::high_resolution_clock::now();
+		if(true!=Render(wave,piece,fmb,rate))
+		{
+			return false;
+		}
+		auto t1=std::chrono::high_resolution_clock::now();
+		double sec=(double)std::chrono::duration_cast<std::chrono::microseconds>(t1-t0).count()/1000000.0;
+		if(0==i || sec<bestSec)
+		{
+			bestSec=sec;
+		}
+	}
+
+	const double numSamples=(double)(wave.size()/4);
+	const double lengthSec=numSamples/(double)rate.output;
+	bestSec=(0.0<bestSec ? bestSec : 0.000001);
+	printf("%-16s %10.0lf samples %8.3lfs audio %9.3lfms %12.0lf samples/s  realtime x%.1lf\n",
+	    piece.label,numSamples,lengthSec,bestSec*1000.0,numSamples/bestSec,lengthSec/bestSec);
+	return true;
+}
+
+int main(int ac,char *av[])
+{
+	MMLPiece piece;
+	piece.label="input";
+	piece.segmented=false;
+
+	std::vector <unsigned char> fmb;
+	const char *outFn=nullptr;
+	int repeat=1;
+	bool bench=false;
+	SamplingRate rate;
+
+	for(int i=1; i<ac; ++i)
+	{
+		std::string opt=av[i];
+		if(("-ch"==opt && true==piece.segmented) ||
+		   (("-seg"==opt || "-segfile"==opt) && true!=piece.segmented && 0<piece.mml.size()))
+		{
+			printf("-ch cannot be used with -seg or -segfile.\n");
+			return 1;
+		}
+
+		if("-ch"==opt && i+2<ac)
+		{
+			unsigned int ch=atoi(av[i+1]);
+			if(MMLPlayer::NUM_CHANNELS<=ch)
+			{
+				printf("Channel must be 0 to %d.\n",MMLPlayer::NUM_CHANNELS-1);
+				return 1;
+			}
+			if(piece.mml.size()<=ch)
+			{
+				piece.mml.resize(ch+1);
+			}
+			piece.mml[ch]=av[i+2];
+			i+=2;
+		}
+		else if("-seg"==opt && i+1<ac)
+		{
+			piece.segmented=true;
+			piece.mml.push_back(av[i+1]);
+			++i;
+		}
+		else if("-segfile"==opt && i+1<ac)
+		{
+			FILE *fp=fopen(av[i+1],"r");
+			if(nullptr==fp)
+			{
+				printf("Cannot open %s\n",av[i+1]);
+				return 1;
+			}
+			piece.segmented=true;
+			char str[4096];
+			while(nullptr!=fgets(str,4095,fp))
+			{
+				std::string line=str;
+				while(0<line.size() && ('\n'==line.back() || '\r'==line.back()))
+				{
+					line.pop_back();
+				}
+				if(0<line.size())
+				{
+					piece.mml.push_back(line);
+				}
+			}
+			fclose(fp);
+			++i;
+		}
+		else if("-fmb"==opt && i+1<ac)
+		{
+			FILE *fp=fopen(av[i+1],"rb");
+			if(nullptr==fp)
+			{
+				printf("Cannot open %s\n",av[i+1]);
+				return 1;
+			}
+			fmb.resize(MMLPlayer::sizeof_defaultFMB);
+			if(1!=fread(fmb.data(),fmb.size(),1,fp))
+			{
+				printf("%s is not an FMB.\n",av[i+1]);
+				fclose(fp);
+				return 1;
+			}
+			fclose(fp);
+			++i;
+		}
+		else if("-o"==opt && i+1<ac)
+		{
+			outFn=av[i+1];
+			++i;
+		}
+		else if("-rate"==opt && i+1<ac)
+		{
+			rate.output=atoi(av[i+1]);
+			++i;
+		}
+		else if("-synth"==opt && i+1<ac)
+		{
+			rate.synthesis=atoi(av[i+1]);
+			++i;
+		}
+		else if("-native"==opt)
+		{
+			rate.synthesis=YM2612::NATIVE_SAMPLING_RATE;
+		}
+		else if("-repeat"==opt && i+1<ac)
+		{
+			repeat=std::max(1,atoi(av[i+1]));
+			++i;
+		}
+		else if("-bench"==opt)
+		{
+			bench=true;
+		}
+		else
+		{
+			printf("Unknown option or missing parameter: %s\n",av[i]);
+			printf("Usage: mml2wav [-ch N MML]... [-seg MML|MML...]... [-segfile FILE] [-fmb FILE] [-o FILE] [-rate N] [-synth N|-native] [-repeat N] [-bench]\n");
+			return 1;
+		}
+	}
+
+	std::vector <unsigned char> wave;
+	if(true==bench)
+	{
+		SamplingRate benchRate[3];
+		benchRate[0].output=YM2612::WAVE_SAMPLING_RATE;
+		benchRate[1].output=48000;
+		benchRate[2].output=48000;
+		benchRate[2].synthesis=YM2612::NATIVE_SAMPLING_RATE;
+		for(auto r : benchRate)
+		{
+			if(0==r.synthesis)
+			{
+				printf("Output %uHz, synthesized directly\n",r.output);
+			}
+			else
+			{
+				printf("Output %uHz, synthesized at %uHz and resampled\n",r.output,r.synthesis);
+			}
+
+			double totalSamples=0.0;
+			auto t0=std::chrono::high_resolution_clock::now();
+			for(auto &p : MakeCorpus())
+			{
+				if(true!=RenderAndReport(wave,p,fmb,r,repeat))
+				{
+					return 1;
+				}
+				totalSamples+=(double)(wave.size()/4)*repeat;
+			}
+			auto t1=std::chrono::high_resolution_clock::now();
+			double sec=(double)std::chrono::duration_cast<std::chrono::microseconds>(t1-t0).count()/1000000.0;
+			printf("Total %.0lf samples in %.3lfs, %.0lf samples/s\n",totalSamples,sec,totalSamples/sec);
+		}
+	}
+
+	if(0<piece.mml.size())
+	{
+		if(true!=RenderAndReport(wave,piece,fmb,rate,repeat))
+		{
+			return 1;
+		}
+		if(nullptr!=outFn)
+		{
+			// Same writer as the mixer.  The wave is little-endian 16-bit stereo.
+			std::vector <int16_t> stereo(wave.size()/2);
+			for(size_t i=0; i<stereo.size(); ++i)
+			{
+				stereo[i]=(int16_t)(wave[i*2]|(wave[i*2+1]<<8));
+			}
+			if(true!=AudioMixer::SaveWav(outFn,stereo,rate.output))
+			{
+				printf("Cannot write %s\n",outFn);
+				return 1;
+			}
+			printf("Saved %s\n",outFn);
+		}
+	}
+	else if(true!=bench)
+	{
+		printf("No MML.\n");
+		return 1;
+	}
+	return 0;
+}
@@ -1,6 +1,7 @@
 #include <iostream>
 #include <algorithm>
 #include <cstring>
+#include <cmath>
 #include "mmlplayer.h"
 
 
@@ -51,12 +52,12 @@ void MMLPlayer::Channel::Clear(void)
 	// noteLength=NOTE_LENGTH_DEFAULT;
 
 	ptr.Clear();
-	mml="";
+	compiled.Clear();
 }
 
-bool MMLPlayer::Channel::PlayDone(void) const
+bool MMLPlayer::Channel::PlayDone(uint64_t timeInMicrosec) const
 {
-	return mml.size()<=ptr.pos && INFINITE==ptr.toneEndAtInMicrosec;
+	return compiled.events.size()<=ptr.pos && compiled.lengthInMicrosec<=timeInMicrosec;
 }
 
 
@@ -68,8 +69,18 @@ bool MMLPlayer::Channel::PlayDone(void) const
 void MMLPlayer::PlayPointer::Clear(void)
 {
 	pos=0;
-	keyOffAtInMicrosec=INFINITE;
-	toneEndAtInMicrosec=INFINITE;
+}
+
+
+
+////////////////////////////////////////////////////////////
+
+
+
+void MMLPlayer::CompiledMML::Clear(void)
+{
+	events.clear();
+	lengthInMicrosec=0;
 }
 
 
@@ -120,14 +131,22 @@ void MMLPlayer::Clear(void)
 	for(int chNum=0; chNum<NUM_CHANNELS; ++chNum)
 	{
 		mute[chNum]=false;
-		ReapplyEnvelope(chNum);
+		ReapplyEnvelope(chNum,channels[chNum].mmlState.instNum,channels[chNum].mmlState.volume);
 	}
 }
 
 bool MMLPlayer::LoadFMB(const unsigned char fmb[6152])
 {
+	ClearKeyframes();
 	fmbName="";
 
+	fmbHash=0xcbf29ce484222325ULL;
+	for(int i=0; i<6152; ++i)
+	{
+		fmbHash^=fmb[i];
+		fmbHash*=0x100000001b3ULL;
+	}
+
 	for(int i=0; i<8 && 0!=fmb[i]; ++i)
 	{
 		fmbName.push_back((char)fmb[i]);
@@ -171,122 +190,356 @@ bool MMLPlayer::LoadFMB(const unsigned char fmb[6152])
 
 		fmb+=48;
 	}
+
+	for(int instNum=0; instNum<128; ++instNum)
+	{
+		CompileInst(compiledInst[instNum],inst[instNum]);
+	}
 	return true;
 }
 
+void MMLPlayer::CompileInst(CompiledInst &compiled,const FMInst &ist)
+{
+	for(int slot=0; slot<4; ++slot)
+	{
+		compiled.value[slot   ]=ist.DT_MULTI[slot];
+		compiled.value[slot+ 4]=ist.TL[slot];
+		compiled.value[slot+ 8]=ist.KS_AR[slot];
+		compiled.value[slot+12]=ist.AMON_DR[slot];
+		compiled.value[slot+16]=ist.SR[slot];
+		compiled.value[slot+20]=ist.SL_RR[slot];
+		compiled.value[slot+24]=0;  // SSG_EG
+	}
+	compiled.value[28]=ist.FB_CNCT;
+	compiled.value[29]=ist.LR_AMS_PMS;
+
+	// Keep the storage.  The synth may still point to it.
+	for(auto &e : compiled.envelope)
+	{
+		e.Clear();
+	}
+}
+
+template <class T>
+static inline void MMLPlayer_AppendToKey(std::string &key,T value)
+{
+	for(size_t i=0; i<sizeof(T); ++i)
+	{
+		key.push_back((char)(value>>(i*8)));
+	}
+}
+
+std::string MMLPlayer::GetSynthStateKey(void) const
+{
+	auto key=GetPlaybackSettingKey();
+	auto ymKey=ym2612.GetStateKey();
+	key.insert(key.end(),ymKey.begin(),ymKey.end());
+	return key;
+}
+
+std::string MMLPlayer::GetPlaybackSettingKey(void) const
+{
+	std::string key;
+	MMLPlayer_AppendToKey(key,fmbHash);
+	for(auto m : mute)
+	{
+		MMLPlayer_AppendToKey(key,(unsigned int)m);
+	}
+	MMLPlayer_AppendToKey(key,outputSamplingRate);
+	MMLPlayer_AppendToKey(key,ym2612.GetSamplingRate());
+	return key;
+}
+
+const YM2612::State &MMLPlayer::GetSynthState(void) const
+{
+	return ym2612.state;
+}
+
+void MMLPlayer::SetSynthState(const YM2612::State &state)
+{
+	ym2612.state=state;
+}
+
 void MMLPlayer::ClearMML(void)
 {
 	timeInMicrosec=0;
+	timeBaseInMicrosec=0;
+	samplesFromTimeBase=0;
 	for(auto &ch : channels)
 	{
 		ch.Clear();
 	}
+	ClearKeyframes();
 }
 
 bool MMLPlayer::AddMML(unsigned int ch,std::string mml)
 {
 	if(ch<NUM_CHANNELS)
 	{
-		channels[ch].mml+=mml;
+		CompiledMML compiled;
+		auto state=channels[ch].mmlState;
+		if(true==CompileMML(compiled,state,ch,mml))
+		{
+			channels[ch].mmlState=state;
+			return AddCompiledMML(ch,compiled);
+		}
+	}
+	return false;
+}
+
+bool MMLPlayer::AddCompiledMML(unsigned int ch,const CompiledMML &compiled)
+{
+	if(ch<NUM_CHANNELS)
+	{
+		// If the channel is already done, the added MML starts now.
+		auto &dst=channels[ch].compiled;
+		const uint64_t offset=std::max(dst.lengthInMicrosec,timeInMicrosec);
+		for(auto evt : compiled.events)
+		{
+			evt.timeInMicrosec+=offset;
+			dst.events.push_back(evt);
+		}
+		dst.lengthInMicrosec=offset+compiled.lengthInMicrosec;
 		return true;
 	}
 	return false;
 }
 
-std::vector <unsigned char> MMLPlayer::GenerateWave(uint64_t timeInMillisec)
+void MMLPlayer::ClearChannel(unsigned int ch)
 {
-	lastError.Clear();
+	if(ch<NUM_CHANNELS)
+	{
+		channels[ch].Clear();
+		ClearKeyframes();
+		unsigned int keyOnOffCh=(ch<3 ? ch : ch+1);
+		ym2612.WriteRegister(0,YM2612::REG_KEY_ON_OFF,keyOnOffCh);
+	}
+}
+
+MMLPlayer::MMLState MMLPlayer::GetMMLState(unsigned int ch) const
+{
+	if(ch<NUM_CHANNELS)
+	{
+		return channels[ch].mmlState;
+	}
+	return MMLState();
+}
+
+void MMLPlayer::SetMMLState(unsigned int ch,const MMLState &state)
+{
+	if(ch<NUM_CHANNELS)
+	{
+		channels[ch].mmlState=state;
+	}
+}
 
-	const uint64_t totalNumSamples=YM2612::WAVE_SAMPLING_RATE*timeInMillisec/MILLI;
-	const uint64_t bufSize=4*totalNumSamples;
+std::vector <unsigned char> MMLPlayer::GenerateWave(uint64_t timeInMillisec)
+{
+	const uint64_t totalNumSamples=outputSamplingRate*timeInMillisec/MILLI;
 	std::vector <unsigned char> wave;
 
-	wave.resize(bufSize);
-	std::memset(wave.data(),0,bufSize);
+	wave.resize(4*totalNumSamples);
+	auto numSamples=MakeWaveForNSamples(wave.data(),totalNumSamples,true);
+	wave.resize(4*numSamples);
+
+	return wave;
+}
 
-	uint64_t wavePtr=0;
-	while(wavePtr<bufSize)
+uint64_t MMLPlayer::MakeWaveForNSamples(unsigned char wave[],uint64_t totalNumSamples,bool stopWhenPlayDone)
+{
+	if(true!=IsResampling())
 	{
-		// Play up to the next cue point.
-		for(int chNum=0; chNum<NUM_CHANNELS; ++chNum)
+		YM2612::WaveBuffer buf;
+		buf.int16=wave;
+		return SynthesizeForNSamples(buf,totalNumSamples,stopWhenPlayDone);
+	}
+
+	uint64_t filled=0;
+	while(filled<totalNumSamples)
+	{
+		auto numOutput=(unsigned int)std::min<uint64_t>(totalNumSamples-filled,RESAMPLE_BLOCK_SAMPLES);
+		auto numInput=resampler.GetNumInputNeeded(numOutput);
+		synthBuf.resize(4*numInput);
+		YM2612::WaveBuffer buf;
+		buf.int16=synthBuf.data();
+		auto numSynthesized=(unsigned int)SynthesizeForNSamples(buf,numInput,stopWhenPlayDone);
+		filled+=resampler.Resample((int16_t *)(wave+4*filled),numOutput,(const int16_t *)synthBuf.data(),numSynthesized);
+		if(numSynthesized<numInput)
 		{
-			auto &ch=channels[chNum];
-			if(ch.ptr.keyOffAtInMicrosec<=timeInMicrosec)
-			{
-				if(chNum<3)
-				{
-					ym2612.WriteRegister(0,YM2612::REG_KEY_ON_OFF,chNum);
-				}
-				else
-				{
-					ym2612.WriteRegister(0,YM2612::REG_KEY_ON_OFF,(chNum+1));
-				}
-				ch.ptr.keyOffAtInMicrosec=INFINITE;
-			}
-			if(ch.ptr.toneEndAtInMicrosec<=timeInMicrosec || ch.ptr.toneEndAtInMicrosec==INFINITE)
-			{
-				ch.ptr.toneEndAtInMicrosec=INFINITE;
-				if(true!=InterpretMML(chNum))
-				{
-					wave.clear();
-					return wave;
-				}
-			}
+			filled+=resampler.Flush((int16_t *)(wave+4*filled),(unsigned int)(totalNumSamples-filled));
+			break;
+		}
+	}
+	std::memset(wave+4*filled,0,4*(totalNumSamples-filled));
+	return filled;
+}
+
+uint64_t MMLPlayer::MakeWaveForNSamplesFloat(float left[],float right[],uint64_t totalNumSamples,bool stopWhenPlayDone)
+{
+	YM2612::WaveBuffer buf;
+	buf.format=(nullptr!=right ? YM2612::WAVE_FLOAT_PLANAR : YM2612::WAVE_FLOAT_INTERLEAVED);
+	buf.left=left;
+	buf.right=right;
+	buf.gain=floatGain;
+	if(true!=IsResampling())
+	{
+		return SynthesizeForNSamples(buf,totalNumSamples,stopWhenPlayDone);
+	}
+
+	uint64_t filled=0;
+	while(filled<totalNumSamples)
+	{
+		auto numOutput=(unsigned int)std::min<uint64_t>(totalNumSamples-filled,RESAMPLE_BLOCK_SAMPLES);
+		auto numInput=resampler.GetNumInputNeeded(numOutput);
+		synthBufFloat.resize(2*numInput);
+		YM2612::WaveBuffer synth;
+		synth.format=YM2612::WAVE_FLOAT_PLANAR;
+		synth.left=synthBufFloat.data();
+		synth.right=synthBufFloat.data()+numInput;
+		synth.gain=floatGain;
+		auto numSynthesized=(unsigned int)SynthesizeForNSamples(synth,numInput,stopWhenPlayDone);
+
+		auto out=buf.Advance(filled);
+		filled+=resampler.Resample(out.left,out.right,numOutput,synth.left,synth.right,numSynthesized);
+		if(numSynthesized<numInput)
+		{
+			out=buf.Advance(filled);
+			filled+=resampler.Flush(out.left,out.right,(unsigned int)(totalNumSamples-filled));
+			break;
 		}
+	}
+	buf.Advance(filled).Clear(totalNumSamples-filled);
+	return filled;
+}
 
+void MMLPlayer::SetFloatHeadroom(float headroomInDB)
+{
+	floatHeadroomInDB=std::max(0.0f,headroomInDB);
+	floatGain=powf(10.0f,-floatHeadroomInDB/20.0f)/32768.0f;
+}
+
+float MMLPlayer::GetFloatHeadroom(void) const
+{
+	return floatHeadroomInDB;
+}
 
-		// Break if no more channels are playing.
-		// End of segment needs to be checked before generating a wave.
-		// After the last MML interpretation, all channels next cue point is INFINITE away.
-		// So is the nearest next cue point.
-		// Which makes wave generator fill the buffer all the way, unless the loop breaks before the wave generation.
-		unsigned int nPlaying=0;
+uint64_t MMLPlayer::SynthesizeForNSamples(const YM2612::WaveBuffer &wave,uint64_t totalNumSamples,bool stopWhenPlayDone)
+{
+	// If stopWhenPlayDone, the wave ends at the first sample at or after the end of the longest channel.
+	uint64_t numSamples=totalNumSamples;
+	if(true==stopWhenPlayDone)
+	{
+		uint64_t endInMicrosec=timeInMicrosec;
 		for(auto &ch : channels)
 		{
-			if(true!=ch.PlayDone())
+			endInMicrosec=std::max(endInMicrosec,ch.compiled.lengthInMicrosec);
+			if(ch.ptr.pos<ch.compiled.events.size())
 			{
-				++nPlaying;
-				break;
+				endInMicrosec=std::max(endInMicrosec,ch.compiled.events.back().timeInMicrosec);
 			}
 		}
-		if(0==nPlaying)
+		auto endSample=MicrosecToSample(endInMicrosec);
+		numSamples=(samplesFromTimeBase<endSample ? std::min(numSamples,endSample-samplesFromTimeBase) : 0);
+	}
+
+	// Each event is written at the first sample at or after the event time, and the wave is made in one call.
+	// It is split only at keyframes.
+	uint64_t filled=0;
+	do
+	{
+		auto n=numSamples-filled;
+		if(0<keyframeIntervalInMicrosec)
 		{
-			break;
+			uint64_t nextKeyframeInMicrosec=0;
+			if(true!=keyframes.empty())
+			{
+				nextKeyframeInMicrosec=(keyframes.back().timeInMicrosec/keyframeIntervalInMicrosec+1)*keyframeIntervalInMicrosec;
+			}
+			if(nextKeyframeInMicrosec<=timeInMicrosec)
+			{
+				keyframes.push_back(GetSnapshot());
+				nextKeyframeInMicrosec=(timeInMicrosec/keyframeIntervalInMicrosec+1)*keyframeIntervalInMicrosec;
+			}
+			n=std::min(n,MicrosecToSample(nextKeyframeInMicrosec)-samplesFromTimeBase);
 		}
 
-
-		// Find next cue point.
-		uint64_t nextCueInMicrosec=INFINITE;
-		for(auto &ch : channels)
+		// Events at the end of the wave are written after the wave so that the state is up to date at the end.
+		scheduleWrites=true;
+		for(int chNum=0; chNum<NUM_CHANNELS; ++chNum)
+		{
+			auto &ch=channels[chNum];
+			while(ch.ptr.pos<ch.compiled.events.size())
+			{
+				auto &evt=ch.compiled.events[ch.ptr.pos];
+				auto sample=MicrosecToSample(evt.timeInMicrosec);
+				if(samplesFromTimeBase+n<sample)
+				{
+					break;
+				}
+				scheduleSample=(samplesFromTimeBase<sample ? sample-samplesFromTimeBase : 0);
+				ApplyEvent(chNum,evt);
+				++ch.ptr.pos;
+			}
+		}
+		scheduleWrites=false;
+		if(nullptr!=commandQueue)
 		{
-			nextCueInMicrosec=std::min(nextCueInMicrosec,ch.ptr.keyOffAtInMicrosec);
-			nextCueInMicrosec=std::min(nextCueInMicrosec,ch.ptr.toneEndAtInMicrosec);
+			ym2612.ScheduleCommands(*commandQueue,n);
 		}
 
-		// Generate wave up to the next cue point or the length of the wave.
-		uint64_t dt=nextCueInMicrosec-timeInMicrosec;
-		uint64_t numSamples=YM2612::WAVE_SAMPLING_RATE;
-		numSamples*=dt;
-		numSamples/=MICRO;
-		if(0==numSamples)
+		ym2612.MakeWaveForNSamplesScheduled(wave.Advance(filled),n);
+		if(nullptr!=commandQueue)
 		{
-			numSamples=1;
+			commandQueue->AddRenderedSamples(n);
 		}
 
-		numSamples=std::min(numSamples,totalNumSamples-(wavePtr/4));
+		filled+=n;
+		samplesFromTimeBase+=n;
+		timeInMicrosec=timeBaseInMicrosec+samplesFromTimeBase*MICRO/ym2612.GetSamplingRate();
+	} while(filled<numSamples);
 
-		ym2612.MakeWaveForNSamples(wave.data()+wavePtr,numSamples);
-		wavePtr+=numSamples*4;
+	wave.Advance(numSamples).Clear(totalNumSamples-numSamples);
+	return numSamples;
+}
 
-		uint64_t actualDt=numSamples;
-		actualDt*=MICRO;
-		actualDt/=YM2612::WAVE_SAMPLING_RATE;
-		timeInMicrosec+=actualDt;
+uint64_t MMLPlayer::MicrosecToSample(uint64_t t) const
+{
+	if(t<=timeBaseInMicrosec)
+	{
+		return 0;
 	}
+	uint64_t rate=ym2612.GetSamplingRate();
+	return ((t-timeBaseInMicrosec)*rate+MICRO-1)/MICRO;
+}
 
-	wave.resize(wavePtr);
+void MMLPlayer::SetSamplingRate(unsigned int outputRate,unsigned int synthesisRate)
+{
+	outputRate=std::max<unsigned int>(YM2612::SAMPLING_RATE_MIN,std::min<unsigned int>(YM2612::SAMPLING_RATE_MAX,outputRate));
+	outputSamplingRate=outputRate;
+	ym2612.SetSamplingRate(0!=synthesisRate ? synthesisRate : outputRate);
+	// Sample positions are counted from here in the new rate.
+	timeBaseInMicrosec=timeInMicrosec;
+	samplesFromTimeBase=0;
+	ClearKeyframes();
+	if(true==IsResampling())
+	{
+		resampler.SetRate(ym2612.GetSamplingRate(),outputSamplingRate);
+	}
+}
 
-	return wave;
+unsigned int MMLPlayer::GetOutputSamplingRate(void) const
+{
+	return outputSamplingRate;
+}
+
+unsigned int MMLPlayer::GetSynthesisSamplingRate(void) const
+{
+	return ym2612.GetSamplingRate();
+}
+
+bool MMLPlayer::IsResampling(void) const
+{
+	return outputSamplingRate!=ym2612.GetSamplingRate();
 }
 
 MMLPlayer::MMLError MMLPlayer::GetLastError(void) const
@@ -294,13 +547,37 @@ MMLPlayer::MMLError MMLPlayer::GetLastError(void) const
 	return lastError;
 }
 
-bool MMLPlayer::InterpretMML(int chNum)
+void MMLPlayer::CompiledMML::Add(uint64_t timeInMicrosec,unsigned char type,unsigned char chBase,unsigned char reg,unsigned char value)
+{
+	Event evt;
+	evt.timeInMicrosec=timeInMicrosec;
+	evt.type=type;
+	evt.chBase=chBase;
+	evt.reg=reg;
+	evt.value=value;
+	events.push_back(evt);
+}
+
+bool MMLPlayer::CompileMML(CompiledMML &compiled,MMLState &state,unsigned int chNum,const std::string &mml)
 {
-	auto &ch=channels[chNum];
-	while(ch.ptr.pos<ch.mml.size() && INFINITE==ch.ptr.toneEndAtInMicrosec)
+	lastError.Clear();
+	compiled.Clear();
+	if(NUM_CHANNELS<=chNum)
+	{
+		return false;
+	}
+
+	auto ch=state;
+	const unsigned char chBase=(chNum<3 ? 0 : 3);
+	const unsigned char chLow=chNum%3;
+	const unsigned char keyOnOffCh=(chNum<3 ? chNum : chNum+1);
+
+	uint64_t t=0;
+	unsigned int pos=0;
+	while(pos<mml.size())
 	{
-		auto errorPos=ch.ptr.pos; // This will be recorded as error position if any.
-		char cmd=ch.mml[ch.ptr.pos++];
+		auto errorPos=pos; // This will be recorded as error position if any.
+		char cmd=mml[pos++];
 		if('a'<=cmd && cmd<='z')
 		{
 			cmd=cmd+'A'-'a';
@@ -312,22 +589,22 @@ bool MMLPlayer::InterpretMML(int chNum)
 			break;
 		case 'R':
 			{
-				int L=GetNumber(chNum);
+				int L=GetNumber(mml,pos);
 				if(0==L)
 				{
 					L=ch.noteLength;
 				}
 
 				uint64_t noteDurationInMicrosec=60*MICRO*4;
-				if('.'==ch.mml[ch.ptr.pos])
+				if('.'==mml[pos])
 				{
 					noteDurationInMicrosec*=3;
 					noteDurationInMicrosec/=2;
-					++ch.ptr.pos;
+					++pos;
 				}
 				noteDurationInMicrosec/=(ch.tempo*L);
 
-				ch.ptr.toneEndAtInMicrosec=timeInMicrosec+noteDurationInMicrosec;
+				t+=noteDurationInMicrosec;
 			}
 			break;
 		case 'C':
@@ -339,29 +616,29 @@ bool MMLPlayer::InterpretMML(int chNum)
 		case 'B':
 			{
 				int sharpOrFlat=0;
-				if('#'==ch.mml[ch.ptr.pos] || '+'==ch.mml[ch.ptr.pos])
+				if('#'==mml[pos] || '+'==mml[pos])
 				{
 					sharpOrFlat=1;
-					++ch.ptr.pos;
+					++pos;
 				}
-				else if('-'==ch.mml[ch.ptr.pos])
+				else if('-'==mml[pos])
 				{
 					sharpOrFlat=-1;
-					++ch.ptr.pos;
+					++pos;
 				}
 
-				int L=GetNumber(chNum);
+				int L=GetNumber(mml,pos);
 				if(0==L)
 				{
 					L=ch.noteLength;
 				}
 
 				uint64_t noteDurationInMicrosec=60*MICRO*4;
-				if('.'==ch.mml[ch.ptr.pos])
+				if('.'==mml[pos])
 				{
 					noteDurationInMicrosec*=3;
 					noteDurationInMicrosec/=2;
-					++ch.ptr.pos;
+					++pos;
 				}
 				noteDurationInMicrosec/=(ch.tempo*L);
 
@@ -374,57 +651,39 @@ bool MMLPlayer::InterpretMML(int chNum)
 				unsigned char highByte,lowByte;
 				highByte=(blk<<3)|(fnum>>8);
 				lowByte=fnum&255;
-				ym2612.WriteRegister((chNum<3 ? 0 : 3),YM2612::REG_FNUM2+chNum%3,highByte);
-				ym2612.WriteRegister((chNum<3 ? 0 : 3),YM2612::REG_FNUM1+chNum%3,lowByte);
-				if(true!=mute[chNum])
-				{
-					if(chNum<3)
-					{
-						ym2612.WriteRegister(0,YM2612::REG_KEY_ON_OFF,0xF0|chNum);
-					}
-					else
-					{
-						ym2612.WriteRegister(0,YM2612::REG_KEY_ON_OFF,0xF0|(chNum+1));
-					}
-				}
+				compiled.Add(t,EVENT_WRITE_REGISTER,chBase,YM2612::REG_FNUM2+chLow,highByte);
+				compiled.Add(t,EVENT_WRITE_REGISTER,chBase,YM2612::REG_FNUM1+chLow,lowByte);
+				compiled.Add(t,EVENT_KEY_ON,0,YM2612::REG_KEY_ON_OFF,0xF0|keyOnOffCh);
 
-				ch.ptr.toneEndAtInMicrosec=timeInMicrosec+noteDurationInMicrosec;
-				if('&'==ch.mml[ch.ptr.pos])
+				if('&'==mml[pos])
 				{
-					ch.ptr.keyOffAtInMicrosec=INFINITE;
-					++ch.ptr.pos;
+					++pos;
 				}
 				else
 				{
-					ch.ptr.keyOffAtInMicrosec=timeInMicrosec+noteDurationInMicrosec*ch.keyOnTimeFraction/KEYON_TIME_FRACTION_MAX;
+					compiled.Add(t+noteDurationInMicrosec*ch.keyOnTimeFraction/KEYON_TIME_FRACTION_MAX,
+					             EVENT_WRITE_REGISTER,0,YM2612::REG_KEY_ON_OFF,keyOnOffCh);
 				}
+				t+=noteDurationInMicrosec;
 			}
 			break;
 		case 'V':
 			{
-				auto vol=GetNumber(chNum);
+				auto vol=GetNumber(mml,pos);
 				if(vol<0 || VOLUME_MAX<vol)
 				{
-					lastError.errorCode=ERROR_VOLUME;
-					lastError.pos=errorPos;
-					lastError.chNum=chNum;
-					lastError.MML=ch.mml;
-					return false;
+					return CompileError(chNum,ERROR_VOLUME,errorPos,mml);
 				}
 				ch.volume=vol;
-				ReapplyEnvelope(chNum);
+				compiled.Add(t,EVENT_PROGRAM_CHANGE,chBase,ch.instNum,ch.volume);
 			}
 			break;
 		case 'O':
 			{
-				auto oct=GetNumber(chNum);
+				auto oct=GetNumber(mml,pos);
 				if(oct<0 || OCTAVE_MAX<oct)
 				{
-					lastError.errorCode=ERROR_OCTAVE;
-					lastError.pos=errorPos;
-					lastError.chNum=chNum;
-					lastError.MML=ch.mml;
-					return false;
+					return CompileError(chNum,ERROR_OCTAVE,errorPos,mml);
 				}
 				ch.octave=oct;
 			}
@@ -443,78 +702,101 @@ bool MMLPlayer::InterpretMML(int chNum)
 			break;
 		case 'L':
 			{
-				auto len=GetNumber(chNum);
+				auto len=GetNumber(mml,pos);
 				if(len<=0 || NOTE_LENGTH_MAX<len)
 				{
-					lastError.errorCode=ERROR_NOTE_LENGTH;
-					lastError.pos=errorPos;
-					lastError.chNum=chNum;
-					lastError.MML=ch.mml;
-					return false;
+					return CompileError(chNum,ERROR_NOTE_LENGTH,errorPos,mml);
 				}
 				ch.noteLength=len;
 			}
 			break;
 		case 'S':
-			GetNumber(chNum); // Ignore to allow F-BASIC V3.0 MML
+			GetNumber(mml,pos); // Ignore to allow F-BASIC V3.0 MML
 			break;
 		case 'M':
-			GetNumber(chNum); // Ignore to allow F-BASIC V3.0 MML
+			GetNumber(mml,pos); // Ignore to allow F-BASIC V3.0 MML
 			break;
 		case 'T':
 			{
-				auto tempo=GetNumber(chNum);
+				auto tempo=GetNumber(mml,pos);
 				if(tempo<=0 || TEMPO_MAX<tempo)
 				{
-					lastError.errorCode=ERROR_TEMPO;
-					lastError.pos=errorPos;
-					lastError.chNum=chNum;
-					lastError.MML=ch.mml;
-					return false;
+					return CompileError(chNum,ERROR_TEMPO,errorPos,mml);
 				}
 				ch.tempo=tempo;
 			}
 			break;
 		case 'Q':
 			{
-				auto fraction=GetNumber(chNum);
+				auto fraction=GetNumber(mml,pos);
 				if(fraction<0 || KEYON_TIME_FRACTION_MAX<fraction)
 				{
-					lastError.errorCode=ERROR_FRACTION;
-					lastError.pos=errorPos;
-					lastError.chNum=chNum;
-					lastError.MML=ch.mml;
-					return false;
+					return CompileError(chNum,ERROR_FRACTION,errorPos,mml);
 				}
 				ch.keyOnTimeFraction=fraction;
 			}
 			break;
 		case '@':
 			{
-				auto instNum=GetNumber(chNum)-1;
+				auto instNum=GetNumber(mml,pos)-1;
 				if(instNum<0 || INST_NUM_MAX<instNum)
 				{
-					lastError.errorCode=ERROR_INSTRUMENT_NUMBER;
-					lastError.pos=errorPos;
-					lastError.chNum=chNum;
-					lastError.MML=ch.mml;
-					return false;
+					return CompileError(chNum,ERROR_INSTRUMENT_NUMBER,errorPos,mml);
 				}
 				ch.instNum=instNum;
-				ReapplyEnvelope(chNum);
+				compiled.Add(t,EVENT_PROGRAM_CHANGE,chBase,ch.instNum,ch.volume);
 			}
 			break;
 		default:
-			lastError.errorCode=ERROR_UNDEFINED_COMMAND;
-			lastError.pos=errorPos;
-			lastError.chNum=chNum;
-			lastError.MML=ch.mml;
-			return false;
+			return CompileError(chNum,ERROR_UNDEFINED_COMMAND,errorPos,mml);
 		}
 	}
+
+	compiled.lengthInMicrosec=t;
+	state=ch;
 	return true;
 }
 
+bool MMLPlayer::CompileError(int chNum,int errorCode,int pos,const std::string &mml)
+{
+	lastError.errorCode=errorCode;
+	lastError.pos=pos;
+	lastError.chNum=chNum;
+	lastError.MML=mml;
+	return false;
+}
+
+void MMLPlayer::WriteRegister(unsigned int chBase,unsigned int reg,unsigned int value)
+{
+	if(true==scheduleWrites)
+	{
+		ym2612.ScheduleWriteRegister(scheduleSample,chBase,reg,value);
+	}
+	else
+	{
+		ym2612.WriteRegister(chBase,reg,value);
+	}
+}
+
+void MMLPlayer::ApplyEvent(int chNum,const Event &evt)
+{
+	switch(evt.type)
+	{
+	case EVENT_WRITE_REGISTER:
+		WriteRegister(evt.chBase,evt.reg,evt.value);
+		break;
+	case EVENT_KEY_ON:
+		if(true!=mute[chNum])
+		{
+			WriteRegister(evt.chBase,evt.reg,evt.value);
+		}
+		break;
+	case EVENT_PROGRAM_CHANGE:
+		ReapplyEnvelope(chNum,evt.reg,evt.value);
+		break;
+	}
+}
+
 void MMLPlayer::OctaveNoteToBlockFnum(unsigned int &blk,unsigned int &fnum,int octave,int note,int sharpOrFlat) const
 {
 	static const int noteToFnum[]=
@@ -584,92 +866,153 @@ void MMLPlayer::OctaveNoteToBlockFnum(unsigned int &blk,unsigned int &fnum,int o
 	}
 }
 
-int MMLPlayer::GetNumber(int chNum)
+/* static */ int MMLPlayer::GetNumber(const std::string &mml,unsigned int &pos)
 {
-	auto &ch=channels[chNum];
 	int num=0;
-	while(ch.ptr.pos<ch.mml.size() && '0'<=ch.mml[ch.ptr.pos] && ch.mml[ch.ptr.pos]<='9')
+	while(pos<mml.size() && '0'<=mml[pos] && mml[pos]<='9')
 	{
 		num*=10;
-		num+=(ch.mml[ch.ptr.pos++]-'0');
+		num+=(mml[pos++]-'0');
 	}
 	return num;
 }
 
-void MMLPlayer::ReapplyEnvelope(int chNum)
+void MMLPlayer::ReapplyEnvelope(int chNum,unsigned int instNum,unsigned int volume)
 {
-	auto &ch=channels[chNum];
-	auto i=inst[ch.instNum];
-	auto CONN=(i.FB_CNCT&7);
-
-	int nCarrierSlots,carrierSlots[4];
-	YM2612::GetCarrierSlotFromConnection(nCarrierSlots,carrierSlots,CONN);
-
-	for(auto j=0; j<nCarrierSlots; ++j)
+	auto &compiled=compiledInst[instNum];
+	if(true==compiled.envelope.empty())
 	{
-		auto slotNum=carrierSlots[j];
-		int TL=i.TL[slotNum];
-		TL+=(15-ch.volume)*2;
-		TL=std::min<int>(YM2612::TL_MAX,TL);
-		i.TL[slotNum]=TL;
+		compiled.envelope.resize(YM2612::NUM_SLOTS);
 	}
 
 	auto chBase=(chNum<3 ? 0 : 3);
 	auto chLow=(chNum%3);
-	ym2612.WriteRegister(chBase,YM2612::REG_DT_MULTI+0x00+chLow,i.DT_MULTI[0]);
-	ym2612.WriteRegister(chBase,YM2612::REG_DT_MULTI+0x04+chLow,i.DT_MULTI[1]);
-	ym2612.WriteRegister(chBase,YM2612::REG_DT_MULTI+0x08+chLow,i.DT_MULTI[2]);
-	ym2612.WriteRegister(chBase,YM2612::REG_DT_MULTI+0x0C+chLow,i.DT_MULTI[3]);
+	auto carrierAttenuation=(15-volume)*2;
+	if(true==scheduleWrites)
+	{
+		ym2612.ScheduleWriteVoice(scheduleSample,chBase,chLow,compiled.value,carrierAttenuation,compiled.envelope.data());
+	}
+	else
+	{
+		ym2612.WriteVoice(chBase,chLow,compiled.value,carrierAttenuation,compiled.envelope.data());
+	}
+}
+
+bool MMLPlayer::PlayDone(void) const
+{
+	for(auto &ch : channels)
+	{
+		if(true!=ch.PlayDone(timeInMicrosec))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+uint64_t MMLPlayer::GetTimeInMicrosec(void) const
+{
+	return timeInMicrosec;
+}
 
-	ym2612.WriteRegister(chBase,YM2612::REG_TL+0x00+chLow,i.TL[0]);
-	ym2612.WriteRegister(chBase,YM2612::REG_TL+0x04+chLow,i.TL[1]);
-	ym2612.WriteRegister(chBase,YM2612::REG_TL+0x08+chLow,i.TL[2]);
-	ym2612.WriteRegister(chBase,YM2612::REG_TL+0x0C+chLow,i.TL[3]);
+MMLPlayer::Snapshot MMLPlayer::GetSnapshot(void) const
+{
+	Snapshot snapshot;
+	snapshot.synthState=GetSynthState();
+	snapshot.timeInMicrosec=timeInMicrosec;
+	snapshot.timeBaseInMicrosec=timeBaseInMicrosec;
+	snapshot.samplesFromTimeBase=samplesFromTimeBase;
+	for(int chNum=0; chNum<NUM_CHANNELS; ++chNum)
+	{
+		snapshot.eventPos[chNum]=channels[chNum].ptr.pos;
+	}
+	return snapshot;
+}
 
-	ym2612.WriteRegister(chBase,YM2612::REG_KS_AR+0x00+chLow,i.KS_AR[0]);
-	ym2612.WriteRegister(chBase,YM2612::REG_KS_AR+0x04+chLow,i.KS_AR[1]);
-	ym2612.WriteRegister(chBase,YM2612::REG_KS_AR+0x08+chLow,i.KS_AR[2]);
-	ym2612.WriteRegister(chBase,YM2612::REG_KS_AR+0x0C+chLow,i.KS_AR[3]);
+void MMLPlayer::RestoreSnapshot(const Snapshot &snapshot)
+{
+	SetSynthState(snapshot.synthState);
+	timeInMicrosec=snapshot.timeInMicrosec;
+	timeBaseInMicrosec=snapshot.timeBaseInMicrosec;
+	samplesFromTimeBase=snapshot.samplesFromTimeBase;
+	for(int chNum=0; chNum<NUM_CHANNELS; ++chNum)
+	{
+		auto &ch=channels[chNum];
+		ch.ptr.pos=std::min<unsigned int>(snapshot.eventPos[chNum],(unsigned int)ch.compiled.events.size());
+	}
+	if(true==IsResampling())
+	{
+		resampler.Reset();
+	}
+}
 
-	ym2612.WriteRegister(chBase,YM2612::REG_AM_DR+0x00+chLow,i.AMON_DR[0]);
-	ym2612.WriteRegister(chBase,YM2612::REG_AM_DR+0x04+chLow,i.AMON_DR[1]);
-	ym2612.WriteRegister(chBase,YM2612::REG_AM_DR+0x08+chLow,i.AMON_DR[2]);
-	ym2612.WriteRegister(chBase,YM2612::REG_AM_DR+0x0C+chLow,i.AMON_DR[3]);
+void MMLPlayer::SetKeyframeInterval(uint64_t intervalInMillisec)
+{
+	keyframeIntervalInMicrosec=intervalInMillisec*(MICRO/MILLI);
+	ClearKeyframes();
+}
 
-	ym2612.WriteRegister(chBase,YM2612::REG_SR+0x00+chLow,i.SR[0]);
-	ym2612.WriteRegister(chBase,YM2612::REG_SR+0x04+chLow,i.SR[1]);
-	ym2612.WriteRegister(chBase,YM2612::REG_SR+0x08+chLow,i.SR[2]);
-	ym2612.WriteRegister(chBase,YM2612::REG_SR+0x0C+chLow,i.SR[3]);
+uint64_t MMLPlayer::GetKeyframeInterval(void) const
+{
+	return keyframeIntervalInMicrosec/(MICRO/MILLI);
+}
 
-	ym2612.WriteRegister(chBase,YM2612::REG_SL_RR+0x00+chLow,i.SL_RR[0]);
-	ym2612.WriteRegister(chBase,YM2612::REG_SL_RR+0x04+chLow,i.SL_RR[1]);
-	ym2612.WriteRegister(chBase,YM2612::REG_SL_RR+0x08+chLow,i.SL_RR[2]);
-	ym2612.WriteRegister(chBase,YM2612::REG_SL_RR+0x0C+chLow,i.SL_RR[3]);
+size_t MMLPlayer::GetNumKeyframes(void) const
+{
+	return keyframes.size();
+}
 
-	ym2612.WriteRegister(chBase,YM2612::REG_SSG_EG+0x00+chLow,0);
-	ym2612.WriteRegister(chBase,YM2612::REG_SSG_EG+0x04+chLow,0);
-	ym2612.WriteRegister(chBase,YM2612::REG_SSG_EG+0x08+chLow,0);
-	ym2612.WriteRegister(chBase,YM2612::REG_SSG_EG+0x0C+chLow,0);
+void MMLPlayer::ClearKeyframes(void)
+{
+	keyframes.clear();
+}
 
-	ym2612.WriteRegister(chBase,YM2612::REG_FB_CNCT+chLow,i.FB_CNCT);
-	ym2612.WriteRegister(chBase,YM2612::REG_LR_AMS_PMS+chLow,i.LR_AMS_PMS);
+static bool MMLPlayer_TimeIsBeforeKeyframe(uint64_t timeInMicrosec,const MMLPlayer::Snapshot &keyframe)
+{
+	return timeInMicrosec<keyframe.timeInMicrosec;
 }
 
-bool MMLPlayer::PlayDone(void) const
+bool MMLPlayer::Seek(uint64_t timeInMicrosec)
 {
-	for(auto &ch : channels)
+	// Last keyframe at or before the time.
+	auto found=std::upper_bound(keyframes.begin(),keyframes.end(),timeInMicrosec,MMLPlayer_TimeIsBeforeKeyframe);
+	if(keyframes.begin()!=found)
 	{
-		if(true!=ch.PlayDone())
+		--found;
+		if(timeInMicrosec<this->timeInMicrosec || this->timeInMicrosec<found->timeInMicrosec)
 		{
-			return false;
+			RestoreSnapshot(*found);
 		}
 	}
+	else if(timeInMicrosec<this->timeInMicrosec)
+	{
+		return false;
+	}
+
+	const auto targetSample=MicrosecToSample(timeInMicrosec);
+	while(samplesFromTimeBase<targetSample)
+	{
+		auto numSamples=std::min<uint64_t>(targetSample-samplesFromTimeBase,SEEK_BLOCK_SAMPLES);
+		synthBuf.resize(4*numSamples);
+		YM2612::WaveBuffer buf;
+		buf.int16=synthBuf.data();
+		SynthesizeForNSamples(buf,numSamples,false);
+	}
+	if(true==IsResampling())
+	{
+		resampler.Reset();
+	}
 	return true;
 }
 
-uint64_t MMLPlayer::GetTimeInMicrosec(void) const
+void MMLPlayer::SetCommandQueue(YM2612::CommandQueue *queue)
 {
-	return timeInMicrosec;
+	commandQueue=queue;
+}
+
+YM2612::CommandQueue *MMLPlayer::GetCommandQueue(void) const
+{
+	return commandQueue;
 }
 
 
@@ -709,7 +1052,7 @@ int MMLPlayer::GetLastErrorCode(void) const
 
 
 
-void MMLSegmentPlayer::AddSegment(
+bool MMLSegmentPlayer::AddSegment(
 		std::string ch0,
 		std::string ch1,
 		std::string ch2,
@@ -718,60 +1061,110 @@ void MMLSegmentPlayer::AddSegment(
 		std::string ch5)
 {
 	Segment seg;
-	mmlSegments.push_back(seg);
-	mmlSegments.back().mml[0]=ch0;
-	mmlSegments.back().mml[1]=ch1;
-	mmlSegments.back().mml[2]=ch2;
-	mmlSegments.back().mml[3]=ch3;
-	mmlSegments.back().mml[4]=ch4;
-	mmlSegments.back().mml[5]=ch5;
-}
-
-std::vector <unsigned char> MMLSegmentPlayer::GenerateWave(const uint64_t timeInMillisec)
-{
-	lastError.Clear();
+	seg.mml[0]=ch0;
+	seg.mml[1]=ch1;
+	seg.mml[2]=ch2;
+	seg.mml[3]=ch3;
+	seg.mml[4]=ch4;
+	seg.mml[5]=ch5;
+
+	// Tempo, octave etc. are taken over from the previous segment.
+	MMLState state[NUM_CHANNELS];
+	for(unsigned int chNum=0; chNum<NUM_CHANNELS; ++chNum)
+	{
+		state[chNum]=GetMMLState(chNum);
+		seg.startState[chNum]=state[chNum];
+		if(true!=CompileMML(seg.compiled[chNum],state[chNum],chNum,seg.mml[chNum]))
+		{
+			return false;
+		}
+	}
+	for(unsigned int chNum=0; chNum<NUM_CHANNELS; ++chNum)
+	{
+		SetMMLState(chNum,state[chNum]);
+	}
+
+	mmlSegments.push_back(seg);
+	return true;
+}
 
+std::vector <unsigned char> MMLSegmentPlayer::GenerateWave(const uint64_t timeInMillisec)
+{
 	std::vector <unsigned char> rawWaveData;
 
 	uint64_t timeInMicrosec=timeInMillisec*(MICRO/MILLI);
 
-	int repeatCount=0;
+	unsigned int numStartedWithoutWave=0;
 	while(true!=this->PlayDone() && 0<timeInMicrosec)
 	{
-		if(true==MMLPlayer::PlayDone())
+		if(true!=replaying && true==MMLPlayer::PlayDone())
 		{
+			if(true==repeat && mmlSegments.size()<=playingSegment)
+			{
+				playingSegment=0;
+			}
 			if(playingSegment<mmlSegments.size())
 			{
-				MMLPlayer::ClearMML();
-				MMLPlayer::AddMML(0,mmlSegments[playingSegment].mml[0]);
-				MMLPlayer::AddMML(1,mmlSegments[playingSegment].mml[1]);
-				MMLPlayer::AddMML(2,mmlSegments[playingSegment].mml[2]);
-				MMLPlayer::AddMML(3,mmlSegments[playingSegment].mml[3]);
-				MMLPlayer::AddMML(4,mmlSegments[playingSegment].mml[4]);
-				MMLPlayer::AddMML(5,mmlSegments[playingSegment].mml[5]);
+				if(true==repeat && mmlSegments.size()<=numStartedWithoutWave)
+				{
+					// Prevent infinite loop.
+					// If no data is generated by going through one loop of
+					// the entire song, probably it should stop.
+					return rawWaveData;
+				}
+				StartSegment(playingSegment);
 				++playingSegment;
-				if(true==repeat)
+				++numStartedWithoutWave;
+			}
+		}
+
+		std::vector <unsigned char> rawWavePiece;
+		if(true==replaying)
+		{
+			size_t pieceSize=timeInMillisec*(GetOutputSamplingRate()*OUTPUT_CHANNELS*OUTPUT_BYTES_PER_SAMPLE)/MILLI;
+			pieceSize=std::min(pieceSize,replayPtr->wave.size()-replayPos);
+			rawWavePiece.resize(pieceSize);
+			if(0<pieceSize)
+			{
+				memcpy(rawWavePiece.data(),replayPtr->wave.data()+replayPos,pieceSize);
+			}
+			replayPos+=pieceSize;
+			if(replayPtr->wave.size()<=replayPos)
+			{
+				// Continue from where the segment was rendered to.
+				SetSynthState(replayPtr->endState);
+				replaying=false;
+			}
+		}
+		else
+		{
+			rawWavePiece=MMLPlayer::GenerateWave(timeInMillisec);
+			if(true==recording)
+			{
+				if(waveCacheBudget<recordingWave.wave.size()+rawWavePiece.size())
 				{
-					playingSegment=0;
-					++repeatCount;
-					if(mmlSegments.size()<=repeatCount)
-					{
-						// Prevent infinite loop.
-						// If no data is generated by going through one loop of
-						// the entire song, probably it should stop.
-						return rawWaveData;
-					}
+					// Won't fit anyway.
+					recording=false;
+					recordingWave.wave.clear();
+					recordingWave.wave.shrink_to_fit();
+				}
+				else
+				{
+					recordingWave.wave.insert(recordingWave.wave.end(),rawWavePiece.begin(),rawWavePiece.end());
 				}
 			}
+			if(true==MMLPlayer::PlayDone())
+			{
+				EndSegment();
+			}
 		}
 
-		auto rawWavePiece=MMLPlayer::GenerateWave(timeInMillisec);
-		if(0!=lastError.errorCode)
+		if(0<rawWavePiece.size())
 		{
-			return rawWaveData;
+			numStartedWithoutWave=0;
 		}
 
-		uint64_t rawWavePieceLengthInMicrosec=rawWavePiece.size()*MICRO/(YM2612::WAVE_SAMPLING_RATE*OUTPUT_CHANNELS*OUTPUT_BYTES_PER_SAMPLE);
+		uint64_t rawWavePieceLengthInMicrosec=rawWavePiece.size()*MICRO/(GetOutputSamplingRate()*OUTPUT_CHANNELS*OUTPUT_BYTES_PER_SAMPLE);
 		if(rawWavePieceLengthInMicrosec<timeInMicrosec)
 		{
 			timeInMicrosec-=rawWavePieceLengthInMicrosec;
@@ -794,7 +1187,7 @@ std::vector <unsigned char> MMLSegmentPlayer::GenerateWave(const uint64_t timeIn
 	if(true==PlayDone())
 	{
 		uint64_t requiredLength=
-		    timeInMillisec*(YM2612::WAVE_SAMPLING_RATE*OUTPUT_CHANNELS*OUTPUT_BYTES_PER_SAMPLE)/MILLI;
+		    timeInMillisec*(GetOutputSamplingRate()*OUTPUT_CHANNELS*OUTPUT_BYTES_PER_SAMPLE)/MILLI;
 		while(rawWaveData.size()<requiredLength)
 		{
 			rawWaveData.push_back(0);
@@ -809,12 +1202,143 @@ void MMLSegmentPlayer::Clear(void)
 	repeat=false;
 	playingSegment=0;
 	mmlSegments.clear();
+	replaying=false;
+	recording=false;
+	recordingWave.wave.clear();
 	MMLPlayer::Clear();
 }
 
 bool MMLSegmentPlayer::PlayDone(void) const
 {
-	return (true==MMLPlayer::PlayDone() && mmlSegments.size()<=playingSegment);
+	return (true!=repeat && true!=replaying && true==MMLPlayer::PlayDone() && mmlSegments.size()<=playingSegment);
+}
+
+std::string MMLSegmentPlayer::MakeWaveCacheKey(unsigned int segNum) const
+{
+	auto &seg=mmlSegments[segNum];
+
+	std::string key;
+	for(unsigned int chNum=0; chNum<NUM_CHANNELS; ++chNum)
+	{
+		auto &state=seg.startState[chNum];
+		MMLPlayer_AppendToKey(key,state.tempo);
+		MMLPlayer_AppendToKey(key,state.octave);
+		MMLPlayer_AppendToKey(key,state.noteLength);
+		MMLPlayer_AppendToKey(key,state.volume);
+		MMLPlayer_AppendToKey(key,state.keyOnTimeFraction);
+		MMLPlayer_AppendToKey(key,state.instNum);
+		MMLPlayer_AppendToKey(key,(uint64_t)seg.mml[chNum].size());
+		key+=seg.mml[chNum];
+	}
+	key+=GetSynthStateKey();
+	return key;
+}
+
+void MMLSegmentPlayer::StartSegment(unsigned int segNum)
+{
+	MMLPlayer::ClearMML();
+	replaying=false;
+	recording=false;
+
+	mmlSegments[segNum].started=true;
+	mmlSegments[segNum].startSnapshot=GetSnapshot();
+
+	// While resampling, the wave depends on the resampler history carried over from the previous segment.
+	// Writes from a command queue are not in the cache key.
+	if(0<waveCacheBudget && true!=IsResampling() && nullptr==GetCommandQueue())
+	{
+		auto key=MakeWaveCacheKey(segNum);
+		auto found=waveCacheIndex.find(key);
+		if(waveCacheIndex.end()!=found)
+		{
+			replayPtr=found->second;
+			replayPos=0;
+			replaying=true;
+			waveCache.splice(waveCache.begin(),waveCache,replayPtr);
+			return;
+		}
+
+		recording=true;
+		recordingWave.key.swap(key);
+		recordingWave.wave.clear();
+		recordingSetting=GetPlaybackSettingKey();
+	}
+
+	for(unsigned int chNum=0; chNum<NUM_CHANNELS; ++chNum)
+	{
+		MMLPlayer::AddCompiledMML(chNum,mmlSegments[segNum].compiled[chNum]);
+	}
+}
+
+void MMLSegmentPlayer::EndSegment(void)
+{
+	if(true==recording && recordingSetting==GetPlaybackSettingKey())
+	{
+		recordingWave.endState=GetSynthState();
+		AddToWaveCache(recordingWave);
+	}
+	recording=false;
+	recordingWave.wave.clear();
+}
+
+void MMLSegmentPlayer::AddToWaveCache(CachedWave &cached)
+{
+	auto size=cached.GetSize();
+	if(waveCacheBudget<size || waveCacheIndex.end()!=waveCacheIndex.find(cached.key))
+	{
+		return;
+	}
+	ShrinkWaveCache(waveCacheBudget-size);
+
+	waveCache.push_front(CachedWave());
+	auto &newCache=waveCache.front();
+	newCache.key.swap(cached.key);
+	newCache.wave.swap(cached.wave);
+	newCache.endState=cached.endState;
+	waveCacheIndex[newCache.key]=waveCache.begin();
+	waveCacheUsed+=size;
+}
+
+void MMLSegmentPlayer::ShrinkWaveCache(size_t budget)
+{
+	auto iter=waveCache.end();
+	while(budget<waveCacheUsed && waveCache.begin()!=iter)
+	{
+		--iter;
+		if(true==replaying && iter==replayPtr)
+		{
+			continue;
+		}
+		waveCacheUsed-=iter->GetSize();
+		waveCacheIndex.erase(iter->key);
+		iter=waveCache.erase(iter);
+	}
+}
+
+size_t MMLSegmentPlayer::CachedWave::GetSize(void) const
+{
+	return sizeof(CachedWave)+key.size()+wave.size();
+}
+
+void MMLSegmentPlayer::SetWaveCacheBudget(size_t bytes)
+{
+	waveCacheBudget=bytes;
+	ShrinkWaveCache(bytes);
+}
+
+size_t MMLSegmentPlayer::GetWaveCacheBudget(void) const
+{
+	return waveCacheBudget;
+}
+
+size_t MMLSegmentPlayer::GetWaveCacheUsage(void) const
+{
+	return waveCacheUsed;
+}
+
+void MMLSegmentPlayer::ClearWaveCache(void)
+{
+	ShrinkWaveCache(0);
 }
 
 void MMLPlayer::MuteChannels(bool ch0Mute,bool ch1Mute,bool ch2Mute,bool ch3Mute,bool ch4Mute,bool ch5Mute)
@@ -825,12 +1349,53 @@ void MMLPlayer::MuteChannels(bool ch0Mute,bool ch1Mute,bool ch2Mute,bool ch3Mute
 	mute[3]=ch3Mute;
 	mute[4]=ch4Mute;
 	mute[5]=ch5Mute;
+	ClearKeyframes();
 }
 
 int MMLSegmentPlayer::GetCurrentSegment(void) const
 {
 	return playingSegment;
 }
+
+void MMLSegmentPlayer::SetRepeat(bool repeat)
+{
+	this->repeat=repeat;
+}
+
+bool MMLSegmentPlayer::GetRepeat(void) const
+{
+	return repeat;
+}
+
+bool MMLSegmentPlayer::SeekSegment(unsigned int segNum)
+{
+	if(mmlSegments.size()<=segNum)
+	{
+		return false;
+	}
+
+	while(true!=mmlSegments[segNum].started && true!=PlayDone())
+	{
+		if(0==GenerateWave(SEEK_STEP_MILLISEC).size())
+		{
+			break;
+		}
+	}
+	if(true!=mmlSegments[segNum].started)
+	{
+		return false;
+	}
+
+	if(true==recording)
+	{
+		recording=false;
+		recordingWave.wave.clear();
+	}
+	RestoreSnapshot(mmlSegments[segNum].startSnapshot);
+	StartSegment(segNum);
+	playingSegment=segNum+1;
+	return true;
+}
 #include "mmlplayer.h"
 
 const unsigned long long MMLPlayer::sizeof_defaultFMB=6152;
@@ -2489,3357 +3054,7207 @@ void YM2612::Channel::Clear()
 
 
 
-/*static*/ int YM2612::sineTable[YM2612::PHASE_STEPS];
+// Lookup tables below are generated offline and stored as read-only data so that
 
-/*static*/ unsigned int YM2612::TLtoDB100[128];   // 100 times dB
+// constructing a YM2612 does not need to compute them.
 
-/*static*/ unsigned int YM2612::SLtoDB100[16];    // 100 times dB
 
-/*static*/ unsigned int YM2612::DB100to4095Scale[9601]; // dB to 0 to 4095 scale
 
-/*static*/ unsigned int YM2612::DB100from4095Scale[4096]; // 0 to 4095 scale to dB
+// sineTable[i]=(int)(sin(2.0*PI*(double)i/(double)PHASE_STEPS)*(double)UNSCALED_MAX)
 
-/*static*/ unsigned int YM2612::linear4096to9600[4097]; // Linear 4096 scale to 9600 scale
+/*static*/ const int YM2612::sineTable[YM2612::PHASE_STEPS]=
 
-/*static*/ unsigned int YM2612::linear9600to4096[9601]; // Linear 9600 scale to 4096 scale
+{
 
-/*static*/ const unsigned int YM2612::connToOutChannel[8][4]=
+	0,3,6,9,12,15,18,21,25,28,31,34,37,40,43,47,
 
-{
+	50,53,56,59,62,65,69,72,75,78,81,84,87,91,94,97,
 
-	{0,0,0,1},
+	100,103,106,109,113,116,119,122,125,128,131,134,138,141,144,147,
 
-	{0,0,0,1},
+	150,153,156,160,163,166,169,172,175,178,181,185,188,191,194,197,
 
-	{0,0,0,1},
+	200,203,206,210,213,216,219,222,225,228,231,235,238,241,244,247,
 
-	{0,0,0,1},
+	250,253,256,260,263,266,269,272,275,278,281,284,288,291,294,297,
 
-	{0,1,0,1},
+	300,303,306,309,312,316,319,322,325,328,331,334,337,340,343,347,
 
-	{0,1,1,1},
+	350,353,356,359,362,365,368,371,374,377,381,384,387,390,393,396,
 
-	{0,1,1,1},
+	399,402,405,408,411,414,418,421,424,427,430,433,436,439,442,445,
 
-	{1,1,1,1},
+	448,451,454,457,460,464,467,470,473,476,479,482,485,488,491,494,
 
-};
+	497,500,503,506,509,512,515,518,521,525,528,531,534,537,540,543,
 
+	546,549,552,555,558,561,564,567,570,573,576,579,582,585,588,591,
 
+	594,597,600,603,606,609,612,615,618,621,624,627,630,633,636,639,
 
-void YM2612::State::PowerOn(void)
+	642,645,648,651,654,657,660,663,666,669,672,675,678,681,684,686,
 
-{
+	689,692,695,698,701,704,707,710,713,716,719,722,725,728,731,734,
 
-	Reset();
+	737,739,742,745,748,751,754,757,760,763,766,769,772,775,777,780,
 
-}
+	783,786,789,792,795,798,801,804,806,809,812,815,818,821,824,827,
 
-void YM2612::State::Reset(void)
+	829,832,835,838,841,844,847,849,852,855,858,861,864,867,869,872,
 
-{
+	875,878,881,884,886,889,892,895,898,901,903,906,909,912,915,917,
 
-	deviceTimeInNS=0;
+	920,923,926,929,932,934,937,940,943,945,948,951,954,957,959,962,
 
-	lastTickTimeInNS=0;
+	965,968,970,973,976,979,982,984,987,990,993,995,998,1001,1003,1006,
 
-	for(auto &c : channels)
+	1009,1012,1014,1017,1020,1023,1025,1028,1031,1033,1036,1039,1042,1044,1047,1050,
 
-	{
+	1052,1055,1058,1060,1063,1066,1069,1071,1074,1077,1079,1082,1085,1087,1090,1093,
 
-		c.Clear();
+	1095,1098,1100,1103,1106,1108,1111,1114,1116,1119,1122,1124,1127,1129,1132,1135,
 
-	}
+	1137,1140,1143,1145,1148,1150,1153,1156,1158,1161,1163,1166,1168,1171,1174,1176,
 
-	for(auto &f : F_NUM_3CH)
+	1179,1181,1184,1186,1189,1192,1194,1197,1199,1202,1204,1207,1209,1212,1214,1217,
 
-	{
+	1219,1222,1225,1227,1230,1232,1235,1237,1240,1242,1245,1247,1250,1252,1255,1257,
 
-		f=0;
+	1259,1262,1264,1267,1269,1272,1274,1277,1279,1282,1284,1287,1289,1291,1294,1296,
 
-	}
+	1299,1301,1304,1306,1308,1311,1313,1316,1318,1320,1323,1325,1328,1330,1332,1335,
 
-	for(auto &b : BLOCK_3CH)
+	1337,1340,1342,1344,1347,1349,1351,1354,1356,1358,1361,1363,1366,1368,1370,1373,
 
-	{
+	1375,1377,1380,1382,1384,1386,1389,1391,1393,1396,1398,1400,1403,1405,1407,1409,
 
-		b=0;
+	1412,1414,1416,1418,1421,1423,1425,1428,1430,1432,1434,1437,1439,1441,1443,1445,
 
-	}
+	1448,1450,1452,1454,1457,1459,1461,1463,1465,1468,1470,1472,1474,1476,1478,1481,
 
-	for(auto &f : F_NUM_6CH)
+	1483,1485,1487,1489,1491,1494,1496,1498,1500,1502,1504,1506,1509,1511,1513,1515,
 
-	{
+	1517,1519,1521,1523,1525,1527,1530,1532,1534,1536,1538,1540,1542,1544,1546,1548,
 
-		f=0;
+	1550,1552,1554,1556,1558,1560,1563,1565,1567,1569,1571,1573,1575,1577,1579,1581,
 
-	}
+	1583,1585,1587,1589,1591,1593,1595,1596,1598,1600,1602,1604,1606,1608,1610,1612,
 
-	for(auto &b : BLOCK_6CH)
+	1614,1616,1618,1620,1622,1624,1626,1627,1629,1631,1633,1635,1637,1639,1641,1643,
 
-	{
+	1644,1646,1648,1650,1652,1654,1656,1657,1659,1661,1663,1665,1667,1668,1670,1672,
 
-		b=0;
+	1674,1676,1678,1679,1681,1683,1685,1686,1688,1690,1692,1694,1695,1697,1699,1701,
 
-	}
+	1702,1704,1706,1708,1709,1711,1713,1714,1716,1718,1720,1721,1723,1725,1726,1728,
 
-	for(auto &r : reg)
+	1730,1731,1733,1735,1736,1738,1740,1741,1743,1745,1746,1748,1750,1751,1753,1755,
 
-	{
+	1756,1758,1759,1761,1763,1764,1766,1767,1769,1770,1772,1774,1775,1777,1778,1780,
 
-		r=0;
+	1781,1783,1785,1786,1788,1789,1791,1792,1794,1795,1797,1798,1800,1801,1803,1804,
 
-	}
+	1806,1807,1809,1810,1812,1813,1814,1816,1817,1819,1820,1822,1823,1825,1826,1827,
 
-	for(auto &t : timerCounter)
+	1829,1830,1832,1833,1834,1836,1837,1839,1840,1841,1843,1844,1845,1847,1848,1850,
 
-	{
+	1851,1852,1854,1855,1856,1858,1859,1860,1861,1863,1864,1865,1867,1868,1869,1871,
 
-		t=0;
+	1872,1873,1874,1876,1877,1878,1879,1881,1882,1883,1884,1886,1887,1888,1889,1890,
 
-	}
+	1892,1893,1894,1895,1896,1898,1899,1900,1901,1902,1903,1905,1906,1907,1908,1909,
 
-	for(auto &b : timerUp)
+	1910,1911,1913,1914,1915,1916,1917,1918,1919,1920,1921,1922,1924,1925,1926,1927,
 
-	{
+	1928,1929,1930,1931,1932,1933,1934,1935,1936,1937,1938,1939,1940,1941,1942,1943,
 
-		b=false;
+	1944,1945,1946,1947,1948,1949,1950,1951,1952,1953,1954,1955,1956,1957,1957,1958,
 
-	}
+	1959,1960,1961,1962,1963,1964,1965,1966,1966,1967,1968,1969,1970,1971,1972,1972,
 
-	for(auto &ch : channels)
+	1973,1974,1975,1976,1977,1977,1978,1979,1980,1981,1981,1982,1983,1984,1985,1985,
 
-	{
+	1986,1987,1988,1988,1989,1990,1991,1991,1992,1993,1994,1994,1995,1996,1996,1997,
 
-		for(auto &slot : ch.slots)
+	1998,1998,1999,2000,2000,2001,2002,2002,2003,2004,2004,2005,2006,2006,2007,2008,
 
-		{
+	2008,2009,2009,2010,2011,2011,2012,2012,2013,2013,2014,2015,2015,2016,2016,2017,
 
-			slot.lastDbX100Cache=0;
+	2017,2018,2018,2019,2019,2020,2020,2021,2021,2022,2022,2023,2023,2024,2024,2025,
 
-		}
+	2025,2026,2026,2027,2027,2028,2028,2028,2029,2029,2030,2030,2031,2031,2031,2032,
 
-	}
+	2032,2032,2033,2033,2034,2034,2034,2035,2035,2035,2036,2036,2036,2037,2037,2037,
 
-	playingCh=0;
+	2038,2038,2038,2039,2039,2039,2039,2040,2040,2040,2040,2041,2041,2041,2041,2042,
 
-	LFO=0;
+	2042,2042,2042,2043,2043,2043,2043,2043,2044,2044,2044,2044,2044,2045,2045,2045,
 
-	FREQCTRL=0;
+	2045,2045,2045,2045,2046,2046,2046,2046,2046,2046,2046,2046,2047,2047,2047,2047,
 
-}
+	2047,2047,2047,2047,2047,2047,2047,2047,2047,2047,2047,2047,2047,2047,2047,2047,
 
+	2048,2047,2047,2047,2047,2047,2047,2047,2047,2047,2047,2047,2047,2047,2047,2047,
 
+	2047,2047,2047,2047,2047,2046,2046,2046,2046,2046,2046,2046,2046,2045,2045,2045,
 
-////////////////////////////////////////////////////////////
+	2045,2045,2045,2045,2044,2044,2044,2044,2044,2043,2043,2043,2043,2043,2042,2042,
 
+	2042,2042,2041,2041,2041,2041,2040,2040,2040,2040,2039,2039,2039,2039,2038,2038,
 
+	2038,2037,2037,2037,2036,2036,2036,2035,2035,2035,2034,2034,2034,2033,2033,2032,
 
-YM2612::YM2612()
+	2032,2032,2031,2031,2031,2030,2030,2029,2029,2028,2028,2028,2027,2027,2026,2026,
 
-{
+	2025,2025,2024,2024,2023,2023,2022,2022,2021,2021,2020,2020,2019,2019,2018,2018,
 
-	std::cout << "YM2612 Emulator for Tsugaru [Tsugaru-Ben]" << std::endl;
+	2017,2017,2016,2016,2015,2015,2014,2013,2013,2012,2012,2011,2011,2010,2009,2009,
 
+	2008,2008,2007,2006,2006,2005,2004,2004,2003,2002,2002,2001,2000,2000,1999,1998,
 
+	1998,1997,1996,1996,1995,1994,1994,1993,1992,1991,1991,1990,1989,1988,1988,1987,
 
-	MakeSineTable();
+	1986,1985,1985,1984,1983,1982,1981,1981,1980,1979,1978,1977,1977,1976,1975,1974,
 
-	MakeTLtoDB100();
+	1973,1972,1972,1971,1970,1969,1968,1967,1966,1966,1965,1964,1963,1962,1961,1960,
 
-	MakeSLtoDB100();
+	1959,1958,1957,1957,1956,1955,1954,1953,1952,1951,1950,1949,1948,1947,1946,1945,
 
-	MakeDB100to4095Scale();
+	1944,1943,1942,1941,1940,1939,1938,1937,1936,1935,1934,1933,1932,1931,1930,1929,
 
-	MakeLinearScaleTable();
+	1928,1927,1926,1925,1924,1922,1921,1920,1919,1918,1917,1916,1915,1914,1913,1911,
 
-	MakeAttackProfileTable();
+	1910,1909,1908,1907,1906,1905,1903,1902,1901,1900,1899,1898,1896,1895,1894,1893,
 
-	PowerOn();
+	1892,1890,1889,1888,1887,1886,1884,1883,1882,1881,1879,1878,1877,1876,1874,1873,
 
-}
+	1872,1871,1869,1868,1867,1865,1864,1863,1861,1860,1859,1858,1856,1855,1854,1852,
 
-YM2612::~YM2612()
+	1851,1850,1848,1847,1845,1844,1843,1841,1840,1839,1837,1836,1834,1833,1832,1830,
 
-{
+	1829,1827,1826,1825,1823,1822,1820,1819,1817,1816,1814,1813,1812,1810,1809,1807,
 
-}
+	1806,1804,1803,1801,1800,1798,1797,1795,1794,1792,1791,1789,1788,1786,1785,1783,
 
+	1781,1780,1778,1777,1775,1774,1772,1770,1769,1767,1766,1764,1763,1761,1759,1758,
 
+	1756,1755,1753,1751,1750,1748,1746,1745,1743,1741,1740,1738,1736,1735,1733,1731,
 
-void YM2612::MakeSineTable(void)
+	1730,1728,1726,1725,1723,1721,1720,1718,1716,1714,1713,1711,1709,1708,1706,1704,
 
-{
+	1702,1701,1699,1697,1695,1694,1692,1690,1688,1686,1685,1683,1681,1679,1678,1676,
 
-	const double PI=3.14159265358979323;
+	1674,1672,1670,1668,1667,1665,1663,1661,1659,1657,1656,1654,1652,1650,1648,1646,
 
-	for(int i=0; i<PHASE_STEPS; ++i)
+	1644,1643,1641,1639,1637,1635,1633,1631,1629,1627,1626,1624,1622,1620,1618,1616,
 
-	{
+	1614,1612,1610,1608,1606,1604,1602,1600,1598,1596,1595,1593,1591,1589,1587,1585,
 
-		double a=2.0*PI*(double)i/(double)PHASE_STEPS;
+	1583,1581,1579,1577,1575,1573,1571,1569,1567,1565,1563,1560,1558,1556,1554,1552,
 
-		double s=sin(a);
+	1550,1548,1546,1544,1542,1540,1538,1536,1534,1532,1530,1527,1525,1523,1521,1519,
 
-		s*=(double)(UNSCALED_MAX);
+	1517,1515,1513,1511,1509,1506,1504,1502,1500,1498,1496,1494,1491,1489,1487,1485,
 
-		sineTable[i]=(int)s;
+	1483,1481,1478,1476,1474,1472,1470,1468,1465,1463,1461,1459,1457,1454,1452,1450,
 
-		// printf("%+-6d,",(int)s);
+	1448,1445,1443,1441,1439,1437,1434,1432,1430,1428,1425,1423,1421,1418,1416,1414,
 
-		// if(i%16==15)
+	1412,1409,1407,1405,1403,1400,1398,1396,1393,1391,1389,1386,1384,1382,1380,1377,
 
-		// {
+	1375,1373,1370,1368,1366,1363,1361,1358,1356,1354,1351,1349,1347,1344,1342,1340,
 
-		// 	printf("\n");
+	1337,1335,1332,1330,1328,1325,1323,1320,1318,1316,1313,1311,1308,1306,1304,1301,
 
-		// }
+	1299,1296,1294,1291,1289,1287,1284,1282,1279,1277,1274,1272,1269,1267,1264,1262,
 
-	}
+	1259,1257,1255,1252,1250,1247,1245,1242,1240,1237,1235,1232,1230,1227,1225,1222,
 
-}
+	1219,1217,1214,1212,1209,1207,1204,1202,1199,1197,1194,1192,1189,1186,1184,1181,
 
-void YM2612::MakeTLtoDB100(void)
+	1179,1176,1174,1171,1168,1166,1163,1161,1158,1156,1153,1150,1148,1145,1143,1140,
 
-{
+	1137,1135,1132,1129,1127,1124,1122,1119,1116,1114,1111,1108,1106,1103,1100,1098,
 
-	for(unsigned int TL=0; TL<128; ++TL)
+	1095,1093,1090,1087,1085,1082,1079,1077,1074,1071,1069,1066,1063,1060,1058,1055,
 
-	{
+	1052,1050,1047,1044,1042,1039,1036,1033,1031,1028,1025,1023,1020,1017,1014,1012,
 
-		TLtoDB100[TL]=TL*75;
+	1009,1006,1003,1001,998,995,993,990,987,984,982,979,976,973,970,968,
 
-	}
+	965,962,959,957,954,951,948,945,943,940,937,934,932,929,926,923,
 
-}
+	920,917,915,912,909,906,903,901,898,895,892,889,886,884,881,878,
 
-void YM2612::MakeSLtoDB100(void)
+	875,872,869,867,864,861,858,855,852,849,847,844,841,838,835,832,
 
-{
+	829,827,824,821,818,815,812,809,806,804,801,798,795,792,789,786,
 
-	for(unsigned int SL=0; SL<16; ++SL)
+	783,780,777,775,772,769,766,763,760,757,754,751,748,745,742,739,
 
-	{
+	737,734,731,728,725,722,719,716,713,710,707,704,701,698,695,692,
 
-		SLtoDB100[SL]=SL*300;
+	689,686,684,681,678,675,672,669,666,663,660,657,654,651,648,645,
 
-	}
+	642,639,636,633,630,627,624,621,618,615,612,609,606,603,600,597,
 
-}
+	594,591,588,585,582,579,576,573,570,567,564,561,558,555,552,549,
 
-void YM2612::MakeDB100to4095Scale(void)
+	546,543,540,537,534,531,528,525,521,518,515,512,509,506,503,500,
 
-{
+	497,494,491,488,485,482,479,476,473,470,467,464,460,457,454,451,
 
-	// To convert 0 to 96dB (log scale) to amplitude 0 to 4095,
+	448,445,442,439,436,433,430,427,424,421,418,414,411,408,405,402,
 
-	//    dB=20*log10(C*amplitude)
+	399,396,393,390,387,384,381,377,374,371,368,365,362,359,356,353,
 
-	//    96=20*log10(C*4095)
+	350,347,343,340,337,334,331,328,325,322,319,316,312,309,306,303,
 
-	//    4.8=log10(C*4095)
+	300,297,294,291,288,284,281,278,275,272,269,266,263,260,256,253,
 
-	//    10^4.8=C*4095
+	250,247,244,241,238,235,231,228,225,222,219,216,213,210,206,203,
 
-	//    C=(10^4.8)/4095.0
+	200,197,194,191,188,185,181,178,175,172,169,166,163,160,156,153,
 
-	const double C=pow(10.0,4.8)/4095.0;
+	150,147,144,141,138,134,131,128,125,122,119,116,113,109,106,103,
 
+	100,97,94,91,87,84,81,78,75,72,69,65,62,59,56,53,
 
+	50,47,43,40,37,34,31,28,25,21,18,15,12,9,6,3,
 
-	//    dB=20*log10(C*amplitude)
+	0,-3,-6,-9,-12,-15,-18,-21,-25,-28,-31,-34,-37,-40,-43,-47,
 
-	//    log10(C*amplitude)=dB/20
+	-50,-53,-56,-59,-62,-65,-69,-72,-75,-78,-81,-84,-87,-91,-94,-97,
 
-	//    10^(dB/20)=C*amplitude
+	-100,-103,-106,-109,-113,-116,-119,-122,-125,-128,-131,-134,-138,-141,-144,-147,
 
-	//    amplitude=(10^(dB/20))/C
+	-150,-153,-156,-160,-163,-166,-169,-172,-175,-178,-181,-185,-188,-191,-194,-197,
 
+	-200,-203,-206,-210,-213,-216,-219,-222,-225,-228,-231,-235,-238,-241,-244,-247,
 
+	-250,-253,-256,-260,-263,-266,-269,-272,-275,-278,-281,-284,-288,-291,-294,-297,
 
-	for(int i=0; i<=9600; ++i)
+	-300,-303,-306,-309,-312,-316,-319,-322,-325,-328,-331,-334,-337,-340,-343,-347,
 
-	{
+	-350,-353,-356,-359,-362,-365,-368,-371,-374,-377,-381,-384,-387,-390,-393,-396,
 
-		double dB=(double)i/100.0;
+	-399,-402,-405,-408,-411,-414,-418,-421,-424,-427,-430,-433,-436,-439,-442,-445,
 
-		DB100to4095Scale[i]=(unsigned int)(pow(10.0,dB/20.0)/C);
+	-448,-451,-454,-457,-460,-464,-467,-470,-473,-476,-479,-482,-485,-488,-491,-494,
 
-		// if(0==i%100)
+	-497,-500,-503,-506,-509,-512,-515,-518,-521,-525,-528,-531,-534,-537,-540,-543,
 
-		// {
+	-546,-549,-552,-555,-558,-561,-564,-567,-570,-573,-576,-579,-582,-585,-588,-591,
 
-		// 	printf("%4ddB -> %4d\n",i/100,DB100to4095Scale[i]);
+	-594,-597,-600,-603,-606,-609,-612,-615,-618,-621,-624,-627,-630,-633,-636,-639,
 
-		// }
+	-642,-645,-648,-651,-654,-657,-660,-663,-666,-669,-672,-675,-678,-681,-684,-686,
 
-	}
+	-689,-692,-695,-698,-701,-704,-707,-710,-713,-716,-719,-722,-725,-728,-731,-734,
 
-	for(int i=0; i<4096; ++i)
+	-737,-739,-742,-745,-748,-751,-754,-757,-760,-763,-766,-769,-772,-775,-777,-780,
 
-	{
+	-783,-786,-789,-792,-795,-798,-801,-804,-806,-809,-812,-815,-818,-821,-824,-827,
 
-		double dB100=100.0*(20.0*log10(C*(double)i));
+	-829,-832,-835,-838,-841,-844,-847,-849,-852,-855,-858,-861,-864,-867,-869,-872,
 
-		DB100from4095Scale[i]=(unsigned int)dB100;
+	-875,-878,-881,-884,-886,-889,-892,-895,-898,-901,-903,-906,-909,-912,-915,-917,
 
-	}
+	-920,-923,-926,-929,-932,-934,-937,-940,-943,-945,-948,-951,-954,-957,-959,-962,
 
-}
+	-965,-968,-970,-973,-976,-979,-982,-984,-987,-990,-993,-995,-998,-1001,-1003,-1006,
 
-void YM2612::MakeLinearScaleTable(void)
+	-1009,-1012,-1014,-1017,-1020,-1023,-1025,-1028,-1031,-1033,-1036,-1039,-1042,-1044,-1047,-1050,
 
-{
+	-1052,-1055,-1058,-1060,-1063,-1066,-1069,-1071,-1074,-1077,-1079,-1082,-1085,-1087,-1090,-1093,
 
-	for(unsigned int i=0; i<=4096; ++i)
+	-1095,-1098,-1100,-1103,-1106,-1108,-1111,-1114,-1116,-1119,-1122,-1124,-1127,-1129,-1132,-1135,
 
-	{
+	-1137,-1140,-1143,-1145,-1148,-1150,-1153,-1156,-1158,-1161,-1163,-1166,-1168,-1171,-1174,-1176,
 
-		linear4096to9600[i]=i*9600/4096;
+	-1179,-1181,-1184,-1186,-1189,-1192,-1194,-1197,-1199,-1202,-1204,-1207,-1209,-1212,-1214,-1217,
 
-	}
+	-1219,-1222,-1225,-1227,-1230,-1232,-1235,-1237,-1240,-1242,-1245,-1247,-1250,-1252,-1255,-1257,
 
-	for(unsigned int i=0; i<=9600; ++i)
+	-1259,-1262,-1264,-1267,-1269,-1272,-1274,-1277,-1279,-1282,-1284,-1287,-1289,-1291,-1294,-1296,
 
-	{
+	-1299,-1301,-1304,-1306,-1308,-1311,-1313,-1316,-1318,-1320,-1323,-1325,-1328,-1330,-1332,-1335,
 
-		linear9600to4096[i]=i*4096/9600;
+	-1337,-1340,-1342,-1344,-1347,-1349,-1351,-1354,-1356,-1358,-1361,-1363,-1366,-1368,-1370,-1373,
 
-	}
+	-1375,-1377,-1380,-1382,-1384,-1386,-1389,-1391,-1393,-1396,-1398,-1400,-1403,-1405,-1407,-1409,
 
-}
+	-1412,-1414,-1416,-1418,-1421,-1423,-1425,-1428,-1430,-1432,-1434,-1437,-1439,-1441,-1443,-1445,
 
+	-1448,-1450,-1452,-1454,-1457,-1459,-1461,-1463,-1465,-1468,-1470,-1472,-1474,-1476,-1478,-1481,
 
+	-1483,-1485,-1487,-1489,-1491,-1494,-1496,-1498,-1500,-1502,-1504,-1506,-1509,-1511,-1513,-1515,
 
-void YM2612::MakeAttackProfileTable(void)
+	-1517,-1519,-1521,-1523,-1525,-1527,-1530,-1532,-1534,-1536,-1538,-1540,-1542,-1544,-1546,-1548,
 
-{
+	-1550,-1552,-1554,-1556,-1558,-1560,-1563,-1565,-1567,-1569,-1571,-1573,-1575,-1577,-1579,-1581,
 
-	// YM2612 manual tells that the output level increases during the attack phase is exponential,
+	-1583,-1585,-1587,-1589,-1591,-1593,-1595,-1596,-1598,-1600,-1602,-1604,-1606,-1608,-1610,-1612,
 
-	// which can open up a lot of interpretations.  Is it like dB(t)=C*k^t  ?
+	-1614,-1616,-1618,-1620,-1622,-1624,-1626,-1627,-1629,-1631,-1633,-1635,-1637,-1639,-1641,-1643,
 
-	// By looking at fmgen by Cisc, it seems to be the difference from the peak output decreases
+	-1644,-1646,-1648,-1650,-1652,-1654,-1656,-1657,-1659,-1661,-1663,-1665,-1667,-1668,-1670,-1672,
 
-	// exponentially.
+	-1674,-1676,-1678,-1679,-1681,-1683,-1685,-1686,-1688,-1690,-1692,-1694,-1695,-1697,-1699,-1701,
 
-	//
+	-1702,-1704,-1706,-1708,-1709,-1711,-1713,-1714,-1716,-1718,-1720,-1721,-1723,-1725,-1726,-1728,
 
-	// If the level difference from the maximum level is diff(i),
+	-1730,-1731,-1733,-1735,-1736,-1738,-1740,-1741,-1743,-1745,-1746,-1748,-1750,-1751,-1753,-1755,
 
-	//     diff(i+1)=diff(i)*k   {0<t<1}
+	-1756,-1758,-1759,-1761,-1763,-1764,-1766,-1767,-1769,-1770,-1772,-1774,-1775,-1777,-1778,-1780,
 
-	// Then,
+	-1781,-1783,-1785,-1786,-1788,-1789,-1791,-1792,-1794,-1795,-1797,-1798,-1800,-1801,-1803,-1804,
 
-	//     diff(i)=diff(0)*(k^i) {0<t<1}
+	-1806,-1807,-1809,-1810,-1812,-1813,-1814,-1816,-1817,-1819,-1820,-1822,-1823,-1825,-1826,-1827,
 
-	// Let's say the maximum is 4096.  I want to say diff reaches 0 at t=4096, but well it won't be zero.
+	-1829,-1830,-1832,-1833,-1834,-1836,-1837,-1839,-1840,-1841,-1843,-1844,-1845,-1847,-1848,-1850,
 
-	// So, let's say diff reaches 1 at t=409t instead.  The initial difference is 4096.  Then,
+	-1851,-1852,-1854,-1855,-1856,-1858,-1859,-1860,-1861,-1863,-1864,-1865,-1867,-1868,-1869,-1871,
 
-	// 
+	-1872,-1873,-1874,-1876,-1877,-1878,-1879,-1881,-1882,-1883,-1884,-1886,-1887,-1888,-1889,-1890,
 
-	//     1=4096*t^4095, 
+	-1892,-1893,-1894,-1895,-1896,-1898,-1899,-1900,-1901,-1902,-1903,-1905,-1906,-1907,-1908,-1909,
 
-	// 
+	-1910,-1911,-1913,-1914,-1915,-1916,-1917,-1918,-1919,-1920,-1921,-1922,-1924,-1925,-1926,-1927,
 
-	// From there, I can calculate t.  And then values for the table.
+	-1928,-1929,-1930,-1931,-1932,-1933,-1934,-1935,-1936,-1937,-1938,-1939,-1940,-1941,-1942,-1943,
 
+	-1944,-1945,-1946,-1947,-1948,-1949,-1950,-1951,-1952,-1953,-1954,-1955,-1956,-1957,-1957,-1958,
 
+	-1959,-1960,-1961,-1962,-1963,-1964,-1965,-1966,-1966,-1967,-1968,-1969,-1970,-1971,-1972,-1972,
 
-	const double lastErr=0.014;
+	-1973,-1974,-1975,-1976,-1977,-1977,-1978,-1979,-1980,-1981,-1981,-1982,-1983,-1984,-1985,-1985,
 
-	const double t=pow(lastErr,1.0/4096.0);
+	-1986,-1987,-1988,-1988,-1989,-1990,-1991,-1991,-1992,-1993,-1994,-1994,-1995,-1996,-1996,-1997,
 
-	for(int i=0; i<4096; ++i)
+	-1998,-1998,-1999,-2000,-2000,-2001,-2002,-2002,-2003,-2004,-2004,-2005,-2006,-2006,-2007,-2008,
 
-	{
+	-2008,-2009,-2009,-2010,-2011,-2011,-2012,-2012,-2013,-2013,-2014,-2015,-2015,-2016,-2016,-2017,
 
-		double y=(1.0-pow(t,(double)i))/(1.0-lastErr);
+	-2017,-2018,-2018,-2019,-2019,-2020,-2020,-2021,-2021,-2022,-2022,-2023,-2023,-2024,-2024,-2025,
 
-		attackExp[i]=(int)(y*4096);
+	-2025,-2026,-2026,-2027,-2027,-2028,-2028,-2028,-2029,-2029,-2030,-2030,-2031,-2031,-2031,-2032,
 
-	}
+	-2032,-2032,-2033,-2033,-2034,-2034,-2034,-2035,-2035,-2035,-2036,-2036,-2036,-2037,-2037,-2037,
 
+	-2038,-2038,-2038,-2039,-2039,-2039,-2039,-2040,-2040,-2040,-2040,-2041,-2041,-2041,-2041,-2042,
 
+	-2042,-2042,-2042,-2043,-2043,-2043,-2043,-2043,-2044,-2044,-2044,-2044,-2044,-2045,-2045,-2045,
 
-	int j=0;
+	-2045,-2045,-2045,-2045,-2046,-2046,-2046,-2046,-2046,-2046,-2046,-2046,-2047,-2047,-2047,-2047,
 
-	for(int i=0; i<4096; ++i)
+	-2047,-2047,-2047,-2047,-2047,-2047,-2047,-2047,-2047,-2047,-2047,-2047,-2047,-2047,-2047,-2047,
 
-	{
+	-2048,-2047,-2047,-2047,-2047,-2047,-2047,-2047,-2047,-2047,-2047,-2047,-2047,-2047,-2047,-2047,
 
-		for(; j<=attackExp[i+1]; ++j)
+	-2047,-2047,-2047,-2047,-2047,-2046,-2046,-2046,-2046,-2046,-2046,-2046,-2046,-2045,-2045,-2045,
 
-		{
+	-2045,-2045,-2045,-2045,-2044,-2044,-2044,-2044,-2044,-2043,-2043,-2043,-2043,-2043,-2042,-2042,
 
-			attackExpInverse[j]=i;
+	-2042,-2042,-2041,-2041,-2041,-2041,-2040,-2040,-2040,-2040,-2039,-2039,-2039,-2039,-2038,-2038,
 
-		}
+	-2038,-2037,-2037,-2037,-2036,-2036,-2036,-2035,-2035,-2035,-2034,-2034,-2034,-2033,-2033,-2032,
 
-	}
+	-2032,-2032,-2031,-2031,-2031,-2030,-2030,-2029,-2029,-2028,-2028,-2028,-2027,-2027,-2026,-2026,
 
-}
+	-2025,-2025,-2024,-2024,-2023,-2023,-2022,-2022,-2021,-2021,-2020,-2020,-2019,-2019,-2018,-2018,
 
+	-2017,-2017,-2016,-2016,-2015,-2015,-2014,-2013,-2013,-2012,-2012,-2011,-2011,-2010,-2009,-2009,
 
+	-2008,-2008,-2007,-2006,-2006,-2005,-2004,-2004,-2003,-2002,-2002,-2001,-2000,-2000,-1999,-1998,
 
-void YM2612::PowerOn(void)
+	-1998,-1997,-1996,-1996,-1995,-1994,-1994,-1993,-1992,-1991,-1991,-1990,-1989,-1988,-1988,-1987,
 
-{
+	-1986,-1985,-1985,-1984,-1983,-1982,-1981,-1981,-1980,-1979,-1978,-1977,-1977,-1976,-1975,-1974,
 
-	state.PowerOn();
+	-1973,-1972,-1972,-1971,-1970,-1969,-1968,-1967,-1966,-1966,-1965,-1964,-1963,-1962,-1961,-1960,
 
-}
+	-1959,-1958,-1957,-1957,-1956,-1955,-1954,-1953,-1952,-1951,-1950,-1949,-1948,-1947,-1946,-1945,
 
-void YM2612::Reset(void)
+	-1944,-1943,-1942,-1941,-1940,-1939,-1938,-1937,-1936,-1935,-1934,-1933,-1932,-1931,-1930,-1929,
 
-{
+	-1928,-1927,-1926,-1925,-1924,-1922,-1921,-1920,-1919,-1918,-1917,-1916,-1915,-1914,-1913,-1911,
 
-	state.Reset();
+	-1910,-1909,-1908,-1907,-1906,-1905,-1903,-1902,-1901,-1900,-1899,-1898,-1896,-1895,-1894,-1893,
 
-}
+	-1892,-1890,-1889,-1888,-1887,-1886,-1884,-1883,-1882,-1881,-1879,-1878,-1877,-1876,-1874,-1873,
 
-unsigned int YM2612::WriteRegister(unsigned int channelBase,unsigned int reg,unsigned int value)
+	-1872,-1871,-1869,-1868,-1867,-1865,-1864,-1863,-1861,-1860,-1859,-1858,-1856,-1855,-1854,-1852,
 
-{
+	-1851,-1850,-1848,-1847,-1845,-1844,-1843,-1841,-1840,-1839,-1837,-1836,-1834,-1833,-1832,-1830,
 
-	if(true==takeRegLog)
+	-1829,-1827,-1826,-1825,-1823,-1822,-1820,-1819,-1817,-1816,-1814,-1813,-1812,-1810,-1809,-1807,
 
-	{
+	-1806,-1804,-1803,-1801,-1800,-1798,-1797,-1795,-1794,-1792,-1791,-1789,-1788,-1786,-1785,-1783,
 
-		RegWriteLog rwl;
+	-1781,-1780,-1778,-1777,-1775,-1774,-1772,-1770,-1769,-1767,-1766,-1764,-1763,-1761,-1759,-1758,
 
-		rwl.chBase=(unsigned char)channelBase;
+	-1756,-1755,-1753,-1751,-1750,-1748,-1746,-1745,-1743,-1741,-1740,-1738,-1736,-1735,-1733,-1731,
 
-		rwl.reg=(unsigned char)reg;
+	-1730,-1728,-1726,-1725,-1723,-1721,-1720,-1718,-1716,-1714,-1713,-1711,-1709,-1708,-1706,-1704,
 
-		rwl.data=(unsigned char)value;
+	-1702,-1701,-1699,-1697,-1695,-1694,-1692,-1690,-1688,-1686,-1685,-1683,-1681,-1679,-1678,-1676,
 
-		rwl.count=1;
+	-1674,-1672,-1670,-1668,-1667,-1665,-1663,-1661,-1659,-1657,-1656,-1654,-1652,-1650,-1648,-1646,
 
-		if(0<regWriteLog.size() &&
+	-1644,-1643,-1641,-1639,-1637,-1635,-1633,-1631,-1629,-1627,-1626,-1624,-1622,-1620,-1618,-1616,
 
-		   regWriteLog.back().chBase==rwl.chBase &&
+	-1614,-1612,-1610,-1608,-1606,-1604,-1602,-1600,-1598,-1596,-1595,-1593,-1591,-1589,-1587,-1585,
 
-		   regWriteLog.back().reg==rwl.reg &&
+	-1583,-1581,-1579,-1577,-1575,-1573,-1571,-1569,-1567,-1565,-1563,-1560,-1558,-1556,-1554,-1552,
 
-		   regWriteLog.back().data==rwl.data)
+	-1550,-1548,-1546,-1544,-1542,-1540,-1538,-1536,-1534,-1532,-1530,-1527,-1525,-1523,-1521,-1519,
 
-		{
+	-1517,-1515,-1513,-1511,-1509,-1506,-1504,-1502,-1500,-1498,-1496,-1494,-1491,-1489,-1487,-1485,
 
-			++regWriteLog.back().count;
+	-1483,-1481,-1478,-1476,-1474,-1472,-1470,-1468,-1465,-1463,-1461,-1459,-1457,-1454,-1452,-1450,
 
-		}
+	-1448,-1445,-1443,-1441,-1439,-1437,-1434,-1432,-1430,-1428,-1425,-1423,-1421,-1418,-1416,-1414,
 
-		else
+	-1412,-1409,-1407,-1405,-1403,-1400,-1398,-1396,-1393,-1391,-1389,-1386,-1384,-1382,-1380,-1377,
 
-		{
+	-1375,-1373,-1370,-1368,-1366,-1363,-1361,-1358,-1356,-1354,-1351,-1349,-1347,-1344,-1342,-1340,
 
-			regWriteLog.push_back(rwl);
+	-1337,-1335,-1332,-1330,-1328,-1325,-1323,-1320,-1318,-1316,-1313,-1311,-1308,-1306,-1304,-1301,
 
-		}
+	-1299,-1296,-1294,-1291,-1289,-1287,-1284,-1282,-1279,-1277,-1274,-1272,-1269,-1267,-1264,-1262,
 
-	}
+	-1259,-1257,-1255,-1252,-1250,-1247,-1245,-1242,-1240,-1237,-1235,-1232,-1230,-1227,-1225,-1222,
 
-	unsigned int chStartPlaying=65535;
+	-1219,-1217,-1214,-1212,-1209,-1207,-1204,-1202,-1199,-1197,-1194,-1192,-1189,-1186,-1184,-1181,
 
-	static const unsigned int slotTwist[4]={0,2,1,3};
+	-1179,-1176,-1174,-1171,-1168,-1166,-1163,-1161,-1158,-1156,-1153,-1150,-1148,-1145,-1143,-1140,
 
-	reg&=255;
+	-1137,-1135,-1132,-1129,-1127,-1124,-1122,-1119,-1116,-1114,-1111,-1108,-1106,-1103,-1100,-1098,
 
-	auto prev=state.reg[reg];
+	-1095,-1093,-1090,-1087,-1085,-1082,-1079,-1077,-1074,-1071,-1069,-1066,-1063,-1060,-1058,-1055,
 
-	state.reg[reg]=value;
+	-1052,-1050,-1047,-1044,-1042,-1039,-1036,-1033,-1031,-1028,-1025,-1023,-1020,-1017,-1014,-1012,
 
-	if(REG_TIMER_CONTROL==reg)
+	-1009,-1006,-1003,-1001,-998,-995,-993,-990,-987,-984,-982,-979,-976,-973,-970,-968,
 
-	{
+	-965,-962,-959,-957,-954,-951,-948,-945,-943,-940,-937,-934,-932,-929,-926,-923,
 
-		// [2] pp. 202 RESET bits will be cleared immediately after set.
+	-920,-917,-915,-912,-909,-906,-903,-901,-898,-895,-892,-889,-886,-884,-881,-878,
 
-		// .... I interpret it as RESET bits are always read to zero.
+	-875,-872,-869,-867,-864,-861,-858,-855,-852,-849,-847,-844,-841,-838,-835,-832,
 
-		state.reg[REG_TIMER_CONTROL]&=0xCF;
+	-829,-827,-824,-821,-818,-815,-812,-809,-806,-804,-801,-798,-795,-792,-789,-786,
 
+	-783,-780,-777,-775,-772,-769,-766,-763,-760,-757,-754,-751,-748,-745,-742,-739,
 
+	-737,-734,-731,-728,-725,-722,-719,-716,-713,-710,-707,-704,-701,-698,-695,-692,
 
-		// LOAD bits are mysterious.
+	-689,-686,-684,-681,-678,-675,-672,-669,-666,-663,-660,-657,-654,-651,-648,-645,
 
-		// [2] pp.201 tells that writing 1 to LOAD bit resets the counter and start counting.
+	-642,-639,-636,-633,-630,-627,-624,-621,-618,-615,-612,-609,-606,-603,-600,-597,
 
-		// Towns OS's behavior does not seem to be agree with it.
+	-594,-591,-588,-585,-582,-579,-576,-573,-570,-567,-564,-561,-558,-555,-552,-549,
 
-		// Timer A interrupt handler writes 0x3F to register 0x27.  If I implement as [2] pp.201,
+	-546,-543,-540,-537,-534,-531,-528,-525,-521,-518,-515,-512,-509,-506,-503,-500,
 
-		// Timer B counter is reset when Timer A is up, or vise versa.
+	-497,-494,-491,-488,-485,-482,-479,-476,-473,-470,-467,-464,-460,-457,-454,-451,
 
-		// Slower one of Timer A or B will never be up.
+	-448,-445,-442,-439,-436,-433,-430,-427,-424,-421,-418,-414,-411,-408,-405,-402,
 
-		//
+	-399,-396,-393,-390,-387,-384,-381,-377,-374,-371,-368,-365,-362,-359,-356,-353,
 
-		// There are some possibilities:
+	-350,-347,-343,-340,-337,-334,-331,-328,-325,-322,-319,-316,-312,-309,-306,-303,
 
-		// (1) The timer counter resets on the rising edge of LOAD.  When timer is up, LOAD will be cleared.
+	-300,-297,-294,-291,-288,-284,-281,-278,-275,-272,-269,-266,-263,-260,-256,-253,
 
-		//     Therefore, writing LOAD=1 when LOAD is already 1 does nothing.
+	-250,-247,-244,-241,-238,-235,-231,-228,-225,-222,-219,-216,-213,-210,-206,-203,
 
-		// (2) Towns OS writes (0118:[0727H])|0x15 for Timer A or (0118:[0727H])|0x2A for Timer B for resetting the counter.
+	-200,-197,-194,-191,-188,-185,-181,-178,-175,-172,-169,-166,-163,-160,-156,-153,
 
-		//     0118:[0727H] is a cached value (or read back) from YM2612 register 27H.  If LOAD bits are always zero when
+	-150,-147,-144,-141,-138,-134,-131,-128,-125,-122,-119,-116,-113,-109,-106,-103,
 
-		//     read, it won't reset the timer when resetting the other timer.
+	-100,-97,-94,-91,-87,-84,-81,-78,-75,-72,-69,-65,-62,-59,-56,-53,
 
-		// (3) The timer counter is reloaded on LOAD=1 only if the timer is up.
+	-50,-47,-43,-40,-37,-34,-31,-28,-25,-21,-18,-15,-12,-9,-6,-3,
 
-        //
+};
 
-		// There are some web sites such as:
 
-		//   https://plutiedev.com/ym2612-registers#reg-27
 
-		//   https://www.smspower.org/maxim/Documents/YM2612
+// 100 times dB.  TLtoDB100[TL]=TL*75
 
-		//   https://wiki.megadrive.org/index.php?title=YM2612_Registers
+/*static*/ const unsigned int YM2612::TLtoDB100[128]=
 
-		// suggesting that LOAD bit means the timer is running.  If so, I guess (2) is unlikely.
+{
 
-		// With my elementary knowledge in FPGA programming, (1) looks to be more straight-forward.
+	0,75,150,225,300,375,450,525,600,675,750,825,900,975,1050,1125,
 
-		// Currently I go with (1).
+	1200,1275,1350,1425,1500,1575,1650,1725,1800,1875,1950,2025,2100,2175,2250,2325,
 
+	2400,2475,2550,2625,2700,2775,2850,2925,3000,3075,3150,3225,3300,3375,3450,3525,
 
+	3600,3675,3750,3825,3900,3975,4050,4125,4200,4275,4350,4425,4500,4575,4650,4725,
 
-		if(0==(prev&1) && 0!=(value&1)) // Load Timer A
+	4800,4875,4950,5025,5100,5175,5250,5325,5400,5475,5550,5625,5700,5775,5850,5925,
 
-		{
+	6000,6075,6150,6225,6300,6375,6450,6525,6600,6675,6750,6825,6900,6975,7050,7125,
 
-			unsigned int countHigh=state.reg[REG_TIMER_A_COUNT_HIGH];
+	7200,7275,7350,7425,7500,7575,7650,7725,7800,7875,7950,8025,8100,8175,8250,8325,
 
-			unsigned int countLow=state.reg[REG_TIMER_A_COUNT_LOW];
+	8400,8475,8550,8625,8700,8775,8850,8925,9000,9075,9150,9225,9300,9375,9450,9525,
 
-			auto count=(countHigh<<2)|(countLow&3);
+};
 
-			state.timerCounter[0]=count*TIMER_A_PER_TICK;
 
-		}
 
-		if(0==(prev&2) && 0!=(value&2)) // Load Timer B
+// 100 times dB.  SLtoDB100[SL]=SL*300
 
-		{
+/*static*/ const unsigned int YM2612::SLtoDB100[16]=
 
-			state.timerCounter[1]=(unsigned int)(state.reg[REG_TIMER_B_COUNT])*TIMER_B_PER_TICK;
+{
 
-		}
+	0,300,600,900,1200,1500,1800,2100,2400,2700,3000,3300,3600,3900,4200,4500,
 
-		if(value&4) // Enable Timer A Flag
+};
 
-		{
 
-		}
 
-		if(value&8) // Enable Timer B Flag
+// dB to 0 to 4095 scale.
 
-		{
+// To convert 0 to 96dB (log scale) to amplitude 0 to 4095,
 
-		}
+//    dB=20*log10(C*amplitude)
 
-		if(value&0x10) // Reset Timer A Flag
+//    96=20*log10(C*4095)
 
-		{
+//    4.8=log10(C*4095)
 
-			state.timerUp[0]=false;
+//    10^4.8=C*4095
 
-		}
+//    C=(10^4.8)/4095.0
 
-		if(value&0x20) // Reset Timer B Flag
+//
 
-		{
+//    dB=20*log10(C*amplitude)
 
-			state.timerUp[1]=false;
+//    log10(C*amplitude)=dB/20
 
-		}
+//    10^(dB/20)=C*amplitude
 
-	}
+//    amplitude=(10^(dB/20))/C
 
-	else if(REG_KEY_ON_OFF==reg)
+//
 
-	{
+// DB100to4095Scale[i]=(unsigned int)(pow(10.0,((double)i/100.0)/20.0)/C)
 
-		static unsigned int chTwist[8]={0,1,2,255,3,4,5,255};
+/*static*/ const unsigned int YM2612::DB100to4095Scale[9601]=
 
-		unsigned int ch=chTwist[value&7];
+{
 
-		if(ch<6)
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-		{
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-			unsigned int slotFlag=((value>>4)&0x0F);
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-			unsigned int onSlots=(~state.channels[ch].usingSlot)&slotFlag;
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-			unsigned int offSlots=(state.channels[ch].usingSlot&(~slotFlag))&0x0F;
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-			// Prob, this is the trigger to start playing.
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-			// F-BASIC386 first writes SLOT=0 then SLOT=0x0F.
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-			if(0!=onSlots)
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-			{
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-				// Play a tone
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-				KeyOn(ch,onSlots);
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-				chStartPlaying=ch;
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-			}
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-			if(0!=offSlots)
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-			{
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-				KeyOff(ch,offSlots);
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-			}
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-			state.channels[ch].usingSlot=slotFlag;
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-		}
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-	}
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-	else if(REG_LFO==reg)
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-	{
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-		state.LFO=(0!=(value&8));
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-		state.FREQCTRL=value&7;
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-	}
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-	else if(0xA8<=reg && reg<=0xAE) // Special 3CH F-Number/BLOCK
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-	{
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-		unsigned int slot=(reg&3);
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-		if(slot<3)
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-		{
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-			if(0==channelBase)
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-			{
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-				if(reg<0xAC)
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-				{
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-					state.F_NUM_3CH[slot]&=0xFF00;
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-					state.F_NUM_3CH[slot]|=value;
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-				}
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-				else
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-				{
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-					state.F_NUM_3CH[slot]&=0xFF;
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-					state.F_NUM_3CH[slot]|=((value&7)<<8);
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-					state.BLOCK_3CH[slot]=((value>>3)&7);
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-				}
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-			}
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-			else if(3==channelBase)
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-			{
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-				if(reg<0xAC)
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-				{
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-					state.F_NUM_6CH[slot]&=0xFF00;
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-					state.F_NUM_6CH[slot]|=value;
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-				}
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-				else
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-				{
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-					state.F_NUM_6CH[slot]&=0xFF;
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-					state.F_NUM_6CH[slot]|=((value&7)<<8);
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-					state.BLOCK_6CH[slot]=((value>>3)&7);
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-				}
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-			}
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-		}
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-	}
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-	else if(0x30<=reg && reg<=0x9E) // Per Channel per slot
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-	{
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-		unsigned int ch=(reg&3);
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-		if(ch<=2)
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-		{
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-			const unsigned int slot=slotTwist[((reg>>2)&3)];
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-			ch+=channelBase;
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-			switch(reg&0xF0)
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-			{
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-			case 0x30: // DT, MULTI
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-				state.channels[ch].slots[slot].DT=((value>>4)&7);
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-				state.channels[ch].slots[slot].MULTI=(value&15);
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-				break;
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-			case 0x40: // TL
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-				{
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-					auto prevTL=state.channels[ch].slots[slot].TL;
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-					state.channels[ch].slots[slot].TL=(value&0x7F);
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-					if(0!=(state.channels[ch].usingSlot&(1<<slot)))
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-					{
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-						auto prevLevel=127-prevTL;
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-						auto newLevel=127-state.channels[ch].slots[slot].TL;
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-						UpdateSlotEnvelope(state.channels[ch],state.channels[ch].slots[slot]);
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-						if(0!=prevLevel)
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-						{
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-							// Must be linear in dB scale.  To prepare for subsequent release phase.
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-							state.channels[ch].slots[slot].lastDbX100Cache*=newLevel;
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-							state.channels[ch].slots[slot].lastDbX100Cache/=prevLevel;
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-						}
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-					}
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-					else if(true==state.channels[ch].slots[slot].InReleasePhase)
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-					{
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-						auto prevLevel=127-prevTL;
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-						auto newLevel=127-state.channels[ch].slots[slot].TL;
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-						if(0!=prevLevel)
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-						{
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-							// Must be linear in dB scale.  lastDbX100Cache shouldn't matter already.
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-							state.channels[ch].slots[slot].ReleaseStartDbX100*=newLevel;
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-							state.channels[ch].slots[slot].ReleaseStartDbX100/=prevLevel;
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-						}
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-					}
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-				}
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-				break;
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-			case 0x50: // KS,AR
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-				state.channels[ch].slots[slot].KS=((value>>6)&3);
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-				state.channels[ch].slots[slot].AR=(value&0x1F);
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-				break;
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-			case 0x60: // AM,DR
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-				state.channels[ch].slots[slot].AM=((value>>7)&1);
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-				state.channels[ch].slots[slot].DR=(value&0x1F);
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-				break;
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-			case 0x70: // SR
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-				state.channels[ch].slots[slot].SR=(value&0x1F);
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-				break;
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-			case 0x80: // SL,RR
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-				state.channels[ch].slots[slot].SL=((value>>4)&0x0F);
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-				state.channels[ch].slots[slot].RR=(value&0x0F);
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-				if(0!=(state.channels[ch].usingSlot&(1<<slot)))
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-				{
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-					UpdateSlotEnvelope(state.channels[ch],state.channels[ch].slots[slot]);
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-				}
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-				else if(true==state.channels[ch].slots[slot].InReleasePhase)
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-				{
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-					UpdateRelease(state.channels[ch],state.channels[ch].slots[slot]);
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-				}
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-				break;
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-			case 0x90: // SSG-EG
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-				state.channels[ch].slots[slot].SSG_EG=(value&0x0F);
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-				break;
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-			}
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-		}
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-	}
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-	else if(0xA0<=reg && reg<=0xB6)
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-	{
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-		unsigned int ch=(reg&3);
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-		if(ch<=2)
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-		{
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-			unsigned int slot=slotTwist[((reg>>2)&3)];
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-			ch+=channelBase;
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-			switch(reg&0xFC)
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-			{
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-			case 0xA0: // F-Number1
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-				// [2] pp.211 Implies that writing to reg A0H to A2H triggers a tone to play.
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 
-				//     When setting the note, first write BLOCK and high 3-bits of F-Number (F-Number2),
+	0,0,0,0,0,0,0,0,1,1,1,1,1,1,1,1,
 
-				//     and then write lower 8-bits of F-Number (F-Number1).
+	1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
 
-				//     Or, is it REG_KEY_ON_OFF?
+	1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
 
-				state.channels[ch].F_NUM&=0xFF00;
+	1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
 
-				state.channels[ch].F_NUM|=value;
+	1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
 
-				UpdatePhase12StepSlot(state.channels[ch]);
+	1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
 
-				break;
+	1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
 
-			case 0xA4: // BLOCK,F-Number2
+	1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
 
-				state.channels[ch].F_NUM&=0x00FF;
+	1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
 
-				state.channels[ch].F_NUM|=((value&7)<<8);
+	1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
 
-				state.channels[ch].BLOCK=((value>>3)&7);
+	1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
 
-				break;
+	1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
 
-			case 0xB0: // FB, CONNECT
+	1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
 
-				state.channels[ch].FB=((value>>3)&7);
+	1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
 
-				state.channels[ch].CONNECT=(value&7);
+	1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
 
-				break;
+	1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
 
-			case 0xB4: // L,R,AMS,PMS
+	1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
 
-				state.channels[ch].L=((value>>7)&1);
+	1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
 
-				state.channels[ch].R=((value>>6)&1);
+	1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
 
-				state.channels[ch].AMS=((value>>4)&3);
+	1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
 
-				state.channels[ch].PMS=(value&7);
+	1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
 
-				break;
+	1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
 
-			}
+	1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
 
-		}
+	1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
 
-	}
+	1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
 
-	return chStartPlaying;
+	1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
 
-}
+	1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
 
-unsigned int YM2612::ReadRegister(unsigned int channelBase,unsigned int reg) const
+	1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
 
-{
+	1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
 
-	return state.reg[reg&255];
+	1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
 
-}
+	1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
 
-void YM2612::Run(unsigned long long int systemTimeInNS)
+	1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
 
-{
+	1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
 
-	if(0==state.deviceTimeInNS)
+	1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
 
-	{
+	1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
 
-		state.lastTickTimeInNS=systemTimeInNS;
+	1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
 
-		state.deviceTimeInNS=systemTimeInNS;
+	1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
 
-		return;
+	1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
 
-	}
+	1,1,2,2,2,2,2,2,2,2,2,2,2,2,2,2,
 
-	if(state.lastTickTimeInNS+TICK_DURATION_IN_NS<systemTimeInNS)
+	2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,
 
-	{
+	2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,
 
-		auto nTick=(systemTimeInNS-state.lastTickTimeInNS)/TICK_DURATION_IN_NS;
+	2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,
 
-		state.lastTickTimeInNS+=nTick*TICK_DURATION_IN_NS;
+	2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,
 
-		// See (1) in the above comment.
+	2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,
 
-		if(0!=(state.reg[REG_TIMER_CONTROL]&0x01))
+	2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,
 
-		{
+	2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,
 
-			state.timerCounter[0]+=nTick;
+	2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,
 
-			if(NTICK_TIMER_A<=state.timerCounter[0])
+	2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,
 
-			{
+	2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,
 
-				state.reg[REG_TIMER_CONTROL]&=(~0x01);
+	2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,
 
-				if(0!=(state.reg[REG_TIMER_CONTROL]&0x04))
+	2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,
 
-				{
+	2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,
 
-					state.timerUp[0]=true;
+	2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,
 
-				}
+	2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,
 
-			}
+	2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,
 
-		}
+	2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,
 
-		if(0!=(state.reg[REG_TIMER_CONTROL]&0x02))
+	2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,
 
-		{
+	2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,
 
-			state.timerCounter[1]+=nTick;
+	2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,
 
-			if(NTICK_TIMER_B<=state.timerCounter[1])
+	2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,
 
-			{
+	2,2,3,3,3,3,3,3,3,3,3,3,3,3,3,3,
 
-				state.reg[REG_TIMER_CONTROL]&=(~0x02);
+	3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,
 
-				if(0!=(state.reg[REG_TIMER_CONTROL]&0x08))
+	3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,
 
-				{
+	3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,
 
-					state.timerUp[1]=true;
+	3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,
 
-				}
+	3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,
 
-			}
+	3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,
 
-		}
+	3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,
 
-	}
+	3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,
 
+	3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,
 
+	3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,
 
+	3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,
 
+	3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,
 
-	state.deviceTimeInNS=systemTimeInNS;
+	3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,
 
-}
+	3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,
 
-bool YM2612::TimerAUp(void) const
+	3,3,3,3,3,3,3,3,3,3,3,3,4,4,4,4,
 
-{
+	4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,
 
-	return state.timerUp[0];
+	4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,
 
-}
+	4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,
 
-bool YM2612::TimerBUp(void) const
+	4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,
 
-{
+	4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,
 
-	return state.timerUp[1];
+	4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,
 
-}
+	4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,
 
-bool YM2612::TimerUp(unsigned int timerId) const
+	4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,
 
-{
+	4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,
 
-	switch(timerId&1)
+	4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,
 
-	{
+	4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,
 
-	default:
+	4,4,4,4,4,4,4,4,4,4,4,4,4,4,5,5,
 
-	case 0:
+	5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,
 
-		return TimerAUp();
+	5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,
 
-	case 1:
+	5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,
 
-		return TimerBUp();
+	5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,
 
-	}
+	5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,
 
-}
+	5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,
 
+	5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,
 
+	5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,
 
-/* static */ void YM2612::GetCarrierSlotFromConnection(int &numCarrierSlots,int carrierSlots[4],unsigned int connection)
+	5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,
 
-{
+	5,5,5,5,5,5,5,5,5,5,5,5,6,6,6,6,
 
-	connection&=7;
+	6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,
 
-	numCarrierSlots=connectionToOutputSlots[connection].nOutputSlots;
+	6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,
 
-	carrierSlots[0]=connectionToOutputSlots[connection].slots[0];
+	6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,
 
-	carrierSlots[1]=connectionToOutputSlots[connection].slots[1];
+	6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,
 
-	carrierSlots[2]=connectionToOutputSlots[connection].slots[2];
+	6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,
 
-	carrierSlots[3]=connectionToOutputSlots[connection].slots[3];
+	6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,
 
-}
+	6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,
 
+	6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,
 
+	6,6,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
 
+	7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
 
+	7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
 
+	7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
 
+	7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
 
-std::vector <std::string> YM2612::GetStatusText(void) const
+	7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
 
-{
+	7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
 
-	std::vector <std::string> text;
+	7,7,7,7,7,7,8,8,8,8,8,8,8,8,8,8,
 
-	char str[256];
+	8,8,8,8,8,8,8,8,8,8,8,8,8,8,8,8,
 
+	8,8,8,8,8,8,8,8,8,8,8,8,8,8,8,8,
 
+	8,8,8,8,8,8,8,8,8,8,8,8,8,8,8,8,
 
-	text.push_back("YM2612");
+	8,8,8,8,8,8,8,8,8,8,8,8,8,8,8,8,
 
+	8,8,8,8,8,8,8,8,8,8,8,8,8,8,8,8,
 
+	8,8,8,8,8,8,8,8,8,8,8,8,9,9,9,9,
 
-	for(int chNum=0; chNum<6; ++chNum)
+	9,9,9,9,9,9,9,9,9,9,9,9,9,9,9,9,
 
-	{
+	9,9,9,9,9,9,9,9,9,9,9,9,9,9,9,9,
 
-		auto &ch=state.channels[chNum];
+	9,9,9,9,9,9,9,9,9,9,9,9,9,9,9,9,
 
+	9,9,9,9,9,9,9,9,9,9,9,9,9,9,9,9,
 
+	9,9,9,9,9,9,9,9,9,9,9,9,9,9,9,9,
 
-		sprintf(str,"CH:%d  F_NUM=%-5d  BLOCK=%-2d  FB=%d  CONNECT=%d  L=%d  R=%d  AMS=%d  PMS=%d  ActiveSlots=%02x",
+	9,9,9,9,9,9,9,9,10,10,10,10,10,10,10,10,
 
-			chNum,
+	10,10,10,10,10,10,10,10,10,10,10,10,10,10,10,10,
 
-			ch.F_NUM,
+	10,10,10,10,10,10,10,10,10,10,10,10,10,10,10,10,
 
-			ch.BLOCK,
+	10,10,10,10,10,10,10,10,10,10,10,10,10,10,10,10,
 
-			ch.FB,
+	10,10,10,10,10,10,10,10,10,10,10,10,10,10,10,10,
 
-			ch.CONNECT,
+	10,10,10,10,10,10,10,10,10,10,10,11,11,11,11,11,
 
-			ch.L,
+	11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,
 
-			ch.R,
+	11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,
 
-			ch.AMS,
+	11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,
 
-			ch.PMS,
+	11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,11,
 
-			ch.usingSlot);
+	11,11,11,11,11,11,12,12,12,12,12,12,12,12,12,12,
 
-		text.push_back(str);
+	12,12,12,12,12,12,12,12,12,12,12,12,12,12,12,12,
 
+	12,12,12,12,12,12,12,12,12,12,12,12,12,12,12,12,
 
+	12,12,12,12,12,12,12,12,12,12,12,12,12,12,12,12,
 
-		int s=0;
+	12,12,12,12,12,12,12,12,12,12,12,12,13,13,13,13,
 
-		for(auto &slot : ch.slots)
+	13,13,13,13,13,13,13,13,13,13,13,13,13,13,13,13,
 
-		{
+	13,13,13,13,13,13,13,13,13,13,13,13,13,13,13,13,
 
-			sprintf(str,"SLOT:%d  DT=%d  MULTI=%-2d  TL=%-3d(%2ddB)  KS=%d  AR=%-2d  AM=%d  DR=%-2d  SR=%-2d  SL=%2d(%2ddB)  RR=%-2d  SSG_EG=%d",
+	13,13,13,13,13,13,13,13,13,13,13,13,13,13,13,13,
 
-				s,
+	13,13,13,13,13,13,13,13,13,13,13,13,14,14,14,14,
 
-				slot.DT,
+	14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
 
-				slot.MULTI,
+	14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
 
-				slot.TL,
+	14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,14,
 
-				TLtoDB100[slot.TL]/100,
+	14,14,14,14,14,14,14,14,15,15,15,15,15,15,15,15,
 
-				slot.KS,
+	15,15,15,15,15,15,15,15,15,15,15,15,15,15,15,15,
 
-				slot.AR,
+	15,15,15,15,15,15,15,15,15,15,15,15,15,15,15,15,
 
-				slot.AM,
+	15,15,15,15,15,15,15,15,15,15,15,15,15,15,15,15,
 
-				slot.DR,
+	16,16,16,16,16,16,16,16,16,16,16,16,16,16,16,16,
 
-				slot.SR,
+	16,16,16,16,16,16,16,16,16,16,16,16,16,16,16,16,
 
-				slot.SL,
+	16,16,16,16,16,16,16,16,16,16,16,16,16,16,16,16,
 
-				SLtoDB100[slot.SL]/100,
+	16,16,16,16,16,17,17,17,17,17,17,17,17,17,17,17,
 
-				slot.RR,
+	17,17,17,17,17,17,17,17,17,17,17,17,17,17,17,17,
 
-				slot.SSG_EG);
+	17,17,17,17,17,17,17,17,17,17,17,17,17,17,17,17,
 
-			text.push_back(str);
+	17,17,17,17,17,17,17,18,18,18,18,18,18,18,18,18,
 
-			++s;
+	18,18,18,18,18,18,18,18,18,18,18,18,18,18,18,18,
 
-		}
+	18,18,18,18,18,18,18,18,18,18,18,18,18,18,18,18,
 
-	}
+	18,18,18,18,18,19,19,19,19,19,19,19,19,19,19,19,
 
+	19,19,19,19,19,19,19,19,19,19,19,19,19,19,19,19,
 
+	19,19,19,19,19,19,19,19,19,19,19,19,19,19,19,19,
 
+	19,19,20,20,20,20,20,20,20,20,20,20,20,20,20,20,
 
+	20,20,20,20,20,20,20,20,20,20,20,20,20,20,20,20,
 
-	sprintf(str,"TimerA Up=%d  Count Preset=0x%04x  Internal Count/Threshold=0x%08x/0x%08x",
+	20,20,20,20,20,20,20,20,20,20,20,20,21,21,21,21,
 
-		TimerAUp(),
+	21,21,21,21,21,21,21,21,21,21,21,21,21,21,21,21,
 
-		((state.reg[REG_TIMER_A_COUNT_HIGH]<<2)|(state.reg[REG_TIMER_A_COUNT_LOW]&3)),
+	21,21,21,21,21,21,21,21,21,21,21,21,21,21,21,21,
 
-		(state.timerCounter[0]&0xFFFFFFFF),
+	21,21,21,21,21,22,22,22,22,22,22,22,22,22,22,22,
 
-		NTICK_TIMER_A);
+	22,22,22,22,22,22,22,22,22,22,22,22,22,22,22,22,
 
-	text.push_back(str);
+	22,22,22,22,22,22,22,22,22,22,22,23,23,23,23,23,
 
+	23,23,23,23,23,23,23,23,23,23,23,23,23,23,23,23,
 
+	23,23,23,23,23,23,23,23,23,23,23,23,23,23,23,23,
 
+	24,24,24,24,24,24,24,24,24,24,24,24,24,24,24,24,
 
+	24,24,24,24,24,24,24,24,24,24,24,24,24,24,24,24,
 
-	sprintf(str,"TimerB Up=%d  Count Preset=0x%04x  Internal Count/Threshold=0x%08x/0x%08x",
+	24,24,24,24,25,25,25,25,25,25,25,25,25,25,25,25,
 
-		TimerBUp(),
+	25,25,25,25,25,25,25,25,25,25,25,25,25,25,25,25,
 
-		state.reg[REG_TIMER_B_COUNT],
+	25,25,25,25,25,25,26,26,26,26,26,26,26,26,26,26,
 
-		(state.timerCounter[1]&0xFFFFFFFF),
+	26,26,26,26,26,26,26,26,26,26,26,26,26,26,26,26,
 
-		NTICK_TIMER_B);
+	26,26,26,26,26,26,26,27,27,27,27,27,27,27,27,27,
 
-	text.push_back(str);
+	27,27,27,27,27,27,27,27,27,27,27,27,27,27,27,27,
 
+	27,27,27,27,27,27,28,28,28,28,28,28,28,28,28,28,
 
+	28,28,28,28,28,28,28,28,28,28,28,28,28,28,28,28,
 
+	28,28,28,28,28,29,29,29,29,29,29,29,29,29,29,29,
 
+	29,29,29,29,29,29,29,29,29,29,29,29,29,29,29,29,
 
-	sprintf(str,"Timer Control(Reg 0x%02x)=0x%02x  MODE:0x%02x  RST:0x%02x  ENA:0x%02x  LOAD:0x%02x",
+	29,29,30,30,30,30,30,30,30,30,30,30,30,30,30,30,
 
-		REG_TIMER_CONTROL,
+	30,30,30,30,30,30,30,30,30,30,30,30,30,30,30,31,
 
-		state.reg[REG_TIMER_CONTROL],
+	31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,31,
 
-		((state.reg[REG_TIMER_CONTROL]>>6)&3),
+	31,31,31,31,31,31,31,31,31,31,32,32,32,32,32,32,
 
-		((state.reg[REG_TIMER_CONTROL]>>4)&3),
+	32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,32,
 
-		((state.reg[REG_TIMER_CONTROL]>>2)&3),
+	32,32,32,32,32,33,33,33,33,33,33,33,33,33,33,33,
 
-		(state.reg[REG_TIMER_CONTROL]&3));
+	33,33,33,33,33,33,33,33,33,33,33,33,33,33,33,34,
 
-	text.push_back(str);
+	34,34,34,34,34,34,34,34,34,34,34,34,34,34,34,34,
 
+	34,34,34,34,34,34,34,34,35,35,35,35,35,35,35,35,
 
+	35,35,35,35,35,35,35,35,35,35,35,35,35,35,35,35,
 
+	35,36,36,36,36,36,36,36,36,36,36,36,36,36,36,36,
 
+	36,36,36,36,36,36,36,36,37,37,37,37,37,37,37,37,
 
-	sprintf(str,"LFO:%d  FREQ-CTRL:%d",state.LFO,state.FREQCTRL);
+	37,37,37,37,37,37,37,37,37,37,37,37,37,37,37,37,
 
-	text.push_back(str);
+	38,38,38,38,38,38,38,38,38,38,38,38,38,38,38,38,
 
+	38,38,38,38,38,38,39,39,39,39,39,39,39,39,39,39,
 
+	39,39,39,39,39,39,39,39,39,39,39,39,40,40,40,40,
 
-	return text;
+	40,40,40,40,40,40,40,40,40,40,40,40,40,40,40,40,
 
-}
+	40,40,41,41,41,41,41,41,41,41,41,41,41,41,41,41,
 
-/* LICENSE>>
+	41,41,41,41,41,41,42,42,42,42,42,42,42,42,42,42,
 
-Copyright 2020 Soji Yamakawa (CaptainYS, http://www.ysflight.com)
+	42,42,42,42,42,42,42,42,42,42,42,43,43,43,43,43,
 
+	43,43,43,43,43,43,43,43,43,43,43,43,43,43,43,44,
 
+	44,44,44,44,44,44,44,44,44,44,44,44,44,44,44,44,
 
-Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+	44,44,45,45,45,45,45,45,45,45,45,45,45,45,45,45,
 
+	45,45,45,45,45,45,46,46,46,46,46,46,46,46,46,46,
 
+	46,46,46,46,46,46,46,46,47,47,47,47,47,47,47,47,
 
-1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+	47,47,47,47,47,47,47,47,47,47,48,48,48,48,48,48,
 
+	48,48,48,48,48,48,48,48,48,48,48,48,49,49,49,49,
 
+	49,49,49,49,49,49,49,49,49,49,49,49,49,49,50,50,
 
-2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+	50,50,50,50,50,50,50,50,50,50,50,50,50,50,50,51,
 
+	51,51,51,51,51,51,51,51,51,51,51,51,51,51,51,51,
 
+	52,52,52,52,52,52,52,52,52,52,52,52,52,52,52,52,
 
-3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+	52,53,53,53,53,53,53,53,53,53,53,53,53,53,53,53,
 
+	53,54,54,54,54,54,54,54,54,54,54,54,54,54,54,54,
 
+	54,55,55,55,55,55,55,55,55,55,55,55,55,55,55,55,
 
-THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+	56,56,56,56,56,56,56,56,56,56,56,56,56,56,56,56,
 
+	57,57,57,57,57,57,57,57,57,57,57,57,57,57,57,58,
 
+	58,58,58,58,58,58,58,58,58,58,58,58,58,58,59,59,
 
-<< LICENSE */
+	59,59,59,59,59,59,59,59,59,59,59,59,60,60,60,60,
 
-#include <algorithm>
+	60,60,60,60,60,60,60,60,60,60,60,61,61,61,61,61,
 
-#include <iostream>
+	61,61,61,61,61,61,61,61,61,62,62,62,62,62,62,62,
 
-#include <cstring>
+	62,62,62,62,62,62,62,63,63,63,63,63,63,63,63,63,
 
+	63,63,63,63,64,64,64,64,64,64,64,64,64,64,64,64,
 
+	64,64,65,65,65,65,65,65,65,65,65,65,65,65,65,66,
 
-#include "ym2612.h"
+	66,66,66,66,66,66,66,66,66,66,66,66,67,67,67,67,
 
+	67,67,67,67,67,67,67,67,67,68,68,68,68,68,68,68,
 
+	68,68,68,68,68,68,69,69,69,69,69,69,69,69,69,69,
 
+	69,69,70,70,70,70,70,70,70,70,70,70,70,70,70,71,
 
+	71,71,71,71,71,71,71,71,71,71,71,72,72,72,72,72,
 
+	72,72,72,72,72,72,72,73,73,73,73,73,73,73,73,73,
 
+	73,73,74,74,74,74,74,74,74,74,74,74,74,74,75,75,
 
-inline void WordOp_Set(unsigned char *ptr,short value)
+	75,75,75,75,75,75,75,75,75,75,76,76,76,76,76,76,
 
-{
+	76,76,76,76,76,77,77,77,77,77,77,77,77,77,77,77,
 
-#ifdef YS_LITTLE_ENDIAN
+	78,78,78,78,78,78,78,78,78,78,78,79,79,79,79,79,
 
-	if(value<-32767)
+	79,79,79,79,79,79,80,80,80,80,80,80,80,80,80,80,
 
-	{
+	80,81,81,81,81,81,81,81,81,81,81,81,82,82,82,82,
 
-		*((short *)ptr)=-32767;
+	82,82,82,82,82,82,83,83,83,83,83,83,83,83,83,83,
 
-	}
+	83,84,84,84,84,84,84,84,84,84,84,85,85,85,85,85,
 
-	else if(32767<value)
+	85,85,85,85,85,86,86,86,86,86,86,86,86,86,86,87,
 
-	{
+	87,87,87,87,87,87,87,87,87,88,88,88,88,88,88,88,
 
-		*((short *)ptr)=32767;
+	88,88,88,89,89,89,89,89,89,89,89,89,90,90,90,90,
 
-	}
+	90,90,90,90,90,90,91,91,91,91,91,91,91,91,91,91,
 
-	else
+	92,92,92,92,92,92,92,92,92,93,93,93,93,93,93,93,
 
-	{
+	93,93,94,94,94,94,94,94,94,94,94,95,95,95,95,95,
 
-		*((short *)ptr)=value;
+	95,95,95,95,95,96,96,96,96,96,96,96,96,96,97,97,
 
-	}
+	97,97,97,97,97,97,98,98,98,98,98,98,98,98,98,99,
 
-#else
+	99,99,99,99,99,99,99,99,100,100,100,100,100,100,100,100,
 
-	if(value<-32767)
+	100,101,101,101,101,101,101,101,101,102,102,102,102,102,102,102,
 
-	{
+	102,102,103,103,103,103,103,103,103,103,104,104,104,104,104,104,
 
-		value=-32767;
+	104,104,105,105,105,105,105,105,105,105,105,106,106,106,106,106,
 
-	}
+	106,106,106,107,107,107,107,107,107,107,107,108,108,108,108,108,
 
-	else if(32767<value)
+	108,108,108,109,109,109,109,109,109,109,109,110,110,110,110,110,
 
-	{
+	110,110,110,111,111,111,111,111,111,111,112,112,112,112,112,112,
 
-		value=32767;
+	112,112,113,113,113,113,113,113,113,113,114,114,114,114,114,114,
 
-	}
+	114,115,115,115,115,115,115,115,115,116,116,116,116,116,116,116,
 
-	ptr[0]=value&255;
+	117,117,117,117,117,117,117,117,118,118,118,118,118,118,118,119,
 
-	ptr[1]=(value>>8)&255;
+	119,119,119,119,119,119,120,120,120,120,120,120,120,120,121,121,
 
-#endif
+	121,121,121,121,121,122,122,122,122,122,122,122,123,123,123,123,
 
-}
+	123,123,123,124,124,124,124,124,124,124,125,125,125,125,125,125,
 
+	125,126,126,126,126,126,126,126,127,127,127,127,127,127,128,128,
 
+	128,128,128,128,128,129,129,129,129,129,129,129,130,130,130,130,
 
+	130,130,130,131,131,131,131,131,131,132,132,132,132,132,132,132,
 
+	133,133,133,133,133,133,134,134,134,134,134,134,134,135,135,135,
 
+	135,135,135,136,136,136,136,136,136,137,137,137,137,137,137,137,
 
+	138,138,138,138,138,138,139,139,139,139,139,139,140,140,140,140,
 
-// #define YM2612_DEBUGOUTPUT
+	140,140,141,141,141,141,141,141,141,142,142,142,142,142,142,143,
 
+	143,143,143,143,143,144,144,144,144,144,144,145,145,145,145,145,
 
+	145,146,146,146,146,146,146,147,147,147,147,147,147,148,148,148,
 
+	148,148,149,149,149,149,149,149,150,150,150,150,150,150,151,151,
 
+	151,151,151,151,152,152,152,152,152,153,153,153,153,153,153,154,
 
-/*static*/ int YM2612::MULTITable[16]= // Multiple x2.
+	154,154,154,154,154,155,155,155,155,155,156,156,156,156,156,156,
 
-{
+	157,157,157,157,157,158,158,158,158,158,158,159,159,159,159,159,
 
-	1,
+	160,160,160,160,160,160,161,161,161,161,161,162,162,162,162,162,
 
-	2,
+	163,163,163,163,163,163,164,164,164,164,164,165,165,165,165,165,
 
-	4,
+	166,166,166,166,166,167,167,167,167,167,167,168,168,168,168,168,
 
-	6,
+	169,169,169,169,169,170,170,170,170,170,171,171,171,171,171,172,
 
-	8,
+	172,172,172,172,173,173,173,173,173,174,174,174,174,174,175,175,
 
-	10,
+	175,175,175,176,176,176,176,176,177,177,177,177,177,178,178,178,
 
-	12,
+	178,178,179,179,179,179,179,180,180,180,180,181,181,181,181,181,
 
-	14,
+	182,182,182,182,182,183,183,183,183,183,184,184,184,184,185,185,
 
-	16,
+	185,185,185,186,186,186,186,186,187,187,187,187,188,188,188,188,
 
-	18,
+	188,189,189,189,189,190,190,190,190,190,191,191,191,191,191,192,
 
-	20,
+	192,192,192,193,193,193,193,193,194,194,194,194,195,195,195,195,
 
-	22,
+	195,196,196,196,196,197,197,197,197,198,198,198,198,198,199,199,
 
-	24,
+	199,199,200,200,200,200,201,201,201,201,201,202,202,202,202,203,
 
-	26,
+	203,203,203,204,204,204,204,205,205,205,205,205,206,206,206,206,
 
-	28,
+	207,207,207,207,208,208,208,208,209,209,209,209,210,210,210,210,
 
-	30,
+	210,211,211,211,211,212,212,212,212,213,213,213,213,214,214,214,
 
-};
+	214,215,215,215,215,216,216,216,216,217,217,217,217,218,218,218,
 
+	218,219,219,219,219,220,220,220,220,221,221,221,221,222,222,222,
 
+	222,223,223,223,224,224,224,224,225,225,225,225,226,226,226,226,
 
-// Attack/Decay/Sustain/Release rate becomes double every four steps in 64-level scale.
+	227,227,227,227,228,228,228,228,229,229,229,230,230,230,230,231,
 
-// However between i*4 and (i+1)*4, the slope is linearly interpolated.
+	231,231,231,232,232,232,232,233,233,233,234,234,234,234,235,235,
 
-// Therefore, the slope should be:
+	235,235,236,236,236,237,237,237,237,238,238,238,238,239,239,239,
 
-//    i=N*4    a
+	240,240,240,240,241,241,241,241,242,242,242,243,243,243,243,244,
 
-//    i=N*4+1  a*1.25
+	244,244,245,245,245,245,246,246,246,247,247,247,247,248,248,248,
 
-//    i=N*4+2  a*1.5
+	249,249,249,249,250,250,250,251,251,251,251,252,252,252,253,253,
 
-//    i=N*4+3  a*1.75
+	253,253,254,254,254,255,255,255,256,256,256,256,257,257,257,258,
 
-//    i=N*4+4  a*2
+	258,258,258,259,259,259,260,260,260,261,261,261,261,262,262,262,
 
-//     :
+	263,263,263,264,264,264,265,265,265,265,266,266,266,267,267,267,
 
-//    i=N*4+8  a*4
+	268,268,268,269,269,269,269,270,270,270,271,271,271,272,272,272,
 
-//
+	273,273,273,274,274,274,274,275,275,275,276,276,276,277,277,277,
 
-// The duration of the segment is inverse of the slope, therefore:
+	278,278,278,279,279,279,280,280,280,281,281,281,282,282,282,282,
 
-//    i=N*4    d
+	283,283,283,284,284,284,285,285,285,286,286,286,287,287,287,288,
 
-//    i=N*4+1  d/1.25
+	288,288,289,289,289,290,290,290,291,291,291,292,292,292,293,293,
 
-//    i=N*4+2  d/1.5
+	293,294,294,294,295,295,295,296,296,296,297,297,298,298,298,299,
 
-//    i=N*4+3  d/1.75
+	299,299,300,300,300,301,301,301,302,302,302,303,303,303,304,304,
 
-//    i=N*4+4  d/2
+	304,305,305,306,306,306,307,307,307,308,308,308,309,309,309,310,
 
-//     :
+	310,310,311,311,312,312,312,313,313,313,314,314,314,315,315,316,
 
-//    i=N*4+8  d/4
+	316,316,317,317,317,318,318,318,319,319,320,320,320,321,321,321,
 
-//
+	322,322,323,323,323,324,324,324,325,325,326,326,326,327,327,327,
 
-// The duration of decay/sustain/release depends on how much dB the segment needs to drop.
+	328,328,329,329,329,330,330,330,331,331,332,332,332,333,333,334,
 
-// It is linear to the dB-drop.
+	334,334,335,335,335,336,336,337,337,337,338,338,339,339,339,340,
 
-//
+	340,340,341,341,342,342,342,343,343,344,344,344,345,345,346,346,
 
-// The duration of attack (based on the observation) is constant regardless of the total level.
+	346,347,347,348,348,348,349,349,350,350,350,351,351,352,352,352,
 
-//
+	353,353,354,354,355,355,355,356,356,357,357,357,358,358,359,359,
 
-// The observation indicated that the values listed in FM TOWNS Technical Databook was
+	359,360,360,361,361,362,362,362,363,363,364,364,364,365,365,366,
 
-// about 10% slower than actual.
+	366,367,367,367,368,368,369,369,370,370,370,371,371,372,372,373,
 
+	373,373,374,374,375,375,376,376,376,377,377,378,378,379,379,379,
 
+	380,380,381,381,382,382,383,383,383,384,384,385,385,386,386,387,
 
-static unsigned int attackTime0to96dB[64]= // 1/100ms
+	387,387,388,388,389,389,390,390,391,391,391,392,392,393,393,394,
 
-{
+	394,395,395,396,396,396,397,397,398,398,399,399,400,400,401,401,
 
-// Note: The time must be proportional to the base clock.
+	402,402,402,403,403,404,404,405,405,406,406,407,407,408,408,409,
 
-// Measured/Estimated    FM TOWNS Technical Databook Table I-5-31
+	409,409,410,410,411,411,412,412,413,413,414,414,415,415,416,416,
 
-1606000,                 // Infinity,
+	417,417,418,418,419,419,420,420,420,421,421,422,422,423,423,424,
 
-1284800,                 // Infinity,
+	424,425,425,426,426,427,427,428,428,429,429,430,430,431,431,432,
 
-1070666,                 // Infinity,
+	432,433,433,434,434,435,435,436,436,437,437,438,438,439,439,440,
 
-917714,                  // Infinity,
+	440,441,441,442,442,443,443,444,444,445,445,446,446,447,447,448,
 
-803000,                  // 897024,
+	449,449,450,450,451,451,452,452,453,453,454,454,455,455,456,456,
 
-642400,                  // 897024,
+	457,457,458,458,459,459,460,461,461,462,462,463,463,464,464,465,
 
-535333,                  // 598016,
+	465,466,466,467,468,468,469,469,470,470,471,471,472,472,473,473,
 
-458857,                  // 598016,
+	474,475,475,476,476,477,477,478,478,479,480,480,481,481,482,482,
 
-401500,                  // 448512,
+	483,483,484,485,485,486,486,487,487,488,488,489,490,490,491,491,
 
-321200,                  // 358810,
+	492,492,493,494,494,495,495,496,496,497,498,498,499,499,500,500,
 
-267666,                  // 299008,   // Actual Measurement 2677ms
+	501,502,502,503,503,504,504,505,506,506,507,507,508,509,509,510,
 
-229428,                  // 258293,
+	510,511,511,512,513,513,514,514,515,516,516,517,517,518,519,519,
 
-200750,                  // 224256,
+	520,520,521,522,522,523,523,524,525,525,526,526,527,528,528,529,
 
-160600,                  // 173405,
+	529,530,531,531,532,533,533,534,534,535,536,536,537,537,538,539,
 
-133833,                  // 149504,
+	539,540,541,541,542,542,543,544,544,545,546,546,547,547,548,549,
 
-114714,                  // 128146,
+	549,550,551,551,552,553,553,554,554,555,556,556,557,558,558,559,
 
+	560,560,561,562,562,563,563,564,565,565,566,567,567,568,569,569,
 
+	570,571,571,572,573,573,574,575,575,576,577,577,578,579,579,580,
 
-100375,                  // 112128,
+	581,581,582,583,583,584,585,585,586,587,587,588,589,589,590,591,
 
-80300,                   // 83702,
+	591,592,593,593,594,595,596,596,597,598,598,599,600,600,601,602,
 
-66916,                   // 74752,
+	602,603,604,604,605,606,607,607,608,609,609,610,611,612,612,613,
 
-57357,                   // 64073,
+	614,614,615,616,616,617,618,619,619,620,621,621,622,623,624,624,
 
-50187,                   // 56064,
+	625,626,626,627,628,629,629,630,631,632,632,633,634,634,635,636,
 
-40149,                   // 44851,
+	637,637,638,639,640,640,641,642,643,643,644,645,646,646,647,648,
 
-33458,                   // 37376,
+	649,649,650,651,652,652,653,654,655,655,656,657,658,658,659,660,
 
-28678,                   // 32037,
+	661,661,662,663,664,664,665,666,667,667,668,669,670,671,671,672,
 
-25093,                   // 28032,
+	673,674,674,675,676,677,678,678,679,680,681,681,682,683,684,685,
 
-20074,                   // 22425,
+	685,686,687,688,689,689,690,691,692,693,693,694,695,696,697,697,
 
-16728,                   // 18688,
+	698,699,700,701,701,702,703,704,705,705,706,707,708,709,709,710,
 
-14338,                   // 16018,
+	711,712,713,714,714,715,716,717,718,719,719,720,721,722,723,724,
 
-12546,                   // 14016,
+	724,725,726,727,728,729,729,730,731,732,733,734,734,735,736,737,
 
-10036,                   // 11213,
+	738,739,740,740,741,742,743,744,745,746,746,747,748,749,750,751,
 
-8364,                    // 9344,
+	752,752,753,754,755,756,757,758,759,759,760,761,762,763,764,765,
 
-7169,                    // 8009,
+	766,766,767,768,769,770,771,772,773,774,774,775,776,777,778,779,
 
+	780,781,782,782,783,784,785,786,787,788,789,790,791,792,792,793,
 
+	794,795,796,797,798,799,800,801,802,803,803,804,805,806,807,808,
 
-6273,                    // 7008,
+	809,810,811,812,813,814,815,816,817,818,818,819,820,821,822,823,
 
-5018,                    // 5806,
+	824,825,826,827,828,829,830,831,832,833,834,835,836,837,838,838,
 
-4182,                    // 4872,
+	839,840,841,842,843,844,845,846,847,848,849,850,851,852,853,854,
 
-3584,                    // 4005,
+	855,856,857,858,859,860,861,862,863,864,865,866,867,868,869,870,
 
-3136,                    // 3504,
+	871,872,873,874,875,876,877,878,879,880,881,882,883,884,885,886,
 
-2508,                    // 2903,
+	887,888,889,890,891,892,893,894,895,896,897,898,900,901,902,903,
 
-2090,                    // 2335,
+	904,905,906,907,908,909,910,911,912,913,914,915,916,917,918,919,
 
-1792,                    // 2002,
+	920,922,923,924,925,926,927,928,929,930,931,932,933,934,935,937,
 
-1568,                    // 1752,
+	938,939,940,941,942,943,944,945,946,947,948,950,951,952,953,954,
 
-1254,                    // 1402,
+	955,956,957,958,959,961,962,963,964,965,966,967,968,969,971,972,
 
-1045,                    // 1168,
+	973,974,975,976,977,978,980,981,982,983,984,985,986,987,989,990,
 
-896,                     // 1001,
+	991,992,993,994,995,997,998,999,1000,1001,1002,1004,1005,1006,1007,1008,
 
-784,                     // 876,
+	1009,1011,1012,1013,1014,1015,1016,1018,1019,1020,1021,1022,1023,1025,1026,1027,
 
-627,                     // 701,
+	1028,1029,1030,1032,1033,1034,1035,1036,1038,1039,1040,1041,1042,1044,1045,1046,
 
-522,                     // 584,
+	1047,1048,1050,1051,1052,1053,1055,1056,1057,1058,1059,1061,1062,1063,1064,1065,
 
-448,                     // 501,
+	1067,1068,1069,1070,1072,1073,1074,1075,1077,1078,1079,1080,1082,1083,1084,1085,
 
+	1087,1088,1089,1090,1092,1093,1094,1095,1097,1098,1099,1100,1102,1103,1104,1105,
 
+	1107,1108,1109,1111,1112,1113,1114,1116,1117,1118,1120,1121,1122,1123,1125,1126,
 
-392,                     // 438,
+	1127,1129,1130,1131,1133,1134,1135,1136,1138,1139,1140,1142,1143,1144,1146,1147,
 
-313,                     // 350,
+	1148,1150,1151,1152,1154,1155,1156,1158,1159,1160,1162,1163,1164,1166,1167,1168,
 
-261,                     // 232,
+	1170,1171,1172,1174,1175,1176,1178,1179,1181,1182,1183,1185,1186,1187,1189,1190,
 
-224,                     // 250,
+	1191,1193,1194,1196,1197,1198,1200,1201,1202,1204,1205,1207,1208,1209,1211,1212,
 
-196,                     // 240,
+	1214,1215,1216,1218,1219,1221,1222,1223,1225,1226,1228,1229,1230,1232,1233,1235,
 
-156,                     // 192,
+	1236,1238,1239,1240,1242,1243,1245,1246,1248,1249,1250,1252,1253,1255,1256,1258,
 
-130,                     // 160,
+	1259,1261,1262,1264,1265,1266,1268,1269,1271,1272,1274,1275,1277,1278,1280,1281,
 
-112,                     // 137,
+	1283,1284,1286,1287,1289,1290,1291,1293,1294,1296,1297,1299,1300,1302,1303,1305,
 
-98,                      // 126,
+	1306,1308,1309,1311,1312,1314,1315,1317,1319,1320,1322,1323,1325,1326,1328,1329,
 
-78,                      // 101,
+	1331,1332,1334,1335,1337,1338,1340,1342,1343,1345,1346,1348,1349,1351,1352,1354,
 
-65,                      // 84,
+	1355,1357,1359,1360,1362,1363,1365,1366,1368,1370,1371,1373,1374,1376,1378,1379,
 
-56,                      // 72,
+	1381,1382,1384,1385,1387,1389,1390,1392,1393,1395,1397,1398,1400,1402,1403,1405,
 
-49,                      // 60,
+	1406,1408,1410,1411,1413,1414,1416,1418,1419,1421,1423,1424,1426,1428,1429,1431,
 
-39,                      // 60,
+	1433,1434,1436,1437,1439,1441,1442,1444,1446,1447,1449,1451,1452,1454,1456,1457,
 
-32,                      // 0,
+	1459,1461,1463,1464,1466,1468,1469,1471,1473,1474,1476,1478,1479,1481,1483,1485,
 
-28,                      // 0,
+	1486,1488,1490,1491,1493,1495,1497,1498,1500,1502,1504,1505,1507,1509,1510,1512,
 
-};
+	1514,1516,1517,1519,1521,1523,1524,1526,1528,1530,1531,1533,1535,1537,1539,1540,
 
-static unsigned int sustainDecayReleaseTime0to96dB[64]= // 1/100ms
+	1542,1544,1546,1547,1549,1551,1553,1555,1556,1558,1560,1562,1564,1565,1567,1569,
 
-{
+	1571,1573,1574,1576,1578,1580,1582,1583,1585,1587,1589,1591,1593,1594,1596,1598,
 
-// Measured/Estimated    FM TOWNS Technical Databook Table I-5-31
+	1600,1602,1604,1606,1607,1609,1611,1613,1615,1617,1619,1620,1622,1624,1626,1628,
 
-22662400,               // Infinity
+	1630,1632,1634,1635,1637,1639,1641,1643,1645,1647,1649,1651,1652,1654,1656,1658,
 
-18129920,               // Infinity
+	1660,1662,1664,1666,1668,1670,1672,1673,1675,1677,1679,1681,1683,1685,1687,1689,
 
-15108266,               // Infinity
+	1691,1693,1695,1697,1699,1701,1703,1705,1707,1709,1711,1712,1714,1716,1718,1720,
 
-12949942,               // Infinity
+	1722,1724,1726,1728,1730,1732,1734,1736,1738,1740,1742,1744,1746,1748,1750,1752,
 
-11331200,               // 12398592,
+	1754,1756,1758,1760,1763,1765,1767,1769,1771,1773,1775,1777,1779,1781,1783,1785,
 
-9064960,                // 12398592,
+	1787,1789,1791,1793,1795,1797,1799,1801,1804,1806,1808,1810,1812,1814,1816,1818,
 
-7554133,                // 8265726,
+	1820,1822,1824,1827,1829,1831,1833,1835,1837,1839,1841,1843,1846,1848,1850,1852,
 
-6474971,                // 8265728,
+	1854,1856,1858,1861,1863,1865,1867,1869,1871,1873,1876,1878,1880,1882,1884,1886,
 
-5665600,                // 5199296,   // Actual measurement: 56656ms (5665600)
+	1889,1891,1893,1895,1897,1900,1902,1904,1906,1908,1910,1913,1915,1917,1919,1922,
 
-4532480,                // 4953437,
+	1924,1926,1928,1930,1933,1935,1937,1939,1942,1944,1946,1948,1950,1953,1955,1957,
 
-3777066,                // 4132864,
+	1959,1962,1964,1966,1969,1971,1973,1975,1978,1980,1982,1984,1987,1989,1991,1994,
 
-3237485,                // 3542455,
+	1996,1998,2001,2003,2005,2007,2010,2012,2014,2017,2019,2021,2024,2026,2028,2031,
 
-2832800,                // 3099648,
+	2033,2035,2038,2040,2042,2045,2047,2050,2052,2054,2057,2059,2061,2064,2066,2068,
 
-2266240,                // 2479719,
+	2071,2073,2076,2078,2080,2083,2085,2088,2090,2092,2095,2097,2100,2102,2105,2107,
 
-1888533,                // 2066432,
+	2109,2112,2114,2117,2119,2122,2124,2126,2129,2131,2134,2136,2139,2141,2144,2146,
 
-1618742,                // 1771227,
+	2149,2151,2154,2156,2159,2161,2163,2166,2168,2171,2173,2176,2178,2181,2184,2186,
 
+	2189,2191,2194,2196,2199,2201,2204,2206,2209,2211,2214,2216,2219,2222,2224,2227,
 
+	2229,2232,2234,2237,2240,2242,2245,2247,2250,2252,2255,2258,2260,2263,2265,2268,
 
-1416400,                // 1549824,
+	2271,2273,2276,2279,2281,2284,2286,2289,2292,2294,2297,2300,2302,2305,2308,2310,
 
-1133120,                // 1239859,
+	2313,2316,2318,2321,2324,2326,2329,2332,2334,2337,2340,2342,2345,2348,2351,2353,
 
-944266,                 // 1033215,
+	2356,2359,2361,2364,2367,2370,2372,2375,2378,2380,2383,2386,2389,2391,2394,2397,
 
-809371,                 // 885614,
+	2400,2403,2405,2408,2411,2414,2416,2419,2422,2425,2428,2430,2433,2436,2439,2442,
 
-708200,                 // 774912,
+	2444,2447,2450,2453,2456,2458,2461,2464,2467,2470,2473,2476,2478,2481,2484,2487,
 
-566560,                 // 619930,
+	2490,2493,2496,2498,2501,2504,2507,2510,2513,2516,2519,2522,2524,2527,2530,2533,
 
-472133,                 // 516608,
+	2536,2539,2542,2545,2548,2551,2554,2557,2560,2563,2565,2568,2571,2574,2577,2580,
 
-404685,                 // 442807,
+	2583,2586,2589,2592,2595,2598,2601,2604,2607,2610,2613,2616,2619,2622,2625,2628,
 
-354100,                 // 387455,
+	2631,2634,2637,2640,2643,2646,2650,2653,2656,2659,2662,2665,2668,2671,2674,2677,
 
-283280,                 // 309965,
+	2680,2683,2686,2690,2693,2696,2699,2702,2705,2708,2711,2714,2718,2721,2724,2727,
 
-236066,                 // 258304,
+	2730,2733,2736,2740,2743,2746,2749,2752,2755,2759,2762,2765,2768,2771,2774,2778,
 
-202342,                 // 221403,
+	2781,2784,2787,2790,2794,2797,2800,2803,2807,2810,2813,2816,2820,2823,2826,2829,
 
-177050,                 // 193728,
+	2833,2836,2839,2842,2846,2849,2852,2855,2859,2862,2865,2869,2872,2875,2879,2882,
 
-141640,                 // 154982,
+	2885,2889,2892,2895,2899,2902,2905,2909,2912,2915,2919,2922,2925,2929,2932,2935,
 
-118033,                 // 129152,
+	2939,2942,2946,2949,2952,2956,2959,2963,2966,2969,2973,2976,2980,2983,2987,2990,
 
-101171,                 // 110702,
+	2994,2997,3000,3004,3007,3011,3014,3018,3021,3025,3028,3032,3035,3039,3042,3046,
 
+	3049,3053,3056,3060,3063,3067,3070,3074,3077,3081,3084,3088,3092,3095,3099,3102,
 
+	3106,3109,3113,3117,3120,3124,3127,3131,3135,3138,3142,3145,3149,3153,3156,3160,
 
-88525,                  // 96864,
+	3164,3167,3171,3175,3178,3182,3186,3189,3193,3197,3200,3204,3208,3211,3215,3219,
 
-70820,                  // 77491,
+	3222,3226,3230,3234,3237,3241,3245,3249,3252,3256,3260,3264,3267,3271,3275,3279,
 
-59016,                  // 64576,
+	3282,3286,3290,3294,3298,3301,3305,3309,3313,3317,3320,3324,3328,3332,3336,3340,
 
-50585,                  // 55351,
+	3343,3347,3351,3355,3359,3363,3367,3370,3374,3378,3382,3386,3390,3394,3398,3402,
 
-44262,                  // 48432,
+	3406,3409,3413,3417,3421,3425,3429,3433,3437,3441,3445,3449,3453,3457,3461,3465,
 
-35409,                  // 38745,
+	3469,3473,3477,3481,3485,3489,3493,3497,3501,3505,3509,3513,3517,3521,3525,3529,
 
-29508,                  // 32298,
+	3533,3537,3542,3546,3550,3554,3558,3562,3566,3570,3574,3578,3583,3587,3591,3595,
 
-25292,                  // 27675,
+	3599,3603,3607,3612,3616,3620,3624,3628,3632,3637,3641,3645,3649,3653,3658,3662,
 
-22131,                  // 24216,
+	3666,3670,3674,3679,3683,3687,3691,3696,3700,3704,3708,3713,3717,3721,3726,3730,
 
-17704,                  // 19373,
+	3734,3738,3743,3747,3751,3756,3760,3764,3769,3773,3777,3782,3786,3791,3795,3799,
 
-14754,                  // 16144,
+	3804,3808,3812,3817,3821,3826,3830,3834,3839,3843,3848,3852,3857,3861,3865,3870,
 
-12646,                  // 13938,
+	3874,3879,3883,3888,3892,3897,3901,3906,3910,3915,3919,3924,3928,3933,3937,3942,
 
-11065,                  // 12108,
+	3946,3951,3955,3960,3965,3969,3974,3978,3983,3987,3992,3997,4001,4006,4011,4015,
 
-8852,                   // 9686,
+	4020,4024,4029,4034,4038,4043,4048,4052,4057,4062,4066,4071,4076,4080,4085,4090,
 
-7376,                   // 8072,
+	4095,
 
-6322,                   // 6919,
+};
 
+/*static*/ const unsigned int YM2612::connToOutChannel[8][4]=
 
+{
 
-5532,                   // 6054,
+	{0,0,0,1},
 
-4425,                   // 4843,
+	{0,0,0,1},
 
-3688,                   // 4056,
+	{0,0,0,1},
 
-3161,                   // 3459,
+	{0,0,0,1},
 
-2766,                   // 3027,
+	{0,1,0,1},
 
-2212,                   // 2422,
+	{0,1,1,1},
 
-1844,                   // 2018,
+	{0,1,1,1},
 
-1580,                   // 1730,
+	{1,1,1,1},
 
-1383,                   // 1514,
+};
 
-1106,                   // 1211,
 
-922,                    // 1009,
 
-790,                    // 865,
+void YM2612::State::PowerOn(void)
 
-691,                    // 757,
+{
 
-552,                    // 757,
+	Reset();
 
-460,                    // 757,
+}
 
-394,                    // 757,
+void YM2612::State::Reset(void)
 
-};
+{
 
+	deviceTimeInNS=0;
 
+	lastTickTimeInNS=0;
 
-// I just took the following table from FM TOWNS Technical Databook,
+	for(auto &c : channels)
 
-// but I have no idea what's the hell this table is for.
+	{
 
-static unsigned int attackTime10to90Percent[64]=
+		c.Clear();
 
-{
+	}
 
-0,
+	for(auto &f : F_NUM_3CH)
 
-0,
+	{
 
-0,
+		f=0;
 
-0,
+	}
 
-0,
+	for(auto &b : BLOCK_3CH)
 
-468891,
+	{
 
-333005,
+		b=0;
 
-333005,
+	}
 
-249446,
+	for(auto &f : F_NUM_6CH)
 
-200294,
+	{
 
-166502,
+		f=0;
 
-141926,
+	}
 
-124723,
+	for(auto &b : BLOCK_6CH)
 
-100147,
+	{
 
-83251,
+		b=0;
 
-70963,
+	}
 
+	for(auto &r : reg)
 
+	{
 
-62362,
+		r=0;
 
-50074,
+	}
 
-41625,
+	for(auto &t : timerCounter)
 
-35482,
+	{
 
-31181,
+		t=0;
 
-25037,
+	}
 
-20813,
+	for(auto &b : timerUp)
 
-17741,
+	{
 
-15590,
+		b=false;
 
-12518,
+	}
 
-10406,
+	for(auto &ch : channels)
 
-8670,
+	{
 
-7795,
+		for(auto &slot : ch.slots)
 
-6259,
+		{
 
-5203,
+			slot.lastDbX100Cache=0;
 
-4435,
+		}
 
+	}
 
+	playingCh=0;
 
-3899,
+	LFO=0;
 
-3130,
+	FREQCTRL=0;
 
-2602,
+}
 
-2218,
 
-1949,
 
-1565,
+////////////////////////////////////////////////////////////
 
-1301,
 
-1109,
 
-974,
+YM2612::YM2612()
 
-782,
+{
 
-650,
+	PowerOn();
 
-554,
+}
 
-497,
+YM2612::~YM2612()
 
-391,
+{
 
-325,
+}
 
-277,
 
 
+void YM2612::PowerOn(void)
 
-241,
+{
 
-194,
+	state.PowerOn();
 
-165,
+}
 
-140,
+void YM2612::Reset(void)
 
-125,
+{
 
-99,
+	state.Reset();
 
-92,
+}
 
-70,
+void YM2612::SetSamplingRate(unsigned int samplingRate)
 
-61,
+{
 
-46,
+	samplingRate=std::max<unsigned int>(SAMPLING_RATE_MIN,std::min<unsigned int>(SAMPLING_RATE_MAX,samplingRate));
 
-37,
+	if(this->samplingRate!=samplingRate)
 
-32,
+	{
 
-26,
+		this->samplingRate=samplingRate;
 
-26,
+		for(auto &ch : state.channels)
 
-0,
+		{
 
-0,
+			UpdatePhase12StepSlot(ch);
 
-};
+		}
 
-static unsigned int sustainDecayReleaseTime10to90Percent[64]=
+	}
 
-{
+}
 
-0,
+unsigned int YM2612::GetSamplingRate(void) const
 
-0,
+{
 
-0,
+	return samplingRate;
 
-0,
+}
 
-0,
+unsigned int YM2612::WriteRegister(unsigned int channelBase,unsigned int reg,unsigned int value)
 
-2491484, // 5:
+{
 
-1658880, // 6:
+	if(true==takeRegLog)
 
-1658880, // 7:
+	{
 
-1247232, // 8: 2491484/2
+		RegWriteLog rwl;
 
-998400,  // 9: 1996800/2
+		rwl.chBase=(unsigned char)channelBase;
 
-823440,  //10: 
+		rwl.reg=(unsigned char)reg;
 
-712704,  //11:
+		rwl.data=(unsigned char)value;
+
+		rwl.count=1;
+
+		if(0<regWriteLog.size() &&
+
+		   regWriteLog.back().chBase==rwl.chBase &&
+
+		   regWriteLog.back().reg==rwl.reg &&
+
+		   regWriteLog.back().data==rwl.data)
+
+		{
+
+			++regWriteLog.back().count;
+
+		}
+
+		else
+
+		{
+
+			regWriteLog.push_back(rwl);
+
+		}
+
+	}
+
+	unsigned int chStartPlaying=65535;
+
+	static const unsigned int slotTwist[4]={0,2,1,3};
+
+	reg&=255;
+
+	auto prev=state.reg[reg];
+
+	state.reg[reg]=value;
+
+	if(REG_TIMER_CONTROL==reg)
+
+	{
+
+		// [2] pp. 202 RESET bits will be cleared immediately after set.
+
+		// .... I interpret it as RESET bits are always read to zero.
+
+		state.reg[REG_TIMER_CONTROL]&=0xCF;
+
+
+
+		// LOAD bits are mysterious.
+
+		// [2] pp.201 tells that writing 1 to LOAD bit resets the counter and start counting.
+
+		// Towns OS's behavior does not seem to be agree with it.
+
+		// Timer A interrupt handler writes 0x3F to register 0x27.  If I implement as [2] pp.201,
+
+		// Timer B counter is reset when Timer A is up, or vise versa.
+
+		// Slower one of Timer A or B will never be up.
+
+		//
+
+		// There are some possibilities:
+
+		// (1) The timer counter resets on the rising edge of LOAD.  When timer is up, LOAD will be cleared.
+
+		//     Therefore, writing LOAD=1 when LOAD is already 1 does nothing.
+
+		// (2) Towns OS writes (0118:[0727H])|0x15 for Timer A or (0118:[0727H])|0x2A for Timer B for resetting the counter.
+
+		//     0118:[0727H] is a cached value (or read back) from YM2612 register 27H.  If LOAD bits are always zero when
+
+		//     read, it won't reset the timer when resetting the other timer.
+
+		// (3) The timer counter is reloaded on LOAD=1 only if the timer is up.
+
+        //
+
+		// There are some web sites such as:
+
+		//   https://plutiedev.com/ym2612-registers#reg-27
+
+		//   https://www.smspower.org/maxim/Documents/YM2612
+
+		//   https://wiki.megadrive.org/index.php?title=YM2612_Registers
+
+		// suggesting that LOAD bit means the timer is running.  If so, I guess (2) is unlikely.
+
+		// With my elementary knowledge in FPGA programming, (1) looks to be more straight-forward.
+
+		// Currently I go with (1).
+
+
+
+		if(0==(prev&1) && 0!=(value&1)) // Load Timer A
+
+		{
+
+			unsigned int countHigh=state.reg[REG_TIMER_A_COUNT_HIGH];
+
+			unsigned int countLow=state.reg[REG_TIMER_A_COUNT_LOW];
+
+			auto count=(countHigh<<2)|(countLow&3);
+
+			state.timerCounter[0]=count*TIMER_A_PER_TICK;
+
+		}
+
+		if(0==(prev&2) && 0!=(value&2)) // Load Timer B
+
+		{
+
+			state.timerCounter[1]=(unsigned int)(state.reg[REG_TIMER_B_COUNT])*TIMER_B_PER_TICK;
+
+		}
+
+		if(value&4) // Enable Timer A Flag
+
+		{
+
+		}
+
+		if(value&8) // Enable Timer B Flag
+
+		{
+
+		}
+
+		if(value&0x10) // Reset Timer A Flag
+
+		{
+
+			state.timerUp[0]=false;
+
+		}
+
+		if(value&0x20) // Reset Timer B Flag
+
+		{
+
+			state.timerUp[1]=false;
+
+		}
+
+	}
+
+	else if(REG_KEY_ON_OFF==reg)
+
+	{
+
+		static unsigned int chTwist[8]={0,1,2,255,3,4,5,255};
+
+		unsigned int ch=chTwist[value&7];
+
+		if(ch<6)
+
+		{
+
+			unsigned int slotFlag=((value>>4)&0x0F);
+
+
+
+			unsigned int onSlots=(~state.channels[ch].usingSlot)&slotFlag;
+
+			unsigned int offSlots=(state.channels[ch].usingSlot&(~slotFlag))&0x0F;
+
+
+
+			// Prob, this is the trigger to start playing.
+
+			// F-BASIC386 first writes SLOT=0 then SLOT=0x0F.
+
+			if(0!=onSlots)
+
+			{
+
+				// Play a tone
+
+				KeyOn(ch,onSlots);
+
+				chStartPlaying=ch;
+
+			}
+
+			if(0!=offSlots)
+
+			{
+
+				KeyOff(ch,offSlots);
+
+			}
+
+
+
+			state.channels[ch].usingSlot=slotFlag;
+
+		}
+
+	}
+
+	else if(REG_LFO==reg)
+
+	{
+
+		state.LFO=(0!=(value&8));
+
+		state.FREQCTRL=value&7;
+
+	}
+
+	else if(0xA8<=reg && reg<=0xAE) // Special 3CH F-Number/BLOCK
+
+	{
+
+		unsigned int slot=(reg&3);
+
+		if(slot<3)
+
+		{
+
+			if(0==channelBase)
+
+			{
+
+				if(reg<0xAC)
+
+				{
+
+					state.F_NUM_3CH[slot]&=0xFF00;
+
+					state.F_NUM_3CH[slot]|=value;
+
+				}
+
+				else
+
+				{
+
+					state.F_NUM_3CH[slot]&=0xFF;
+
+					state.F_NUM_3CH[slot]|=((value&7)<<8);
+
+					state.BLOCK_3CH[slot]=((value>>3)&7);
+
+				}
+
+			}
+
+			else if(3==channelBase)
+
+			{
+
+				if(reg<0xAC)
+
+				{
+
+					state.F_NUM_6CH[slot]&=0xFF00;
+
+					state.F_NUM_6CH[slot]|=value;
+
+				}
+
+				else
+
+				{
+
+					state.F_NUM_6CH[slot]&=0xFF;
+
+					state.F_NUM_6CH[slot]|=((value&7)<<8);
+
+					state.BLOCK_6CH[slot]=((value>>3)&7);
+
+				}
+
+			}
+
+		}
+
+	}
+
+	else if(0x30<=reg && reg<=0x9E) // Per Channel per slot
+
+	{
+
+		unsigned int ch=(reg&3);
+
+		if(ch<=2)
+
+		{
+
+			const unsigned int slot=slotTwist[((reg>>2)&3)];
+
+			ch+=channelBase;
+
+			switch(reg&0xF0)
+
+			{
+
+			case 0x30: // DT, MULTI
+
+				state.channels[ch].slots[slot].DT=((value>>4)&7);
+
+				state.channels[ch].slots[slot].MULTI=(value&15);
+
+				break;
+
+			case 0x40: // TL
+
+				{
+
+					auto prevTL=state.channels[ch].slots[slot].TL;
+
+					state.channels[ch].slots[slot].TL=(value&0x7F);
+
+					if(0!=(state.channels[ch].usingSlot&(1<<slot)))
+
+					{
+
+						auto prevLevel=127-prevTL;
+
+						auto newLevel=127-state.channels[ch].slots[slot].TL;
+
+						UpdateSlotEnvelope(state.channels[ch],state.channels[ch].slots[slot],slotEnvelope[ch][slot]);
+
+						if(0!=prevLevel)
+
+						{
+
+							// Must be linear in dB scale.  To prepare for subsequent release phase.
+
+							state.channels[ch].slots[slot].lastDbX100Cache*=newLevel;
+
+							state.channels[ch].slots[slot].lastDbX100Cache/=prevLevel;
+
+						}
+
+					}
+
+					else if(true==state.channels[ch].slots[slot].InReleasePhase)
+
+					{
+
+						auto prevLevel=127-prevTL;
+
+						auto newLevel=127-state.channels[ch].slots[slot].TL;
+
+						if(0!=prevLevel)
+
+						{
+
+							// Must be linear in dB scale.  lastDbX100Cache shouldn't matter already.
+
+							state.channels[ch].slots[slot].ReleaseStartDbX100*=newLevel;
+
+							state.channels[ch].slots[slot].ReleaseStartDbX100/=prevLevel;
+
+						}
+
+					}
+
+				}
+
+				break;
+
+			case 0x50: // KS,AR
+
+				state.channels[ch].slots[slot].KS=((value>>6)&3);
+
+				state.channels[ch].slots[slot].AR=(value&0x1F);
+
+				break;
+
+			case 0x60: // AM,DR
+
+				state.channels[ch].slots[slot].AM=((value>>7)&1);
+
+				state.channels[ch].slots[slot].DR=(value&0x1F);
+
+				break;
+
+			case 0x70: // SR
+
+				state.channels[ch].slots[slot].SR=(value&0x1F);
+
+				break;
+
+			case 0x80: // SL,RR
+
+				state.channels[ch].slots[slot].SL=((value>>4)&0x0F);
+
+				state.channels[ch].slots[slot].RR=(value&0x0F);
+
+				if(0!=(state.channels[ch].usingSlot&(1<<slot)))
+
+				{
+
+					UpdateSlotEnvelope(state.channels[ch],state.channels[ch].slots[slot],slotEnvelope[ch][slot]);
+
+				}
+
+				else if(true==state.channels[ch].slots[slot].InReleasePhase)
+
+				{
+
+					UpdateRelease(state.channels[ch],state.channels[ch].slots[slot]);
+
+				}
+
+				break;
+
+			case 0x90: // SSG-EG
+
+				state.channels[ch].slots[slot].SSG_EG=(value&0x0F);
+
+				break;
+
+			}
+
+		}
+
+	}
+
+	else if(0xA0<=reg && reg<=0xB6)
+
+	{
+
+		unsigned int ch=(reg&3);
+
+		if(ch<=2)
+
+		{
+
+			unsigned int slot=slotTwist[((reg>>2)&3)];
+
+			ch+=channelBase;
+
+			switch(reg&0xFC)
+
+			{
+
+			case 0xA0: // F-Number1
+
+				// [2] pp.211 Implies that writing to reg A0H to A2H triggers a tone to play.
+
+				//     When setting the note, first write BLOCK and high 3-bits of F-Number (F-Number2),
+
+				//     and then write lower 8-bits of F-Number (F-Number1).
+
+				//     Or, is it REG_KEY_ON_OFF?
+
+				state.channels[ch].F_NUM&=0xFF00;
+
+				state.channels[ch].F_NUM|=value;
+
+				UpdatePhase12StepSlot(state.channels[ch]);
+
+				break;
+
+			case 0xA4: // BLOCK,F-Number2
+
+				state.channels[ch].F_NUM&=0x00FF;
+
+				state.channels[ch].F_NUM|=((value&7)<<8);
+
+				state.channels[ch].BLOCK=((value>>3)&7);
+
+				break;
+
+			case 0xB0: // FB, CONNECT
+
+				state.channels[ch].FB=((value>>3)&7);
+
+				state.channels[ch].CONNECT=(value&7);
+
+				break;
+
+			case 0xB4: // L,R,AMS,PMS
+
+				state.channels[ch].L=((value>>7)&1);
+
+				state.channels[ch].R=((value>>6)&1);
+
+				state.channels[ch].AMS=((value>>4)&3);
+
+				state.channels[ch].PMS=(value&7);
+
+				break;
+
+			}
+
+		}
+
+	}
+
+	return chStartPlaying;
+
+}
+
+unsigned int YM2612::ReadRegister(unsigned int channelBase,unsigned int reg) const
+
+{
+
+	return state.reg[reg&255];
+
+}
+
+
+
+/* static */ const unsigned char YM2612::voiceRegs[NUM_VOICE_REGS]=
+
+{
+
+	REG_DT_MULTI+0x00,REG_DT_MULTI+0x04,REG_DT_MULTI+0x08,REG_DT_MULTI+0x0C,
+
+	REG_TL      +0x00,REG_TL      +0x04,REG_TL      +0x08,REG_TL      +0x0C,
+
+	REG_KS_AR   +0x00,REG_KS_AR   +0x04,REG_KS_AR   +0x08,REG_KS_AR   +0x0C,
+
+	REG_AM_DR   +0x00,REG_AM_DR   +0x04,REG_AM_DR   +0x08,REG_AM_DR   +0x0C,
+
+	REG_SR      +0x00,REG_SR      +0x04,REG_SR      +0x08,REG_SR      +0x0C,
+
+	REG_SL_RR   +0x00,REG_SL_RR   +0x04,REG_SL_RR   +0x08,REG_SL_RR   +0x0C,
+
+	REG_SSG_EG  +0x00,REG_SSG_EG  +0x04,REG_SSG_EG  +0x08,REG_SSG_EG  +0x0C,
+
+	REG_FB_CNCT,
+
+	REG_LR_AMS_PMS,
+
+};
+
+
+
+void YM2612::WriteVoice(unsigned int channelBase,unsigned int chLow,const unsigned char value[NUM_VOICE_REGS],unsigned int carrierAttenuation,EnvelopeDurations envelope[NUM_SLOTS])
+
+{
+
+	static const unsigned int slotTwist[4]={0,2,1,3};
+
+
+
+	unsigned char v[NUM_VOICE_REGS];
+
+	memcpy(v,value,sizeof(v));
+
+	int nCarrierSlots,carrierSlots[4];
+
+	GetCarrierSlotFromConnection(nCarrierSlots,carrierSlots,v[28]);
+
+	for(int i=0; i<nCarrierSlots; ++i)
+
+	{
+
+		auto &TL=v[4+carrierSlots[i]];
+
+		TL=(unsigned char)std::min<unsigned int>(TL_MAX,TL+carrierAttenuation);
+
+	}
+
+
+
+	const unsigned int chNum=channelBase+chLow;
+
+	if(2<chLow || NUM_CHANNELS<=chNum)
+
+	{
+
+		for(int i=0; i<NUM_VOICE_REGS; ++i)
+
+		{
+
+			WriteRegister(channelBase,voiceRegs[i]+chLow,v[i]);
+
+		}
+
+		return;
+
+	}
+
+
+
+	// Register offsets 0x00,0x04,0x08,0x0C are slots 0,2,1,3.
+
+	// Durations are given first so that the TL and SL_RR writes below use them.
+
+	for(unsigned int r=0; r<NUM_SLOTS; ++r)
+
+	{
+
+		EnvelopeDurations *durations=nullptr;
+
+		if(nullptr!=envelope)
+
+		{
+
+			auto key=EnvelopeKey((v[8+r]>>6)&3,v[8+r]&0x1F,v[12+r]&0x1F,v[16+r]&0x1F,(v[20+r]>>4)&0x0F);
+
+			if(envelope[r].key!=key)
+
+			{
+
+				envelope[r].Clear();
+
+				envelope[r].key=key;
+
+			}
+
+			durations=&envelope[r];
+
+		}
+
+		slotEnvelope[chNum][slotTwist[r]]=durations;
+
+	}
+
+
+
+	if(true==takeRegLog)
+
+	{
+
+		// The log must see every write.
+
+		for(int i=0; i<NUM_VOICE_REGS; ++i)
+
+		{
+
+			WriteRegister(channelBase,voiceRegs[i]+chLow,v[i]);
+
+		}
+
+		return;
+
+	}
+
+
+
+	for(int i=0; i<NUM_VOICE_REGS; ++i)
+
+	{
+
+		state.reg[voiceRegs[i]+chLow]=v[i];
+
+	}
+
+
+
+	auto &ch=state.channels[chNum];
+
+	for(unsigned int r=0; r<NUM_SLOTS; ++r)
+
+	{
+
+		const unsigned int slotNum=slotTwist[r];
+
+		auto &slot=ch.slots[slotNum];
+
+		slot.DT=((v[r]>>4)&7);
+
+		slot.MULTI=(v[r]&15);
+
+		slot.KS=((v[8+r]>>6)&3);
+
+		slot.AR=(v[8+r]&0x1F);
+
+		slot.AM=((v[12+r]>>7)&1);
+
+		slot.DR=(v[12+r]&0x1F);
+
+		slot.SR=(v[16+r]&0x1F);
+
+		slot.SSG_EG=(v[24+r]&0x0F);
+
+
+
+		// TL and SL_RR update the envelope of a slot being played or released.
+
+		if(0!=(ch.usingSlot&(1<<slotNum)) || true==slot.InReleasePhase)
+
+		{
+
+			WriteRegister(channelBase,REG_TL+r*4+chLow,v[4+r]);
+
+			WriteRegister(channelBase,REG_SL_RR+r*4+chLow,v[20+r]);
+
+		}
+
+		else
+
+		{
+
+			slot.TL=(v[4+r]&0x7F);
+
+			slot.SL=((v[20+r]>>4)&0x0F);
+
+			slot.RR=(v[20+r]&0x0F);
+
+		}
+
+	}
+
+
+
+	ch.FB=((v[28]>>3)&7);
+
+	ch.CONNECT=(v[28]&7);
+
+	ch.L=((v[29]>>7)&1);
+
+	ch.R=((v[29]>>6)&1);
+
+	ch.AMS=((v[29]>>4)&3);
+
+	ch.PMS=(v[29]&7);
+
+}
+
+void YM2612::Run(unsigned long long int systemTimeInNS)
+
+{
+
+	if(0==state.deviceTimeInNS)
+
+	{
+
+		state.lastTickTimeInNS=systemTimeInNS;
+
+		state.deviceTimeInNS=systemTimeInNS;
+
+		return;
+
+	}
+
+	if(state.lastTickTimeInNS+TICK_DURATION_IN_NS<systemTimeInNS)
+
+	{
+
+		auto nTick=(systemTimeInNS-state.lastTickTimeInNS)/TICK_DURATION_IN_NS;
+
+		state.lastTickTimeInNS+=nTick*TICK_DURATION_IN_NS;
+
+		// See (1) in the above comment.
+
+		if(0!=(state.reg[REG_TIMER_CONTROL]&0x01))
+
+		{
+
+			state.timerCounter[0]+=nTick;
+
+			if(NTICK_TIMER_A<=state.timerCounter[0])
+
+			{
+
+				state.reg[REG_TIMER_CONTROL]&=(~0x01);
+
+				if(0!=(state.reg[REG_TIMER_CONTROL]&0x04))
+
+				{
+
+					state.timerUp[0]=true;
+
+				}
+
+			}
+
+		}
+
+		if(0!=(state.reg[REG_TIMER_CONTROL]&0x02))
+
+		{
+
+			state.timerCounter[1]+=nTick;
+
+			if(NTICK_TIMER_B<=state.timerCounter[1])
+
+			{
+
+				state.reg[REG_TIMER_CONTROL]&=(~0x02);
+
+				if(0!=(state.reg[REG_TIMER_CONTROL]&0x08))
+
+				{
+
+					state.timerUp[1]=true;
+
+				}
+
+			}
+
+		}
+
+	}
+
+
+
+
+
+	state.deviceTimeInNS=systemTimeInNS;
+
+}
+
+bool YM2612::TimerAUp(void) const
+
+{
+
+	return state.timerUp[0];
+
+}
+
+bool YM2612::TimerBUp(void) const
+
+{
+
+	return state.timerUp[1];
+
+}
+
+bool YM2612::TimerUp(unsigned int timerId) const
+
+{
+
+	switch(timerId&1)
+
+	{
+
+	default:
+
+	case 0:
+
+		return TimerAUp();
+
+	case 1:
+
+		return TimerBUp();
+
+	}
+
+}
+
+
+
+/* static */ void YM2612::GetCarrierSlotFromConnection(int &numCarrierSlots,int carrierSlots[4],unsigned int connection)
+
+{
+
+	connection&=7;
+
+	numCarrierSlots=connectionToOutputSlots[connection].nOutputSlots;
+
+	carrierSlots[0]=connectionToOutputSlots[connection].slots[0];
+
+	carrierSlots[1]=connectionToOutputSlots[connection].slots[1];
+
+	carrierSlots[2]=connectionToOutputSlots[connection].slots[2];
+
+	carrierSlots[3]=connectionToOutputSlots[connection].slots[3];
+
+}
+
+
+
+
+
+
+
+std::vector <std::string> YM2612::GetStatusText(void) const
+
+{
+
+	std::vector <std::string> text;
+
+	char str[256];
+
+
+
+	text.push_back("YM2612");
+
+
+
+	for(int chNum=0; chNum<6; ++chNum)
+
+	{
+
+		auto &ch=state.channels[chNum];
+
+
+
+		sprintf(str,"CH:%d  F_NUM=%-5d  BLOCK=%-2d  FB=%d  CONNECT=%d  L=%d  R=%d  AMS=%d  PMS=%d  ActiveSlots=%02x",
+
+			chNum,
+
+			ch.F_NUM,
+
+			ch.BLOCK,
+
+			ch.FB,
+
+			ch.CONNECT,
+
+			ch.L,
+
+			ch.R,
+
+			ch.AMS,
+
+			ch.PMS,
+
+			ch.usingSlot);
+
+		text.push_back(str);
+
+
+
+		int s=0;
+
+		for(auto &slot : ch.slots)
+
+		{
+
+			sprintf(str,"SLOT:%d  DT=%d  MULTI=%-2d  TL=%-3d(%2ddB)  KS=%d  AR=%-2d  AM=%d  DR=%-2d  SR=%-2d  SL=%2d(%2ddB)  RR=%-2d  SSG_EG=%d",
+
+				s,
+
+				slot.DT,
+
+				slot.MULTI,
+
+				slot.TL,
+
+				TLtoDB100[slot.TL]/100,
+
+				slot.KS,
+
+				slot.AR,
+
+				slot.AM,
+
+				slot.DR,
+
+				slot.SR,
+
+				slot.SL,
+
+				SLtoDB100[slot.SL]/100,
+
+				slot.RR,
+
+				slot.SSG_EG);
+
+			text.push_back(str);
+
+			++s;
+
+		}
+
+	}
+
+
+
+
+
+	sprintf(str,"TimerA Up=%d  Count Preset=0x%04x  Internal Count/Threshold=0x%08x/0x%08x",
+
+		TimerAUp(),
+
+		((state.reg[REG_TIMER_A_COUNT_HIGH]<<2)|(state.reg[REG_TIMER_A_COUNT_LOW]&3)),
+
+		(state.timerCounter[0]&0xFFFFFFFF),
+
+		NTICK_TIMER_A);
+
+	text.push_back(str);
+
+
+
+
+
+	sprintf(str,"TimerB Up=%d  Count Preset=0x%04x  Internal Count/Threshold=0x%08x/0x%08x",
+
+		TimerBUp(),
+
+		state.reg[REG_TIMER_B_COUNT],
+
+		(state.timerCounter[1]&0xFFFFFFFF),
+
+		NTICK_TIMER_B);
+
+	text.push_back(str);
+
+
+
+
+
+	sprintf(str,"Timer Control(Reg 0x%02x)=0x%02x  MODE:0x%02x  RST:0x%02x  ENA:0x%02x  LOAD:0x%02x",
+
+		REG_TIMER_CONTROL,
+
+		state.reg[REG_TIMER_CONTROL],
+
+		((state.reg[REG_TIMER_CONTROL]>>6)&3),
+
+		((state.reg[REG_TIMER_CONTROL]>>4)&3),
+
+		((state.reg[REG_TIMER_CONTROL]>>2)&3),
+
+		(state.reg[REG_TIMER_CONTROL]&3));
+
+	text.push_back(str);
+
+
+
+
+
+	sprintf(str,"LFO:%d  FREQ-CTRL:%d",state.LFO,state.FREQCTRL);
+
+	text.push_back(str);
+
+
+
+	return text;
+
+}
+
+
+
+template <class T>
+
+static inline void YM2612_AppendToKey(std::vector <unsigned char> &key,T value)
+
+{
+
+	for(size_t i=0; i<sizeof(T); ++i)
+
+	{
+
+		key.push_back((unsigned char)(value>>(i*8)));
+
+	}
+
+}
+
+
+
+std::vector <unsigned char> YM2612::GetStateKey(void) const
+
+{
+
+	std::vector <unsigned char> key;
+
+
+
+	YM2612_AppendToKey(key,(unsigned int)state.LFO);
+
+	YM2612_AppendToKey(key,state.FREQCTRL);
+
+	YM2612_AppendToKey(key,state.playingCh);
+
+	YM2612_AppendToKey(key,state.volume);
+
+	for(unsigned int chNum=0; chNum<NUM_CHANNELS; ++chNum)
+
+	{
+
+		auto &ch=state.channels[chNum];
+
+
+
+		// A channel that is keyed off and whose all slots have finished stays silent until the next key-on,
+
+		// which resets time and phase.
+
+		bool sounding=false;
+
+		if(0!=(state.playingCh&(1<<chNum)))
+
+		{
+
+			if(0!=ch.usingSlot)
+
+			{
+
+				sounding=true;
+
+			}
+
+			for(auto &slot : ch.slots)
+
+			{
+
+				if(slot.microsecS12<slot.toneDurationMicrosecS12)
+
+				{
+
+					sounding=true;
+
+				}
+
+			}
+
+		}
+
+
+
+		YM2612_AppendToKey(key,(unsigned int)channelMute[chNum]);
+
+		YM2612_AppendToKey(key,(unsigned int)sounding);
+
+		YM2612_AppendToKey(key,ch.F_NUM);
+
+		YM2612_AppendToKey(key,ch.BLOCK);
+
+		YM2612_AppendToKey(key,ch.FB);
+
+		YM2612_AppendToKey(key,ch.CONNECT);
+
+		YM2612_AppendToKey(key,ch.L);
+
+		YM2612_AppendToKey(key,ch.R);
+
+		YM2612_AppendToKey(key,ch.AMS);
+
+		YM2612_AppendToKey(key,ch.PMS);
+
+		YM2612_AppendToKey(key,ch.usingSlot);
+
+		YM2612_AppendToKey(key,ch.playState);
+
+		if(true==sounding)
+
+		{
+
+			YM2612_AppendToKey(key,ch.lastSlot0Out[0]);
+
+			YM2612_AppendToKey(key,ch.lastSlot0Out[1]);
+
+		}
+
+		for(auto &slot : ch.slots)
+
+		{
+
+			YM2612_AppendToKey(key,slot.DT);
+
+			YM2612_AppendToKey(key,slot.MULTI);
+
+			YM2612_AppendToKey(key,slot.TL);
+
+			YM2612_AppendToKey(key,slot.KS);
+
+			YM2612_AppendToKey(key,slot.AR);
+
+			YM2612_AppendToKey(key,slot.AM);
+
+			YM2612_AppendToKey(key,slot.DR);
+
+			YM2612_AppendToKey(key,slot.SR);
+
+			YM2612_AppendToKey(key,slot.SL);
+
+			YM2612_AppendToKey(key,slot.RR);
+
+			YM2612_AppendToKey(key,slot.SSG_EG);
+
+			YM2612_AppendToKey(key,slot.lastDbX100Cache);
+
+			if(true==sounding)
+
+			{
+
+				YM2612_AppendToKey(key,slot.microsecS12);
+
+				YM2612_AppendToKey(key,slot.toneDurationMicrosecS12);
+
+				YM2612_AppendToKey(key,slot.phaseS12);
+
+				YM2612_AppendToKey(key,slot.phaseS12Step);
+
+				for(auto e : slot.env)
+
+				{
+
+					YM2612_AppendToKey(key,e);
+
+				}
+
+				YM2612_AppendToKey(key,slot.envDurationCache);
+
+				YM2612_AppendToKey(key,(unsigned int)slot.InReleasePhase);
+
+				YM2612_AppendToKey(key,slot.ReleaseStartTime);
+
+				YM2612_AppendToKey(key,slot.ReleaseEndTime);
+
+				YM2612_AppendToKey(key,slot.ReleaseStartDbX100);
+
+			}
+
+		}
+
+	}
+
+	return key;
+
+}
+
+/* LICENSE>>
+
+Copyright 2020 Soji Yamakawa (CaptainYS, http://www.ysflight.com)
+
+
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+
+
+1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+
+
+
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+
+
+
+3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+
+<< LICENSE */
+
+#include <algorithm>
+
+#include <iostream>
+
+#include <cstring>
+
+
+
+#include "ym2612.h"
+
+
+
+
+
+
+
+inline void WordOp_Set(unsigned char *ptr,short value)
+
+{
+
+#ifdef YS_LITTLE_ENDIAN
+
+	if(value<-32767)
+
+	{
+
+		*((short *)ptr)=-32767;
+
+	}
+
+	else if(32767<value)
+
+	{
+
+		*((short *)ptr)=32767;
+
+	}
+
+	else
+
+	{
+
+		*((short *)ptr)=value;
+
+	}
+
+#else
+
+	if(value<-32767)
+
+	{
+
+		value=-32767;
+
+	}
+
+	else if(32767<value)
+
+	{
+
+		value=32767;
+
+	}
+
+	ptr[0]=value&255;
+
+	ptr[1]=(value>>8)&255;
+
+#endif
+
+}
+
+
+
+
+
+
+
+// #define YM2612_DEBUGOUTPUT
+
+
+
+
+
+/*static*/ int YM2612::MULTITable[16]= // Multiple x2.
+
+{
+
+	1,
+
+	2,
+
+	4,
+
+	6,
+
+	8,
+
+	10,
+
+	12,
+
+	14,
+
+	16,
+
+	18,
+
+	20,
+
+	22,
+
+	24,
+
+	26,
+
+	28,
+
+	30,
+
+};
+
+
+
+// Attack/Decay/Sustain/Release rate becomes double every four steps in 64-level scale.
+
+// However between i*4 and (i+1)*4, the slope is linearly interpolated.
+
+// Therefore, the slope should be:
+
+//    i=N*4    a
+
+//    i=N*4+1  a*1.25
+
+//    i=N*4+2  a*1.5
+
+//    i=N*4+3  a*1.75
+
+//    i=N*4+4  a*2
+
+//     :
+
+//    i=N*4+8  a*4
+
+//
+
+// The duration of the segment is inverse of the slope, therefore:
+
+//    i=N*4    d
+
+//    i=N*4+1  d/1.25
+
+//    i=N*4+2  d/1.5
+
+//    i=N*4+3  d/1.75
+
+//    i=N*4+4  d/2
+
+//     :
+
+//    i=N*4+8  d/4
+
+//
+
+// The duration of decay/sustain/release depends on how much dB the segment needs to drop.
+
+// It is linear to the dB-drop.
+
+//
+
+// The duration of attack (based on the observation) is constant regardless of the total level.
+
+//
+
+// The observation indicated that the values listed in FM TOWNS Technical Databook was
+
+// about 10% slower than actual.
+
+
+
+static unsigned int attackTime0to96dB[64]= // 1/100ms
+
+{
+
+// Note: The time must be proportional to the base clock.
+
+// Measured/Estimated    FM TOWNS Technical Databook Table I-5-31
+
+1606000,                 // Infinity,
+
+1284800,                 // Infinity,
+
+1070666,                 // Infinity,
+
+917714,                  // Infinity,
+
+803000,                  // 897024,
+
+642400,                  // 897024,
+
+535333,                  // 598016,
+
+458857,                  // 598016,
+
+401500,                  // 448512,
+
+321200,                  // 358810,
+
+267666,                  // 299008,   // Actual Measurement 2677ms
+
+229428,                  // 258293,
+
+200750,                  // 224256,
+
+160600,                  // 173405,
+
+133833,                  // 149504,
+
+114714,                  // 128146,
+
+
+
+100375,                  // 112128,
+
+80300,                   // 83702,
+
+66916,                   // 74752,
+
+57357,                   // 64073,
+
+50187,                   // 56064,
+
+40149,                   // 44851,
+
+33458,                   // 37376,
+
+28678,                   // 32037,
+
+25093,                   // 28032,
+
+20074,                   // 22425,
+
+16728,                   // 18688,
+
+14338,                   // 16018,
+
+12546,                   // 14016,
+
+10036,                   // 11213,
+
+8364,                    // 9344,
+
+7169,                    // 8009,
+
+
+
+6273,                    // 7008,
+
+5018,                    // 5806,
+
+4182,                    // 4872,
+
+3584,                    // 4005,
+
+3136,                    // 3504,
+
+2508,                    // 2903,
+
+2090,                    // 2335,
+
+1792,                    // 2002,
+
+1568,                    // 1752,
+
+1254,                    // 1402,
+
+1045,                    // 1168,
+
+896,                     // 1001,
+
+784,                     // 876,
+
+627,                     // 701,
+
+522,                     // 584,
+
+448,                     // 501,
+
+
+
+392,                     // 438,
+
+313,                     // 350,
+
+261,                     // 232,
+
+224,                     // 250,
+
+196,                     // 240,
+
+156,                     // 192,
+
+130,                     // 160,
+
+112,                     // 137,
+
+98,                      // 126,
+
+78,                      // 101,
+
+65,                      // 84,
+
+56,                      // 72,
+
+49,                      // 60,
+
+39,                      // 60,
+
+32,                      // 0,
+
+28,                      // 0,
+
+};
+
+static unsigned int sustainDecayReleaseTime0to96dB[64]= // 1/100ms
+
+{
+
+// Measured/Estimated    FM TOWNS Technical Databook Table I-5-31
+
+22662400,               // Infinity
+
+18129920,               // Infinity
+
+15108266,               // Infinity
+
+12949942,               // Infinity
+
+11331200,               // 12398592,
+
+9064960,                // 12398592,
+
+7554133,                // 8265726,
+
+6474971,                // 8265728,
+
+5665600,                // 5199296,   // Actual measurement: 56656ms (5665600)
+
+4532480,                // 4953437,
+
+3777066,                // 4132864,
+
+3237485,                // 3542455,
+
+2832800,                // 3099648,
+
+2266240,                // 2479719,
+
+1888533,                // 2066432,
+
+1618742,                // 1771227,
+
+
+
+1416400,                // 1549824,
+
+1133120,                // 1239859,
+
+944266,                 // 1033215,
+
+809371,                 // 885614,
+
+708200,                 // 774912,
+
+566560,                 // 619930,
+
+472133,                 // 516608,
+
+404685,                 // 442807,
+
+354100,                 // 387455,
+
+283280,                 // 309965,
+
+236066,                 // 258304,
+
+202342,                 // 221403,
+
+177050,                 // 193728,
+
+141640,                 // 154982,
+
+118033,                 // 129152,
+
+101171,                 // 110702,
+
+
+
+88525,                  // 96864,
+
+70820,                  // 77491,
+
+59016,                  // 64576,
+
+50585,                  // 55351,
+
+44262,                  // 48432,
+
+35409,                  // 38745,
+
+29508,                  // 32298,
+
+25292,                  // 27675,
+
+22131,                  // 24216,
+
+17704,                  // 19373,
+
+14754,                  // 16144,
+
+12646,                  // 13938,
+
+11065,                  // 12108,
+
+8852,                   // 9686,
+
+7376,                   // 8072,
+
+6322,                   // 6919,
+
+
+
+5532,                   // 6054,
+
+4425,                   // 4843,
+
+3688,                   // 4056,
+
+3161,                   // 3459,
+
+2766,                   // 3027,
+
+2212,                   // 2422,
+
+1844,                   // 2018,
+
+1580,                   // 1730,
+
+1383,                   // 1514,
+
+1106,                   // 1211,
+
+922,                    // 1009,
+
+790,                    // 865,
+
+691,                    // 757,
+
+552,                    // 757,
+
+460,                    // 757,
+
+394,                    // 757,
+
+};
+
+
+
+// I just took the following table from FM TOWNS Technical Databook,
+
+// but I have no idea what's the hell this table is for.
+
+static unsigned int attackTime10to90Percent[64]=
+
+{
+
+0,
+
+0,
+
+0,
+
+0,
+
+0,
+
+468891,
+
+333005,
+
+333005,
+
+249446,
+
+200294,
+
+166502,
+
+141926,
+
+124723,
+
+100147,
+
+83251,
+
+70963,
+
+
+
+62362,
+
+50074,
+
+41625,
+
+35482,
+
+31181,
+
+25037,
+
+20813,
+
+17741,
+
+15590,
+
+12518,
+
+10406,
+
+8670,
+
+7795,
+
+6259,
+
+5203,
+
+4435,
+
+
+
+3899,
+
+3130,
+
+2602,
+
+2218,
+
+1949,
+
+1565,
+
+1301,
+
+1109,
+
+974,
+
+782,
+
+650,
+
+554,
+
+497,
+
+391,
+
+325,
+
+277,
+
+
+
+241,
+
+194,
+
+165,
+
+140,
+
+125,
+
+99,
+
+92,
+
+70,
+
+61,
+
+46,
+
+37,
+
+32,
+
+26,
+
+26,
+
+0,
+
+0,
+
+};
+
+static unsigned int sustainDecayReleaseTime10to90Percent[64]=
+
+{
+
+0,
+
+0,
+
+0,
+
+0,
+
+0,
+
+2491484, // 5:
+
+1658880, // 6:
+
+1658880, // 7:
+
+1247232, // 8: 2491484/2
+
+998400,  // 9: 1996800/2
+
+823440,  //10: 
+
+712704,  //11:
 
 623616,  //12: 2491484/4
 
-498200,  //13: 1996800/4  499200?
+498200,  //13: 1996800/4  499200?
+
+414720,  //14: 
+
+356352,  //15: 
+
+
+
+311808,  //16: 2491484/8
+
+249600,
+
+207360,
+
+178175,
+
+155904,
+
+124800,
+
+103680,
+
+89088,
+
+77952,
+
+62400,
+
+51840,
+
+44544,
+
+38876,
+
+31200,
+
+25920,
+
+22272,
+
+
+
+19488,
+
+15800,
+
+12960,
+
+11136,
+
+9744,
+
+7800,
+
+6480,
+
+5568,
+
+4872,
+
+3900,
+
+3240,
+
+2784,
+
+2436,
+
+1950,
+
+1620,
+
+1392,
+
+
+
+1218,
+
+975,
+
+810,
+
+696,
+
+509,
+
+480,
+
+407,
+
+350,
+
+305,
+
+243,
+
+203,
+
+173,
+
+152,
+
+152,
+
+152,
+
+152,
+
+};
+
+
+
+const struct YM2612::ConnectionToOutputSlot YM2612::connectionToOutputSlots[8]=
+
+{
+
+	{1,{3,-1,-1,-1}},
+
+	{1,{3,-1,-1,-1}},
+
+	{1,{3,-1,-1,-1}},
+
+	{1,{3,-1,-1,-1}},
+
+	{2,{1,3,-1,-1}},
+
+	{3,{1,2,3,-1}},
+
+	{3,{1,2,3,-1}},
+
+	{4,{0,1,2,3}},
+
+};
+
+
+
+static unsigned int detune1000Table[]=
+
+{
+
+	   0,   0,  48,  95,
+
+	   0,   0,  48,  95,
+
+	   0,   0,  48,  95,
+
+	   0,   0,  48,  95,
+
+	   0,  48,  95,  95,
+
+	   0,  48,  95, 143,
+
+	   0,  48,  95, 143,
+
+	   0,  48,  95, 143,
+
+	   0,  48,  95, 191,
+
+	   0,  48, 143, 191,
+
+
+
+	   0,  48, 143, 191,
+
+	   0,  48, 143, 238,
+
+	   0,  95, 191, 238,
+
+	   0,  95, 191, 286,
+
+	   0,  95, 191, 288,
+
+	   0,  95, 238, 334,
+
+	   0,  85, 238, 381, // 85?
+
+	   0, 143, 286, 381,
+
+	   0, 143, 298, 429,
+
+	   0, 143, 334, 477,
+
+
+
+	   0, 191, 381, 525,
+
+	   0, 191, 381, 572,
+
+	   0, 191, 429, 620,
+
+	   0, 238, 477, 668,
+
+	   0, 238, 525, 763,
+
+	   0, 286, 672, 811,
+
+	   0, 286, 520, 906,
+
+	   0, 334, 668, 354,
+
+	   0, 391, 763,1049,
+
+	   0, 391, 763,1049,
+
+
+
+	   0, 391, 763,1049,
+
+	   0, 391, 763,1049,
+
+};
+
+
+
+////////////////////////////////////////////////////////////
+
+
+
+// YM2612 manual tells that the output level increases during the attack phase is exponential,
+
+// which can open up a lot of interpretations.  Is it like dB(t)=C*k^t  ?
+
+// By looking at fmgen by Cisc, it seems to be the difference from the peak output decreases
+
+// exponentially.
+
+//
+
+// If the level difference from the maximum level is diff(i),
+
+//     diff(i+1)=diff(i)*k   {0<t<1}
+
+// Then,
+
+//     diff(i)=diff(0)*(k^i) {0<t<1}
+
+// Let's say the maximum is 4096.  I want to say diff reaches 0 at t=4096, but well it won't be zero.
+
+// So, let's say diff reaches 1 at t=409t instead.  The initial difference is 4096.  Then,
+
+// 
+
+//     1=4096*t^4095, 
+
+// 
+
+// From there, I can calculate t.  And then values for the table.
+
+//
+
+//     lastErr=0.014
+
+//     t=pow(lastErr,1.0/4096.0)
+
+//     attackExp[i]=(int)(4096*(1.0-pow(t,(double)i))/(1.0-lastErr))
+
+//
+
+// attackExpInverse[j] is the largest i that satisfies attackExp[i]<=j, or 4095 if j is beyond attackExp[4095].
+
+
+
+// 0 to 4095 scale in -> 0 to 4095 scale out.
+
+/*static*/ const unsigned int YM2612::attackExp[4096]=
+
+{
+
+	0,4,8,12,17,21,25,30,34,38,43,47,51,55,60,64,
+
+	68,72,77,81,85,89,94,98,102,106,111,115,119,123,127,132,
+
+	136,140,144,148,152,157,161,165,169,173,177,182,186,190,194,198,
+
+	202,206,210,215,219,223,227,231,235,239,243,247,251,255,259,263,
+
+	268,272,276,280,284,288,292,296,300,304,308,312,316,320,324,328,
+
+	332,336,340,344,348,352,356,360,364,367,371,375,379,383,387,391,
+
+	395,399,403,407,411,415,418,422,426,430,434,438,442,446,449,453,
+
+	457,461,465,469,473,476,480,484,488,492,495,499,503,507,511,514,
+
+	518,522,526,530,533,537,541,545,548,552,556,560,563,567,571,575,
+
+	578,582,586,590,593,597,601,604,608,612,615,619,623,627,630,634,
+
+	638,641,645,648,652,656,659,663,667,670,674,678,681,685,688,692,
+
+	696,699,703,706,710,714,717,721,724,728,732,735,739,742,746,749,
+
+	753,756,760,763,767,771,774,778,781,785,788,792,795,799,802,806,
+
+	809,813,816,820,823,826,830,833,837,840,844,847,851,854,858,861,
+
+	864,868,871,875,878,881,885,888,892,895,898,902,905,909,912,915,
+
+	919,922,926,929,932,936,939,942,946,949,952,956,959,962,966,969,
+
+	972,976,979,982,986,989,992,995,999,1002,1005,1009,1012,1015,1018,1022,
+
+	1025,1028,1031,1035,1038,1041,1044,1048,1051,1054,1057,1061,1064,1067,1070,1073,
+
+	1077,1080,1083,1086,1089,1093,1096,1099,1102,1105,1109,1112,1115,1118,1121,1124,
+
+	1128,1131,1134,1137,1140,1143,1146,1150,1153,1156,1159,1162,1165,1168,1171,1174,
+
+	1178,1181,1184,1187,1190,1193,1196,1199,1202,1205,1208,1211,1215,1218,1221,1224,
+
+	1227,1230,1233,1236,1239,1242,1245,1248,1251,1254,1257,1260,1263,1266,1269,1272,
+
+	1275,1278,1281,1284,1287,1290,1293,1296,1299,1302,1305,1308,1311,1314,1317,1320,
+
+	1323,1326,1329,1332,1335,1337,1340,1343,1346,1349,1352,1355,1358,1361,1364,1367,
+
+	1370,1372,1375,1378,1381,1384,1387,1390,1393,1396,1398,1401,1404,1407,1410,1413,
+
+	1416,1418,1421,1424,1427,1430,1433,1436,1438,1441,1444,1447,1450,1452,1455,1458,
+
+	1461,1464,1466,1469,1472,1475,1478,1480,1483,1486,1489,1492,1494,1497,1500,1503,
+
+	1505,1508,1511,1514,1516,1519,1522,1525,1527,1530,1533,1536,1538,1541,1544,1546,
+
+	1549,1552,1555,1557,1560,1563,1565,1568,1571,1574,1576,1579,1582,1584,1587,1590,
+
+	1592,1595,1598,1600,1603,1606,1608,1611,1614,1616,1619,1621,1624,1627,1629,1632,
+
+	1635,1637,1640,1642,1645,1648,1650,1653,1656,1658,1661,1663,1666,1669,1671,1674,
+
+	1676,1679,1681,1684,1687,1689,1692,1694,1697,1699,1702,1705,1707,1710,1712,1715,
+
+	1717,1720,1722,1725,1727,1730,1732,1735,1737,1740,1743,1745,1748,1750,1753,1755,
+
+	1758,1760,1763,1765,1768,1770,1772,1775,1777,1780,1782,1785,1787,1790,1792,1795,
+
+	1797,1800,1802,1805,1807,1809,1812,1814,1817,1819,1822,1824,1826,1829,1831,1834,
+
+	1836,1839,1841,1843,1846,1848,1851,1853,1855,1858,1860,1863,1865,1867,1870,1872,
+
+	1874,1877,1879,1882,1884,1886,1889,1891,1893,1896,1898,1900,1903,1905,1907,1910,
+
+	1912,1914,1917,1919,1921,1924,1926,1928,1931,1933,1935,1938,1940,1942,1945,1947,
+
+	1949,1952,1954,1956,1958,1961,1963,1965,1968,1970,1972,1974,1977,1979,1981,1983,
+
+	1986,1988,1990,1992,1995,1997,1999,2001,2004,2006,2008,2010,2013,2015,2017,2019,
+
+	2022,2024,2026,2028,2030,2033,2035,2037,2039,2041,2044,2046,2048,2050,2052,2055,
+
+	2057,2059,2061,2063,2065,2068,2070,2072,2074,2076,2079,2081,2083,2085,2087,2089,
+
+	2091,2094,2096,2098,2100,2102,2104,2106,2109,2111,2113,2115,2117,2119,2121,2123,
+
+	2126,2128,2130,2132,2134,2136,2138,2140,2142,2144,2147,2149,2151,2153,2155,2157,
+
+	2159,2161,2163,2165,2167,2169,2172,2174,2176,2178,2180,2182,2184,2186,2188,2190,
+
+	2192,2194,2196,2198,2200,2202,2204,2206,2208,2210,2212,2214,2216,2218,2220,2222,
+
+	2225,2227,2229,2231,2233,2235,2237,2239,2241,2243,2245,2246,2248,2250,2252,2254,
+
+	2256,2258,2260,2262,2264,2266,2268,2270,2272,2274,2276,2278,2280,2282,2284,2286,
+
+	2288,2290,2292,2294,2296,2297,2299,2301,2303,2305,2307,2309,2311,2313,2315,2317,
+
+	2319,2321,2322,2324,2326,2328,2330,2332,2334,2336,2338,2340,2341,2343,2345,2347,
+
+	2349,2351,2353,2355,2356,2358,2360,2362,2364,2366,2368,2370,2371,2373,2375,2377,
+
+	2379,2381,2383,2384,2386,2388,2390,2392,2394,2395,2397,2399,2401,2403,2405,2406,
+
+	2408,2410,2412,2414,2415,2417,2419,2421,2423,2424,2426,2428,2430,2432,2433,2435,
+
+	2437,2439,2441,2442,2444,2446,2448,2450,2451,2453,2455,2457,2458,2460,2462,2464,
+
+	2465,2467,2469,2471,2472,2474,2476,2478,2479,2481,2483,2485,2486,2488,2490,2492,
+
+	2493,2495,2497,2499,2500,2502,2504,2505,2507,2509,2511,2512,2514,2516,2517,2519,
+
+	2521,2523,2524,2526,2528,2529,2531,2533,2534,2536,2538,2539,2541,2543,2544,2546,
+
+	2548,2549,2551,2553,2554,2556,2558,2559,2561,2563,2564,2566,2568,2569,2571,2573,
+
+	2574,2576,2578,2579,2581,2583,2584,2586,2587,2589,2591,2592,2594,2596,2597,2599,
+
+	2600,2602,2604,2605,2607,2609,2610,2612,2613,2615,2617,2618,2620,2621,2623,2625,
+
+	2626,2628,2629,2631,2633,2634,2636,2637,2639,2640,2642,2644,2645,2647,2648,2650,
+
+	2651,2653,2655,2656,2658,2659,2661,2662,2664,2665,2667,2669,2670,2672,2673,2675,
+
+	2676,2678,2679,2681,2682,2684,2685,2687,2689,2690,2692,2693,2695,2696,2698,2699,
+
+	2701,2702,2704,2705,2707,2708,2710,2711,2713,2714,2716,2717,2719,2720,2722,2723,
+
+	2725,2726,2728,2729,2731,2732,2734,2735,2737,2738,2740,2741,2742,2744,2745,2747,
+
+	2748,2750,2751,2753,2754,2756,2757,2759,2760,2761,2763,2764,2766,2767,2769,2770,
+
+	2772,2773,2774,2776,2777,2779,2780,2782,2783,2784,2786,2787,2789,2790,2792,2793,
+
+	2794,2796,2797,2799,2800,2802,2803,2804,2806,2807,2809,2810,2811,2813,2814,2816,
+
+	2817,2818,2820,2821,2822,2824,2825,2827,2828,2829,2831,2832,2834,2835,2836,2838,
+
+	2839,2840,2842,2843,2844,2846,2847,2849,2850,2851,2853,2854,2855,2857,2858,2859,
+
+	2861,2862,2863,2865,2866,2867,2869,2870,2871,2873,2874,2875,2877,2878,2879,2881,
+
+	2882,2883,2885,2886,2887,2889,2890,2891,2893,2894,2895,2897,2898,2899,2901,2902,
+
+	2903,2904,2906,2907,2908,2910,2911,2912,2914,2915,2916,2917,2919,2920,2921,2923,
+
+	2924,2925,2926,2928,2929,2930,2932,2933,2934,2935,2937,2938,2939,2940,2942,2943,
+
+	2944,2945,2947,2948,2949,2950,2952,2953,2954,2955,2957,2958,2959,2960,2962,2963,
+
+	2964,2965,2967,2968,2969,2970,2972,2973,2974,2975,2977,2978,2979,2980,2981,2983,
+
+	2984,2985,2986,2988,2989,2990,2991,2992,2994,2995,2996,2997,2998,3000,3001,3002,
+
+	3003,3004,3006,3007,3008,3009,3010,3012,3013,3014,3015,3016,3017,3019,3020,3021,
+
+	3022,3023,3025,3026,3027,3028,3029,3030,3032,3033,3034,3035,3036,3037,3039,3040,
+
+	3041,3042,3043,3044,3046,3047,3048,3049,3050,3051,3052,3054,3055,3056,3057,3058,
+
+	3059,3060,3062,3063,3064,3065,3066,3067,3068,3070,3071,3072,3073,3074,3075,3076,
+
+	3077,3079,3080,3081,3082,3083,3084,3085,3086,3087,3089,3090,3091,3092,3093,3094,
+
+	3095,3096,3097,3099,3100,3101,3102,3103,3104,3105,3106,3107,3108,3109,3111,3112,
+
+	3113,3114,3115,3116,3117,3118,3119,3120,3121,3122,3124,3125,3126,3127,3128,3129,
+
+	3130,3131,3132,3133,3134,3135,3136,3137,3138,3139,3141,3142,3143,3144,3145,3146,
+
+	3147,3148,3149,3150,3151,3152,3153,3154,3155,3156,3157,3158,3159,3160,3161,3162,
+
+	3164,3165,3166,3167,3168,3169,3170,3171,3172,3173,3174,3175,3176,3177,3178,3179,
+
+	3180,3181,3182,3183,3184,3185,3186,3187,3188,3189,3190,3191,3192,3193,3194,3195,
+
+	3196,3197,3198,3199,3200,3201,3202,3203,3204,3205,3206,3207,3208,3209,3210,3211,
+
+	3212,3213,3214,3215,3216,3217,3218,3219,3220,3221,3222,3223,3224,3225,3225,3226,
+
+	3227,3228,3229,3230,3231,3232,3233,3234,3235,3236,3237,3238,3239,3240,3241,3242,
+
+	3243,3244,3245,3246,3247,3247,3248,3249,3250,3251,3252,3253,3254,3255,3256,3257,
+
+	3258,3259,3260,3261,3262,3262,3263,3264,3265,3266,3267,3268,3269,3270,3271,3272,
+
+	3273,3274,3274,3275,3276,3277,3278,3279,3280,3281,3282,3283,3284,3284,3285,3286,
+
+	3287,3288,3289,3290,3291,3292,3293,3293,3294,3295,3296,3297,3298,3299,3300,3301,
+
+	3301,3302,3303,3304,3305,3306,3307,3308,3309,3309,3310,3311,3312,3313,3314,3315,
+
+	3316,3316,3317,3318,3319,3320,3321,3322,3323,3323,3324,3325,3326,3327,3328,3329,
+
+	3329,3330,3331,3332,3333,3334,3335,3335,3336,3337,3338,3339,3340,3341,3341,3342,
+
+	3343,3344,3345,3346,3346,3347,3348,3349,3350,3351,3351,3352,3353,3354,3355,3356,
+
+	3356,3357,3358,3359,3360,3361,3361,3362,3363,3364,3365,3366,3366,3367,3368,3369,
+
+	3370,3370,3371,3372,3373,3374,3375,3375,3376,3377,3378,3379,3379,3380,3381,3382,
+
+	3383,3383,3384,3385,3386,3387,3387,3388,3389,3390,3391,3391,3392,3393,3394,3395,
+
+	3395,3396,3397,3398,3399,3399,3400,3401,3402,3402,3403,3404,3405,3406,3406,3407,
+
+	3408,3409,3409,3410,3411,3412,3413,3413,3414,3415,3416,3416,3417,3418,3419,3419,
+
+	3420,3421,3422,3423,3423,3424,3425,3426,3426,3427,3428,3429,3429,3430,3431,3432,
+
+	3432,3433,3434,3435,3435,3436,3437,3438,3438,3439,3440,3441,3441,3442,3443,3444,
+
+	3444,3445,3446,3447,3447,3448,3449,3449,3450,3451,3452,3452,3453,3454,3455,3455,
+
+	3456,3457,3457,3458,3459,3460,3460,3461,3462,3463,3463,3464,3465,3465,3466,3467,
+
+	3468,3468,3469,3470,3470,3471,3472,3473,3473,3474,3475,3475,3476,3477,3478,3478,
+
+	3479,3480,3480,3481,3482,3482,3483,3484,3485,3485,3486,3487,3487,3488,3489,3489,
+
+	3490,3491,3491,3492,3493,3494,3494,3495,3496,3496,3497,3498,3498,3499,3500,3500,
+
+	3501,3502,3502,3503,3504,3504,3505,3506,3506,3507,3508,3508,3509,3510,3510,3511,
+
+	3512,3513,3513,3514,3515,3515,3516,3517,3517,3518,3518,3519,3520,3520,3521,3522,
+
+	3522,3523,3524,3524,3525,3526,3526,3527,3528,3528,3529,3530,3530,3531,3532,3532,
+
+	3533,3534,3534,3535,3535,3536,3537,3537,3538,3539,3539,3540,3541,3541,3542,3543,
+
+	3543,3544,3544,3545,3546,3546,3547,3548,3548,3549,3549,3550,3551,3551,3552,3553,
+
+	3553,3554,3554,3555,3556,3556,3557,3558,3558,3559,3559,3560,3561,3561,3562,3563,
+
+	3563,3564,3564,3565,3566,3566,3567,3567,3568,3569,3569,3570,3571,3571,3572,3572,
+
+	3573,3574,3574,3575,3575,3576,3577,3577,3578,3578,3579,3580,3580,3581,3581,3582,
+
+	3583,3583,3584,3584,3585,3586,3586,3587,3587,3588,3588,3589,3590,3590,3591,3591,
+
+	3592,3593,3593,3594,3594,3595,3595,3596,3597,3597,3598,3598,3599,3600,3600,3601,
+
+	3601,3602,3602,3603,3604,3604,3605,3605,3606,3606,3607,3608,3608,3609,3609,3610,
+
+	3610,3611,3612,3612,3613,3613,3614,3614,3615,3615,3616,3617,3617,3618,3618,3619,
+
+	3619,3620,3621,3621,3622,3622,3623,3623,3624,3624,3625,3625,3626,3627,3627,3628,
+
+	3628,3629,3629,3630,3630,3631,3632,3632,3633,3633,3634,3634,3635,3635,3636,3636,
+
+	3637,3637,3638,3639,3639,3640,3640,3641,3641,3642,3642,3643,3643,3644,3644,3645,
+
+	3645,3646,3647,3647,3648,3648,3649,3649,3650,3650,3651,3651,3652,3652,3653,3653,
+
+	3654,3654,3655,3655,3656,3656,3657,3657,3658,3659,3659,3660,3660,3661,3661,3662,
+
+	3662,3663,3663,3664,3664,3665,3665,3666,3666,3667,3667,3668,3668,3669,3669,3670,
+
+	3670,3671,3671,3672,3672,3673,3673,3674,3674,3675,3675,3676,3676,3677,3677,3678,
+
+	3678,3679,3679,3680,3680,3681,3681,3682,3682,3683,3683,3684,3684,3685,3685,3686,
+
+	3686,3687,3687,3688,3688,3689,3689,3690,3690,3690,3691,3691,3692,3692,3693,3693,
+
+	3694,3694,3695,3695,3696,3696,3697,3697,3698,3698,3699,3699,3700,3700,3701,3701,
+
+	3701,3702,3702,3703,3703,3704,3704,3705,3705,3706,3706,3707,3707,3708,3708,3708,
+
+	3709,3709,3710,3710,3711,3711,3712,3712,3713,3713,3714,3714,3714,3715,3715,3716,
+
+	3716,3717,3717,3718,3718,3719,3719,3719,3720,3720,3721,3721,3722,3722,3723,3723,
+
+	3724,3724,3724,3725,3725,3726,3726,3727,3727,3728,3728,3728,3729,3729,3730,3730,
+
+	3731,3731,3732,3732,3732,3733,3733,3734,3734,3735,3735,3735,3736,3736,3737,3737,
+
+	3738,3738,3738,3739,3739,3740,3740,3741,3741,3742,3742,3742,3743,3743,3744,3744,
+
+	3745,3745,3745,3746,3746,3747,3747,3747,3748,3748,3749,3749,3750,3750,3750,3751,
+
+	3751,3752,3752,3753,3753,3753,3754,3754,3755,3755,3755,3756,3756,3757,3757,3758,
+
+	3758,3758,3759,3759,3760,3760,3760,3761,3761,3762,3762,3762,3763,3763,3764,3764,
+
+	3764,3765,3765,3766,3766,3766,3767,3767,3768,3768,3769,3769,3769,3770,3770,3771,
+
+	3771,3771,3772,3772,3772,3773,3773,3774,3774,3774,3775,3775,3776,3776,3776,3777,
+
+	3777,3778,3778,3778,3779,3779,3780,3780,3780,3781,3781,3782,3782,3782,3783,3783,
+
+	3783,3784,3784,3785,3785,3785,3786,3786,3787,3787,3787,3788,3788,3788,3789,3789,
+
+	3790,3790,3790,3791,3791,3791,3792,3792,3793,3793,3793,3794,3794,3794,3795,3795,
+
+	3796,3796,3796,3797,3797,3797,3798,3798,3799,3799,3799,3800,3800,3800,3801,3801,
+
+	3802,3802,3802,3803,3803,3803,3804,3804,3804,3805,3805,3806,3806,3806,3807,3807,
+
+	3807,3808,3808,3808,3809,3809,3810,3810,3810,3811,3811,3811,3812,3812,3812,3813,
+
+	3813,3813,3814,3814,3814,3815,3815,3816,3816,3816,3817,3817,3817,3818,3818,3818,
+
+	3819,3819,3819,3820,3820,3820,3821,3821,3821,3822,3822,3823,3823,3823,3824,3824,
+
+	3824,3825,3825,3825,3826,3826,3826,3827,3827,3827,3828,3828,3828,3829,3829,3829,
+
+	3830,3830,3830,3831,3831,3831,3832,3832,3832,3833,3833,3833,3834,3834,3834,3835,
+
+	3835,3835,3836,3836,3836,3837,3837,3837,3838,3838,3838,3839,3839,3839,3840,3840,
+
+	3840,3841,3841,3841,3842,3842,3842,3843,3843,3843,3844,3844,3844,3845,3845,3845,
+
+	3845,3846,3846,3846,3847,3847,3847,3848,3848,3848,3849,3849,3849,3850,3850,3850,
+
+	3851,3851,3851,3852,3852,3852,3852,3853,3853,3853,3854,3854,3854,3855,3855,3855,
+
+	3856,3856,3856,3857,3857,3857,3857,3858,3858,3858,3859,3859,3859,3860,3860,3860,
+
+	3861,3861,3861,3861,3862,3862,3862,3863,3863,3863,3864,3864,3864,3864,3865,3865,
+
+	3865,3866,3866,3866,3867,3867,3867,3867,3868,3868,3868,3869,3869,3869,3870,3870,
+
+	3870,3870,3871,3871,3871,3872,3872,3872,3873,3873,3873,3873,3874,3874,3874,3875,
+
+	3875,3875,3875,3876,3876,3876,3877,3877,3877,3877,3878,3878,3878,3879,3879,3879,
+
+	3879,3880,3880,3880,3881,3881,3881,3881,3882,3882,3882,3883,3883,3883,3883,3884,
+
+	3884,3884,3885,3885,3885,3885,3886,3886,3886,3886,3887,3887,3887,3888,3888,3888,
+
+	3888,3889,3889,3889,3890,3890,3890,3890,3891,3891,3891,3891,3892,3892,3892,3893,
+
+	3893,3893,3893,3894,3894,3894,3894,3895,3895,3895,3896,3896,3896,3896,3897,3897,
+
+	3897,3897,3898,3898,3898,3898,3899,3899,3899,3900,3900,3900,3900,3901,3901,3901,
+
+	3901,3902,3902,3902,3902,3903,3903,3903,3903,3904,3904,3904,3905,3905,3905,3905,
+
+	3906,3906,3906,3906,3907,3907,3907,3907,3908,3908,3908,3908,3909,3909,3909,3909,
+
+	3910,3910,3910,3910,3911,3911,3911,3911,3912,3912,3912,3912,3913,3913,3913,3913,
+
+	3914,3914,3914,3914,3915,3915,3915,3915,3916,3916,3916,3916,3917,3917,3917,3917,
+
+	3918,3918,3918,3918,3919,3919,3919,3919,3920,3920,3920,3920,3921,3921,3921,3921,
+
+	3922,3922,3922,3922,3923,3923,3923,3923,3923,3924,3924,3924,3924,3925,3925,3925,
+
+	3925,3926,3926,3926,3926,3927,3927,3927,3927,3928,3928,3928,3928,3928,3929,3929,
+
+	3929,3929,3930,3930,3930,3930,3931,3931,3931,3931,3932,3932,3932,3932,3932,3933,
+
+	3933,3933,3933,3934,3934,3934,3934,3934,3935,3935,3935,3935,3936,3936,3936,3936,
+
+	3937,3937,3937,3937,3937,3938,3938,3938,3938,3939,3939,3939,3939,3939,3940,3940,
+
+	3940,3940,3941,3941,3941,3941,3941,3942,3942,3942,3942,3943,3943,3943,3943,3943,
+
+	3944,3944,3944,3944,3945,3945,3945,3945,3945,3946,3946,3946,3946,3946,3947,3947,
+
+	3947,3947,3948,3948,3948,3948,3948,3949,3949,3949,3949,3949,3950,3950,3950,3950,
+
+	3951,3951,3951,3951,3951,3952,3952,3952,3952,3952,3953,3953,3953,3953,3953,3954,
+
+	3954,3954,3954,3955,3955,3955,3955,3955,3956,3956,3956,3956,3956,3957,3957,3957,
+
+	3957,3957,3958,3958,3958,3958,3958,3959,3959,3959,3959,3959,3960,3960,3960,3960,
+
+	3960,3961,3961,3961,3961,3961,3962,3962,3962,3962,3962,3963,3963,3963,3963,3963,
+
+	3964,3964,3964,3964,3964,3965,3965,3965,3965,3965,3966,3966,3966,3966,3966,3967,
+
+	3967,3967,3967,3967,3968,3968,3968,3968,3968,3969,3969,3969,3969,3969,3969,3970,
+
+	3970,3970,3970,3970,3971,3971,3971,3971,3971,3972,3972,3972,3972,3972,3973,3973,
+
+	3973,3973,3973,3973,3974,3974,3974,3974,3974,3975,3975,3975,3975,3975,3976,3976,
+
+	3976,3976,3976,3976,3977,3977,3977,3977,3977,3978,3978,3978,3978,3978,3978,3979,
+
+	3979,3979,3979,3979,3980,3980,3980,3980,3980,3980,3981,3981,3981,3981,3981,3982,
+
+	3982,3982,3982,3982,3982,3983,3983,3983,3983,3983,3984,3984,3984,3984,3984,3984,
+
+	3985,3985,3985,3985,3985,3985,3986,3986,3986,3986,3986,3987,3987,3987,3987,3987,
+
+	3987,3988,3988,3988,3988,3988,3988,3989,3989,3989,3989,3989,3989,3990,3990,3990,
+
+	3990,3990,3990,3991,3991,3991,3991,3991,3991,3992,3992,3992,3992,3992,3992,3993,
+
+	3993,3993,3993,3993,3994,3994,3994,3994,3994,3994,3995,3995,3995,3995,3995,3995,
+
+	3995,3996,3996,3996,3996,3996,3996,3997,3997,3997,3997,3997,3997,3998,3998,3998,
+
+	3998,3998,3998,3999,3999,3999,3999,3999,3999,4000,4000,4000,4000,4000,4000,4001,
+
+	4001,4001,4001,4001,4001,4001,4002,4002,4002,4002,4002,4002,4003,4003,4003,4003,
+
+	4003,4003,4004,4004,4004,4004,4004,4004,4004,4005,4005,4005,4005,4005,4005,4006,
+
+	4006,4006,4006,4006,4006,4006,4007,4007,4007,4007,4007,4007,4008,4008,4008,4008,
+
+	4008,4008,4008,4009,4009,4009,4009,4009,4009,4010,4010,4010,4010,4010,4010,4010,
+
+	4011,4011,4011,4011,4011,4011,4011,4012,4012,4012,4012,4012,4012,4012,4013,4013,
+
+	4013,4013,4013,4013,4014,4014,4014,4014,4014,4014,4014,4015,4015,4015,4015,4015,
+
+	4015,4015,4016,4016,4016,4016,4016,4016,4016,4017,4017,4017,4017,4017,4017,4017,
+
+	4018,4018,4018,4018,4018,4018,4018,4019,4019,4019,4019,4019,4019,4019,4020,4020,
+
+	4020,4020,4020,4020,4020,4020,4021,4021,4021,4021,4021,4021,4021,4022,4022,4022,
+
+	4022,4022,4022,4022,4023,4023,4023,4023,4023,4023,4023,4023,4024,4024,4024,4024,
+
+	4024,4024,4024,4025,4025,4025,4025,4025,4025,4025,4026,4026,4026,4026,4026,4026,
+
+	4026,4026,4027,4027,4027,4027,4027,4027,4027,4028,4028,4028,4028,4028,4028,4028,
+
+	4028,4029,4029,4029,4029,4029,4029,4029,4029,4030,4030,4030,4030,4030,4030,4030,
+
+	4030,4031,4031,4031,4031,4031,4031,4031,4032,4032,4032,4032,4032,4032,4032,4032,
+
+	4033,4033,4033,4033,4033,4033,4033,4033,4034,4034,4034,4034,4034,4034,4034,4034,
+
+	4035,4035,4035,4035,4035,4035,4035,4035,4036,4036,4036,4036,4036,4036,4036,4036,
+
+	4037,4037,4037,4037,4037,4037,4037,4037,4037,4038,4038,4038,4038,4038,4038,4038,
+
+	4038,4039,4039,4039,4039,4039,4039,4039,4039,4040,4040,4040,4040,4040,4040,4040,
+
+	4040,4040,4041,4041,4041,4041,4041,4041,4041,4041,4042,4042,4042,4042,4042,4042,
+
+	4042,4042,4042,4043,4043,4043,4043,4043,4043,4043,4043,4043,4044,4044,4044,4044,
+
+	4044,4044,4044,4044,4045,4045,4045,4045,4045,4045,4045,4045,4045,4046,4046,4046,
+
+	4046,4046,4046,4046,4046,4046,4047,4047,4047,4047,4047,4047,4047,4047,4047,4048,
+
+	4048,4048,4048,4048,4048,4048,4048,4048,4049,4049,4049,4049,4049,4049,4049,4049,
+
+	4049,4050,4050,4050,4050,4050,4050,4050,4050,4050,4050,4051,4051,4051,4051,4051,
+
+	4051,4051,4051,4051,4052,4052,4052,4052,4052,4052,4052,4052,4052,4053,4053,4053,
+
+	4053,4053,4053,4053,4053,4053,4053,4054,4054,4054,4054,4054,4054,4054,4054,4054,
+
+	4054,4055,4055,4055,4055,4055,4055,4055,4055,4055,4056,4056,4056,4056,4056,4056,
+
+	4056,4056,4056,4056,4057,4057,4057,4057,4057,4057,4057,4057,4057,4057,4058,4058,
+
+	4058,4058,4058,4058,4058,4058,4058,4058,4059,4059,4059,4059,4059,4059,4059,4059,
+
+	4059,4059,4060,4060,4060,4060,4060,4060,4060,4060,4060,4060,4061,4061,4061,4061,
+
+	4061,4061,4061,4061,4061,4061,4061,4062,4062,4062,4062,4062,4062,4062,4062,4062,
+
+	4062,4063,4063,4063,4063,4063,4063,4063,4063,4063,4063,4063,4064,4064,4064,4064,
+
+	4064,4064,4064,4064,4064,4064,4064,4065,4065,4065,4065,4065,4065,4065,4065,4065,
+
+	4065,4066,4066,4066,4066,4066,4066,4066,4066,4066,4066,4066,4067,4067,4067,4067,
+
+	4067,4067,4067,4067,4067,4067,4067,4068,4068,4068,4068,4068,4068,4068,4068,4068,
+
+	4068,4068,4068,4069,4069,4069,4069,4069,4069,4069,4069,4069,4069,4069,4070,4070,
+
+	4070,4070,4070,4070,4070,4070,4070,4070,4070,4071,4071,4071,4071,4071,4071,4071,
+
+	4071,4071,4071,4071,4071,4072,4072,4072,4072,4072,4072,4072,4072,4072,4072,4072,
+
+	4072,4073,4073,4073,4073,4073,4073,4073,4073,4073,4073,4073,4073,4074,4074,4074,
+
+	4074,4074,4074,4074,4074,4074,4074,4074,4074,4075,4075,4075,4075,4075,4075,4075,
+
+	4075,4075,4075,4075,4075,4076,4076,4076,4076,4076,4076,4076,4076,4076,4076,4076,
+
+	4076,4077,4077,4077,4077,4077,4077,4077,4077,4077,4077,4077,4077,4077,4078,4078,
+
+	4078,4078,4078,4078,4078,4078,4078,4078,4078,4078,4079,4079,4079,4079,4079,4079,
+
+	4079,4079,4079,4079,4079,4079,4079,4080,4080,4080,4080,4080,4080,4080,4080,4080,
+
+	4080,4080,4080,4080,4081,4081,4081,4081,4081,4081,4081,4081,4081,4081,4081,4081,
+
+	4081,4081,4082,4082,4082,4082,4082,4082,4082,4082,4082,4082,4082,4082,4082,4083,
+
+	4083,4083,4083,4083,4083,4083,4083,4083,4083,4083,4083,4083,4083,4084,4084,4084,
+
+	4084,4084,4084,4084,4084,4084,4084,4084,4084,4084,4085,4085,4085,4085,4085,4085,
+
+	4085,4085,4085,4085,4085,4085,4085,4085,4086,4086,4086,4086,4086,4086,4086,4086,
+
+	4086,4086,4086,4086,4086,4086,4087,4087,4087,4087,4087,4087,4087,4087,4087,4087,
+
+	4087,4087,4087,4087,4087,4088,4088,4088,4088,4088,4088,4088,4088,4088,4088,4088,
+
+	4088,4088,4088,4089,4089,4089,4089,4089,4089,4089,4089,4089,4089,4089,4089,4089,
+
+	4089,4089,4090,4090,4090,4090,4090,4090,4090,4090,4090,4090,4090,4090,4090,4090,
+
+	4090,4091,4091,4091,4091,4091,4091,4091,4091,4091,4091,4091,4091,4091,4091,4091,
+
+	4091,4092,4092,4092,4092,4092,4092,4092,4092,4092,4092,4092,4092,4092,4092,4092,
+
+	4093,4093,4093,4093,4093,4093,4093,4093,4093,4093,4093,4093,4093,4093,4093,4093,
+
+	4094,4094,4094,4094,4094,4094,4094,4094,4094,4094,4094,4094,4094,4094,4094,4094,
+
+	4095,4095,4095,4095,4095,4095,4095,4095,4095,4095,4095,4095,4095,4095,4095,4095,
+
+};
+
+
+
+// 0 to 4095 scale in -> 0 to 4095 scale out.
+
+/*static*/ const unsigned int YM2612::attackExpInverse[4096]=
+
+{
+
+	0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,
+
+	3,3,4,4,4,4,5,5,5,5,6,6,6,6,6,7,
+
+	7,7,7,8,8,8,8,9,9,9,9,9,10,10,10,10,
+
+	11,11,11,11,12,12,12,12,13,13,13,13,13,14,14,14,
+
+	14,15,15,15,15,16,16,16,16,17,17,17,17,17,18,18,
+
+	18,18,19,19,19,19,20,20,20,20,21,21,21,21,21,22,
+
+	22,22,22,23,23,23,23,24,24,24,24,25,25,25,25,25,
+
+	26,26,26,26,27,27,27,27,28,28,28,28,29,29,29,29,
+
+	30,30,30,30,30,31,31,31,31,32,32,32,32,33,33,33,
+
+	33,34,34,34,34,35,35,35,35,36,36,36,36,36,37,37,
+
+	37,37,38,38,38,38,39,39,39,39,40,40,40,40,41,41,
+
+	41,41,42,42,42,42,42,43,43,43,43,44,44,44,44,45,
+
+	45,45,45,46,46,46,46,47,47,47,47,48,48,48,48,49,
+
+	49,49,49,50,50,50,50,50,51,51,51,51,52,52,52,52,
+
+	53,53,53,53,54,54,54,54,55,55,55,55,56,56,56,56,
+
+	57,57,57,57,58,58,58,58,59,59,59,59,60,60,60,60,
+
+	61,61,61,61,62,62,62,62,63,63,63,63,63,64,64,64,
+
+	64,65,65,65,65,66,66,66,66,67,67,67,67,68,68,68,
+
+	68,69,69,69,69,70,70,70,70,71,71,71,71,72,72,72,
+
+	72,73,73,73,73,74,74,74,74,75,75,75,75,76,76,76,
+
+	76,77,77,77,77,78,78,78,78,79,79,79,79,80,80,80,
+
+	80,81,81,81,81,82,82,82,82,83,83,83,83,84,84,84,
+
+	84,85,85,85,85,86,86,86,86,87,87,87,87,88,88,88,
+
+	89,89,89,89,90,90,90,90,91,91,91,91,92,92,92,92,
+
+	93,93,93,93,94,94,94,94,95,95,95,95,96,96,96,96,
+
+	97,97,97,97,98,98,98,98,99,99,99,99,100,100,100,100,
+
+	101,101,101,102,102,102,102,103,103,103,103,104,104,104,104,105,
+
+	105,105,105,106,106,106,106,107,107,107,107,108,108,108,108,109,
+
+	109,109,110,110,110,110,111,111,111,111,112,112,112,112,113,113,
+
+	113,113,114,114,114,114,115,115,115,115,116,116,116,117,117,117,
+
+	117,118,118,118,118,119,119,119,119,120,120,120,120,121,121,121,
+
+	122,122,122,122,123,123,123,123,124,124,124,124,125,125,125,125,
+
+	126,126,126,127,127,127,127,128,128,128,128,129,129,129,129,130,
+
+	130,130,130,131,131,131,132,132,132,132,133,133,133,133,134,134,
+
+	134,134,135,135,135,136,136,136,136,137,137,137,137,138,138,138,
+
+	138,139,139,139,140,140,140,140,141,141,141,141,142,142,142,142,
+
+	143,143,143,144,144,144,144,145,145,145,145,146,146,146,146,147,
+
+	147,147,148,148,148,148,149,149,149,149,150,150,150,151,151,151,
+
+	151,152,152,152,152,153,153,153,154,154,154,154,155,155,155,155,
+
+	156,156,156,156,157,157,157,158,158,158,158,159,159,159,159,160,
+
+	160,160,161,161,161,161,162,162,162,163,163,163,163,164,164,164,
+
+	164,165,165,165,166,166,166,166,167,167,167,167,168,168,168,169,
+
+	169,169,169,170,170,170,170,171,171,171,172,172,172,172,173,173,
+
+	173,174,174,174,174,175,175,175,175,176,176,176,177,177,177,177,
+
+	178,178,178,179,179,179,179,180,180,180,180,181,181,181,182,182,
+
+	182,182,183,183,183,184,184,184,184,185,185,185,185,186,186,186,
+
+	187,187,187,187,188,188,188,189,189,189,189,190,190,190,191,191,
+
+	191,191,192,192,192,193,193,193,193,194,194,194,195,195,195,195,
+
+	196,196,196,196,197,197,197,198,198,198,198,199,199,199,200,200,
+
+	200,200,201,201,201,202,202,202,202,203,203,203,204,204,204,204,
+
+	205,205,205,206,206,206,206,207,207,207,208,208,208,208,209,209,
+
+	209,210,210,210,210,211,211,211,212,212,212,213,213,213,213,214,
+
+	214,214,215,215,215,215,216,216,216,217,217,217,217,218,218,218,
+
+	219,219,219,219,220,220,220,221,221,221,221,222,222,222,223,223,
+
+	223,224,224,224,224,225,225,225,226,226,226,226,227,227,227,228,
+
+	228,228,229,229,229,229,230,230,230,231,231,231,231,232,232,232,
+
+	233,233,233,234,234,234,234,235,235,235,236,236,236,236,237,237,
+
+	237,238,238,238,239,239,239,239,240,240,240,241,241,241,241,242,
+
+	242,242,243,243,243,244,244,244,244,245,245,245,246,246,246,247,
+
+	247,247,247,248,248,248,249,249,249,250,250,250,250,251,251,251,
+
+	252,252,252,253,253,253,253,254,254,254,255,255,255,256,256,256,
+
+	256,257,257,257,258,258,258,259,259,259,259,260,260,260,261,261,
+
+	261,262,262,262,263,263,263,263,264,264,264,265,265,265,266,266,
+
+	266,266,267,267,267,268,268,268,269,269,269,270,270,270,270,271,
+
+	271,271,272,272,272,273,273,273,274,274,274,274,275,275,275,276,
+
+	276,276,277,277,277,278,278,278,278,279,279,279,280,280,280,281,
+
+	281,281,282,282,282,282,283,283,283,284,284,284,285,285,285,286,
+
+	286,286,287,287,287,287,288,288,288,289,289,289,290,290,290,291,
+
+	291,291,292,292,292,292,293,293,293,294,294,294,295,295,295,296,
+
+	296,296,297,297,297,297,298,298,298,299,299,299,300,300,300,301,
+
+	301,301,302,302,302,303,303,303,303,304,304,304,305,305,305,306,
+
+	306,306,307,307,307,308,308,308,309,309,309,310,310,310,310,311,
+
+	311,311,312,312,312,313,313,313,314,314,314,315,315,315,316,316,
+
+	316,317,317,317,318,318,318,319,319,319,319,320,320,320,321,321,
+
+	321,322,322,322,323,323,323,324,324,324,325,325,325,326,326,326,
+
+	327,327,327,328,328,328,329,329,329,330,330,330,331,331,331,331,
+
+	332,332,332,333,333,333,334,334,334,335,335,335,336,336,336,337,
+
+	337,337,338,338,338,339,339,339,340,340,340,341,341,341,342,342,
+
+	342,343,343,343,344,344,344,345,345,345,346,346,346,347,347,347,
+
+	348,348,348,349,349,349,350,350,350,351,351,351,352,352,352,353,
+
+	353,353,354,354,354,355,355,355,356,356,356,357,357,357,358,358,
+
+	358,359,359,359,360,360,360,361,361,361,362,362,362,363,363,363,
+
+	364,364,364,365,365,365,366,366,366,367,367,367,368,368,368,369,
+
+	369,369,370,370,370,371,371,371,372,372,373,373,373,374,374,374,
+
+	375,375,375,376,376,376,377,377,377,378,378,378,379,379,379,380,
+
+	380,380,381,381,381,382,382,382,383,383,383,384,384,385,385,385,
+
+	386,386,386,387,387,387,388,388,388,389,389,389,390,390,390,391,
+
+	391,391,392,392,392,393,393,394,394,394,395,395,395,396,396,396,
+
+	397,397,397,398,398,398,399,399,399,400,400,401,401,401,402,402,
+
+	402,403,403,403,404,404,404,405,405,405,406,406,406,407,407,408,
+
+	408,408,409,409,409,410,410,410,411,411,411,412,412,413,413,413,
+
+	414,414,414,415,415,415,416,416,416,417,417,418,418,418,419,419,
+
+	419,420,420,420,421,421,421,422,422,423,423,423,424,424,424,425,
+
+	425,425,426,426,426,427,427,428,428,428,429,429,429,430,430,430,
+
+	431,431,432,432,432,433,433,433,434,434,434,435,435,436,436,436,
+
+	437,437,437,438,438,438,439,439,440,440,440,441,441,441,442,442,
+
+	442,443,443,444,444,444,445,445,445,446,446,447,447,447,448,448,
+
+	448,449,449,449,450,450,451,451,451,452,452,452,453,453,454,454,
+
+	454,455,455,455,456,456,456,457,457,458,458,458,459,459,459,460,
+
+	460,461,461,461,462,462,462,463,463,464,464,464,465,465,465,466,
+
+	466,467,467,467,468,468,468,469,469,470,470,470,471,471,471,472,
+
+	472,473,473,473,474,474,475,475,475,476,476,476,477,477,478,478,
+
+	478,479,479,479,480,480,481,481,481,482,482,483,483,483,484,484,
+
+	484,485,485,486,486,486,487,487,487,488,488,489,489,489,490,490,
+
+	491,491,491,492,492,492,493,493,494,494,494,495,495,496,496,496,
+
+	497,497,498,498,498,499,499,499,500,500,501,501,501,502,502,503,
+
+	503,503,504,504,505,505,505,506,506,506,507,507,508,508,508,509,
+
+	509,510,510,510,511,511,512,512,512,513,513,514,514,514,515,515,
+
+	516,516,516,517,517,518,518,518,519,519,520,520,520,521,521,521,
+
+	522,522,523,523,523,524,524,525,525,525,526,526,527,527,527,528,
+
+	528,529,529,529,530,530,531,531,531,532,532,533,533,534,534,534,
+
+	535,535,536,536,536,537,537,538,538,538,539,539,540,540,540,541,
+
+	541,542,542,542,543,543,544,544,544,545,545,546,546,546,547,547,
+
+	548,548,549,549,549,550,550,551,551,551,552,552,553,553,553,554,
+
+	554,555,555,556,556,556,557,557,558,558,558,559,559,560,560,560,
+
+	561,561,562,562,563,563,563,564,564,565,565,565,566,566,567,567,
+
+	568,568,568,569,569,570,570,570,571,571,572,572,573,573,573,574,
+
+	574,575,575,576,576,576,577,577,578,578,578,579,579,580,580,581,
+
+	581,581,582,582,583,583,584,584,584,585,585,586,586,587,587,587,
+
+	588,588,589,589,590,590,590,591,591,592,592,593,593,593,594,594,
+
+	595,595,596,596,596,597,597,598,598,599,599,599,600,600,601,601,
+
+	602,602,602,603,603,604,604,605,605,605,606,606,607,607,608,608,
+
+	608,609,609,610,610,611,611,612,612,612,613,613,614,614,615,615,
+
+	615,616,616,617,617,618,618,619,619,619,620,620,621,621,622,622,
+
+	623,623,623,624,624,625,625,626,626,627,627,627,628,628,629,629,
+
+	630,630,631,631,631,632,632,633,633,634,634,635,635,635,636,636,
+
+	637,637,638,638,639,639,639,640,640,641,641,642,642,643,643,644,
+
+	644,644,645,645,646,646,647,647,648,648,649,649,649,650,650,651,
+
+	651,652,652,653,653,654,654,654,655,655,656,656,657,657,658,658,
+
+	659,659,660,660,660,661,661,662,662,663,663,664,664,665,665,665,
+
+	666,666,667,667,668,668,669,669,670,670,671,671,672,672,672,673,
+
+	673,674,674,675,675,676,676,677,677,678,678,679,679,679,680,680,
+
+	681,681,682,682,683,683,684,684,685,685,686,686,687,687,687,688,
+
+	688,689,689,690,690,691,691,692,692,693,693,694,694,695,695,696,
+
+	696,697,697,697,698,698,699,699,700,700,701,701,702,702,703,703,
+
+	704,704,705,705,706,706,707,707,708,708,709,709,709,710,710,711,
+
+	711,712,712,713,713,714,714,715,715,716,716,717,717,718,718,719,
+
+	719,720,720,721,721,722,722,723,723,724,724,725,725,726,726,727,
+
+	727,728,728,729,729,730,730,731,731,732,732,733,733,734,734,735,
+
+	735,735,736,736,737,737,738,738,739,739,740,740,741,741,742,742,
+
+	743,743,744,744,745,745,746,747,747,748,748,749,749,750,750,751,
+
+	751,752,752,753,753,754,754,755,755,756,756,757,757,758,758,759,
+
+	759,760,760,761,761,762,762,763,763,764,764,765,765,766,766,767,
+
+	767,768,768,769,769,770,770,771,771,772,773,773,774,774,775,775,
+
+	776,776,777,777,778,778,779,779,780,780,781,781,782,782,783,783,
+
+	784,784,785,786,786,787,787,788,788,789,789,790,790,791,791,792,
+
+	792,793,793,794,794,795,796,796,797,797,798,798,799,799,800,800,
+
+	801,801,802,802,803,804,804,805,805,806,806,807,807,808,808,809,
+
+	809,810,810,811,812,812,813,813,814,814,815,815,816,816,817,817,
+
+	818,819,819,820,820,821,821,822,822,823,823,824,825,825,826,826,
+
+	827,827,828,828,829,829,830,831,831,832,832,833,833,834,834,835,
+
+	836,836,837,837,838,838,839,839,840,841,841,842,842,843,843,844,
+
+	844,845,846,846,847,847,848,848,849,849,850,851,851,852,852,853,
+
+	853,854,854,855,856,856,857,857,858,858,859,860,860,861,861,862,
+
+	862,863,864,864,865,865,866,866,867,868,868,869,869,870,870,871,
+
+	872,872,873,873,874,874,875,876,876,877,877,878,878,879,880,880,
+
+	881,881,882,882,883,884,884,885,885,886,887,887,888,888,889,889,
+
+	890,891,891,892,892,893,894,894,895,895,896,896,897,898,898,899,
+
+	899,900,901,901,902,902,903,904,904,905,905,906,907,907,908,908,
+
+	909,910,910,911,911,912,913,913,914,914,915,916,916,917,917,918,
+
+	919,919,920,920,921,922,922,923,923,924,925,925,926,926,927,928,
+
+	928,929,929,930,931,931,932,932,933,934,934,935,936,936,937,937,
+
+	938,939,939,940,940,941,942,942,943,944,944,945,945,946,947,947,
+
+	948,948,949,950,950,951,952,952,953,953,954,955,955,956,957,957,
+
+	958,958,959,960,960,961,962,962,963,963,964,965,965,966,967,967,
+
+	968,969,969,970,970,971,972,972,973,974,974,975,976,976,977,977,
+
+	978,979,979,980,981,981,982,983,983,984,985,985,986,986,987,988,
+
+	988,989,990,990,991,992,992,993,994,994,995,996,996,997,998,998,
+
+	999,999,1000,1001,1001,1002,1003,1003,1004,1005,1005,1006,1007,1007,1008,1009,
+
+	1009,1010,1011,1011,1012,1013,1013,1014,1015,1015,1016,1017,1017,1018,1019,1019,
+
+	1020,1021,1021,1022,1023,1023,1024,1025,1025,1026,1027,1027,1028,1029,1029,1030,
+
+	1031,1031,1032,1033,1033,1034,1035,1036,1036,1037,1038,1038,1039,1040,1040,1041,
+
+	1042,1042,1043,1044,1044,1045,1046,1046,1047,1048,1049,1049,1050,1051,1051,1052,
+
+	1053,1053,1054,1055,1055,1056,1057,1058,1058,1059,1060,1060,1061,1062,1062,1063,
+
+	1064,1065,1065,1066,1067,1067,1068,1069,1069,1070,1071,1072,1072,1073,1074,1074,
+
+	1075,1076,1076,1077,1078,1079,1079,1080,1081,1081,1082,1083,1084,1084,1085,1086,
+
+	1086,1087,1088,1089,1089,1090,1091,1092,1092,1093,1094,1094,1095,1096,1097,1097,
+
+	1098,1099,1099,1100,1101,1102,1102,1103,1104,1105,1105,1106,1107,1108,1108,1109,
+
+	1110,1110,1111,1112,1113,1113,1114,1115,1116,1116,1117,1118,1119,1119,1120,1121,
+
+	1122,1122,1123,1124,1125,1125,1126,1127,1128,1128,1129,1130,1131,1131,1132,1133,
+
+	1134,1134,1135,1136,1137,1137,1138,1139,1140,1140,1141,1142,1143,1143,1144,1145,
+
+	1146,1146,1147,1148,1149,1149,1150,1151,1152,1153,1153,1154,1155,1156,1156,1157,
+
+	1158,1159,1159,1160,1161,1162,1163,1163,1164,1165,1166,1166,1167,1168,1169,1170,
+
+	1170,1171,1172,1173,1173,1174,1175,1176,1177,1177,1178,1179,1180,1181,1181,1182,
+
+	1183,1184,1185,1185,1186,1187,1188,1189,1189,1190,1191,1192,1193,1193,1194,1195,
+
+	1196,1197,1197,1198,1199,1200,1201,1201,1202,1203,1204,1205,1205,1206,1207,1208,
+
+	1209,1209,1210,1211,1212,1213,1214,1214,1215,1216,1217,1218,1218,1219,1220,1221,
+
+	1222,1223,1223,1224,1225,1226,1227,1228,1228,1229,1230,1231,1232,1233,1233,1234,
+
+	1235,1236,1237,1238,1238,1239,1240,1241,1242,1243,1244,1244,1245,1246,1247,1248,
+
+	1249,1249,1250,1251,1252,1253,1254,1255,1255,1256,1257,1258,1259,1260,1261,1261,
+
+	1262,1263,1264,1265,1266,1267,1267,1268,1269,1270,1271,1272,1273,1274,1274,1275,
+
+	1276,1277,1278,1279,1280,1281,1281,1282,1283,1284,1285,1286,1287,1288,1288,1289,
+
+	1290,1291,1292,1293,1294,1295,1296,1296,1297,1298,1299,1300,1301,1302,1303,1304,
+
+	1305,1305,1306,1307,1308,1309,1310,1311,1312,1313,1314,1314,1315,1316,1317,1318,
+
+	1319,1320,1321,1322,1323,1324,1325,1325,1326,1327,1328,1329,1330,1331,1332,1333,
+
+	1334,1335,1336,1337,1337,1338,1339,1340,1341,1342,1343,1344,1345,1346,1347,1348,
+
+	1349,1350,1351,1352,1353,1353,1354,1355,1356,1357,1358,1359,1360,1361,1362,1363,
+
+	1364,1365,1366,1367,1368,1369,1370,1371,1372,1373,1374,1375,1375,1376,1377,1378,
+
+	1379,1380,1381,1382,1383,1384,1385,1386,1387,1388,1389,1390,1391,1392,1393,1394,
+
+	1395,1396,1397,1398,1399,1400,1401,1402,1403,1404,1405,1406,1407,1408,1409,1410,
+
+	1411,1412,1413,1414,1415,1416,1417,1418,1419,1420,1421,1422,1423,1424,1425,1426,
+
+	1427,1428,1429,1430,1431,1432,1433,1434,1435,1436,1438,1439,1440,1441,1442,1443,
+
+	1444,1445,1446,1447,1448,1449,1450,1451,1452,1453,1454,1455,1456,1457,1458,1459,
+
+	1461,1462,1463,1464,1465,1466,1467,1468,1469,1470,1471,1472,1473,1474,1475,1477,
+
+	1478,1479,1480,1481,1482,1483,1484,1485,1486,1487,1488,1490,1491,1492,1493,1494,
+
+	1495,1496,1497,1498,1499,1501,1502,1503,1504,1505,1506,1507,1508,1509,1511,1512,
+
+	1513,1514,1515,1516,1517,1518,1520,1521,1522,1523,1524,1525,1526,1527,1529,1530,
+
+	1531,1532,1533,1534,1535,1537,1538,1539,1540,1541,1542,1543,1545,1546,1547,1548,
+
+	1549,1550,1552,1553,1554,1555,1556,1557,1559,1560,1561,1562,1563,1564,1566,1567,
+
+	1568,1569,1570,1572,1573,1574,1575,1576,1578,1579,1580,1581,1582,1584,1585,1586,
+
+	1587,1588,1590,1591,1592,1593,1594,1596,1597,1598,1599,1601,1602,1603,1604,1605,
+
+	1607,1608,1609,1610,1612,1613,1614,1615,1617,1618,1619,1620,1622,1623,1624,1625,
+
+	1627,1628,1629,1630,1632,1633,1634,1635,1637,1638,1639,1641,1642,1643,1644,1646,
+
+	1647,1648,1650,1651,1652,1653,1655,1656,1657,1659,1660,1661,1663,1664,1665,1666,
+
+	1668,1669,1670,1672,1673,1674,1676,1677,1678,1680,1681,1682,1684,1685,1686,1688,
+
+	1689,1690,1692,1693,1694,1696,1697,1698,1700,1701,1703,1704,1705,1707,1708,1709,
+
+	1711,1712,1714,1715,1716,1718,1719,1720,1722,1723,1725,1726,1727,1729,1730,1732,
+
+	1733,1734,1736,1737,1739,1740,1741,1743,1744,1746,1747,1749,1750,1751,1753,1754,
+
+	1756,1757,1759,1760,1762,1763,1764,1766,1767,1769,1770,1772,1773,1775,1776,1778,
+
+	1779,1781,1782,1784,1785,1787,1788,1790,1791,1792,1794,1795,1797,1798,1800,1802,
+
+	1803,1805,1806,1808,1809,1811,1812,1814,1815,1817,1818,1820,1821,1823,1824,1826,
+
+	1828,1829,1831,1832,1834,1835,1837,1838,1840,1842,1843,1845,1846,1848,1850,1851,
+
+	1853,1854,1856,1858,1859,1861,1862,1864,1866,1867,1869,1870,1872,1874,1875,1877,
+
+	1879,1880,1882,1883,1885,1887,1888,1890,1892,1893,1895,1897,1898,1900,1902,1903,
+
+	1905,1907,1908,1910,1912,1914,1915,1917,1919,1920,1922,1924,1926,1927,1929,1931,
+
+	1932,1934,1936,1938,1939,1941,1943,1945,1946,1948,1950,1952,1953,1955,1957,1959,
+
+	1961,1962,1964,1966,1968,1969,1971,1973,1975,1977,1979,1980,1982,1984,1986,1988,
+
+	1989,1991,1993,1995,1997,1999,2001,2002,2004,2006,2008,2010,2012,2014,2016,2017,
+
+	2019,2021,2023,2025,2027,2029,2031,2033,2035,2037,2039,2040,2042,2044,2046,2048,
+
+	2050,2052,2054,2056,2058,2060,2062,2064,2066,2068,2070,2072,2074,2076,2078,2080,
+
+	2082,2084,2086,2088,2090,2092,2094,2096,2098,2100,2102,2105,2107,2109,2111,2113,
+
+	2115,2117,2119,2121,2123,2125,2128,2130,2132,2134,2136,2138,2140,2143,2145,2147,
+
+	2149,2151,2153,2156,2158,2160,2162,2164,2167,2169,2171,2173,2175,2178,2180,2182,
+
+	2184,2187,2189,2191,2193,2196,2198,2200,2203,2205,2207,2210,2212,2214,2216,2219,
+
+	2221,2223,2226,2228,2231,2233,2235,2238,2240,2242,2245,2247,2250,2252,2254,2257,
+
+	2259,2262,2264,2267,2269,2272,2274,2277,2279,2281,2284,2286,2289,2292,2294,2297,
+
+	2299,2302,2304,2307,2309,2312,2314,2317,2320,2322,2325,2327,2330,2333,2335,2338,
+
+	2341,2343,2346,2349,2351,2354,2357,2359,2362,2365,2367,2370,2373,2376,2378,2381,
+
+	2384,2387,2389,2392,2395,2398,2401,2404,2406,2409,2412,2415,2418,2421,2424,2426,
+
+	2429,2432,2435,2438,2441,2444,2447,2450,2453,2456,2459,2462,2465,2468,2471,2474,
+
+	2477,2480,2483,2486,2489,2492,2496,2499,2502,2505,2508,2511,2514,2518,2521,2524,
+
+	2527,2530,2534,2537,2540,2543,2547,2550,2553,2557,2560,2563,2567,2570,2573,2577,
+
+	2580,2583,2587,2590,2594,2597,2601,2604,2608,2611,2615,2618,2622,2625,2629,2633,
+
+	2636,2640,2643,2647,2651,2654,2658,2662,2665,2669,2673,2677,2680,2684,2688,2692,
+
+	2696,2699,2703,2707,2711,2715,2719,2723,2727,2731,2735,2739,2743,2747,2751,2755,
+
+	2759,2763,2767,2771,2776,2780,2784,2788,2792,2797,2801,2805,2809,2814,2818,2823,
+
+	2827,2831,2836,2840,2845,2849,2854,2858,2863,2867,2872,2877,2881,2886,2891,2895,
+
+	2900,2905,2910,2914,2919,2924,2929,2934,2939,2944,2949,2954,2959,2964,2969,2974,
+
+	2979,2984,2990,2995,3000,3005,3011,3016,3021,3027,3032,3038,3043,3049,3054,3060,
+
+	3065,3071,3077,3082,3088,3094,3100,3106,3112,3118,3123,3129,3136,3142,3148,3154,
+
+	3160,3166,3173,3179,3185,3192,3198,3205,3211,3218,3224,3231,3238,3245,3251,3258,
+
+	3265,3272,3279,3286,3293,3301,3308,3315,3323,3330,3337,3345,3352,3360,3368,3376,
+
+	3383,3391,3399,3407,3415,3423,3432,3440,3448,3457,3465,3474,3483,3491,3500,3509,
+
+	3518,3527,3536,3546,3555,3564,3574,3584,3593,3603,3613,3623,3633,3643,3654,3664,
+
+	3675,3686,3696,3707,3718,3730,3741,3752,3764,3776,3788,3800,3812,3824,3837,3849,
+
+	3862,3875,3889,3902,3916,3929,3943,3957,3972,3986,4001,4016,4032,4047,4063,4079,
+
+};
+
+
+
+////////////////////////////////////////////////////////////
+
+
+
+
+
+
+
+static unsigned int LFOCycleMicroSec[8]=
+
+{
+
+	100000000/ 398, // 1000000/ 3.98,
+
+	100000000/ 556, // 1000000/ 5.56,
+
+	100000000/ 602, // 1000000/ 6.02,
+
+	100000000/ 637, // 1000000/ 6.37,
+
+	100000000/ 688, // 1000000/ 6.88,
+
+	100000000/ 963, // 1000000/ 9.63,
+
+	100000000/4810, // 1000000/48.10,
+
+	100000000/7220  // 1000000/72.20
+
+};
+
+
+
+// Definition of cent.
+
+// https://ja.wikipedia.org/wiki/%E3%82%BB%E3%83%B3%E3%83%88_(%E9%9F%B3%E6%A5%BD)
+
+static int PMS16384Table[8]=
+
+{
+
+  0,
+
+ 32,// scale(3.400000)=1.001966, (1.001966-1.0)*16384.0=32
+
+ 63,// scale(6.700000)=1.003878, (1.003878-1.0)*16384.0=63
+
+ 94,// scale(10.000000)=1.005793, (1.005793-1.0)*16384.0=94
+
+133,// scale(14.000000)=1.008120, (1.008120-1.0)*16384.0=133
+
+190,// scale(20.000000)=1.011619, (1.011619-1.0)*16384.0=190
+
+382,// scale(40.000000)=1.023374, (1.023374-1.0)*16384.0=382
+
+774,// scale(80.000000)=1.047294, (1.047294-1.0)*16384.0=774
+
+};
+
+
+
+// dB=20log10(P/Pref)
+
+// 0=20log10(P/Pref) -> P/Pref=1.0
+
+// 1.4=20log10(P/Pref) -> 10^(1.4/20)=P/Pref -> 
+
+// 5.9=20log10(P/Pref) -> 10^(5.9/20)=P/Pref ->
+
+// 11.8=20log10(P/Pref) -> 10^(11.8/20)=P/Pref ->
+
+static int AMS4096Table[4]=
+
+{
+
+ 4096-4096,  // 1.0
+
+ 4812-4096,  // 1.1749
+
+ 8079-4096,  // 1.97242
+
+15935-4096, // 3.89045
+
+};
+
+
+
+////////////////////////////////////////////////////////////
+
+
+
+int YM2612::Slot::DetuneContributionToPhaseStepS12(unsigned int BLOCK,unsigned int NOTE) const
+
+{
+
+	// Hz ranges 1 to roughly 8000.  PHASE_STEPS=4096.  hertz*PHASE_STEPS=2^13*2^12=2^25. Fits in 32 bit.
+
+	long long int detuneStepContribution=0;
+
+	if(0!=DT)
+
+	{
+
+		long long int hertz1000=detune1000Table[(BLOCK<<4)+(NOTE<<2)+(DT&3)];
+
+		detuneStepContribution=(hertz1000*PHASE_STEPS);
+
+		detuneStepContribution<<=12;
+
+		detuneStepContribution/=1000;  // Now it is (hertz*PHASE_STEPS)<<12.
+
+		if(0!=(DT&4))
+
+		{
+
+			detuneStepContribution=-detuneStepContribution;
+
+		}
+
+	}
+
+	return (int)detuneStepContribution;
+
+}
+
+
+
+inline int YM2612::Slot::UnscaledOutput(int phase,int phaseShift) const
+
+{
+
+	// phaseShift is input from the upstream slot.
+
+	// -4096 to 4096.  4096 should be counted as 8pi.
+
+	// UNSCALED_MAX is 2048. therefore 8x.
+
+
+
+	//phaseShift*=MULTITable[this->MULTI];
+
+	//phaseShift>>=1;
+
+
+
+	//                     8.0       * (2PI / 2)     /   1.0
+
+	const int outputScale=SLOTOUT_TO_NPI*(PHASE_STEPS/2)/UNSCALED_MAX;
+
+	return sineTable[(phase+(phaseShift*outputScale))&PHASE_MASK];
+
+}
+
+inline int YM2612::Slot::UnscaledOutput(int phase,int phaseShift,unsigned int FB,int lastSlot0Out) const
+
+{
+
+	if(0!=FB)
+
+	{
+
+		static const int FBScaleTable[]=
+
+		{
+
+			0,1,2,4,8,16,32,64
+
+		};
+
+		// lastSlotOut=1.0=>UNSCALED_MAX   4096=>2PI
+
+		// To make it 4PI(8192) at FB=7(scale=64), must divide by UNSCALED_MAX*64/8192.
+
+		// What was I thinking when I made div=32?  It should be 16.
+
+		const int div=UNSCALED_MAX*64/8192;
+
+		phase+=(lastSlot0Out*FBScaleTable[FB]/div);
+
+	}
+
+	//                     8.0       * (2PI / 2)     /   1.0
+
+	const int outputScale=SLOTOUT_TO_NPI*(PHASE_STEPS/2)/UNSCALED_MAX;
+
+	return sineTable[(phase+(phaseShift*outputScale))&PHASE_MASK];
+
+}
+
+inline int YM2612::Slot::EnvelopedOutputDbToAmpl(int phase,int phaseShift,unsigned int timeInMS,unsigned int FB,int lastSlot0Out) const
+
+{
+
+	int dB=InterpolateEnvelope(timeInMS);
+
+	lastDbX100Cache=dB;
+
+	int ampl=DB100to4095Scale[dB];
+
+	int unscaledOut=UnscaledOutput(phase,phaseShift,FB,lastSlot0Out);
+
+	return (unscaledOut*ampl)/4096;
+
+}
+
+inline int YM2612::Slot::EnvelopedOutputDbToAmpl(int phase,int phaseShift,unsigned int timeInMS) const
+
+{
+
+	int dB=InterpolateEnvelope(timeInMS);
+
+	lastDbX100Cache=dB;
+
+	int ampl=DB100to4095Scale[dB];
+
+	int unscaledOut=UnscaledOutput(phase,phaseShift);
+
+	return (unscaledOut*ampl)/4096;
+
+}
+
+inline int YM2612::Slot::InterpolateEnvelope(unsigned int timeInMS) const
+
+{
+
+	if(true!=InReleasePhase)
+
+	{
+
+		if(timeInMS<env[0]) // Attack
+
+		{
+
+			unsigned int x=4096*timeInMS/env[0];
+
+			return (env[1]*attackExp[x])>>12;
+
+		}
+
+		else
+
+		{
+
+			timeInMS-=env[0];
+
+			if(timeInMS<env[2])
+
+			{
+
+				return env[1]-(env[1]-env[3])*timeInMS/env[2];
+
+			}
+
+			else
+
+			{
+
+				timeInMS-=env[2];
+
+				if(timeInMS<env[4])
+
+				{
+
+					return env[3]-env[3]*timeInMS/env[4];
+
+				}
+
+			}
+
+		}
+
+		return 0;
+
+	}
+
+	else
+
+	{
+
+		if(timeInMS<ReleaseEndTime && ReleaseStartTime<ReleaseEndTime)
+
+		{
+
+			auto diff=ReleaseEndTime-timeInMS;
+
+			auto DbX100=ReleaseStartDbX100;
+
+			DbX100*=diff;
+
+			DbX100/=(ReleaseEndTime-ReleaseStartTime);
+
+			return DbX100;
+
+		}
+
+		return 0; // Not supported yet.
+
+	}
+
+}
+
+
+
+unsigned int YM2612::Channel::Note(void) const
+
+{
+
+	// Formula [2] pp.204
+
+	// There is an error.  F_NUM is 11bits.  There is no F11.
+
+	// Probably, F11, F10, F9, F8 should be read bit10, bit9, bit8, bit7.
+
+	unsigned int F10=((F_NUM>>10)&1);
+
+	unsigned int F9= ((F_NUM>> 9)&1);
+
+	unsigned int F8= ((F_NUM>> 8)&1);
+
+	unsigned int F7=((F_NUM>>11)&1);
+
+	unsigned int N3=(F10&(F9|F8|F7)); // |((~F10)&F9&F8&F7);  Measurement from actual FM TOWNS 2MX suggests no contribution from the second term.
+
+	unsigned int NOTE=(F10<<1)|N3;
+
+	return NOTE;
+
+}
+
+
+
+unsigned int YM2612::Channel::KC(void) const
+
+{
+
+	// Formulat in [2] pp.204 suggests:
+
+ 	//   unsigned int KC=(ch.BLOCK<<2)|NOTE;
+
+	// which doesn't make sense.
+
+	// SEGA Genesis Software Manaual tells KC is just top 5 bits of BLOCK|F_NUM2.
+
+	// Which makes more sense.
+
+
+
+	// Measurement taken from FM TOWNS 2MX gave a conclusion:
+
+	//   NOTE=(N4<<1)|N3
+
+	//   N4=F11
+
+	//   N3=F11&(F10|F9|F8)
+
+	// F11 Highest bit of F_NUMBER
+
+	// F10 Second highest bit of F_NUMBER
+
+	// F9  Third highest bit of F_NUMBER
+
+	// F8  Fourth highest bit of F_NUMBER
+
+
+
+	// YAMAHA official manual for YM2608 Section 2-4-1-A, and FM Towns Technical Databook suggests:
+
+	//    N3=(F11&(F10|F9|F8))|((~F11)&F10&F9&F8)
+
+	// However, the actual YM2612 didn't show any contribution from ((~F11)&F10&F9&F8).
+
+
+
+	unsigned int N4=((F_NUM>>9)&2);
+
+	unsigned int N3=((F_NUM>>10)&((F_NUM>>9)|(F_NUM>>8)|(F_NUM>>7)))&1;
+
+	unsigned int KC=(BLOCK<<2)|N4|N3;
+
+	return KC&0x1F;
+
+}
+
+
+
+////////////////////////////////////////////////////////////
+
+
+
+void YM2612::KeyOn(unsigned int chNum,unsigned int slotFlags)
+
+{
+
+	if(0==slotFlags)
+
+	{
+
+		return;
+
+	}
+
+
+
+
+
+	auto &ch=state.channels[chNum];
+
+
+
+	const unsigned int hertzX16=BLOCK_FNUM_to_FreqX16(ch.BLOCK,ch.F_NUM);
+
+
+
+	state.playingCh|=(1<<chNum);
+
+	ch.playState=CH_PLAYING;
+
+	if(0!=(1&slotFlags))
 
-414720,  //14: 
+	{
 
-356352,  //15: 
+		ch.lastSlot0Out[0]=0;
 
+		ch.lastSlot0Out[1]=0;
 
+	}
 
-311808,  //16: 2491484/8
 
-249600,
 
-207360,
+	for(int i=0; i<NUM_SLOTS; ++i)
 
-178175,
+	{
 
-155904,
+		if(0!=(slotFlags&(1<<i)))
 
-124800,
+		{
 
-103680,
+			auto &slot=ch.slots[i];
 
-89088,
 
-77952,
 
-62400,
+			slot.InReleasePhase=false;
 
-51840,
+			slot.phaseS12=0;
 
-44544,
 
-38876,
 
-31200,
+			UpdatePhase12StepSlot(slot,hertzX16,slot.DetuneContributionToPhaseStepS12(ch.BLOCK,ch.Note()));
 
-25920,
 
-22272,
 
+			// (hertzX16*PHASE_STEPS)<<8==hertz*PHASE_STEPS*4096
 
+			UpdateSlotEnvelope(ch,slot,slotEnvelope[chNum][i]);
 
-19488,
 
-15800,
 
-12960,
+			// Observation tells that if key is turned on while the previous tone is still playing, 
 
-11136,
+			// The initial output level must start from the last output level, in which case
 
-9744,
+			// microsec12 must fast-forwarded so that the output matches the lastDbX100Cache.
 
-7800,
+			// Linear interpolation will have error, but should be better than nothing.
 
-6480,
+			if(slot.lastDbX100Cache<=0)
 
-5568,
+			{
 
-4872,
+				slot.microsecS12=0;
 
-3900,
+			}
 
-3240,
+			else if(slot.env[1]<=slot.lastDbX100Cache)
 
-2784,
+			{
 
-2436,
+				slot.microsecS12=(slot.env[0]<<(12+10));
 
-1950,
+			}
 
-1620,
+			else
 
-1392,
+			{
 
+				unsigned int scale=attackExpInverse[4096*slot.lastDbX100Cache/slot.env[1]];
 
+				slot.microsecS12=(slot.env[0]*scale/4096)<<(12+10);
 
-1218,
+			}
 
-975,
+			slot.lastDbX100Cache=0;
 
-810,
+		}
 
-696,
+	}
 
-509,
 
-480,
 
-407,
+#ifdef YM2612_DEBUGOUTPUT
 
-350,
+	printf("%d BLOCK %03xH F_NUM %03xH Hertz %d\n",KC,ch.BLOCK,ch.F_NUM,hertzX16/16);
 
-305,
+#endif
 
-243,
+}
 
-203,
 
-173,
 
-152,
+void YM2612::UpdatePhase12StepSlot(Slot &slot,const unsigned int hertzX16,int detuneContribution)
 
-152,
+{
 
-152,
+	// Phase runs hertz*PHASE_STEPS times per second.
 
-152,
+	//            hertz*PHASE_STEPS/samplingRate times per step.
 
-};
+	// Phase 12 runs
+
+	//            0x1000*hertz*PHASE_STEPS/samplingRate per step.
 
+	unsigned long long phaseS12Step;
 
+	phaseS12Step=MULTITable[slot.MULTI]*hertzX16*PHASE_STEPS; // 2X from MULTITable, 16X from hertzX16
+
+	phaseS12Step<<=7;                                         // 128X  Overall 2x16x128=4096X
+
+	phaseS12Step+=MULTITable[slot.MULTI]*detuneContribution/2;
+
+	phaseS12Step/=samplingRate;
+
+	slot.phaseS12Step=(unsigned int)phaseS12Step;
+
+}
 
-const struct YM2612::ConnectionToOutputSlot YM2612::connectionToOutputSlots[8]=
+
+
+void YM2612::UpdatePhase12StepSlot(Channel &ch)
 
 {
 
-	{1,{3,-1,-1,-1}},
+	const unsigned int hertzX16=BLOCK_FNUM_to_FreqX16(ch.BLOCK,ch.F_NUM);
 
-	{1,{3,-1,-1,-1}},
+	for(auto &slot : ch.slots)
 
-	{1,{3,-1,-1,-1}},
+	{
 
-	{1,{3,-1,-1,-1}},
+		UpdatePhase12StepSlot(slot,hertzX16,slot.DetuneContributionToPhaseStepS12(ch.BLOCK,ch.Note()));
 
-	{2,{1,3,-1,-1}},
+	};
 
-	{3,{1,2,3,-1}},
+}
 
-	{3,{1,2,3,-1}},
 
-	{4,{0,1,2,3}},
 
-};
+void YM2612::KeyOff(unsigned int chNum,unsigned int slotFlags)
+
+{
 
+	if(0!=(state.playingCh&(1<<chNum)))
 
+	{
 
-static unsigned int detune1000Table[]=
+		auto &ch=state.channels[chNum];
+
+		for(auto &slot : ch.slots)
+
+		{
+
+			if(true!=slot.InReleasePhase)
+
+			{
+
+				slot.InReleasePhase=true;
+
+				UpdateRelease(ch,slot);
+
+			}
+
+		}
+
+	}
+
+}
+
+
+
+void YM2612::CheckToneDone(unsigned int chNum)
 
 {
 
-	   0,   0,  48,  95,
+	auto &ch=state.channels[chNum];
 
-	   0,   0,  48,  95,
+	if(CH_PLAYING!=ch.playState)
 
-	   0,   0,  48,  95,
+	{
 
-	   0,   0,  48,  95,
+		state.playingCh&=~(1<<chNum);
 
-	   0,  48,  95,  95,
+	}
 
-	   0,  48,  95, 143,
+	else
 
-	   0,  48,  95, 143,
+	{
 
-	   0,  48,  95, 143,
+		bool slotStillPlaying=false;
 
-	   0,  48,  95, 191,
+		for(int i=0; i<connectionToOutputSlots[ch.CONNECT].nOutputSlots; ++i)
 
-	   0,  48, 143, 191,
+		{
 
+			auto &slot=ch.slots[connectionToOutputSlots[ch.CONNECT].slots[i]];
 
+			auto millisec=(slot.microsecS12>>(10+12));
 
-	   0,  48, 143, 191,
+			if(true==slot.InReleasePhase && millisec<slot.ReleaseEndTime)
 
-	   0,  48, 143, 238,
+			{
 
-	   0,  95, 191, 238,
+				slotStillPlaying=true;
+
+				break;;
+
+			}
+
+			else if(true!=slot.InReleasePhase && millisec<slot.envDurationCache)
+
+			{
+
+				slotStillPlaying=true;
+
+				break;;
+
+			}
+
+		}
+
+		if(true!=slotStillPlaying)
+
+		{
+
+			state.playingCh&=~(1<<chNum);
+
+			ch.playState=CH_IDLE;
+
+			for(auto &s : ch.slots)
+
+			{
+
+				s.lastDbX100Cache=0;
+
+				s.InReleasePhase=false;
+
+			}
+
+		}
+
+	}
+
+}
+
+
+
+void YM2612::CheckToneDoneAllChannels(void)
+
+{
+
+	for(unsigned int chNum=0; chNum<NUM_CHANNELS; ++chNum)
+
+	{
+
+		CheckToneDone(chNum);
+
+	}
+
+}
+
+
+
+std::vector <unsigned char> YM2612::MakeWaveAllChannels(unsigned long long int millisec) const
+
+{
+
+	std::vector <unsigned char> wave;
+
+
+
+	unsigned long long int numSamples=(millisec<<12);
+
+	numSamples*=samplingRate;
+
+	numSamples/=1000;
 
-	   0,  95, 191, 286,
+	numSamples>>=12;
 
-	   0,  95, 191, 288,
 
-	   0,  95, 238, 334,
 
-	   0,  85, 238, 381, // 85?
+	wave.resize(4*numSamples);
 
-	   0, 143, 286, 381,
 
-	   0, 143, 298, 429,
 
-	   0, 143, 334, 477,
+	unsigned int nPlayingCh=0;
 
+	unsigned int playingCh[NUM_CHANNELS];
 
+	for(unsigned int chNum=0; chNum<NUM_CHANNELS; ++chNum)
 
-	   0, 191, 381, 525,
+	{
 
-	   0, 191, 381, 572,
+		if(0!=(state.playingCh&(1<<chNum)))
 
-	   0, 191, 429, 620,
+		{
 
-	   0, 238, 477, 668,
+			playingCh[nPlayingCh++]=chNum;
 
-	   0, 238, 525, 763,
+		}
 
-	   0, 286, 672, 811,
+	}
 
-	   0, 286, 520, 906,
+	MakeWaveForNSamples(wave.data(),nPlayingCh,playingCh,numSamples);
 
-	   0, 334, 668, 354,
+	return wave;
 
-	   0, 391, 763,1049,
+}
 
-	   0, 391, 763,1049,
 
 
+std::vector <unsigned char> YM2612::MakeWave(unsigned int ch,unsigned long long int millisec) const
 
-	   0, 391, 763,1049,
+{
 
-	   0, 391, 763,1049,
+	std::vector <unsigned char> wave;
 
-};
 
 
+	unsigned long long int numSamples=(millisec<<12);
 
-////////////////////////////////////////////////////////////
+	numSamples*=samplingRate;
 
+	numSamples/=1000;
 
+	numSamples>>=12;
 
-/*static*/ unsigned int YM2612::attackExp[4096];         // 0 to 4095 scale in -> 0 to 4095 scale out.
 
-/*static*/ unsigned int YM2612::attackExpInverse[4096];  // 0 to 4095 scale in -> 0 to 4095 scale out.
 
+	wave.resize(4*numSamples);
 
 
-////////////////////////////////////////////////////////////
 
+	unsigned int playingCh[1]={ch};
 
+	MakeWaveForNSamples(wave.data(),1,playingCh,numSamples);
 
+	return wave;
 
+}
 
 
 
-static unsigned int LFOCycleMicroSec[8]=
+class YM2612::WithLFO
 
 {
 
-	100000000/ 398, // 1000000/ 3.98,
+public:
 
-	100000000/ 556, // 1000000/ 5.56,
+	static inline void CalculateLFO(int AMSAdjustment[4],int PMSAdjustment[4],unsigned int FREQCTRL,const Channel &ch)
 
-	100000000/ 602, // 1000000/ 6.02,
+	{
 
-	100000000/ 637, // 1000000/ 6.37,
+		if(0!=ch.PMS)
 
-	100000000/ 688, // 1000000/ 6.88,
+		{
 
-	100000000/ 963, // 1000000/ 9.63,
+			for(unsigned int i=0; i<connectionToOutputSlots[ch.CONNECT].nOutputSlots; ++i)
 
-	100000000/4810, // 1000000/48.10,
+			{
 
-	100000000/7220  // 1000000/72.20
+				auto sl=connectionToOutputSlots[ch.CONNECT].slots[i];
 
-};
+				int signedStep=ch.slots[sl].phaseS12Step;
 
 
 
-// Definition of cent.
+				unsigned long long int LFOPhase=(ch.slots[sl].microsecS12>>12);
 
-// https://ja.wikipedia.org/wiki/%E3%82%BB%E3%83%B3%E3%83%88_(%E9%9F%B3%E6%A5%BD)
+				LFOPhase=LFOPhase*PHASE_STEPS/LFOCycleMicroSec[FREQCTRL];
 
-static int PMS16384Table[8]=
 
-{
 
-  0,
+				int PMSAdj=PMS16384Table[ch.PMS]*sineTable[LFOPhase&PHASE_MASK]/UNSCALED_MAX;
 
- 32,// scale(3.400000)=1.001966, (1.001966-1.0)*16384.0=32
+				PMSAdjustment[sl]=signedStep*PMSAdj/16384/2;
 
- 63,// scale(6.700000)=1.003878, (1.003878-1.0)*16384.0=63
+			}
 
- 94,// scale(10.000000)=1.005793, (1.005793-1.0)*16384.0=94
+		}
 
-133,// scale(14.000000)=1.008120, (1.008120-1.0)*16384.0=133
+		{
 
-190,// scale(20.000000)=1.011619, (1.011619-1.0)*16384.0=190
+			for(unsigned int i=0; i<connectionToOutputSlots[ch.CONNECT].nOutputSlots; ++i)
 
-382,// scale(40.000000)=1.023374, (1.023374-1.0)*16384.0=382
+			{
 
-774,// scale(80.000000)=1.047294, (1.047294-1.0)*16384.0=774
+				auto sl=connectionToOutputSlots[ch.CONNECT].slots[i];
 
-};
+				if(0!=ch.slots[sl].AM)
 
+				{
 
+					unsigned long long int LFOPhase=(ch.slots[sl].microsecS12>>12);
 
-// dB=20log10(P/Pref)
+					LFOPhase=LFOPhase*PHASE_STEPS/LFOCycleMicroSec[FREQCTRL];
 
-// 0=20log10(P/Pref) -> P/Pref=1.0
+					AMSAdjustment[sl]=4096+(AMS4096Table[ch.AMS]*sineTable[LFOPhase&PHASE_MASK])/UNSCALED_MAX;
 
-// 1.4=20log10(P/Pref) -> 10^(1.4/20)=P/Pref -> 
+				}
 
-// 5.9=20log10(P/Pref) -> 10^(5.9/20)=P/Pref ->
+			}
 
-// 11.8=20log10(P/Pref) -> 10^(11.8/20)=P/Pref ->
+		}
 
-static int AMS4096Table[4]=
+	}
 
-{
+	static inline const int AMSMul(const int AMS)
 
- 4096-4096,  // 1.0
+	{
 
- 4812-4096,  // 1.1749
+		return AMS;
 
- 8079-4096,  // 1.97242
+	}
 
-15935-4096, // 3.89045
+	static inline constexpr int AMSDiv(void)
 
-};
+	{
 
+		return 4096;
 
+	}
 
-////////////////////////////////////////////////////////////
+};
 
 
 
-int YM2612::Slot::DetuneContributionToPhaseStepS12(unsigned int BLOCK,unsigned int NOTE) const
+class YM2612::WithoutLFO
 
 {
 
-	// Hz ranges 1 to roughly 8000.  PHASE_STEPS=4096.  hertz*PHASE_STEPS=2^13*2^12=2^25. Fits in 32 bit.
-
-	long long int detuneStepContribution=0;
+public:
 
-	if(0!=DT)
+	static inline void CalculateLFO(int AMSAdjustment[4],int PMSAdjustment[4],unsigned int FREQCTRL,const Channel &ch)
 
 	{
 
-		long long int hertz1000=detune1000Table[(BLOCK<<4)+(NOTE<<2)+(DT&3)];
+	}
 
-		detuneStepContribution=(hertz1000*PHASE_STEPS);
+	static inline constexpr int AMSMul(const int)
 
-		detuneStepContribution<<=12;
+	{
 
-		detuneStepContribution/=1000;  // Now it is (hertz*PHASE_STEPS)<<12.
+		return 1;
 
-		if(0!=(DT&4))
+	}
 
-		{
+	static inline constexpr int AMSDiv(void)
 
-			detuneStepContribution=-detuneStepContribution;
+	{
 
-		}
+		return 1;
 
 	}
 
-	return (int)detuneStepContribution;
-
-}
+};
 
 
 
-inline int YM2612::Slot::UnscaledOutput(int phase,int phaseShift) const
+class YM2612::Int16Output
 
 {
 
-	// phaseShift is input from the upstream slot.
+public:
 
-	// -4096 to 4096.  4096 should be counted as 8pi.
+	unsigned char *wave;
 
-	// UNSCALED_MAX is 2048. therefore 8x.
 
 
+	inline void Set(unsigned long long int i,int leftOut,int rightOut)
 
-	//phaseShift*=MULTITable[this->MULTI];
+	{
 
-	//phaseShift>>=1;
+		WordOp_Set(wave+i*4  ,leftOut);
+
+		WordOp_Set(wave+i*4+2,rightOut);
 
+	}
 
+	inline void Clear(unsigned long long int i,unsigned long long int n)
 
-	//                     8.0       * (2PI / 2)     /   1.0
+	{
 
-	const int outputScale=SLOTOUT_TO_NPI*(PHASE_STEPS/2)/UNSCALED_MAX;
+		std::memset(wave+i*4,0,n*4);
 
-	return sineTable[(phase+(phaseShift*outputScale))&PHASE_MASK];
+	}
 
-}
+};
 
-inline int YM2612::Slot::UnscaledOutput(int phase,int phaseShift,unsigned int FB,int lastSlot0Out) const
 
-{
 
-	if(0!=FB)
+class YM2612::FloatInterleavedOutput
 
-	{
+{
 
-		static const int FBScaleTable[]=
+public:
 
-		{
+	float *wave;
 
-			0,1,2,4,8,16,32,64
+	float gain;
 
-		};
 
-		// lastSlotOut=1.0=>UNSCALED_MAX   4096=>2PI
 
-		// To make it 4PI(8192) at FB=7(scale=64), must divide by UNSCALED_MAX*64/8192.
+	inline void Set(unsigned long long int i,int leftOut,int rightOut)
 
-		// What was I thinking when I made div=32?  It should be 16.
+	{
 
-		const int div=UNSCALED_MAX*64/8192;
+		wave[i*2  ]=(float)leftOut*gain;
 
-		phase+=(lastSlot0Out*FBScaleTable[FB]/div);
+		wave[i*2+1]=(float)rightOut*gain;
 
 	}
 
-	//                     8.0       * (2PI / 2)     /   1.0
+	inline void Clear(unsigned long long int i,unsigned long long int n)
 
-	const int outputScale=SLOTOUT_TO_NPI*(PHASE_STEPS/2)/UNSCALED_MAX;
+	{
 
-	return sineTable[(phase+(phaseShift*outputScale))&PHASE_MASK];
+		std::memset(wave+i*2,0,n*2*sizeof(float));
 
-}
+	}
 
-inline int YM2612::Slot::EnvelopedOutputDbToAmpl(int phase,int phaseShift,unsigned int timeInMS,unsigned int FB,int lastSlot0Out) const
+};
 
-{
 
-	int dB=InterpolateEnvelope(timeInMS);
 
-	lastDbX100Cache=dB;
+class YM2612::FloatPlanarOutput
 
-	int ampl=DB100to4095Scale[dB];
+{
 
-	int unscaledOut=UnscaledOutput(phase,phaseShift,FB,lastSlot0Out);
+public:
 
-	return (unscaledOut*ampl)/4096;
+	float *left,*right;
 
-}
+	float gain;
 
-inline int YM2612::Slot::EnvelopedOutputDbToAmpl(int phase,int phaseShift,unsigned int timeInMS) const
 
-{
 
-	int dB=InterpolateEnvelope(timeInMS);
+	inline void Set(unsigned long long int i,int leftOut,int rightOut)
 
-	lastDbX100Cache=dB;
+	{
 
-	int ampl=DB100to4095Scale[dB];
+		left[i]=(float)leftOut*gain;
 
-	int unscaledOut=UnscaledOutput(phase,phaseShift);
+		right[i]=(float)rightOut*gain;
 
-	return (unscaledOut*ampl)/4096;
+	}
 
-}
+	inline void Clear(unsigned long long int i,unsigned long long int n)
 
-inline int YM2612::Slot::InterpolateEnvelope(unsigned int timeInMS) const
+	{
 
-{
+		std::memset(left+i,0,n*sizeof(float));
 
-	if(true!=InReleasePhase)
+		std::memset(right+i,0,n*sizeof(float));
 
-	{
+	}
 
-		if(timeInMS<env[0]) // Attack
+};
 
-		{
 
-			unsigned int x=4096*timeInMS/env[0];
 
-			return (env[1]*attackExp[x])>>12;
+void YM2612::WaveBuffer::Clear(unsigned long long int numSamples) const
 
-		}
+{
 
-		else
+	switch(format)
 
-		{
+	{
 
-			timeInMS-=env[0];
+	case WAVE_INT16:
 
-			if(timeInMS<env[2])
+		std::memset(int16,0,numSamples*4);
 
-			{
+		break;
 
-				return env[1]-(env[1]-env[3])*timeInMS/env[2];
+	case WAVE_FLOAT_INTERLEAVED:
 
-			}
+		std::memset(left,0,numSamples*2*sizeof(float));
 
-			else
+		break;
 
-			{
+	case WAVE_FLOAT_PLANAR:
 
-				timeInMS-=env[2];
+		std::memset(left,0,numSamples*sizeof(float));
 
-				if(timeInMS<env[4])
+		std::memset(right,0,numSamples*sizeof(float));
 
-				{
+		break;
 
-					return env[3]-env[3]*timeInMS/env[4];
+	}
 
-				}
+}
 
-			}
 
-		}
 
-		return 0;
+YM2612::WaveBuffer YM2612::WaveBuffer::Advance(unsigned long long int numSamples) const
 
-	}
+{
 
-	else
+	WaveBuffer buf=*this;
+
+	switch(format)
 
 	{
 
-		if(timeInMS<ReleaseEndTime && ReleaseStartTime<ReleaseEndTime)
+	case WAVE_INT16:
 
-		{
+		buf.int16+=numSamples*4;
 
-			auto diff=ReleaseEndTime-timeInMS;
+		break;
+
+	case WAVE_FLOAT_INTERLEAVED:
 
-			auto DbX100=ReleaseStartDbX100;
+		buf.left+=numSamples*2;
 
-			DbX100*=diff;
+		break;
 
-			DbX100/=(ReleaseEndTime-ReleaseStartTime);
+	case WAVE_FLOAT_PLANAR:
 
-			return DbX100;
+		buf.left+=numSamples;
 
-		}
+		buf.right+=numSamples;
 
-		return 0; // Not supported yet.
+		break;
 
 	}
 
+	return buf;
+
 }
 
 
 
-unsigned int YM2612::Channel::Note(void) const
+template <class LFOClass,class OutputClass>
+
+long long int YM2612::MakeWaveForNSamplesTemplate(OutputClass out,unsigned int nPlayingCh,unsigned int playingCh[],unsigned long long int numSamples) const
 
 {
 
-	// Formula [2] pp.204
+	const unsigned int microsecS12Step=4096000000/samplingRate;
 
-	// There is an error.  F_NUM is 11bits.  There is no F11.
+	// Time runs 1/samplingRate seconds per step
 
-	// Probably, F11, F10, F9, F8 should be read bit10, bit9, bit8, bit7.
+	//           1000/samplingRate milliseconds per step
 
-	unsigned int F10=((F_NUM>>10)&1);
+	//           1000000/samplingRate microseconds per step
 
-	unsigned int F9= ((F_NUM>> 9)&1);
+	//           1000000000/samplingRate nanoseconds per step
 
-	unsigned int F8= ((F_NUM>> 8)&1);
 
-	unsigned int F7=((F_NUM>>11)&1);
 
-	unsigned int N3=(F10&(F9|F8|F7)); // |((~F10)&F9&F8&F7);  Measurement from actual FM TOWNS 2MX suggests no contribution from the second term.
+	// If microSec12=4096*microseconds, tm runs
 
-	unsigned int NOTE=(F10<<1)|N3;
+	//           4096000000/samplingRate per step
 
-	return NOTE;
 
-}
 
+	unsigned int LeftANDPtn[NUM_CHANNELS];
 
+	unsigned int RightANDPtn[NUM_CHANNELS];
 
-unsigned int YM2612::Channel::KC(void) const
 
-{
 
-	// Formulat in [2] pp.204 suggests:
+	for(unsigned int chNum=0; chNum<NUM_CHANNELS; ++chNum)
 
- 	//   unsigned int KC=(ch.BLOCK<<2)|NOTE;
+	{
 
-	// which doesn't make sense.
+		auto &ch=state.channels[chNum];
 
-	// SEGA Genesis Software Manaual tells KC is just top 5 bits of BLOCK|F_NUM2.
+		LeftANDPtn[chNum]=(0!=ch.L ? ~0 : 0);
 
-	// Which makes more sense.
+		RightANDPtn[chNum]=(0!=ch.R ? ~0 : 0);
 
+	}
 
 
-	// Measurement taken from FM TOWNS 2MX gave a conclusion:
 
-	//   NOTE=(N4<<1)|N3
+	// Rests and decayed tones don't go through the per-sample loop.
 
-	//   N4=F11
+	// If no channel is left, the buffer is just cleared below.
 
-	//   N3=F11&(F10|F9|F8)
+	for(int j=nPlayingCh-1; 0<=j; --j)
 
-	// F11 Highest bit of F_NUMBER
+	{
 
-	// F10 Second highest bit of F_NUMBER
+		if(true==SkipSilentChannel<LFOClass>(playingCh[j],numSamples,microsecS12Step))
 
-	// F9  Third highest bit of F_NUMBER
+		{
 
-	// F8  Fourth highest bit of F_NUMBER
+			playingCh[j]=playingCh[nPlayingCh-1];
 
+			--nPlayingCh;
 
+		}
 
-	// YAMAHA official manual for YM2608 Section 2-4-1-A, and FM Towns Technical Databook suggests:
+	}
 
-	//    N3=(F11&(F10|F9|F8))|((~F11)&F10&F9&F8)
 
-	// However, the actual YM2612 didn't show any contribution from ((~F11)&F10&F9&F8).
 
+	unsigned int i;
 
+	for(i=0; i<numSamples && 0<nPlayingCh; ++i)
 
-	unsigned int N4=((F_NUM>>9)&2);
+	{
 
-	unsigned int N3=((F_NUM>>10)&((F_NUM>>9)|(F_NUM>>8)|(F_NUM>>7)))&1;
+		int leftOut=0,rightOut=0;
 
-	unsigned int KC=(BLOCK<<2)|N4|N3;
+		for(int j=nPlayingCh-1; 0<=j; --j)
 
-	return KC&0x1F;
+		{
 
-}
+			auto chNum=playingCh[j];
 
+			auto &ch=state.channels[chNum];
 
+			if(ch.slots[0].toneDurationMicrosecS12<=ch.slots[0].microsecS12 &&
 
-////////////////////////////////////////////////////////////
+			   ch.slots[1].toneDurationMicrosecS12<=ch.slots[1].microsecS12 &&
 
+			   ch.slots[2].toneDurationMicrosecS12<=ch.slots[2].microsecS12 &&
 
+			   ch.slots[3].toneDurationMicrosecS12<=ch.slots[3].microsecS12)
 
-void YM2612::KeyOn(unsigned int chNum,unsigned int slotFlags)
+			{
 
-{
+				// The channel moved to j has already been done for this sample.
 
-	if(0==slotFlags)
+				// Other channels still need to be, otherwise they lose a sample.
 
-	{
+				playingCh[j]=playingCh[nPlayingCh-1];
 
-		return;
+				--nPlayingCh;
 
-	}
+				continue;
 
+			}
 
 
 
+			int PMSAdjustment[4]=
 
-	auto &ch=state.channels[chNum];
+			{
 
+				0,0,0,0
 
+			};
 
-	const unsigned int hertzX16=BLOCK_FNUM_to_FreqX16(ch.BLOCK,ch.F_NUM);
+			int AMSAdjustment[4]=
 
+			{
 
+				4096,4096,4096,4096
 
-	state.playingCh|=(1<<chNum);
+			};
 
-	ch.playState=CH_PLAYING;
 
-	if(0!=(1&slotFlags))
 
-	{
+			LFOClass::CalculateLFO(AMSAdjustment,PMSAdjustment,state.FREQCTRL,ch);
 
-		ch.lastSlot0Out[0]=0;
 
-		ch.lastSlot0Out[1]=0;
 
-	}
 
 
+			// Why take an average of last two samples, not just the last sample, for feedback?
 
-	for(int i=0; i<NUM_SLOTS; ++i)
+			// Cisc's FMGEN YM emulator does it.  I was wondering why.  But, it works as a damper to prevent
 
-	{
+			// premature divergence.
 
-		if(0!=(slotFlags&(1<<i)))
+			// 
 
-		{
+			// When feedback is given, the output from slot 0 is calculated as:
 
-			auto &slot=ch.slots[i];
+			// 
 
+			//     y(i+1)=A*sin(i*dt+C*y(i))
 
+			// 
 
-			slot.InReleasePhase=false;
+			// A is amplitude calculated from the envelope, and C is defined by feedback level, and
 
-			slot.phaseS12=0;
+			// dt depends on the frequency of the tone.
 
+			// 
 
+			// Let's denote the angle given to the sine function as:
 
-			UpdatePhase12StepSlot(slot,hertzX16,slot.DetuneContributionToPhaseStepS12(ch.BLOCK,ch.Note()));
+			// 
 
+			//     X(i)=i*dt+C*y(i)
 
+			// 
 
-			// (hertzX16*PHASE_STEPS)<<8==hertz*PHASE_STEPS*4096
+			// When the slope of sin(X(i)) is negative (0.5PI<X(i)<1.5PI), means the value is decreasing with
 
-			UpdateSlotEnvelope(ch,slot);
+			// increasing X, the function can become unstable and diverge, until the function returns to the
 
+			// positive slope.  Here's what can happen.
 
+			// 
 
-			// Observation tells that if key is turned on while the previous tone is still playing, 
+			// X(i) monotonicly increase if C=0, means no feedback.  However, if C is non-zero, i*dt increases, 
 
-			// The initial output level must start from the last output level, in which case
+			// but C*y(i) can increase or decrease depending on the slope of y(i).
 
-			// microsec12 must fast-forwarded so that the output matches the lastDbX100Cache.
+			// 
 
-			// Linear interpolation will have error, but should be better than nothing.
+			// If the one-step decrease of C*y(i) exceeds the increase of i*dt (which is dt), 
 
-			if(slot.lastDbX100Cache<=0)
+			// X(i) will decrease overall, which means the input to the sine functions goes backward.
 
-			{
+			// Amplitude is positive, and if the slope of the sine function at X(i) was negative, and if 
 
-				slot.microsecS12=0;
+			// the input goes backward, y suddenly increases. i.e., y(i+1) is greater than y(i).
 
-			}
+			// 
 
-			else if(slot.env[1]<=slot.lastDbX100Cache)
+			// Then in the next step, both C*y and i*dt terms increase.  This makes a large jump of X.
 
-			{
+			// The sine function is going down with X, as a result y dives down bigger than the last 
 
-				slot.microsecS12=(slot.env[0]<<(12+10));
+			// increase.  Then, the next comes even bigger increase of y, followed by even bigger dive, 
 
-			}
+			// and the function of y(i) starts oscillating every sample.
 
-			else
+			// 
 
-			{
+			// From the above, the condition that starts this divergence is:
 
-				unsigned int scale=attackExpInverse[4096*slot.lastDbX100Cache/slot.env[1]];
+			// 
 
-				slot.microsecS12=(slot.env[0]*scale/4096)<<(12+10);
+			//     dt<-dY
 
-			}
+			// 
 
-			slot.lastDbX100Cache=0;
+			// where Y=C*y(i).  Interestingly, because of this condition, this particular mode of oscillation
 
-		}
+			// only appears when dY<0.
 
-	}
+			// 
 
+			// While it is a legitimate divergence that adds some noise component to the tone in some settings,
 
+			// Slot 0 starts this oscillation too easily.
 
-#ifdef YM2612_DEBUGOUTPUT
+			// 
 
-	printf("%d BLOCK %03xH F_NUM %03xH Hertz %d\n",KC,ch.BLOCK,ch.F_NUM,hertzX16/16);
+			// Cisc's FMGEN YM-chip emulator, used in XM7 and M88 emulators (and maybe other emulators as well)
 
-#endif
+			// solves this problem by feeding the average of the last two samples back to slot 0.
 
-}
+			// 
 
+			// During the oscillation, the value of y jumps up and down.  But, if you look at the middle of the two
 
+			// consecutive outputs, it goes through a smooth decreasing curve.
 
-void YM2612::UpdatePhase12StepSlot(Slot &slot,const unsigned int hertzX16,int detuneContribution)
+			// 
 
-{
+			// The cause of this divergence is from the oscillation of the feedback term, C*y.  By taking average
 
-	// Phase runs hertz*PHASE_STEPS times per second.
+			// of the last two samples, it essentially damps the oscillation, and effectively prevents this divergence.
 
-	//            hertz*PHASE_STEPS/WAVE_SAMPLING_RATE times per step.
+			//
 
-	// Phase 12 runs
+			// So the modified formulation is:
 
-	//            0x1000*hertz*PHASE_STEPS/WAVE_SAMPLING_RATE per step.
+			//
 
-	unsigned long long phaseS12Step;
+			//     y(i+1)=A*sin(i*dt+C*(y(i)+y(i-1))/2)
 
-	phaseS12Step=MULTITable[slot.MULTI]*hertzX16*PHASE_STEPS; // 2X from MULTITable, 16X from hertzX16
+			//
 
-	phaseS12Step<<=7;                                         // 128X  Overall 2x16x128=4096X
+			// Here I am explicitly writing it out, but Cisc's implementation embedded this division by two
 
-	phaseS12Step+=MULTITable[slot.MULTI]*detuneContribution/2;
+			// in the anyway-required bit shift.
 
-	phaseS12Step/=WAVE_SAMPLING_RATE;
+			//
 
-	slot.phaseS12Step=(unsigned int)phaseS12Step;
+			// Very genious solution it is.
 
-}
 
 
+			auto s0Out=(ch.lastSlot0Out[1]+ch.lastSlot0Out[0])/2;
 
-void YM2612::UpdatePhase12StepSlot(Channel &ch)
+			const uint64_t microsecS12[4]=
 
-{
+			{
 
-	const unsigned int hertzX16=BLOCK_FNUM_to_FreqX16(ch.BLOCK,ch.F_NUM);
+				ch.slots[0].microsecS12,
 
-	for(auto &slot : ch.slots)
+				ch.slots[1].microsecS12,
 
-	{
+				ch.slots[2].microsecS12,
 
-		UpdatePhase12StepSlot(slot,hertzX16,slot.DetuneContributionToPhaseStepS12(ch.BLOCK,ch.Note()));
+				ch.slots[3].microsecS12,
 
-	};
+			};
 
-}
+			const unsigned int phaseS12[4]=
 
+			{
 
+				ch.slots[0].phaseS12,
 
-void YM2612::KeyOff(unsigned int chNum,unsigned int slotFlags)
+				ch.slots[1].phaseS12,
 
-{
+				ch.slots[2].phaseS12,
 
-	if(0!=(state.playingCh&(1<<chNum)))
+				ch.slots[3].phaseS12,
 
-	{
+			};
 
-		auto &ch=state.channels[chNum];
+			auto ampl=CalculateAmplitude<LFOClass>(chNum,microsecS12,phaseS12,AMSAdjustment,s0Out);
 
-		for(auto &slot : ch.slots)
+			ch.lastSlot0Out[1]=ch.lastSlot0Out[0];
 
-		{
+			ch.lastSlot0Out[0]=s0Out;
 
-			if(true!=slot.InReleasePhase)
 
-			{
 
-				slot.InReleasePhase=true;
+			leftOut+=(LeftANDPtn[chNum]&ampl);
 
-				UpdateRelease(ch,slot);
+			rightOut+=(RightANDPtn[chNum]&ampl);
 
-			}
 
-		}
 
-	}
+			ch.slots[0].phaseS12+=ch.slots[0].phaseS12Step+PMSAdjustment[0];
 
-}
+			ch.slots[1].phaseS12+=ch.slots[1].phaseS12Step+PMSAdjustment[1];
 
+			ch.slots[2].phaseS12+=ch.slots[2].phaseS12Step+PMSAdjustment[2];
 
+			ch.slots[3].phaseS12+=ch.slots[3].phaseS12Step+PMSAdjustment[3];
 
-void YM2612::CheckToneDone(unsigned int chNum)
+			ch.slots[0].microsecS12+=microsecS12Step;
 
-{
+			ch.slots[1].microsecS12+=microsecS12Step;
 
-	auto &ch=state.channels[chNum];
+			ch.slots[2].microsecS12+=microsecS12Step;
 
-	if(CH_PLAYING!=ch.playState)
+			ch.slots[3].microsecS12+=microsecS12Step;
 
-	{
+		}
 
-		state.playingCh&=~(1<<chNum);
+		out.Set(i,leftOut,rightOut);
 
 	}
 
-	else
 
-	{
 
-		bool slotStillPlaying=false;
+	out.Clear(i,numSamples-i);
 
-		for(int i=0; i<connectionToOutputSlots[ch.CONNECT].nOutputSlots; ++i)
 
-		{
 
-			auto &slot=ch.slots[connectionToOutputSlots[ch.CONNECT].slots[i]];
+// std::cout << (microsec12>>12) << "us " << std::endl;
 
-			auto millisec=(slot.microsecS12>>(10+12));
+// std::cout << phase12[0] << "," << (phase12[0]>>12)/PHASE_STEPS << "cycles" << std::endl;
 
-			if(true==slot.InReleasePhase && millisec<slot.ReleaseEndTime)
+// std::cout << phase12[1] << "," << (phase12[1]>>12)/PHASE_STEPS << "cycles" << std::endl;
 
-			{
+// std::cout << phase12[2] << "," << (phase12[2]>>12)/PHASE_STEPS << "cycles" << std::endl;
 
-				slotStillPlaying=true;
+// std::cout << phase12[3] << "," << (phase12[3]>>12)/PHASE_STEPS << "cycles" << std::endl;
 
-				break;;
 
-			}
 
-			else if(true!=slot.InReleasePhase && millisec<slot.envDurationCache)
+	return i;
 
-			{
+}
 
-				slotStillPlaying=true;
 
-				break;;
 
-			}
+template <class LFOClass>
 
-		}
+bool YM2612::SkipSilentChannel(unsigned int chNum,unsigned long long int numSamples,unsigned int microsecS12Step) const
 
-		if(true!=slotStillPlaying)
+{
 
-		{
+	auto &ch=state.channels[chNum];
 
-			state.playingCh&=~(1<<chNum);
+	if(0==numSamples || (true==state.LFO && 0!=ch.PMS))
 
-			ch.playState=CH_IDLE;
+	{
 
-			for(auto &s : ch.slots)
+		// Phase with PMS cannot be advanced in bulk.
 
-			{
+		return false;
 
-				s.lastDbX100Cache=0;
+	}
 
-				s.InReleasePhase=false;
 
-			}
 
-		}
+	const bool muted=channelMute[chNum];
 
-	}
+	bool slotActive[NUM_SLOTS];
 
-}
+	for(unsigned int s=0; s<NUM_SLOTS; ++s)
 
+	{
 
+		slotActive[s]=(0!=(ch.usingSlot&(1<<s)) || true==ch.slots[s].InReleasePhase);
 
-void YM2612::CheckToneDoneAllChannels(void)
+	}
 
-{
 
-	for(unsigned int chNum=0; chNum<NUM_CHANNELS; ++chNum)
 
-	{
+	// Carriers must be past the attack, and their amplitude must be zero.
 
-		CheckToneDone(chNum);
+	// Modulators don't matter then, except slot 0, which feeds back to itself.
 
-	}
+	bool slot0IsCarrier=false;
 
-}
+	for(unsigned int i=0; i<connectionToOutputSlots[ch.CONNECT].nOutputSlots && true!=muted; ++i)
 
+	{
 
+		auto s=connectionToOutputSlots[ch.CONNECT].slots[i];
 
-std::vector <unsigned char> YM2612::MakeWaveAllChannels(unsigned long long int millisec) const
+		auto &slot=ch.slots[s];
 
-{
+		slot0IsCarrier=(slot0IsCarrier || 0==s);
 
-	std::vector <unsigned char> wave;
+		if(true==slotActive[s])
 
+		{
 
+			unsigned int timeInMS=(unsigned int)(slot.microsecS12>>(12+10));
 
-	unsigned long long int numSamples=(millisec<<12);
+			if((true!=slot.InReleasePhase && timeInMS<slot.env[0]) ||
 
-	numSamples*=WAVE_SAMPLING_RATE;
+			   0!=DB100to4095Scale[slot.InterpolateEnvelope(timeInMS)])
 
-	numSamples/=1000;
+			{
 
-	numSamples>>=12;
+				return false;
 
+			}
 
+		}
 
-	wave.resize(4*numSamples);
+	}
 
 
 
-	unsigned int nPlayingCh=0;
+	// The per-sample loop drops the channel when all slots pass toneDurationMicrosecS12.
 
-	unsigned int playingCh[NUM_CHANNELS];
+	uint64_t numToDone=0;
 
-	for(unsigned int chNum=0; chNum<NUM_CHANNELS; ++chNum)
+	for(auto &slot : ch.slots)
 
 	{
 
-		if(0!=(state.playingCh&(1<<chNum)))
+		if(slot.microsecS12<slot.toneDurationMicrosecS12)
 
 		{
 
-			playingCh[nPlayingCh++]=chNum;
+			numToDone=std::max<uint64_t>(numToDone,(slot.toneDurationMicrosecS12-slot.microsecS12+microsecS12Step-1)/microsecS12Step);
 
 		}
 
 	}
 
-	MakeWaveForNSamples(wave.data(),nPlayingCh,playingCh,numSamples);
+	if(0==numToDone)
 
-	return wave;
+	{
 
-}
+		return false;
 
+	}
 
+	const uint64_t n=std::min<uint64_t>(numToDone,numSamples);
 
-std::vector <unsigned char> YM2612::MakeWave(unsigned int ch,unsigned long long int millisec) const
 
-{
 
-	std::vector <unsigned char> wave;
+	// Feedback history of slot 0.
 
+	auto &slot0=ch.slots[0];
 
+	if(true==muted)
 
-	unsigned long long int numSamples=(millisec<<12);
+	{
 
-	numSamples*=WAVE_SAMPLING_RATE;
+		// CalculateAmplitude returns before slot 0, and the average is fed back.  It converges in a few steps.
 
-	numSamples/=1000;
+		for(uint64_t i=0; i<n && ch.lastSlot0Out[0]!=ch.lastSlot0Out[1]; ++i)
 
-	numSamples>>=12;
+		{
 
+			auto s0Out=(ch.lastSlot0Out[1]+ch.lastSlot0Out[0])/2;
 
+			ch.lastSlot0Out[1]=ch.lastSlot0Out[0];
 
-	wave.resize(4*numSamples);
+			ch.lastSlot0Out[0]=s0Out;
 
+		}
 
+	}
 
-	unsigned int playingCh[1]={ch};
+	else if(true==slotActive[0] && true!=slot0IsCarrier)
 
-	MakeWaveForNSamples(wave.data(),1,playingCh,numSamples);
+	{
 
-	return wave;
+		// Slot 0 is a modulator and may still be sounding.  Only slot 0 is calculated.
 
-}
+		// AMS is applied only to carriers, so that the modulator output is not scaled.
 
+		for(uint64_t i=0; i<n; ++i)
 
+		{
 
-class YM2612::WithLFO
+			int s0Out=(ch.lastSlot0Out[1]+ch.lastSlot0Out[0])/2;
 
-{
+			unsigned int timeInMS=(unsigned int)((slot0.microsecS12+i*microsecS12Step)>>(12+10));
 
-public:
+			unsigned int phase=slot0.phaseS12+(unsigned int)(i*slot0.phaseS12Step);
 
-	static inline void CalculateLFO(int AMSAdjustment[4],int PMSAdjustment[4],unsigned int FREQCTRL,const Channel &ch)
+			s0Out=slot0.EnvelopedOutputDbToAmpl(phase>>12,0,timeInMS,ch.FB,s0Out)*LFOClass::AMSMul(4096)/LFOClass::AMSDiv();
 
-	{
+			ch.lastSlot0Out[1]=ch.lastSlot0Out[0];
 
-		if(0!=ch.PMS)
+			ch.lastSlot0Out[0]=s0Out;
 
-		{
+		}
 
-			for(unsigned int i=0; i<connectionToOutputSlots[ch.CONNECT].nOutputSlots; ++i)
+	}
 
-			{
+	else
 
-				auto sl=connectionToOutputSlots[ch.CONNECT].slots[i];
+	{
 
-				int signedStep=ch.slots[sl].phaseS12Step;
+		// Slot 0 outputs zero.
 
+		ch.lastSlot0Out[1]=(1==n ? ch.lastSlot0Out[0] : 0);
 
+		ch.lastSlot0Out[0]=0;
 
-				unsigned long long int LFOPhase=(ch.slots[sl].microsecS12>>12);
+	}
 
-				LFOPhase=LFOPhase*PHASE_STEPS/LFOCycleMicroSec[FREQCTRL];
 
 
+	for(unsigned int s=0; s<NUM_SLOTS; ++s)
 
-				int PMSAdj=PMS16384Table[ch.PMS]*sineTable[LFOPhase&PHASE_MASK]/UNSCALED_MAX;
+	{
 
-				PMSAdjustment[sl]=signedStep*PMSAdj/16384/2;
+		auto &slot=ch.slots[s];
 
-			}
+		slot.phaseS12+=(unsigned int)(n*slot.phaseS12Step);
 
-		}
+		slot.microsecS12+=n*microsecS12Step;
+
+		if(true!=muted && true==slotActive[s])
 
 		{
 
-			for(unsigned int i=0; i<connectionToOutputSlots[ch.CONNECT].nOutputSlots; ++i)
+			// As if evaluated for the last sample.
 
-			{
+			slot.lastDbX100Cache=slot.InterpolateEnvelope((unsigned int)((slot.microsecS12-microsecS12Step)>>(12+10)));
 
-				auto sl=connectionToOutputSlots[ch.CONNECT].slots[i];
+		}
 
-				if(0!=ch.slots[sl].AM)
+	}
 
-				{
+	return true;
 
-					unsigned long long int LFOPhase=(ch.slots[sl].microsecS12>>12);
+}
 
-					LFOPhase=LFOPhase*PHASE_STEPS/LFOCycleMicroSec[FREQCTRL];
 
-					AMSAdjustment[sl]=4096+(AMS4096Table[ch.AMS]*sineTable[LFOPhase&PHASE_MASK])/UNSCALED_MAX;
 
-				}
+long long int YM2612::MakeWaveForNSamples(unsigned char wavBuf[],unsigned long long int numSamplesRequested) const
 
-			}
+{
 
-		}
+	unsigned int nPlayingCh=0;
 
-	}
+	unsigned int playingCh[NUM_CHANNELS];
 
-	static inline const int AMSMul(const int AMS)
+	for(unsigned int chNum=0; chNum<NUM_CHANNELS; ++chNum)
 
 	{
 
-		return AMS;
-
-	}
+		if(0!=(state.playingCh&(1<<chNum)))
 
-	static inline constexpr int AMSDiv(void)
+		{
 
-	{
+			playingCh[nPlayingCh++]=chNum;
 
-		return 4096;
+		}
 
 	}
 
-};
+	return MakeWaveForNSamples(wavBuf,nPlayingCh,playingCh,numSamplesRequested);
+
+}
 
 
 
-class YM2612::WithoutLFO
+long long int YM2612::MakeWaveForNSamples(unsigned char wave[],unsigned int nPlayingCh,unsigned int playingCh[],unsigned long long int numSamples) const
 
 {
 
-public:
+	Int16Output out;
 
-	static inline void CalculateLFO(int AMSAdjustment[4],int PMSAdjustment[4],unsigned int FREQCTRL,const Channel &ch)
+	out.wave=wave;
 
-	{
+	return MakeWaveForNSamplesOutput(out,nPlayingCh,playingCh,numSamples);
 
-	}
+}
 
-	static inline constexpr int AMSMul(const int)
 
-	{
 
-		return 1;
+long long int YM2612::MakeWaveForNSamples(const WaveBuffer &buf,unsigned long long int numSamplesRequested) const
 
-	}
+{
 
-	static inline constexpr int AMSDiv(void)
+	unsigned int nPlayingCh=0;
 
-	{
+	unsigned int playingCh[NUM_CHANNELS];
 
-		return 1;
+	for(unsigned int chNum=0; chNum<NUM_CHANNELS; ++chNum)
 
-	}
+	{
 
-};
+		if(0!=(state.playingCh&(1<<chNum)))
+
+		{
 
+			playingCh[nPlayingCh++]=chNum;
 
+		}
 
-template <class LFOClass>
+	}
 
-long long int YM2612::MakeWaveForNSamplesTemplate(unsigned char wave[],unsigned int nPlayingCh,unsigned int playingCh[],unsigned long long int numSamples) const
+	return MakeWaveForNSamples(buf,nPlayingCh,playingCh,numSamplesRequested);
 
-{
+}
 
-	const unsigned int microsecS12Step=4096000000/WAVE_SAMPLING_RATE;
 
-	// Time runs 1/WAVE_SAMPLING_RATE seconds per step
 
-	//           1000/WAVE_SAMPLING_RATE milliseconds per step
+long long int YM2612::MakeWaveForNSamples(const WaveBuffer &buf,unsigned int nPlayingCh,unsigned int playingCh[],unsigned long long int numSamples) const
 
-	//           1000000/WAVE_SAMPLING_RATE microseconds per step
+{
 
-	//           1000000000/WAVE_SAMPLING_RATE nanoseconds per step
+	switch(buf.format)
 
+	{
 
+	case WAVE_INT16:
 
-	// If microSec12=4096*microseconds, tm runs
+		{
 
-	//           4096000000/WAVE_SAMPLING_RATE per step
+			Int16Output out;
 
+			out.wave=buf.int16;
 
+			return MakeWaveForNSamplesOutput(out,nPlayingCh,playingCh,numSamples);
 
-	unsigned int LeftANDPtn[NUM_CHANNELS];
+		}
 
-	unsigned int RightANDPtn[NUM_CHANNELS];
+	case WAVE_FLOAT_INTERLEAVED:
 
+		{
 
+			FloatInterleavedOutput out;
 
-	for(unsigned int chNum=0; chNum<NUM_CHANNELS; ++chNum)
+			out.wave=buf.left;
 
-	{
+			out.gain=buf.gain;
 
-		auto &ch=state.channels[chNum];
+			return MakeWaveForNSamplesOutput(out,nPlayingCh,playingCh,numSamples);
 
-		LeftANDPtn[chNum]=(0!=ch.L ? ~0 : 0);
+		}
 
-		RightANDPtn[chNum]=(0!=ch.R ? ~0 : 0);
+	case WAVE_FLOAT_PLANAR:
 
-	}
+		{
 
+			FloatPlanarOutput out;
 
+			out.left=buf.left;
 
-	unsigned int i;
+			out.right=buf.right;
 
-	for(i=0; i<numSamples && 0<nPlayingCh; ++i)
+			out.gain=buf.gain;
 
-	{
+			return MakeWaveForNSamplesOutput(out,nPlayingCh,playingCh,numSamples);
 
-		int leftOut=0,rightOut=0;
+		}
 
-		for(int j=nPlayingCh-1; 0<=j; --j)
+	}
 
-		{
+	return 0;
 
-			auto chNum=playingCh[j];
+}
 
-			auto &ch=state.channels[chNum];
 
-			if(ch.slots[0].toneDurationMicrosecS12<=ch.slots[0].microsecS12 &&
 
-			   ch.slots[1].toneDurationMicrosecS12<=ch.slots[1].microsecS12 &&
+void YM2612::ScheduleWriteRegister(unsigned long long int sample,unsigned int channelBase,unsigned int reg,unsigned int value)
 
-			   ch.slots[2].toneDurationMicrosecS12<=ch.slots[2].microsecS12 &&
+{
 
-			   ch.slots[3].toneDurationMicrosecS12<=ch.slots[3].microsecS12)
+	ScheduledWrite w;
 
-			{
+	w.sample=sample;
 
-				playingCh[j]=playingCh[nPlayingCh-1];
+	w.chBase=(unsigned char)channelBase;
 
-				--nPlayingCh;
+	w.reg=(unsigned char)reg;
 
-				break;
+	w.value=(unsigned char)value;
 
-			}
+	writeSchedule.push_back(w);
 
+}
 
 
-			int PMSAdjustment[4]=
 
-			{
+void YM2612::ScheduleWriteVoice(unsigned long long int sample,unsigned int channelBase,unsigned int chLow,const unsigned char voice[NUM_VOICE_REGS],unsigned int carrierAttenuation,EnvelopeDurations envelope[NUM_SLOTS])
 
-				0,0,0,0
+{
 
-			};
+	ScheduledWrite w;
 
-			int AMSAdjustment[4]=
+	w.sample=sample;
 
-			{
+	w.chBase=(unsigned char)channelBase;
 
-				4096,4096,4096,4096
+	w.reg=(unsigned char)chLow;
 
-			};
+	w.value=(unsigned char)carrierAttenuation;
 
+	w.voice=voice;
 
+	w.envelope=envelope;
 
-			LFOClass::CalculateLFO(AMSAdjustment,PMSAdjustment,state.FREQCTRL,ch);
+	writeSchedule.push_back(w);
 
+}
 
 
 
+static bool YM2612_ScheduledWriteIsEarlier(const YM2612::ScheduledWrite &a,const YM2612::ScheduledWrite &b)
 
-			// Why take an average of last two samples, not just the last sample, for feedback?
+{
 
-			// Cisc's FMGEN YM emulator does it.  I was wondering why.  But, it works as a damper to prevent
+	return a.sample<b.sample;
 
-			// premature divergence.
+}
 
-			// 
 
-			// When feedback is given, the output from slot 0 is calculated as:
 
-			// 
+long long int YM2612::MakeWaveForNSamplesScheduled(const WaveBuffer &buf,unsigned long long int numSamples)
 
-			//     y(i+1)=A*sin(i*dt+C*y(i))
+{
 
-			// 
+	// Writes at the same sample must stay in the order scheduled.
 
-			// A is amplitude calculated from the envelope, and C is defined by feedback level, and
+	std::stable_sort(writeSchedule.begin(),writeSchedule.end(),YM2612_ScheduledWriteIsEarlier);
 
-			// dt depends on the frequency of the tone.
 
-			// 
 
-			// Let's denote the angle given to the sine function as:
+	size_t nextWrite=0;
 
-			// 
+	unsigned long long int filled=0;
 
-			//     X(i)=i*dt+C*y(i)
+	for(;;)
 
-			// 
+	{
 
-			// When the slope of sin(X(i)) is negative (0.5PI<X(i)<1.5PI), means the value is decreasing with
+		while(nextWrite<writeSchedule.size() && writeSchedule[nextWrite].sample<=filled)
 
-			// increasing X, the function can become unstable and diverge, until the function returns to the
+		{
 
-			// positive slope.  Here's what can happen.
+			auto &w=writeSchedule[nextWrite++];
 
-			// 
+			if(nullptr!=w.voice)
 
-			// X(i) monotonicly increase if C=0, means no feedback.  However, if C is non-zero, i*dt increases, 
+			{
 
-			// but C*y(i) can increase or decrease depending on the slope of y(i).
+				WriteVoice(w.chBase,w.reg,w.voice,w.value,w.envelope);
 
-			// 
+			}
 
-			// If the one-step decrease of C*y(i) exceeds the increase of i*dt (which is dt), 
+			else
 
-			// X(i) will decrease overall, which means the input to the sine functions goes backward.
+			{
 
-			// Amplitude is positive, and if the slope of the sine function at X(i) was negative, and if 
+				WriteRegister(w.chBase,w.reg,w.value);
 
-			// the input goes backward, y suddenly increases. i.e., y(i+1) is greater than y(i).
+			}
 
-			// 
+		}
 
-			// Then in the next step, both C*y and i*dt terms increase.  This makes a large jump of X.
+		if(numSamples<=filled)
 
-			// The sine function is going down with X, as a result y dives down bigger than the last 
+		{
 
-			// increase.  Then, the next comes even bigger increase of y, followed by even bigger dive, 
+			break;
 
-			// and the function of y(i) starts oscillating every sample.
+		}
 
-			// 
 
-			// From the above, the condition that starts this divergence is:
 
-			// 
+		auto until=numSamples;
 
-			//     dt<-dY
+		if(nextWrite<writeSchedule.size())
 
-			// 
+		{
 
-			// where Y=C*y(i).  Interestingly, because of this condition, this particular mode of oscillation
+			until=std::min(until,writeSchedule[nextWrite].sample);
 
-			// only appears when dY<0.
+		}
 
-			// 
+		MakeWaveForNSamples(buf.Advance(filled),until-filled);
 
-			// While it is a legitimate divergence that adds some noise component to the tone in some settings,
+		filled=until;
 
-			// Slot 0 starts this oscillation too easily.
+	}
 
-			// 
 
-			// Cisc's FMGEN YM-chip emulator, used in XM7 and M88 emulators (and maybe other emulators as well)
 
-			// solves this problem by feeding the average of the last two samples back to slot 0.
+	writeSchedule.erase(writeSchedule.begin(),writeSchedule.begin()+nextWrite);
 
-			// 
+	for(auto &w : writeSchedule)
 
-			// During the oscillation, the value of y jumps up and down.  But, if you look at the middle of the two
+	{
 
-			// consecutive outputs, it goes through a smooth decreasing curve.
+		w.sample-=numSamples;
 
-			// 
+	}
 
-			// The cause of this divergence is from the oscillation of the feedback term, C*y.  By taking average
+	return numSamples;
 
-			// of the last two samples, it essentially damps the oscillation, and effectively prevents this divergence.
+}
 
-			//
 
-			// So the modified formulation is:
 
-			//
+YM2612::CommandQueue::CommandQueue(size_t capacity)
 
-			//     y(i+1)=A*sin(i*dt+C*(y(i)+y(i-1))/2)
+{
 
-			//
+	size_t size=1;
 
-			// Here I am explicitly writing it out, but Cisc's implementation embedded this division by two
+	while(size<capacity)
 
-			// in the anyway-required bit shift.
+	{
 
-			//
+		size<<=1;
 
-			// Very genious solution it is.
+	}
 
+	ring.resize(size);
 
+	mask=size-1;
 
-			auto s0Out=(ch.lastSlot0Out[1]+ch.lastSlot0Out[0])/2;
+	readPtr.store(0);
 
-			const uint64_t microsecS12[4]=
+	writePtr.store(0);
 
-			{
+	renderedSamples.store(0);
 
-				ch.slots[0].microsecS12,
+}
 
-				ch.slots[1].microsecS12,
 
-				ch.slots[2].microsecS12,
 
-				ch.slots[3].microsecS12,
+bool YM2612::CommandQueue::Push(unsigned long long int sample,unsigned int channelBase,unsigned int reg,unsigned int value)
 
-			};
+{
 
-			const unsigned int phaseS12[4]=
+	auto w=writePtr.load(std::memory_order_relaxed);
 
-			{
+	if(ring.size()<=w-readPtr.load(std::memory_order_acquire))
 
-				ch.slots[0].phaseS12,
+	{
 
-				ch.slots[1].phaseS12,
+		return false;
 
-				ch.slots[2].phaseS12,
+	}
 
-				ch.slots[3].phaseS12,
+	auto &cmd=ring[w&mask];
 
-			};
+	cmd.sample=sample;
 
-			auto ampl=CalculateAmplitude<LFOClass>(chNum,microsecS12,phaseS12,AMSAdjustment,s0Out);
+	cmd.chBase=(unsigned char)channelBase;
 
-			ch.lastSlot0Out[1]=ch.lastSlot0Out[0];
+	cmd.reg=(unsigned char)reg;
 
-			ch.lastSlot0Out[0]=s0Out;
+	cmd.value=(unsigned char)value;
 
+	writePtr.store(w+1,std::memory_order_release);
 
+	return true;
 
-			leftOut+=(LeftANDPtn[chNum]&ampl);
+}
 
-			rightOut+=(RightANDPtn[chNum]&ampl);
 
 
+unsigned long long int YM2612::CommandQueue::GetRenderedSamples(void) const
 
-			ch.slots[0].phaseS12+=ch.slots[0].phaseS12Step+PMSAdjustment[0];
+{
 
-			ch.slots[1].phaseS12+=ch.slots[1].phaseS12Step+PMSAdjustment[1];
+	return renderedSamples.load(std::memory_order_acquire);
 
-			ch.slots[2].phaseS12+=ch.slots[2].phaseS12Step+PMSAdjustment[2];
+}
 
-			ch.slots[3].phaseS12+=ch.slots[3].phaseS12Step+PMSAdjustment[3];
 
-			ch.slots[0].microsecS12+=microsecS12Step;
 
-			ch.slots[1].microsecS12+=microsecS12Step;
+bool YM2612::CommandQueue::Peek(Command &cmd) const
 
-			ch.slots[2].microsecS12+=microsecS12Step;
+{
 
-			ch.slots[3].microsecS12+=microsecS12Step;
+	auto r=readPtr.load(std::memory_order_relaxed);
 
-		}
+	if(r==writePtr.load(std::memory_order_acquire))
 
-		WordOp_Set(wave+i*4  ,leftOut);
+	{
 
-		WordOp_Set(wave+i*4+2,rightOut);
+		return false;
 
 	}
 
+	cmd=ring[r&mask];
 
+	return true;
 
-	std::memset(wave+i*4,0,(numSamples-i)*4);
+}
 
 
 
-// std::cout << (microsec12>>12) << "us " << std::endl;
+void YM2612::CommandQueue::Pop(void)
 
-// std::cout << phase12[0] << "," << (phase12[0]>>12)/PHASE_STEPS << "cycles" << std::endl;
+{
 
-// std::cout << phase12[1] << "," << (phase12[1]>>12)/PHASE_STEPS << "cycles" << std::endl;
+	readPtr.store(readPtr.load(std::memory_order_relaxed)+1,std::memory_order_release);
 
-// std::cout << phase12[2] << "," << (phase12[2]>>12)/PHASE_STEPS << "cycles" << std::endl;
+}
 
-// std::cout << phase12[3] << "," << (phase12[3]>>12)/PHASE_STEPS << "cycles" << std::endl;
 
 
+void YM2612::CommandQueue::AddRenderedSamples(unsigned long long int numSamples)
 
-	return i;
+{
+
+	renderedSamples.store(renderedSamples.load(std::memory_order_relaxed)+numSamples,std::memory_order_release);
 
 }
 
 
 
-long long int YM2612::MakeWaveForNSamples(unsigned char wavBuf[],unsigned long long int numSamplesRequested) const
+void YM2612::ScheduleCommands(CommandQueue &queue,unsigned long long int numSamples)
 
 {
 
-	unsigned int nPlayingCh=0;
+	const auto top=queue.GetRenderedSamples();
 
-	unsigned int playingCh[NUM_CHANNELS];
+	Command cmd;
 
-	for(unsigned int chNum=0; chNum<NUM_CHANNELS; ++chNum)
+	while(true==queue.Peek(cmd) && cmd.sample<top+numSamples)
 
 	{
 
-		if(0!=(state.playingCh&(1<<chNum)))
+		ScheduleWriteRegister(top<cmd.sample ? cmd.sample-top : 0,cmd.chBase,cmd.reg,cmd.value);
 
-		{
+		queue.Pop();
 
-			playingCh[nPlayingCh++]=chNum;
+	}
 
-		}
+}
 
-	}
 
-	return MakeWaveForNSamples(wavBuf,nPlayingCh,playingCh,numSamplesRequested);
+
+long long int YM2612::MakeWaveForNSamples(CommandQueue &queue,const WaveBuffer &buf,unsigned long long int numSamples)
+
+{
+
+	ScheduleCommands(queue,numSamples);
+
+	MakeWaveForNSamplesScheduled(buf,numSamples);
+
+	queue.AddRenderedSamples(numSamples);
+
+	return numSamples;
 
 }
 
 
 
-long long int YM2612::MakeWaveForNSamples(unsigned char wave[],unsigned int nPlayingCh,unsigned int playingCh[],unsigned long long int numSamples) const
+template <class OutputClass>
+
+long long int YM2612::MakeWaveForNSamplesOutput(OutputClass out,unsigned int nPlayingCh,unsigned int playingCh[],unsigned long long int numSamples) const
 
 {
 
@@ -5847,7 +10262,7 @@ long long int YM2612::MakeWaveForNSamples(unsigned char wave[],unsigned int nPla
 
 	{
 
-		return MakeWaveForNSamplesTemplate <WithLFO> (wave,nPlayingCh,playingCh,numSamples);
+		return MakeWaveForNSamplesTemplate <WithLFO,OutputClass> (out,nPlayingCh,playingCh,numSamples);
 
 	}
 
@@ -5855,7 +10270,7 @@ long long int YM2612::MakeWaveForNSamples(unsigned char wave[],unsigned int nPla
 
 	{
 
-		return MakeWaveForNSamplesTemplate <WithoutLFO> (wave,nPlayingCh,playingCh,numSamples);
+		return MakeWaveForNSamplesTemplate <WithoutLFO,OutputClass> (out,nPlayingCh,playingCh,numSamples);
 
 	}
 
@@ -5863,11 +10278,11 @@ long long int YM2612::MakeWaveForNSamples(unsigned char wave[],unsigned int nPla
 
 
 
-void YM2612::UpdateSlotEnvelope(const Channel &ch,Slot &slot)
+void YM2612::UpdateSlotEnvelope(const Channel &ch,Slot &slot,EnvelopeDurations *durations)
 
 {
 
-	CalculateEnvelope(slot.env,ch.KC(),slot);
+	LookUpEnvelope(slot.env,ch.KC(),slot,durations);
 
 	slot.envDurationCache=slot.env[0]+slot.env[2]+slot.env[4];
 
@@ -5953,29 +10368,55 @@ bool YM2612::CalculateEnvelope(unsigned int env[6],unsigned int KC,const Slot &s
 
 {
 
-#ifdef YM2612_DEBUGOUTPUT
+	unsigned int duration[3];
 
-	std::cout << KC << "," << slot.KS << "," << (KC>>(3-slot.KS)) << ", ";
+	if(true!=CalculateEnvelopeDuration(duration,KC,slot.KS,slot.AR,slot.DR,slot.SR,slot.SL))
 
-#endif
+	{
+
+		return NoTone(env);
 
+	}
 
+	return MakeEnvelope(env,duration,slot);
 
-	unsigned int AR=slot.AR*2+(KC>>(3-slot.KS));
+}
 
-	unsigned int DR=slot.DR*2+(KC>>(3-slot.KS));
 
-	unsigned int SR=slot.SR*2+(KC>>(3-slot.KS));
 
-	AR=std::min(AR,63U);
+bool YM2612::LookUpEnvelope(unsigned int env[6],unsigned int KC,const Slot &slot,EnvelopeDurations *durations) const
 
-	DR=std::min(DR,63U);
+{
 
-	SR=std::min(SR,63U);
+	if(nullptr==durations || durations->key!=EnvelopeKey(slot.KS,slot.AR,slot.DR,slot.SR,slot.SL))
+
+	{
+
+		return CalculateEnvelope(env,KC,slot);
 
+	}
 
 
-	if(AR<4)
+
+	const unsigned int bit=(1U<<KC);
+
+	if(0==(durations->knownKC&bit))
+
+	{
+
+		if(true!=CalculateEnvelopeDuration(durations->duration[KC],KC,slot.KS,slot.AR,slot.DR,slot.SR,slot.SL))
+
+		{
+
+			durations->noToneKC|=bit;
+
+		}
+
+		durations->knownKC|=bit;
+
+	}
+
+	if(0!=(durations->noToneKC&bit))
 
 	{
 
@@ -5983,7 +10424,15 @@ bool YM2612::CalculateEnvelope(unsigned int env[6],unsigned int KC,const Slot &s
 
 	}
 
+	return MakeEnvelope(env,durations->duration[KC],slot);
+
+}
+
+
 
+bool YM2612::MakeEnvelope(unsigned int env[6],const unsigned int duration[3],const Slot &slot) const
+
+{
 
 	auto TLdB100=TLtoDB100[slot.TL];
 
@@ -6005,23 +10454,85 @@ bool YM2612::CalculateEnvelope(unsigned int env[6],unsigned int KC,const Slot &s
 
 
 
+	// Ealier I was linearly interpolating the amplitude, but maybe it is linear in dB scale.
+
+	env[0]=duration[0];
+
+	env[1]=TLinv;
+
+	env[2]=duration[1];
+
+	env[3]=(SLdB100<TLinv ? TLinv-SLdB100 : 0);
+
+	env[4]=duration[2];
+
+	env[5]=0;
+
+
+
 #ifdef YM2612_DEBUGOUTPUT
 
-	std::cout << "AR=" << AR << " DR=" << DR << " SR=" << SR << " TL=" << slot.TL  << " SL=" << slot.SL ;
+	std::cout << "TL=" << slot.TL  << " SL=" << slot.SL << " ";
+
+	for(int i=0; i<6; ++i){std::cout << env[i] << ",";}
+
+	std::cout << std::endl;
+
+#endif
+
+
+
+	return true;
+
+}
+
+
+
+bool YM2612::CalculateEnvelopeDuration(unsigned int duration[3],unsigned int KC,unsigned int KS,unsigned int AR,unsigned int DR,unsigned int SR,unsigned int SL) const
+
+{
+
+#ifdef YM2612_DEBUGOUTPUT
 
-	std::cout << " ";
+	std::cout << KC << "," << KS << "," << (KC>>(3-KS)) << ", ";
 
 #endif
 
 
 
-	// Ealier I was linearly interpolating the amplitude, but maybe it is linear in dB scale.
+	AR=AR*2+(KC>>(3-KS));
 
-	env[1]=TLinv;
+	DR=DR*2+(KC>>(3-KS));
 
-	env[3]=(SLdB100<TLinv ? TLinv-SLdB100 : 0);
+	SR=SR*2+(KC>>(3-KS));
 
-	env[5]=0;
+	AR=std::min(AR,63U);
+
+	DR=std::min(DR,63U);
+
+	SR=std::min(SR,63U);
+
+
+
+	if(AR<4)
+
+	{
+
+		return false;
+
+	}
+
+
+
+	auto SLdB100=SLtoDB100[SL];
+
+
+
+#ifdef YM2612_DEBUGOUTPUT
+
+	std::cout << "AR=" << AR << " DR=" << DR << " SR=" << SR << " ";
+
+#endif
 
 
 
@@ -6041,7 +10552,7 @@ bool YM2612::CalculateEnvelope(unsigned int env[6],unsigned int KC,const Slot &s
 
 	unsigned long long int mul;
 
-	env[0]=(attackTime0to96dB[AR]*10)>>10;  // *10 to make it microsed, and then divide by 1024.
+	duration[0]=(attackTime0to96dB[AR]*10)>>10;  // *10 to make it microsed, and then divide by 1024.
 
 	mul=SLdB100;
 
@@ -6049,7 +10560,7 @@ bool YM2612::CalculateEnvelope(unsigned int env[6],unsigned int KC,const Slot &s
 
 	mul/=(9600*1024/10);
 
-	env[2]=(unsigned int)mul;
+	duration[1]=(unsigned int)mul;
 
 	mul=9600-SLdB100;
 
@@ -6057,7 +10568,7 @@ bool YM2612::CalculateEnvelope(unsigned int env[6],unsigned int KC,const Slot &s
 
 	mul/=(9600*1024/10);
 
-	env[4]=(unsigned int)mul;
+	duration[2]=(unsigned int)mul;
 
 
 
@@ -6129,17 +10640,33 @@ bool YM2612::CalculateEnvelope(unsigned int env[6],unsigned int KC,const Slot &s
 
 
 
-#ifdef YM2612_DEBUGOUTPUT
+	return true;
 
-	for(int i=0; i<6; ++i){std::cout << env[i] << ",";}
+}
 
-	std::cout << std::endl;
 
-#endif
 
 
 
-	return true;
+/* static */ unsigned int YM2612::EnvelopeKey(unsigned int KS,unsigned int AR,unsigned int DR,unsigned int SR,unsigned int SL)
+
+{
+
+	return (KS<<19)|(AR<<14)|(DR<<9)|(SR<<4)|SL;
+
+}
+
+
+
+void YM2612::EnvelopeDurations::Clear(void)
+
+{
+
+	key=~0U;
+
+	knownKC=0;
+
+	noToneKC=0;
 
 }
 
@@ -3,10 +3,13 @@
 /* { */
 
 #include <chrono>
+#include <list>
 #include <string>
 #include <vector>
+#include <unordered_map>
 #include <cstdint>
 #include "ym2612.h"
+#include "audioresampler.h"
 
 #ifdef INFINITE
 #undef INFINITE
@@ -76,6 +79,8 @@ public:
 
 		OUTPUT_CHANNELS=2,
 		OUTPUT_BYTES_PER_SAMPLE=2,
+		RESAMPLE_BLOCK_SAMPLES=4096,
+		SEEK_BLOCK_SAMPLES=4096,
 		MILLI=1000,
 		MICRO=1000000,
 		INFINITE=~0,
@@ -110,6 +115,17 @@ public:
 
 		void Clear(void);
 	};
+
+	/*! Instrument compiled at LoadFMB.  A program change copies the register values to the channel by
+	    YM2612::WriteVoice, which attenuates TL of the carrier slots by the volume.
+	*/
+	class CompiledInst
+	{
+	public:
+		unsigned char value[YM2612::NUM_VOICE_REGS];  // In the order of YM2612::voiceRegs.
+		// Envelope durations of the slots, filled as the notes are played.  Allocated at the first program change.
+		std::vector <YM2612::EnvelopeDurations> envelope;
+	};
 	class MMLError
 	{
 	public:
@@ -121,18 +137,79 @@ public:
 		std::vector <std::string> Format(void) const;
 	};
 
+	enum
+	{
+		EVENT_WRITE_REGISTER,
+		EVENT_KEY_ON,         // Register write that is skipped while the channel is muted.
+		EVENT_PROGRAM_CHANGE, // reg=instrument number, value=volume.  Registers are taken from the FMB when played.
+	};
+
+	/*! One step of the compiled MML.
+	*/
+	class Event
+	{
+	public:
+		uint64_t timeInMicrosec;  // From the beginning of the compiled MML.
+		unsigned char type;
+		unsigned char chBase,reg,value;
+	};
+
+	/*! State of the MML compiler.  It is taken over from one MML to the next MML of the same channel.
+	*/
+	class MMLState
+	{
+	public:
+		unsigned int tempo=TEMPO_DEFAULT;
+		unsigned int octave=OCTAVE_DEFAULT;
+		unsigned int noteLength=NOTE_LENGTH_DEFAULT;
+		unsigned int volume=VOLUME_DEFAULT;
+		unsigned int keyOnTimeFraction=KEYON_TIME_FRACTION_DEFAULT;
+		unsigned int instNum=0;
+	};
+
+	/*! MML of one channel compiled into a time-ordered event stream.
+	*/
+	class CompiledMML
+	{
+	public:
+		std::vector <Event> events;
+		uint64_t lengthInMicrosec=0;
+
+		void Clear(void);
+		void Add(uint64_t timeInMicrosec,unsigned char type,unsigned char chBase,unsigned char reg,unsigned char value);
+	};
+
+	/*! Synth and sequencer state at a sample.  Restoring it makes the same wave as when it was taken,
+	    as long as the MML, FMB, mute flags, and sampling rate are the same.
+	*/
+	class Snapshot
+	{
+	public:
+		YM2612::State synthState;
+		uint64_t timeInMicrosec=0;
+		uint64_t timeBaseInMicrosec=0,samplesFromTimeBase=0;
+		unsigned int eventPos[NUM_CHANNELS];
+	};
+
 private:
 	YM2612 ym2612;
 	std::string fmbName;
+	uint64_t fmbHash=0;  // FNV-1a of the loaded FMB.
 	FMInst inst[128];
+	CompiledInst compiledInst[128];
 	bool mute[NUM_CHANNELS];
 
+	unsigned int outputSamplingRate=YM2612::WAVE_SAMPLING_RATE;
+	AudioResampler resampler;               // Used if YM2612 runs at a different rate from the output.
+	std::vector <unsigned char> synthBuf;   // YM2612 output before resampling.
+	std::vector <float> synthBufFloat;
+	float floatHeadroomInDB=0.0f;
+	float floatGain=1.0f/32768.0f;
+
 	class PlayPointer
 	{
 	public:
-		int pos=0;
-		uint64_t keyOffAtInMicrosec=INFINITE;
-		uint64_t toneEndAtInMicrosec=INFINITE;
+		unsigned int pos=0;  // Next event in Channel::compiled.
 
 		void Clear(void);
 	};
@@ -140,20 +217,23 @@ private:
 	{
 	public:
 		PlayPointer ptr;
-		unsigned int tempo=TEMPO_DEFAULT;
-		unsigned int octave=OCTAVE_DEFAULT;
-		unsigned int noteLength=NOTE_LENGTH_DEFAULT;
-		unsigned int volume=VOLUME_DEFAULT;
-		unsigned int keyOnTimeFraction=KEYON_TIME_FRACTION_DEFAULT;
-		unsigned int instNum=0;
-		std::string mml;
+		MMLState mmlState;  // At the end of the compiled MML.
+		CompiledMML compiled;
 
 		void Clear(void);
-		bool PlayDone(void) const;
+		bool PlayDone(uint64_t timeInMicrosec) const;
 	};
 	uint64_t timeInMicrosec=0;
+	uint64_t timeBaseInMicrosec=0;  // Time of sample 0.  Moved when the sampling rate changes.
+	uint64_t samplesFromTimeBase=0;
+	bool scheduleWrites=false;      // If true, register writes are scheduled at scheduleSample of the wave being made.
+	uint64_t scheduleSample=0;
+	YM2612::CommandQueue *commandQueue=nullptr;
 	Channel channels[NUM_CHANNELS];
 
+	uint64_t keyframeIntervalInMicrosec=0;
+	std::vector <Snapshot> keyframes;  // In the order of time.
+
 protected:
 	MMLError lastError;
 
@@ -176,20 +256,133 @@ public:
 	void ClearMML(void);
 
 	/*! AddMML to the channel.
+	    MML is compiled into an event stream here.  If the MML has an error, it returns false,
+	    the channel is left unchanged, and the error can be retrieved by GetLastError.
 	*/
 	bool AddMML(unsigned int ch,std::string mml);
 
+	/*! Compiles MML of channel ch starting from the given compiler state.
+	    The state is updated only if the MML has no error.
+	    Event time is measured from the beginning of this MML.
+	*/
+	bool CompileMML(CompiledMML &compiled,MMLState &state,unsigned int ch,const std::string &mml);
+
+	/*! Returns the compiler state at the end of the MML added to the channel so far.
+	*/
+	MMLState GetMMLState(unsigned int ch) const;
+
+	/*! Sets the compiler state that the next MML added to the channel starts from.
+	*/
+	void SetMMLState(unsigned int ch,const MMLState &state);
+
+	/*! Appends compiled MML to the channel.
+	*/
+	bool AddCompiledMML(unsigned int ch,const CompiledMML &compiled);
+
+	/*! Discards MML left in the channel and keys off the channel.
+	    MML added to the channel next starts immediately.
+	*/
+	void ClearChannel(unsigned int ch);
+
 	/*!
 	*/
 	std::vector <unsigned char> GenerateWave(uint64_t timeInMillisec);
 
+	/*! Makes 16-bit stereo wave of numSamples samples in wave[], which must be at least 4*numSamples bytes long.
+	    If stopWhenPlayDone is true, it stops when all channels are done, and otherwise it keeps generating
+	    the remaining tone and silence till the end of the buffer.
+	    Returns the number of samples generated.
+	*/
+	uint64_t MakeWaveForNSamples(unsigned char wave[],uint64_t numSamples,bool stopWhenPlayDone);
+
+	/*! Float version of MakeWaveForNSamples.  If right is nullptr, left[] receives interleaved L,R and must be
+	    at least 2*numSamples long.  Otherwise left[] and right[] receive planar samples.
+	    Output is not clipped.  Full scale of the 16-bit output is 1.0 attenuated by the headroom.
+	*/
+	uint64_t MakeWaveForNSamplesFloat(float left[],float right[],uint64_t numSamples,bool stopWhenPlayDone);
+
+	/*! Sets the headroom of the float output in dB.  Default is 0dB, which makes the same level as the 16-bit output.
+	*/
+	void SetFloatHeadroom(float headroomInDB);
+	float GetFloatHeadroom(void) const;
+
+	/*! Sets the sampling rate of the wave made by GenerateWave and MakeWaveForNSamples.
+	    If synthesisRate is zero or the same as outputRate, YM2612 directly makes the wave at outputRate.
+	    Otherwise, YM2612 runs at synthesisRate, such as YM2612::NATIVE_SAMPLING_RATE, and the wave is
+	    resampled to outputRate by a polyphase filter.  Resampling delays the synthesis by a fraction of
+	    a millisecond, and when the MML ends, the wave after the end of the MML is cut.
+	*/
+	void SetSamplingRate(unsigned int outputRate,unsigned int synthesisRate=0);
+	unsigned int GetOutputSamplingRate(void) const;
+	unsigned int GetSynthesisSamplingRate(void) const;
+	bool IsResampling(void) const;
+
 	/*!
 	*/
 	bool PlayDone(void) const;
+
+	/*! Returns the synth and sequencer state at the current position.
+	*/
+	Snapshot GetSnapshot(void) const;
+
+	/*! Goes back or forward to the position where the snapshot was taken.
+	    Input kept in the resampler is discarded.
+	*/
+	void RestoreSnapshot(const Snapshot &snapshot);
+
+	/*! If intervalInMillisec is not zero, a snapshot (keyframe) is taken every intervalInMillisec
+	    while making the wave, so that Seek does not need to synthesize from the beginning.
+	    Keyframes are dropped when the MML, FMB, mute flags, or sampling rate is changed.
+	    Default is zero (no keyframes).
+	*/
+	void SetKeyframeInterval(uint64_t intervalInMillisec);
+	uint64_t GetKeyframeInterval(void) const;
+	size_t GetNumKeyframes(void) const;
+	void ClearKeyframes(void);
+
+	/*! Moves the play position to the time.  The last keyframe at or before the time is restored,
+	    and the wave from there to the time is synthesized and discarded.  Therefore, seeking takes
+	    at most one keyframe interval of synthesis.  If there is no keyframe, it can only go forward.
+	    Returns false if it cannot go to the time.
+	*/
+	bool Seek(uint64_t timeInMicrosec);
+
+	/*! Register writes pushed to the queue by another thread, such as the game logic, are made at their
+	    samples while the player makes the wave, together with the MML.  Samples of the commands are
+	    counted at the synthesis sampling rate, as queue->GetRenderedSamples.  The writes are not muted.
+	    The player does not take the ownership.  nullptr stops taking the commands.
+	    While a queue is set, the player must be used only by the thread making the wave, and
+	    MMLSegmentPlayer does not use the wave cache.
+	*/
+	void SetCommandQueue(YM2612::CommandQueue *queue);
+	YM2612::CommandQueue *GetCommandQueue(void) const;
 protected:
-	bool InterpretMML(int chNum);
-	void ReapplyEnvelope(int chNum);
-	int GetNumber(int chNum);
+	/*! Makes the wave at the synthesis sampling rate.
+	*/
+	uint64_t SynthesizeForNSamples(const YM2612::WaveBuffer &wave,uint64_t numSamples,bool stopWhenPlayDone);
+
+	/*! Returns the first sample at or after the time, counted from timeBaseInMicrosec.
+	*/
+	uint64_t MicrosecToSample(uint64_t timeInMicrosec) const;
+
+	void WriteRegister(unsigned int chBase,unsigned int reg,unsigned int value);
+
+	bool CompileError(int chNum,int errorCode,int pos,const std::string &mml);
+	void ApplyEvent(int chNum,const Event &evt);
+	void ReapplyEnvelope(int chNum,unsigned int instNum,unsigned int volume);
+	void CompileInst(CompiledInst &compiled,const FMInst &ist);
+	static int GetNumber(const std::string &mml,unsigned int &pos);
+
+	/*! Returns a byte string that is identical if the player makes the same wave from the same compiled MML.
+	    It covers the FMB, mute flags, and the state of the YM2612.
+	*/
+	std::string GetSynthStateKey(void) const;
+	/*! Returns the part of GetSynthStateKey that is not changed by playing MML, including the sampling rates.
+	*/
+	std::string GetPlaybackSettingKey(void) const;
+	const YM2612::State &GetSynthState(void) const;
+	void SetSynthState(const YM2612::State &state);
+
 	void OctaveNoteToBlockFnum(unsigned int &blk,unsigned int &fnum,int octave,int note,int sharpOrFlat) const;
 
 public:
@@ -225,6 +418,16 @@ public:
 	{
 	public:
 		std::string mml[MMLPlayer::NUM_CHANNELS];
+		CompiledMML compiled[MMLPlayer::NUM_CHANNELS];
+		MMLState startState[MMLPlayer::NUM_CHANNELS];  // Compiler state at the beginning of the segment.
+		bool started=false;
+		Snapshot startSnapshot;  // Player state when the segment started last time.
+	};
+
+	enum
+	{
+		WAVE_CACHE_BUDGET_DEFAULT=16*1024*1024,  // Bytes.  About 95 seconds of 44.1KHz stereo.
+		SEEK_STEP_MILLISEC=1000,
 	};
 
 
@@ -233,11 +436,44 @@ private:
 	unsigned int playingSegment=0;
 	std::vector <Segment> mmlSegments;
 
+	/*! Rendered wave of one segment.  Valid if the segment starts from the same synth state.
+	*/
+	class CachedWave
+	{
+	public:
+		std::string key;
+		std::vector <unsigned char> wave;
+		YM2612::State endState;  // Synth state at the end of the segment.
+
+		size_t GetSize(void) const;
+	};
+	// Front is the most-recently used.
+	std::list <CachedWave> waveCache;
+	std::unordered_map <std::string,std::list <CachedWave>::iterator> waveCacheIndex;
+	size_t waveCacheBudget=WAVE_CACHE_BUDGET_DEFAULT;
+	size_t waveCacheUsed=0;
+
+	// Segment currently played from the cache, or rendered and recorded to the cache.
+	// The segment being replayed is never dropped from the cache, therefore replayPtr stays valid.
+	bool replaying=false;
+	std::list <CachedWave>::iterator replayPtr;
+	size_t replayPos=0;
+	bool recording=false;
+	CachedWave recordingWave;
+	std::string recordingSetting;  // To detect FMB or mute change while recording.
+
+	std::string MakeWaveCacheKey(unsigned int segNum) const;
+	void StartSegment(unsigned int segNum);
+	void EndSegment(void);
+	void AddToWaveCache(CachedWave &cached);
+	void ShrinkWaveCache(size_t budget);
+
 
 public:
-	/*!
+	/*! Compiles and adds a segment.
+	    Returns false and does not add the segment if one of the channels has an error.
 	*/
-	void AddSegment(
+	bool AddSegment(
 		std::string ch0,
 		std::string ch1="",
 		std::string ch2="",
@@ -277,13 +513,44 @@ public:
 
 
 
-	/*! Not implemented yet.  Just for placeholder.
+	/*! If repeat is true, the first segment starts right after the last segment, and PlayDone never
+	    becomes true.  Tones still sounding at the end of the last segment continue into the first segment.
 	*/
 	void SetRepeat(bool repeat);
 
-	/*! Not implemented yet.  Just for placeholder.
+	/*!
 	*/
 	bool GetRepeat(void) const;
+
+
+
+	/*! Goes to the beginning of the segment.
+	    The player state is restored from when the segment started last time.  If the segment has
+	    never started, segments before it are synthesized and discarded first.
+	    Returns false if segNum is out of range or the segment cannot be reached.
+	*/
+	bool SeekSegment(unsigned int segNum);
+
+
+
+	/*! Sets the memory budget in bytes of the rendered-segment cache.
+	    Once a segment is rendered, it is replayed from the cache if the same segment starts
+	    from the same synth state with the same FMB.  Least-recently used segments are
+	    dropped when the cache exceeds the budget.  Zero disables the cache.
+	*/
+	void SetWaveCacheBudget(size_t bytes);
+
+	/*!
+	*/
+	size_t GetWaveCacheBudget(void) const;
+
+	/*! Returns bytes used by the rendered-segment cache.
+	*/
+	size_t GetWaveCacheUsage(void) const;
+
+	/*! Drops all rendered segments.
+	*/
+	void ClearWaveCache(void);
 };
 
 
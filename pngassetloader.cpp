@@ -0,0 +1,259 @@
+#include <stdio.h>
+#include <chrono>
+#include "pngassetloader.h"
+#include "yspng.h"
+
+
+
+static uint64_t PngAssetLoader_NowInMicrosec(void)
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static double PngAssetLoader_MBPerSec(uint64_t numBytes,uint64_t microsec)
+{
+	if(0==microsec)
+	{
+		return 0.0;
+	}
+	return (double)numBytes/(double)microsec;  // Bytes per microsecond is MB per second.
+}
+
+bool PngAssetLoader::Image::IsLoaded(void) const
+{
+	return nullptr!=rgba;
+}
+
+double PngAssetLoader::Image::GetFileMBPerSec(void) const
+{
+	return PngAssetLoader_MBPerSec(fileSize,decodeMicrosec);
+}
+
+double PngAssetLoader::Image::GetImageMBPerSec(void) const
+{
+	return PngAssetLoader_MBPerSec((uint64_t)wid*hei*4,decodeMicrosec);
+}
+
+PngAssetLoader::PngAssetLoader(unsigned int numThreads)
+{
+	if(0==numThreads)
+	{
+		numThreads=std::thread::hardware_concurrency();
+		if(0==numThreads)
+		{
+			numThreads=1;
+		}
+	}
+	for(unsigned int i=0; i<numThreads; ++i)
+	{
+		workers.push_back(std::unique_ptr <Worker>(new Worker));
+	}
+	for(unsigned int i=0; i<numThreads; ++i)
+	{
+		workers[i]->thread=std::thread(&PngAssetLoader::WorkerThread,this,i);
+	}
+}
+
+PngAssetLoader::~PngAssetLoader()
+{
+	{
+		std::lock_guard <std::mutex> lock(batchLock);
+		terminate=true;
+	}
+	batchReady.notify_all();
+	for(auto &w : workers)
+	{
+		w->thread.join();
+	}
+}
+
+unsigned int PngAssetLoader::GetNumThreads(void) const
+{
+	return (unsigned int)workers.size();
+}
+
+void PngAssetLoader::Load(std::vector <Image> &images,const std::vector <std::string> &fn)
+{
+	const uint64_t t0=PngAssetLoader_NowInMicrosec();
+
+	images.clear();
+	images.resize(fn.size());
+	for(size_t i=0; i<fn.size(); ++i)
+	{
+		images[i].fn=fn[i];
+	}
+
+	// Deal the files in turns.  Threads start with the files given to them last, and steal the first ones.
+	for(size_t i=0; i<fn.size(); ++i)
+	{
+		Worker &w=*workers[i%workers.size()];
+		std::lock_guard <std::mutex> lock(w.queueLock);
+		w.queue.push_back(i);
+	}
+
+	{
+		std::unique_lock <std::mutex> lock(batchLock);
+		batchImages=&images;
+		numBusy=(unsigned int)workers.size();
+		++batchSerial;
+		batchReady.notify_all();
+		while(0<numBusy)
+		{
+			batchDone.wait(lock);
+		}
+		batchImages=nullptr;
+	}
+
+	batchMicrosec=PngAssetLoader_NowInMicrosec()-t0;
+}
+
+void PngAssetLoader::SetVerifyChecksum(bool verify)
+{
+	verifyChecksum=verify;
+}
+
+uint64_t PngAssetLoader::GetLastLoadMicrosec(void) const
+{
+	return batchMicrosec;
+}
+
+void PngAssetLoader::WorkerThread(unsigned int threadIdx)
+{
+	YsRawPngDecoder decoder;
+	uint64_t doneSerial=0;
+	for(;;)
+	{
+		std::vector <Image> *images;
+		{
+			std::unique_lock <std::mutex> lock(batchLock);
+			while(true!=terminate && doneSerial==batchSerial)
+			{
+				batchReady.wait(lock);
+			}
+			if(true==terminate)
+			{
+				return;
+			}
+			doneSerial=batchSerial;
+			images=batchImages;
+		}
+
+		// No file is added during a batch.  Once no queue has a file, this thread is done with the batch.
+		size_t fileIdx;
+		while(true==TakeFile(fileIdx,threadIdx))
+		{
+			Image &img=(*images)[fileIdx];
+			img.threadIdx=threadIdx;
+			DecodeFile(img,decoder,verifyChecksum);
+		}
+		// The queues are drained.  Return the scratch memory of the largest image until the next batch.
+		decoder.arena.Release();
+
+		{
+			std::lock_guard <std::mutex> lock(batchLock);
+			--numBusy;
+			if(0==numBusy)
+			{
+				batchDone.notify_all();
+			}
+		}
+	}
+}
+
+bool PngAssetLoader::TakeFile(size_t &fileIdx,unsigned int threadIdx)
+{
+	{
+		Worker &own=*workers[threadIdx];
+		std::lock_guard <std::mutex> lock(own.queueLock);
+		if(true!=own.queue.empty())
+		{
+			fileIdx=own.queue.back();
+			own.queue.pop_back();
+			return true;
+		}
+	}
+	for(size_t i=1; i<workers.size(); ++i)
+	{
+		Worker &victim=*workers[(threadIdx+i)%workers.size()];
+		std::lock_guard <std::mutex> lock(victim.queueLock);
+		if(true!=victim.queue.empty())
+		{
+			fileIdx=victim.queue.front();
+			victim.queue.pop_front();
+			return true;
+		}
+	}
+	return false;
+}
+
+/* static */ void PngAssetLoader::DecodeFile(Image &img,YsRawPngDecoder &decoder,bool verifyChecksum)
+{
+	const uint64_t t0=PngAssetLoader_NowInMicrosec();
+
+	FILE *fp=fopen(img.fn.c_str(),"rb");
+	if(nullptr!=fp)
+	{
+		fseek(fp,0,SEEK_END);
+		img.fileSize=(size_t)ftell(fp);
+		fclose(fp);
+	}
+
+	decoder.verifyChecksum=(true==verifyChecksum ? YSTRUE : YSFALSE);
+	if(YSOK==decoder.Decode(img.fn.c_str()) && nullptr!=decoder.rgba && 0<decoder.wid && 0<decoder.hei)
+	{
+		// Take the buffer.
+		img.wid=decoder.wid;
+		img.hei=decoder.hei;
+		img.rgba.reset(decoder.rgba);
+		decoder.rgba=nullptr;
+		decoder.wid=0;
+		decoder.hei=0;
+	}
+
+	img.decodeMicrosec=PngAssetLoader_NowInMicrosec()-t0;
+}
+
+/* static */ std::string PngAssetLoader::FormatReport(const std::vector <Image> &images,uint64_t wallMicrosec,unsigned int numThreads)
+{
+	std::string report;
+	char line[512];
+	for(auto &img : images)
+	{
+		if(true==img.IsLoaded())
+		{
+			snprintf(line,sizeof(line),"%s %ux%u %zu bytes %.2lfms %.1lfMB/s (RGBA %.1lfMB/s) thread %u\n",
+			    img.fn.c_str(),img.wid,img.hei,img.fileSize,(double)img.decodeMicrosec/1000.0,
+			    img.GetFileMBPerSec(),img.GetImageMBPerSec(),img.threadIdx);
+		}
+		else
+		{
+			snprintf(line,sizeof(line),"%s failed\n",img.fn.c_str());
+		}
+		report+=line;
+	}
+	report+=FormatSummary(images,wallMicrosec,numThreads);
+	return report;
+}
+
+/* static */ std::string PngAssetLoader::FormatSummary(const std::vector <Image> &images,uint64_t wallMicrosec,unsigned int numThreads)
+{
+	uint64_t totalFile=0,totalImage=0,totalDecode=0;
+	unsigned int numFailed=0;
+	for(auto &img : images)
+	{
+		if(true!=img.IsLoaded())
+		{
+			++numFailed;
+		}
+		totalFile+=img.fileSize;
+		totalImage+=(uint64_t)img.wid*img.hei*4;
+		totalDecode+=img.decodeMicrosec;
+	}
+
+	char line[512];
+	snprintf(line,sizeof(line),"Total %zu files (%u failed) %.2lfMB in %.2lfms on %u threads  %.1lfMB/s (RGBA %.1lfMB/s)  Sum of decode time %.2lfms\n",
+	    images.size(),numFailed,(double)totalFile/1000000.0,(double)wallMicrosec/1000.0,numThreads,
+	    PngAssetLoader_MBPerSec(totalFile,wallMicrosec),PngAssetLoader_MBPerSec(totalImage,wallMicrosec),
+	    (double)totalDecode/1000.0);
+	return line;
+}
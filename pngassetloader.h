@@ -0,0 +1,115 @@
+#ifndef PNGASSETLOADER_IS_INCLUDED
+#define PNGASSETLOADER_IS_INCLUDED
+/* { */
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+class YsRawPngDecoder;
+
+/*! Decodes a batch of PNG files on a pool of threads.
+    Each thread has a YsRawPngDecoder, and uses it for all of its files, so that the scratch memory of the decoder
+    is allocated once per batch rather than for every file.  The memory is returned when the thread runs out of files.
+    Files are dealt to the per-thread queues in turns.
+    A thread takes files from the back of its own queue, and when the queue is empty, steals from the
+    front of the other queues, so that a few large files do not leave the other threads idle.
+
+    The threads are made on construction and wait between batches.
+*/
+class PngAssetLoader
+{
+public:
+	/*! Decoded image.  rgba is wid*hei*4 bytes, or nullptr if the file could not be decoded.
+	*/
+	class Image
+	{
+	public:
+		std::string fn;
+		unsigned int wid=0,hei=0;
+		std::unique_ptr <unsigned char []> rgba;
+
+		size_t fileSize=0;
+		uint64_t decodeMicrosec=0;  // Including reading the file.
+		unsigned int threadIdx=0;   // Thread that decoded the file.
+
+		bool IsLoaded(void) const;
+
+		/*! Megabytes of the file per second.
+		*/
+		double GetFileMBPerSec(void) const;
+
+		/*! Megabytes of RGBA per second.
+		*/
+		double GetImageMBPerSec(void) const;
+	};
+
+private:
+	class Worker
+	{
+	public:
+		std::mutex queueLock;
+		std::deque <size_t> queue;
+		std::thread thread;
+	};
+
+	std::vector <std::unique_ptr <Worker> > workers;
+
+	std::mutex batchLock;
+	std::condition_variable batchReady,batchDone;
+	uint64_t batchSerial=0;
+	unsigned int numBusy=0;
+	bool terminate=false;
+
+	std::vector <Image> *batchImages=nullptr;
+	uint64_t batchMicrosec=0;
+	bool verifyChecksum=true;
+
+	PngAssetLoader(const PngAssetLoader &);
+	PngAssetLoader &operator=(const PngAssetLoader &);
+
+public:
+	/*! numThreads=0 uses one thread per hardware thread.
+	*/
+	explicit PngAssetLoader(unsigned int numThreads=0);
+	~PngAssetLoader();
+
+	unsigned int GetNumThreads(void) const;
+
+	/*! If false, CRC and Adler-32 of the files are not checked.  For trusted assets.  Default is true.
+	    Must not be changed during Load.
+	*/
+	void SetVerifyChecksum(bool verify);
+
+	/*! Decodes the files, and returns when all of them are done.  images are in the same order as fn.
+	    Must not be called from more than one thread at the same time.
+	*/
+	void Load(std::vector <Image> &images,const std::vector <std::string> &fn);
+
+	/*! Wall-clock time of the last Load.
+	*/
+	uint64_t GetLastLoadMicrosec(void) const;
+
+	/*! One line per file (file name, size, time, MB/s, thread), and FormatSummary at the end.
+	*/
+	static std::string FormatReport(const std::vector <Image> &images,uint64_t wallMicrosec,unsigned int numThreads);
+
+	/*! One line of the total size, wall-clock time, and aggregate MB/s.
+	*/
+	static std::string FormatSummary(const std::vector <Image> &images,uint64_t wallMicrosec,unsigned int numThreads);
+
+private:
+	void WorkerThread(unsigned int threadIdx);
+	bool TakeFile(size_t &fileIdx,unsigned int threadIdx);
+	static void DecodeFile(Image &img,YsRawPngDecoder &decoder,bool verifyChecksum);
+};
+
+/* } */
+#endif
@@ -0,0 +1,45 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include "pngassetloader.h"
+
+/*
+PNG batch loading benchmark.
+
+  pngloadbench numThreads file1.png [file2.png ...]
+
+Decodes the files with PngAssetLoader on numThreads threads (0 for one per hardware thread),
+and then on one thread for comparison.  Time and MB/s of each file and the total are printed.
+*/
+
+int main(int ac,char *av[])
+{
+	if(ac<3)
+	{
+		printf("Usage: pngloadbench numThreads file1.png [file2.png ...]\n");
+		return 1;
+	}
+
+	unsigned int numThreads=atoi(av[1]);
+	std::vector <std::string> fn;
+	for(int i=2; i<ac; ++i)
+	{
+		fn.push_back(av[i]);
+	}
+
+	std::vector <PngAssetLoader::Image> images;
+
+	PngAssetLoader loader(numThreads);
+	loader.Load(images,fn);
+	printf("%s",PngAssetLoader::FormatReport(images,loader.GetLastLoadMicrosec(),loader.GetNumThreads()).c_str());
+
+	if(1<loader.GetNumThreads())
+	{
+		PngAssetLoader single(1);
+		single.Load(images,fn);
+		printf("%s",PngAssetLoader::FormatSummary(images,single.GetLastLoadMicrosec(),1).c_str());
+		printf("Speed up %.2lfx\n",(double)single.GetLastLoadMicrosec()/(double)loader.GetLastLoadMicrosec());
+	}
+	return 0;
+}
@@ -0,0 +1,219 @@
+#include <algorithm>
+#include "sfxplayer.h"
+
+
+
+SFXPlayer::SFXPlayer()
+{
+	// Instrument numbers are of the default FMB.
+	SetEffect(SFX_HIT,          "T240@14V13O4L32C<C",0);
+	SetEffect(SFX_POWER_UP,     "T240@17V12O5L64CEG>CEG>C",3);
+	SetEffect(SFX_WALL_ADD,     "T200@3V12O5L32CE",2);
+	SetEffect(SFX_WALL_SUBTRACT,"T200@3V12O5L32E<A",2);
+	SetEffect(SFX_WALL_MULTIPLY,"T200@3V12O5L32C>C",2);
+	SetEffect(SFX_WALL_DIVIDE,  "T200@3V12O5L32C<C",2);
+	Clear();
+}
+
+void SFXPlayer::Clear(void)
+{
+	ClearMML();
+	for(auto &p : pending)
+	{
+		p=0;
+	}
+	for(unsigned int i=0; i<MAX_VOICES; ++i)
+	{
+		if(0<=voices[i].sfx)
+		{
+			ClearChannel(i);
+		}
+		voices[i]=Voice();
+	}
+	numStolen=0;
+	numDropped=0;
+}
+
+bool SFXPlayer::SetEffect(int sfx,const std::string &mml,int priority)
+{
+	if(sfx<0 || NUM_SFX<=sfx)
+	{
+		return false;
+	}
+
+	Effect effect;
+	effect.mml=mml;
+	effect.priority=priority;
+	for(unsigned int chNum=0; chNum<NUM_CHANNELS; ++chNum)
+	{
+		MMLState state;
+		if(true!=CompileMML(effect.compiled[chNum],state,chNum,mml))
+		{
+			return false;
+		}
+	}
+	effects[sfx]=effect;
+	return true;
+}
+
+void SFXPlayer::SetVoiceBudget(unsigned int numVoices)
+{
+	numVoices=std::max<unsigned int>(1,std::min<unsigned int>(MAX_VOICES,numVoices));
+	for(unsigned int i=numVoices; i<voiceBudget; ++i)
+	{
+		if(0<=voices[i].sfx)
+		{
+			ClearChannel(i);
+		}
+		voices[i]=Voice();
+	}
+	voiceBudget=numVoices;
+}
+
+unsigned int SFXPlayer::GetVoiceBudget(void) const
+{
+	return voiceBudget;
+}
+
+void SFXPlayer::Play(int sfx)
+{
+	if(0<=sfx && sfx<NUM_SFX)
+	{
+		++pending[sfx];
+	}
+}
+
+std::vector <unsigned char> SFXPlayer::GenerateWave(uint64_t timeInMillisec)
+{
+	const uint64_t numSamples=GetOutputSamplingRate()*timeInMillisec/MILLI;
+	std::vector <unsigned char> wave;
+	wave.resize(4*numSamples);
+	MakeWaveForNSamples(wave.data(),numSamples);
+	return wave;
+}
+
+uint64_t SFXPlayer::MakeWaveForNSamples(unsigned char wave[],uint64_t numSamples)
+{
+	return MakeWaveForNSamples(wave,numSamples,false);
+}
+
+uint64_t SFXPlayer::MakeWaveForNSamples(unsigned char wave[],uint64_t numSamples,bool stopWhenPlayDone)
+{
+	StartPendingEffects();
+	return MMLPlayer::MakeWaveForNSamples(wave,numSamples,stopWhenPlayDone);
+}
+
+uint64_t SFXPlayer::MakeWaveForNSamplesFloat(float left[],float right[],uint64_t numSamples)
+{
+	return MakeWaveForNSamplesFloat(left,right,numSamples,false);
+}
+
+uint64_t SFXPlayer::MakeWaveForNSamplesFloat(float left[],float right[],uint64_t numSamples,bool stopWhenPlayDone)
+{
+	StartPendingEffects();
+	return MMLPlayer::MakeWaveForNSamplesFloat(left,right,numSamples,stopWhenPlayDone);
+}
+
+void SFXPlayer::StartPendingEffects(void)
+{
+	for(int sfx=0; sfx<NUM_SFX; ++sfx)
+	{
+		if(0<pending[sfx])
+		{
+			StartEffect(sfx,pending[sfx]);
+			pending[sfx]=0;
+		}
+	}
+}
+
+unsigned int SFXPlayer::GetNumActiveVoices(void) const
+{
+	unsigned int n=0;
+	auto now=GetTimeInMicrosec();
+	for(unsigned int i=0; i<voiceBudget; ++i)
+	{
+		if(0<=voices[i].sfx && now<voices[i].endTimeInMicrosec)
+		{
+			++n;
+		}
+	}
+	return n;
+}
+
+unsigned int SFXPlayer::GetNumStolenVoices(void) const
+{
+	return numStolen;
+}
+
+unsigned int SFXPlayer::GetNumDroppedRequests(void) const
+{
+	return numDropped;
+}
+
+void SFXPlayer::StartEffect(int sfx,unsigned int numRequests)
+{
+	auto &effect=effects[sfx];
+	auto voiceNum=AllocateVoice(effect.priority);
+	if(voiceNum<0)
+	{
+		++numDropped;
+		return;
+	}
+
+	// Coalesced requests make it louder, +1 volume every time the number of requests doubles.
+	unsigned int boost=0;
+	while(1<numRequests && boost<MAX_VOLUME_BOOST)
+	{
+		++boost;
+		numRequests>>=1;
+	}
+
+	CompiledMML compiled=effect.compiled[voiceNum];
+	for(auto &evt : compiled.events)
+	{
+		if(EVENT_PROGRAM_CHANGE==evt.type)
+		{
+			evt.value=std::min<unsigned int>(VOLUME_MAX,evt.value+boost);
+		}
+	}
+
+	ClearChannel(voiceNum);
+	AddCompiledMML(voiceNum,compiled);
+
+	auto now=GetTimeInMicrosec();
+	auto &voice=voices[voiceNum];
+	voice.sfx=sfx;
+	voice.priority=effect.priority;
+	voice.startTimeInMicrosec=now;
+	voice.endTimeInMicrosec=now+compiled.lengthInMicrosec+RELEASE_MICROSEC;
+}
+
+int SFXPlayer::AllocateVoice(int priority)
+{
+	auto now=GetTimeInMicrosec();
+	for(unsigned int i=0; i<voiceBudget; ++i)
+	{
+		if(voices[i].sfx<0 || voices[i].endTimeInMicrosec<=now)
+		{
+			return i;
+		}
+	}
+
+	// Steal the oldest voice of the lowest priority, as long as the priority is not higher than the new effect.
+	int victim=-1;
+	for(unsigned int i=0; i<voiceBudget; ++i)
+	{
+		if(voices[i].priority<=priority &&
+		   (victim<0 ||
+		    voices[i].priority<voices[victim].priority ||
+		    (voices[i].priority==voices[victim].priority && voices[i].startTimeInMicrosec<voices[victim].startTimeInMicrosec)))
+		{
+			victim=i;
+		}
+	}
+	if(0<=victim)
+	{
+		++numStolen;
+	}
+	return victim;
+}
@@ -0,0 +1,128 @@
+#ifndef SFXPLAYER_IS_INCLUDED
+#define SFXPLAYER_IS_INCLUDED
+/* { */
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "mmlplayer.h"
+
+/*! Sound-effect synthesizer on top of MMLPlayer.
+    Each sound effect is a short MML, and each YM2612 channel is used as one voice.
+
+    Play() only counts the request.  Requests of the same effect made before the next
+    GenerateWave are coalesced into one voice, which is played louder when more requests
+    are coalesced.  If all voices are busy, the oldest voice of the lowest priority is
+    stolen, or the request is dropped if all voices are playing effects of higher priority.
+    Therefore, the number of voices and the cost for generating wave does not depend on
+    how many times Play() is called in one frame.
+*/
+class SFXPlayer : public MMLPlayer
+{
+public:
+	enum
+	{
+		SFX_HIT,
+		SFX_POWER_UP,
+		SFX_WALL_ADD,
+		SFX_WALL_SUBTRACT,
+		SFX_WALL_MULTIPLY,
+		SFX_WALL_DIVIDE,
+
+		NUM_SFX
+	};
+
+	enum
+	{
+		MAX_VOICES=NUM_CHANNELS,
+		RELEASE_MICROSEC=300000,  // Voice is kept busy for this long after the last note for the release.
+		MAX_VOLUME_BOOST=3,
+	};
+
+	class Effect
+	{
+	public:
+		std::string mml;
+		int priority=0;
+		CompiledMML compiled[NUM_CHANNELS];  // MML is compiled for each channel.
+	};
+
+private:
+	class Voice
+	{
+	public:
+		int sfx=-1;
+		int priority=0;
+		uint64_t startTimeInMicrosec=0;
+		uint64_t endTimeInMicrosec=0;
+	};
+
+	Effect effects[NUM_SFX];
+	unsigned int pending[NUM_SFX];
+	Voice voices[MAX_VOICES];
+	unsigned int voiceBudget=MAX_VOICES;
+	unsigned int numStolen=0,numDropped=0;
+
+public:
+	SFXPlayer();
+
+	/*! Stops all voices and discards pending requests.  Effects are not changed.
+	*/
+	void Clear(void);
+
+	/*! Replaces the MML of the sound effect.
+	    Returns false and leaves the effect unchanged if the MML has an error.
+	*/
+	bool SetEffect(int sfx,const std::string &mml,int priority);
+
+	/*! Sets the number of voices (YM2612 channels) used, 1 to MAX_VOICES.
+	*/
+	void SetVoiceBudget(unsigned int numVoices);
+
+	/*!
+	*/
+	unsigned int GetVoiceBudget(void) const;
+
+	/*! Requests a sound effect.  It starts at the beginning of the next GenerateWave.
+	*/
+	void Play(int sfx);
+
+	/*! Starts requested effects, and generates 16-bit stereo wave of the given length.
+	    Unlike MMLPlayer::GenerateWave, it always returns the requested length, including silence.
+	*/
+	std::vector <unsigned char> GenerateWave(uint64_t timeInMillisec);
+
+	/*! Starts requested effects, and makes 16-bit stereo wave of numSamples samples in wave[].
+	    wave[] must be at least 4*numSamples bytes long.
+	*/
+	uint64_t MakeWaveForNSamples(unsigned char wave[],uint64_t numSamples);
+
+	/*! Starts requested effects, and then same as MMLPlayer::MakeWaveForNSamples.
+	*/
+	uint64_t MakeWaveForNSamples(unsigned char wave[],uint64_t numSamples,bool stopWhenPlayDone);
+
+	/*! Float version of MakeWaveForNSamples.  See MMLPlayer::MakeWaveForNSamplesFloat for the buffer layout.
+	*/
+	uint64_t MakeWaveForNSamplesFloat(float left[],float right[],uint64_t numSamples);
+
+	/*! Starts requested effects, and then same as MMLPlayer::MakeWaveForNSamplesFloat.
+	*/
+	uint64_t MakeWaveForNSamplesFloat(float left[],float right[],uint64_t numSamples,bool stopWhenPlayDone);
+
+	/*! Returns the number of voices that are still playing or releasing.
+	*/
+	unsigned int GetNumActiveVoices(void) const;
+
+	/*! Returns the number of voices stolen and requests dropped since the last Clear.
+	*/
+	unsigned int GetNumStolenVoices(void) const;
+	unsigned int GetNumDroppedRequests(void) const;
+
+protected:
+	void StartPendingEffects(void);
+	void StartEffect(int sfx,unsigned int numRequests);
+	int AllocateVoice(int priority);
+};
+
+/* } */
+#endif
@@ -0,0 +1,239 @@
+#include <algorithm>
+#include <cstring>
+#include "wavstream.h"
+
+
+
+static unsigned int WavStream_GetWord(const unsigned char ptr[])
+{
+	return ptr[0]|(ptr[1]<<8);
+}
+
+static unsigned int WavStream_GetDword(const unsigned char ptr[])
+{
+	return ptr[0]|(ptr[1]<<8)|(ptr[2]<<16)|(ptr[3]<<24);
+}
+
+WavStream::WavStream()
+{
+}
+
+WavStream::~WavStream()
+{
+	Close();
+}
+
+bool WavStream::Open(const char fn[])
+{
+	Close();
+
+	if(true!=file.Open(fn))
+	{
+		return false;
+	}
+
+	if(true!=ParseRIFF())
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+bool WavStream::ParseRIFF(void)
+{
+	const unsigned char *fileTop=file.GetData();
+	const size_t fileSize=file.GetSize();
+	if(fileSize<12 || 0!=memcmp(fileTop,"RIFF",4) || 0!=memcmp(fileTop+8,"WAVE",4))
+	{
+		return false;
+	}
+
+	bool fmtFound=false;
+	size_t ptr=12;
+	while(ptr+8<=fileSize)
+	{
+		const unsigned char *chunk=fileTop+ptr;
+		size_t chunkSize=WavStream_GetDword(chunk+4);
+		size_t available=fileSize-(ptr+8);
+
+		if(0==memcmp(chunk,"fmt ",4))
+		{
+			if(chunkSize<16 || available<16)
+			{
+				return false;
+			}
+			auto formatTag=WavStream_GetWord(chunk+8);
+			numChannels=WavStream_GetWord(chunk+10);
+			samplingRate=WavStream_GetDword(chunk+12);
+			bitsPerSample=WavStream_GetWord(chunk+22);
+			if(0xFFFE==formatTag && 26<=chunkSize && 26<=available)
+			{
+				// WAVE_FORMAT_EXTENSIBLE.  First two bytes of the sub-format GUID is the format tag.
+				formatTag=WavStream_GetWord(chunk+8+24);
+			}
+			if(1!=formatTag ||
+			   (1!=numChannels && 2!=numChannels) ||
+			   (8!=bitsPerSample && 16!=bitsPerSample) ||
+			   0==samplingRate)
+			{
+				return false;
+			}
+			bytesPerSample=numChannels*bitsPerSample/8;
+			fmtFound=true;
+		}
+		else if(0==memcmp(chunk,"data",4))
+		{
+			if(true!=fmtFound)
+			{
+				return false;
+			}
+			pcm=chunk+8;
+			pcmSize=std::min(chunkSize,available);  // Tolerate a truncated file.
+			numSamples=pcmSize/bytesPerSample;
+			playPtr=0;
+			releasedUpTo=0;
+			return true;
+		}
+
+		ptr+=8+chunkSize+(chunkSize&1);
+	}
+	return false;
+}
+
+void WavStream::Close(void)
+{
+	file.Close();
+	pcm=nullptr;
+	pcmSize=0;
+	numChannels=0;
+	bitsPerSample=0;
+	samplingRate=0;
+	bytesPerSample=0;
+	numSamples=0;
+	playPtr=0;
+	releasedUpTo=0;
+}
+
+bool WavStream::IsOpen(void) const
+{
+	return nullptr!=pcm;
+}
+
+unsigned int WavStream::GetSamplingRate(void) const
+{
+	return samplingRate;
+}
+unsigned int WavStream::GetNumChannels(void) const
+{
+	return numChannels;
+}
+unsigned int WavStream::GetBitsPerSample(void) const
+{
+	return bitsPerSample;
+}
+uint64_t WavStream::GetNumSamples(void) const
+{
+	return numSamples;
+}
+
+const unsigned char *WavStream::GetPCMPointer(void) const
+{
+	return pcm;
+}
+size_t WavStream::GetPCMSize(void) const
+{
+	return pcmSize;
+}
+
+void WavStream::SetLoop(bool loop)
+{
+	this->loop=loop;
+}
+
+void WavStream::Seek(uint64_t sample)
+{
+	playPtr=std::min(sample,numSamples);
+	releasedUpTo=std::min<size_t>(releasedUpTo,(size_t)(playPtr*bytesPerSample)+(pcm-file.GetData()));
+}
+
+uint64_t WavStream::GetPlayPointer(void) const
+{
+	return playPtr;
+}
+
+unsigned int WavStream::GetSamples(int16_t stereo[],unsigned int numRequested)
+{
+	if(true!=IsOpen())
+	{
+		return 0;
+	}
+
+	unsigned int filled=0;
+	while(filled<numRequested)
+	{
+		if(numSamples<=playPtr)
+		{
+			if(true==loop && 0<numSamples)
+			{
+				playPtr=0;
+				releasedUpTo=0;
+			}
+			else
+			{
+				break;
+			}
+		}
+		auto n=(unsigned int)std::min<uint64_t>(numRequested-filled,numSamples-playPtr);
+		ConvertSamples(stereo+filled*2,playPtr,n);
+		filled+=n;
+		playPtr+=n;
+	}
+
+	ReleasePlayedPages();
+	return filled;
+}
+
+void WavStream::ConvertSamples(int16_t stereo[],uint64_t from,unsigned int n) const
+{
+	const unsigned char *src=pcm+from*bytesPerSample;
+	if(16==bitsPerSample && 2==numChannels)
+	{
+		// Already 16-bit stereo little endian.
+		memcpy(stereo,src,n*4);
+	}
+	else if(16==bitsPerSample)
+	{
+		for(unsigned int i=0; i<n; ++i)
+		{
+			int16_t s=(int16_t)WavStream_GetWord(src+i*2);
+			stereo[i*2]=s;
+			stereo[i*2+1]=s;
+		}
+	}
+	else if(2==numChannels)
+	{
+		for(unsigned int i=0; i<n*2; ++i)
+		{
+			stereo[i]=(int16_t)((src[i]-128)*256);
+		}
+	}
+	else
+	{
+		for(unsigned int i=0; i<n; ++i)
+		{
+			int16_t s=(int16_t)((src[i]-128)*256);
+			stereo[i*2]=s;
+			stereo[i*2+1]=s;
+		}
+	}
+}
+
+void WavStream::ReleasePlayedPages(void)
+{
+	const size_t playedUpTo=(size_t)(playPtr*bytesPerSample)+(pcm-file.GetData());
+	if(releasedUpTo+RELEASE_CHUNK_SIZE<=playedUpTo)
+	{
+		releasedUpTo=file.ReleasePages(releasedUpTo,playedUpTo);
+	}
+}
@@ -0,0 +1,92 @@
+#ifndef WAVSTREAM_IS_INCLUDED
+#define WAVSTREAM_IS_INCLUDED
+/* { */
+
+#include <cstdint>
+#include <cstddef>
+#include "audiomixer.h"
+#include "mappedfile.h"
+
+/*! WAV file streamed from a memory-mapped file.
+    Open() only maps the file and parses RIFF, fmt, and data chunks.  PCM is not copied
+    until GetSamples() converts the samples being played, so opening does not depend on
+    the length of the file.  Pages that have been played are returned to the OS, so that
+    the resident memory stays around the current play position.
+
+    8-bit or 16-bit, mono or stereo linear PCM is supported.  Samples are converted to
+    16-bit stereo, but the sampling rate is not converted.
+*/
+class WavStream : public AudioMixer::Source
+{
+public:
+	enum
+	{
+		RELEASE_CHUNK_SIZE=1024*1024,  // Played pages are released in this unit.
+	};
+
+private:
+	MappedFile file;
+
+	const unsigned char *pcm=nullptr;
+	size_t pcmSize=0;
+	unsigned int numChannels=0,bitsPerSample=0,samplingRate=0,bytesPerSample=0;
+	uint64_t numSamples=0;
+
+	uint64_t playPtr=0;
+	size_t releasedUpTo=0;  // Offset from the top of the file.
+	bool loop=false;
+
+	WavStream(const WavStream &);
+	WavStream &operator=(const WavStream &);
+
+public:
+	WavStream();
+	~WavStream();
+
+	/*! Maps the file and parses the header.  Returns false if the file cannot be opened or
+	    it is not a supported format.
+	*/
+	bool Open(const char fn[]);
+
+	/*!
+	*/
+	void Close(void);
+
+	/*!
+	*/
+	bool IsOpen(void) const;
+
+	unsigned int GetSamplingRate(void) const;
+	unsigned int GetNumChannels(void) const;
+	unsigned int GetBitsPerSample(void) const;
+	uint64_t GetNumSamples(void) const;
+
+	/*! Returns the PCM in the file as is, without copying.
+	*/
+	const unsigned char *GetPCMPointer(void) const;
+	size_t GetPCMSize(void) const;
+
+	/*! If loop is true, GetSamples goes back to the beginning at the end, and never ends.
+	*/
+	void SetLoop(bool loop);
+
+	/*!
+	*/
+	void Seek(uint64_t sample);
+
+	/*!
+	*/
+	uint64_t GetPlayPointer(void) const;
+
+	/*! Converts next numSamples to 16-bit stereo.
+	*/
+	unsigned int GetSamples(int16_t stereo[],unsigned int numSamples) override;
+
+private:
+	bool ParseRIFF(void);
+	void ConvertSamples(int16_t stereo[],uint64_t from,unsigned int numSamples) const;
+	void ReleasePlayedPages(void);
+};
+
+/* } */
+#endif
@@ -18,6 +18,7 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 
 #include <vector>
 #include <string>
+#include <atomic>
 
 
 
@@ -56,10 +57,17 @@ public:
 
 		TONE_CHOPOFF_MILLISEC=4000,
 
-		WAVE_SAMPLING_RATE=44100,
+		WAVE_SAMPLING_RATE=44100,        // Default sampling rate.
+		NATIVE_SAMPLING_RATE=50000,      // One sample per Timer-A tick, 12 internal-clock ticks.
+		SAMPLING_RATE_MIN=8000,
+		SAMPLING_RATE_MAX=192000,
 		WAVE_OUTPUT_AMPLITUDE_MAX_DEFAULT=8192,
+		COMMAND_QUEUE_CAPACITY_DEFAULT=1024,
 
 		TL_MAX=127,
+
+		NUM_KEY_CODES=32,
+		NUM_VOICE_REGS=30,  // DT_MULTI, TL, KS_AR, AM_DR, SR, SL_RR, and SSG_EG of 4 slots, FB_CNCT, and LR_AMS_PMS.
 	};
 
 	enum
@@ -188,17 +196,15 @@ public:
 
 	State state;
 	bool channelMute[NUM_CHANNELS]={false,false,false,false,false,false};
+	unsigned int samplingRate=WAVE_SAMPLING_RATE;
 
-	static unsigned int attackExp[4096];
-	static unsigned int attackExpInverse[4096];
+	static const unsigned int attackExp[4096];
+	static const unsigned int attackExpInverse[4096];
 
-	static int sineTable[PHASE_STEPS];
-	static unsigned int TLtoDB100[128];   // 100 times dB
-	static unsigned int SLtoDB100[16];    // 100 times dB
-	static unsigned int DB100to4095Scale[9601]; // dB to 0 to 4095 scale
-	static unsigned int DB100from4095Scale[4096]; // 4095 scale to dB
-	static unsigned int linear4096to9600[4097]; // Linear 4096 scale to 9600 scale
-	static unsigned int linear9600to4096[9601]; // Linear 9600 scale to 4096 scale
+	static const int sineTable[PHASE_STEPS];
+	static const unsigned int TLtoDB100[128];   // 100 times dB
+	static const unsigned int SLtoDB100[16];    // 100 times dB
+	static const unsigned int DB100to4095Scale[9601]; // dB to 0 to 4095 scale
 	static const unsigned int connToOutChannel[8][4];
 	static int MULTITable[16];
 
@@ -222,23 +228,55 @@ public:
 
 	YM2612();
 	~YM2612();
-private:
-	void MakeSineTable(void);
-	void MakeTLtoDB100(void);
-	void MakeSLtoDB100(void);
-	void MakeDB100to4095Scale(void);
-	void MakeLinearScaleTable(void);
-	void MakeAttackProfileTable(void);
-public:
+
 	void PowerOn(void);
 	void Reset(void);
 
+	/*! Sets the sampling rate of the wave made by MakeWaveForNSamples.
+	    The rate is clamped to SAMPLING_RATE_MIN to SAMPLING_RATE_MAX.
+	    Phase steps of the channels are recalculated, so that the tones being played continue in the same pitch.
+	*/
+	void SetSamplingRate(unsigned int samplingRate);
+	unsigned int GetSamplingRate(void) const;
+
 	/*! Writes to a register, and if a channel starts playing a tone, it calls KeyOn and returns between 0 to 5.
 	    65535 otherwise.
 	*/
 	unsigned int WriteRegister(unsigned int channelBase,unsigned int reg,unsigned int value);
 	unsigned int ReadRegister(unsigned int channelBase,unsigned int reg) const;
 
+	/*! Registers of a channel set by a program change, in the order of the values given to WriteVoice.
+	    Add the channel number within the channel base (0 to 2).
+	*/
+	static const unsigned char voiceRegs[NUM_VOICE_REGS];
+
+	/*! Envelope durations of a slot (env[0], env[2], and env[4]) by key code.  They only depend on KS, AR, DR, SR, and SL,
+	    and are calculated once for each key code as it is played.  Owned by the caller of WriteVoice.
+	*/
+	class EnvelopeDurations
+	{
+	public:
+		unsigned int key=~0U;     // EnvelopeKey of the slot parameters.
+		unsigned int knownKC=0;   // Bit KC is set if duration[KC] is calculated.
+		unsigned int noToneKC=0;  // Bit KC is set if AR is too low to make a tone.
+		unsigned int duration[NUM_KEY_CODES][3];
+
+		void Clear(void);
+	};
+
+	/*! Envelope durations given to the slots by WriteVoice.  Not a part of the state, and only used while
+	    the slot parameters match.
+	*/
+	EnvelopeDurations *slotEnvelope[NUM_CHANNELS][NUM_SLOTS]={};
+
+	/*! Same as writing value[i] to voiceRegs[i]+chLow in this order, except that only TL and SL_RR of the slots
+	    that are playing or releasing go through WriteRegister.  The other values are copied to the channel.
+	    TL of the carrier slots is attenuated by carrierAttenuation.
+	    Key-ons of the channel take the envelope durations from envelope[4] (in the register order of the slots)
+	    until the slot parameters are changed.  envelope may be nullptr.
+	*/
+	void WriteVoice(unsigned int channelBase,unsigned int chLow,const unsigned char value[NUM_VOICE_REGS],unsigned int carrierAttenuation,EnvelopeDurations envelope[NUM_SLOTS]);
+
 	void Run(unsigned long long int systemTimeInNS);
 
 	bool TimerAUp(void) const;
@@ -260,7 +298,7 @@ public:
 	*/
 	void UpdatePhase12StepSlot(Channel &ch);
 
-	/*! Sampling rate is defined by WAVE_SAMPLING_RATE.
+	/*! Sampling rate is given by SetSamplingRate.
 	*/
 	std::vector <unsigned char> MakeWaveAllChannels(unsigned long long int millisec) const;
 
@@ -269,20 +307,162 @@ public:
 	std::vector <unsigned char> MakeWave(unsigned int ch,unsigned long long int millisec) const;
 
 public:
+	enum
+	{
+		WAVE_INT16,            // 16-bit stereo little endian, 4 bytes per sample.
+		WAVE_FLOAT_INTERLEAVED,
+		WAVE_FLOAT_PLANAR,
+	};
+
+	/*! Destination of the wave.
+	    Float output is the 16-bit value times gain, and is not clipped.  Default gain makes 32768 to 1.0.
+	    WAVE_FLOAT_INTERLEAVED writes L,R,L,R... to left[].  WAVE_FLOAT_PLANAR writes to left[] and right[].
+	*/
+	class WaveBuffer
+	{
+	public:
+		int format=WAVE_INT16;
+		unsigned char *int16=nullptr;
+		float *left=nullptr,*right=nullptr;
+		float gain=1.0f/32768.0f;
+
+		/*! Fills numSamples samples with zero.
+		*/
+		void Clear(unsigned long long int numSamples) const;
+
+		/*! Returns the buffer that starts numSamples samples after this buffer.
+		*/
+		WaveBuffer Advance(unsigned long long int numSamples) const;
+	};
+
 	/*! Adds a wave to the buffer, and returns the number of samples (number_of_bytes_filled/4).
-	    Sampling rate is defined by WAVE_SAMPLING_RATE.
+	    Sampling rate is given by SetSamplingRate.
 	*/
 	long long int MakeWaveForNSamples(unsigned char wavBuf[],unsigned long long int numSamplesRequested) const;
 
 	/*! Adds a wave to the buffer, and returns the number of samples (number_of_bytes_filled/4).
-	    Sampling rate is defined by WAVE_SAMPLING_RATE.
+	    Sampling rate is given by SetSamplingRate.
 	*/
 	long long int MakeWaveForNSamples(unsigned char wavBuf[],unsigned int nPlayingCh,unsigned int playingCh[],unsigned long long int numSamplesRequested) const;
+
+	/*! Makes a wave in the format of the buffer, and returns the number of samples.
+	*/
+	long long int MakeWaveForNSamples(const WaveBuffer &buf,unsigned long long int numSamplesRequested) const;
+	long long int MakeWaveForNSamples(const WaveBuffer &buf,unsigned int nPlayingCh,unsigned int playingCh[],unsigned long long int numSamplesRequested) const;
+
+	/*! Register write made at a sample of the wave made by MakeWaveForNSamplesScheduled.
+	*/
+	class ScheduledWrite
+	{
+	public:
+		unsigned long long int sample;  // From the beginning of the wave made next.
+		unsigned char chBase,reg,value;
+		const unsigned char *voice=nullptr;      // If not nullptr, WriteVoice(chBase,reg,voice,value,envelope).
+		EnvelopeDurations *envelope=nullptr;
+	};
+	std::vector <ScheduledWrite> writeSchedule;
+
+	/*! Schedules a register write at the sample of the wave made next by MakeWaveForNSamplesScheduled.
+	    Writes at the same sample are made in the order scheduled.
+	*/
+	void ScheduleWriteRegister(unsigned long long int sample,unsigned int channelBase,unsigned int reg,unsigned int value);
+
+	/*! Schedules WriteVoice in the same way.  voice and envelope must be kept until it is written.
+	*/
+	void ScheduleWriteVoice(unsigned long long int sample,unsigned int channelBase,unsigned int chLow,const unsigned char voice[NUM_VOICE_REGS],unsigned int carrierAttenuation,EnvelopeDurations envelope[NUM_SLOTS]);
+
+	/*! Makes a wave of numSamples samples in one call, making scheduled register writes right before
+	    their samples.  Writes scheduled at numSamples are made after the wave.  Later writes are kept
+	    for the next call, and their positions are moved back by numSamples.
+	    Returns the number of samples.
+	*/
+	long long int MakeWaveForNSamplesScheduled(const WaveBuffer &buf,unsigned long long int numSamples);
+
+	/*! Register write sent through CommandQueue.
+	*/
+	class Command
+	{
+	public:
+		unsigned long long int sample;  // Position in the stream made by MakeWaveForNSamples(CommandQueue &,...).
+		unsigned char chBase,reg,value;
+	};
+
+	/*! Wait-free single-producer single-consumer queue of register writes.
+	    One thread, such as the game logic, pushes commands, and the audio thread making the wave takes them.
+	    Neither side waits for the other or takes a lock.  The capacity is fixed, and Push fails when the queue is full.
+	    Once a queue is used, YM2612 must be touched only by the audio thread.
+	*/
+	class CommandQueue
+	{
+	private:
+		std::vector <Command> ring;
+		size_t mask;
+		alignas(64) std::atomic <size_t> readPtr;                          // Written only by the audio thread.
+		alignas(64) std::atomic <size_t> writePtr;                         // Written only by the pushing thread.
+		alignas(64) std::atomic <unsigned long long int> renderedSamples;  // Written only by the audio thread.
+
+		CommandQueue(const CommandQueue &);
+		CommandQueue &operator=(const CommandQueue &);
+
+	public:
+		/*! Capacity is rounded up to a power of two.
+		*/
+		CommandQueue(size_t capacity=COMMAND_QUEUE_CAPACITY_DEFAULT);
+
+		/*! Pushing thread.  Queues a register write at the sample of the stream.
+		    Samples must not decrease from one command to the next.  A command stamped at or before
+		    GetRenderedSamples is written at the beginning of the next wave.
+		    Returns false if the queue is full.
+		*/
+		bool Push(unsigned long long int sample,unsigned int channelBase,unsigned int reg,unsigned int value);
+
+		/*! Either thread.  Returns the number of samples made from the queue so far.
+		*/
+		unsigned long long int GetRenderedSamples(void) const;
+
+		/*! Audio thread.  Copies the first command to cmd without taking it, and returns true if the queue is not empty.
+		*/
+		bool Peek(Command &cmd) const;
+
+		/*! Audio thread.  Takes the first command.
+		*/
+		void Pop(void);
+
+		/*! Audio thread.
+		*/
+		void AddRenderedSamples(unsigned long long int numSamples);
+	};
+
+	/*! Audio thread.  Takes the commands stamped before the end of the next numSamples samples, and schedules
+	    them by ScheduleWriteRegister.  Commands stamped later are left in the queue.
+	    The wave must be made next by MakeWaveForNSamplesScheduled, and then queue.AddRenderedSamples(numSamples).
+	*/
+	void ScheduleCommands(CommandQueue &queue,unsigned long long int numSamples);
+
+	/*! Audio thread.  Takes the commands stamped before the end of this wave, and makes numSamples samples
+	    with the writes at their samples.  Commands stamped later are left in the queue.
+	    Returns the number of samples.
+	*/
+	long long int MakeWaveForNSamples(CommandQueue &queue,const WaveBuffer &buf,unsigned long long int numSamples);
 private:
 	class WithLFO;
 	class WithoutLFO;
-	template <class LFO>
-	long long int MakeWaveForNSamplesTemplate(unsigned char wavBuf[],unsigned int nPlayingCh,unsigned int playingCh[],unsigned long long int numSamplesRequested) const;
+	class Int16Output;
+	class FloatInterleavedOutput;
+	class FloatPlanarOutput;
+	template <class LFO,class OutputClass>
+	long long int MakeWaveForNSamplesTemplate(OutputClass out,unsigned int nPlayingCh,unsigned int playingCh[],unsigned long long int numSamplesRequested) const;
+	template <class OutputClass>
+	long long int MakeWaveForNSamplesOutput(OutputClass out,unsigned int nPlayingCh,unsigned int playingCh[],unsigned long long int numSamplesRequested) const;
+
+	/*! If channel chNum outputs zero for the next numSamples samples, advances the channel by as many
+	    samples as the per-sample loop would, and returns true.
+	    The output is zero if the channel is muted, or if every carrier slot is past the attack and its
+	    envelope is so low that the amplitude rounds to zero.  The envelope never rises after the attack
+	    until a register is written, so it stays zero.
+	*/
+	template <class LFOClass>
+	bool SkipSilentChannel(unsigned int chNum,unsigned long long int numSamples,unsigned int microsecS12Step) const;
 
 	/*! lastSlot0Out is input/output.  Needed for calculating feedback.
 	*/
@@ -306,9 +486,9 @@ public:
 	void CheckToneDoneAllChannels(void);
 
 
-	/*! Updates slot envelope.
+	/*! Updates slot envelope.  durations may be nullptr.
 	*/
-	void UpdateSlotEnvelope(const Channel &ch,Slot &slot);
+	void UpdateSlotEnvelope(const Channel &ch,Slot &slot,EnvelopeDurations *durations);
 
 
 	/*!
@@ -329,7 +509,20 @@ public:
 	       env[5]  Zero
 	*/
 	bool CalculateEnvelope(unsigned int env[6],unsigned int BLOCK_NOTE,const Slot &slot) const;
+
+	static unsigned int EnvelopeKey(unsigned int KS,unsigned int AR,unsigned int DR,unsigned int SR,unsigned int SL);
+
+	/*! Same as CalculateEnvelope, but the durations are taken from durations if it is for the slot parameters.
+	    The durations of KC are calculated and kept in durations if not yet.
+	*/
+	bool LookUpEnvelope(unsigned int env[6],unsigned int KC,const Slot &slot,EnvelopeDurations *durations) const;
+
 private:
+	/*! Returns false if AR is too low to make a tone.
+	*/
+	bool CalculateEnvelopeDuration(unsigned int duration[3],unsigned int KC,unsigned int KS,unsigned int AR,unsigned int DR,unsigned int SR,unsigned int SL) const;
+	bool MakeEnvelope(unsigned int env[6],const unsigned int duration[3],const Slot &slot) const;
+
 	inline bool NoTone(unsigned int env[6]) const
 	{
 		env[0]=0;
@@ -409,6 +602,14 @@ public:
 
 
 	std::vector <std::string> GetStatusText(void) const;
+
+
+	/*! Returns a byte string that is identical for two states that make the same wave from now on
+	    as long as the same registers are written at the same timings.
+	    Time and phase of a channel that is keyed off and has finished its tone are not included,
+	    since they are reset on the next key-on.  Timers are not included.
+	*/
+	std::vector <unsigned char> GetStateKey(void) const;
 };
 
 
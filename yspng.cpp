@@ -28,12 +28,42 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 //////////////////////////////////////////////////////////// */
 
 #include <stdio.h>
+#include <stdint.h>
+#include <string.h>
 
 #include "yspng.h"
-
-
-
-unsigned int YsGenericPngDecoder::verboseMode=YSFALSE;
+#include "mappedfile.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && 2<=_M_IX86_FP)
+	#define YSPNG_USE_SSE2
+	#include <emmintrin.h>
+#endif
+#if defined(YSPNG_USE_SSE2) && (defined(__SSSE3__) || defined(__AVX__))
+	#define YSPNG_USE_SSSE3
+	#include <tmmintrin.h>
+#endif
+#if defined(__AVX2__)
+	#define YSPNG_USE_AVX2
+	#include <immintrin.h>
+#endif
+#if defined(YSPNG_USE_SSE2) && defined(__PCLMUL__) && defined(__SSE4_1__)
+	#define YSPNG_USE_PCLMUL
+	#define YSPNG_PCLMUL_TARGET
+	#include <smmintrin.h>
+	#include <wmmintrin.h>
+#elif defined(YSPNG_USE_SSE2) && (defined(__GNUC__) || defined(_MSC_VER))
+	// Not targeted by the compiler.  The CRC-32 checks the CPU at run time and uses PCLMULQDQ if available.
+	#define YSPNG_USE_PCLMUL
+	#define YSPNG_PCLMUL_RUNTIME_CHECK
+	#ifdef __GNUC__
+		#define YSPNG_PCLMUL_TARGET __attribute__((target("pclmul,sse4.1")))
+	#else
+		#define YSPNG_PCLMUL_TARGET
+		#include <intrin.h>
+	#endif
+	#include <smmintrin.h>
+	#include <wmmintrin.h>
+#endif
 
 
 
@@ -72,6 +102,21 @@ unsigned int YsGenericPngDecoder::verboseMode=YSFALSE;
 //     1bit Indexed Color was already supported.  I was forgetting to add in the list below.
 //   2014/12/21
 //     Small improvement in the de-compression efficiency.
+//   2026/10/19
+//     Table-driven Huffman decoding.
+//     Rows are unfiltered and converted a row at a time.
+//     SSE2 Sub/Up/Paeth unfiltering.
+//     Files are memory-mapped by MappedFile (mappedfile.h), and IDAT chunks are uncompressed where they are without being joined.
+//     Incremental decoding by BeginPush/Push/EndPush.  YsRowPngDecoder gives RGBA rows without keeping the image.
+//     YsRawPngDecoder can write to the caller's buffer with a stride, in RGBA/BGRA/RGB/gray, top-down or bottom-up.
+//     CRC of the chunks and Adler-32 of the image data are checked unless verifyChecksum is YSFALSE.
+//     CRC uses PCLMULQDQ if the CPU has it, otherwise slice-by-8.
+//     Decode returns YSERR if the output cannot be prepared (unsupported format), as Push does.
+//     The window, row buffers, and copies of IDAT are taken from a per-decoder arena, which is kept for the next image.
+//     A decoder can be used for many images.  tRNS, gAMA, and PLTE of the previous image are not taken over.
+//     Adam7 passes 1 to 6 are decoded to small RGBA images, and interleaved into the even rows as pass 7 comes.
+//     Support:
+//       Interlaced 1bit Grayscale, 1bit/2bit/4bit Indexed color
 
 /* Supported color and depth
 
@@ -87,6 +132,8 @@ Non-Interlaced
   16bit True Color (48bit per pixel)
 
 Interlaced
+  1bit Grayscale
+  1bit, 2bit, 4bit Indexed Color
   8bit Grayscale
   8bit Grayscale with Alpha
   8bit Indexed Color
@@ -119,81 +166,377 @@ static inline unsigned int PngGetUnsignedInt(const unsigned char dat[4])
 
 ////////////////////////////////////////////////////////////
 
-void YsPngHeader::Decode(unsigned char dat[])
+// CRC-32 of the chunks, eight bytes at a time with eight tables (slice-by-8).
+class YsPngCrcTable
 {
-	width=PngGetUnsignedInt(dat);
-	height=PngGetUnsignedInt(dat+4);
-	bitDepth=dat[8];
-	colorType=dat[9];
-	compressionMethod=dat[10];
-	filterMethod=dat[11];
-	interlaceMethod=dat[12];
+public:
+	unsigned int t[8][256];
+	YsPngCrcTable();
+};
 
-	if(YsGenericPngDecoder::verboseMode==YSTRUE)
+YsPngCrcTable::YsPngCrcTable()
+{
+	for(unsigned int i=0; i<256; ++i)
+	{
+		unsigned int c=i;
+		for(int k=0; k<8; ++k)
+		{
+			c=(0!=(c&1) ? 0xedb88320u^(c>>1) : (c>>1));
+		}
+		t[0][i]=c;
+	}
+	for(unsigned int i=0; i<256; ++i)
 	{
-		printf("Width=%d Height=%d\n",width,height);
-		printf("bitDepth=%d\n",bitDepth);
-		printf("colorType=%d\n",colorType);
-		printf("compressionMethod=%d\n",compressionMethod);
-		printf("filterMethod=%d\n",filterMethod);
-		printf("interlaceMethod=%d\n",interlaceMethod);
+		for(int k=1; k<8; ++k)
+		{
+			t[k][i]=(t[k-1][i]>>8)^t[0][t[k-1][i]&255];
+		}
 	}
 }
 
-YsPngPalette::YsPngPalette()
+static const YsPngCrcTable &PngGetCrcTable(void)
 {
-	nEntry=0;
-	entry=NULL;
+	// Made once on the first use.  Initialization of a local static is thread-safe.
+	static const YsPngCrcTable table;
+	return table;
 }
 
-YsPngPalette::~YsPngPalette()
+#ifdef YSPNG_USE_PCLMUL
+// Folds 64 bytes at a time by carry-less multiplication, and reduces to 32 bits at the end.
+// length must be 64 or more, and a multiple of 16.  crc is not inverted.
+YSPNG_PCLMUL_TARGET static unsigned int PngCrc32PCLMUL(unsigned int crc,const unsigned char dat[],size_t length)
 {
-	if(entry!=NULL)
-	{
-		delete [] entry;
-	}
+	const __m128i k1k2=_mm_set_epi64x(0x01c6e41596,0x0154442bd4);
+	const __m128i k3k4=_mm_set_epi64x(0x00ccaa009e,0x01751997d0);
+	const __m128i k5k0=_mm_set_epi64x(0,0x0163cd6124);
+	const __m128i poly=_mm_set_epi64x(0x01f7011641,0x01db710641);
+	const __m128i mask32=_mm_setr_epi32(-1,0,-1,0);
+
+	__m128i x1=_mm_loadu_si128((const __m128i *)(dat));
+	__m128i x2=_mm_loadu_si128((const __m128i *)(dat+16));
+	__m128i x3=_mm_loadu_si128((const __m128i *)(dat+32));
+	__m128i x4=_mm_loadu_si128((const __m128i *)(dat+48));
+	x1=_mm_xor_si128(x1,_mm_cvtsi32_si128((int)crc));
+	dat+=64;
+	length-=64;
+
+	while(64<=length)
+	{
+		__m128i x5=_mm_clmulepi64_si128(x1,k1k2,0x00);
+		__m128i x6=_mm_clmulepi64_si128(x2,k1k2,0x00);
+		__m128i x7=_mm_clmulepi64_si128(x3,k1k2,0x00);
+		__m128i x8=_mm_clmulepi64_si128(x4,k1k2,0x00);
+		x1=_mm_clmulepi64_si128(x1,k1k2,0x11);
+		x2=_mm_clmulepi64_si128(x2,k1k2,0x11);
+		x3=_mm_clmulepi64_si128(x3,k1k2,0x11);
+		x4=_mm_clmulepi64_si128(x4,k1k2,0x11);
+		x1=_mm_xor_si128(_mm_xor_si128(x1,x5),_mm_loadu_si128((const __m128i *)(dat)));
+		x2=_mm_xor_si128(_mm_xor_si128(x2,x6),_mm_loadu_si128((const __m128i *)(dat+16)));
+		x3=_mm_xor_si128(_mm_xor_si128(x3,x7),_mm_loadu_si128((const __m128i *)(dat+32)));
+		x4=_mm_xor_si128(_mm_xor_si128(x4,x8),_mm_loadu_si128((const __m128i *)(dat+48)));
+		dat+=64;
+		length-=64;
+	}
+
+	// Four to one.
+	__m128i x5=_mm_clmulepi64_si128(x1,k3k4,0x00);
+	x1=_mm_clmulepi64_si128(x1,k3k4,0x11);
+	x1=_mm_xor_si128(_mm_xor_si128(x1,x2),x5);
+	x5=_mm_clmulepi64_si128(x1,k3k4,0x00);
+	x1=_mm_clmulepi64_si128(x1,k3k4,0x11);
+	x1=_mm_xor_si128(_mm_xor_si128(x1,x3),x5);
+	x5=_mm_clmulepi64_si128(x1,k3k4,0x00);
+	x1=_mm_clmulepi64_si128(x1,k3k4,0x11);
+	x1=_mm_xor_si128(_mm_xor_si128(x1,x4),x5);
+
+	while(16<=length)
+	{
+		x5=_mm_clmulepi64_si128(x1,k3k4,0x00);
+		x1=_mm_clmulepi64_si128(x1,k3k4,0x11);
+		x1=_mm_xor_si128(_mm_xor_si128(x1,_mm_loadu_si128((const __m128i *)dat)),x5);
+		dat+=16;
+		length-=16;
+	}
+
+	// 128 bits to 64 bits.
+	__m128i x2r=_mm_clmulepi64_si128(x1,k3k4,0x10);
+	x1=_mm_xor_si128(_mm_srli_si128(x1,8),x2r);
+	x2r=_mm_srli_si128(x1,4);
+	x1=_mm_and_si128(x1,mask32);
+	x1=_mm_clmulepi64_si128(x1,k5k0,0x00);
+	x1=_mm_xor_si128(x1,x2r);
+
+	// Barrett reduction to 32 bits.
+	x2r=_mm_and_si128(x1,mask32);
+	x2r=_mm_clmulepi64_si128(x2r,poly,0x10);
+	x2r=_mm_and_si128(x2r,mask32);
+	x2r=_mm_clmulepi64_si128(x2r,poly,0x00);
+	x1=_mm_xor_si128(x1,x2r);
+	return (unsigned int)_mm_extract_epi32(x1,1);
 }
 
-int YsPngPalette::Decode(unsigned length,unsigned char dat[])
+static bool PngCpuHasPCLMUL(void)
 {
-	if(length%3!=0)
+#if !defined(YSPNG_PCLMUL_RUNTIME_CHECK)
+	return true;
+#elif defined(__GNUC__)
+	__builtin_cpu_init();
+	return 0!=__builtin_cpu_supports("pclmul") && 0!=__builtin_cpu_supports("sse4.1");
+#else
+	int info[4];
+	__cpuid(info,1);
+	return 0!=(info[2]&(1<<1)) && 0!=(info[2]&(1<<19));  // PCLMULQDQ and SSE4.1
+#endif
+}
+#endif
+
+/*! Same as crc32 of zlib.  Start with crc=0, and give the previous return value to continue.
+*/
+static unsigned int PngCrc32(unsigned int crc,const unsigned char dat[],size_t length)
+{
+	const YsPngCrcTable &table=PngGetCrcTable();
+	crc=~crc;
+
+#ifdef YSPNG_USE_PCLMUL
+	// Checked once on the first use.
+	static const bool hasPCLMUL=PngCpuHasPCLMUL();
+	if(64<=length && true==hasPCLMUL)
 	{
-		return YSERR;
+		const size_t n=(length&~(size_t)15);
+		crc=PngCrc32PCLMUL(crc,dat,n);
+		dat+=n;
+		length-=n;
 	}
+#endif
 
-	if(entry!=NULL)
+	while(8<=length)
+	{
+		const unsigned int lo=crc^((unsigned int)dat[0]|((unsigned int)dat[1]<<8)|((unsigned int)dat[2]<<16)|((unsigned int)dat[3]<<24));
+		const unsigned int hi=(unsigned int)dat[4]|((unsigned int)dat[5]<<8)|((unsigned int)dat[6]<<16)|((unsigned int)dat[7]<<24);
+		crc=table.t[7][lo&255]^table.t[6][(lo>>8)&255]^table.t[5][(lo>>16)&255]^table.t[4][lo>>24]^
+		    table.t[3][hi&255]^table.t[2][(hi>>8)&255]^table.t[1][(hi>>16)&255]^table.t[0][hi>>24];
+		dat+=8;
+		length-=8;
+	}
+	while(0<length)
 	{
-		delete [] entry;
-		nEntry=0;
-		entry=NULL;
+		crc=table.t[0][(crc^*dat)&255]^(crc>>8);
+		++dat;
+		--length;
 	}
+	return ~crc;
+}
 
-	if(length>0)
+// Adler-32 of the uncompressed data.  s2 may grow up to 2^32-1 in PNG_ADLER_NMAX bytes before taking the modulo.
+#define PNG_ADLER_BASE 65521
+#define PNG_ADLER_NMAX 5552
+
+/*! Same as adler32 of zlib.  Start with adler=1.
+*/
+static unsigned int PngAdler32(unsigned int adler,const unsigned char dat[],size_t length)
+{
+	unsigned int s1=(adler&0xffff),s2=(adler>>16);
+
+#ifdef YSPNG_USE_SSE2
+	// In each 16 bytes, s1 grows by the sum of the bytes, and s2 by 16*s1 plus the bytes weighted 16 to 1.
+	const __m128i zero=_mm_setzero_si128();
+	const __m128i weightLo=_mm_setr_epi16(16,15,14,13,12,11,10,9);
+	const __m128i weightHi=_mm_setr_epi16(8,7,6,5,4,3,2,1);
+	while(16<=length)
 	{
-		entry=new unsigned char [length];
-		if(entry!=NULL)
+		const size_t n=(length<PNG_ADLER_NMAX ? length : PNG_ADLER_NMAX)&~(size_t)15;
+		s2+=s1*(unsigned int)n;
+
+		__m128i vs1=zero,vs1Sum=zero,vs2=zero;
+		for(size_t i=0; i<n; i+=16)
 		{
-			unsigned int i;
-			nEntry=length/3;
+			const __m128i x=_mm_loadu_si128((const __m128i *)(dat+i));
+			vs1Sum=_mm_add_epi32(vs1Sum,vs1);
+			vs1=_mm_add_epi32(vs1,_mm_sad_epu8(x,zero));
+			vs2=_mm_add_epi32(vs2,_mm_madd_epi16(_mm_unpacklo_epi8(x,zero),weightLo));
+			vs2=_mm_add_epi32(vs2,_mm_madd_epi16(_mm_unpackhi_epi8(x,zero),weightHi));
+		}
+		vs2=_mm_add_epi32(vs2,_mm_slli_epi32(vs1Sum,4));
 
-			if(YsGenericPngDecoder::verboseMode==YSTRUE)
-			{
-				printf("%d palette entries\n",nEntry);
-			}
+		vs1=_mm_add_epi32(vs1,_mm_shuffle_epi32(vs1,_MM_SHUFFLE(1,0,3,2)));
+		vs2=_mm_add_epi32(vs2,_mm_shuffle_epi32(vs2,_MM_SHUFFLE(1,0,3,2)));
+		vs2=_mm_add_epi32(vs2,_mm_shuffle_epi32(vs2,_MM_SHUFFLE(2,3,0,1)));
+		s1+=(unsigned int)_mm_cvtsi128_si32(vs1);
+		s2+=(unsigned int)_mm_cvtsi128_si32(vs2);
+		s1%=PNG_ADLER_BASE;
+		s2%=PNG_ADLER_BASE;
 
-			for(i=0; i<length; i++)
-			{
-				entry[i]=dat[i];
-			}
+		dat+=n;
+		length-=n;
+	}
+#endif
+
+	while(0<length)
+	{
+		const size_t n=(length<PNG_ADLER_NMAX ? length : PNG_ADLER_NMAX);
+		for(size_t i=0; i<n; ++i)
+		{
+			s1+=dat[i];
+			s2+=s1;
 		}
+		s1%=PNG_ADLER_BASE;
+		s2%=PNG_ADLER_BASE;
+		dat+=n;
+		length-=n;
+	}
+	return (s2<<16)|s1;
+}
+
+////////////////////////////////////////////////////////////
+
+YsPngArena::YsPngArena()
+{
+	buf=NULL;
+	top=NULL;
+	capacity=0;
+	used=0;
+	allocated=0;
+}
+
+YsPngArena::~YsPngArena()
+{
+	Release();
+}
+
+void *YsPngArena::Alloc(size_t size)
+{
+	size=(size+ALIGNMENT-1)&~(size_t)(ALIGNMENT-1);
+	allocated+=size;
+	if(size<=capacity-used)
+	{
+		void *ptr=top+used;
+		used+=size;
+		return ptr;
+	}
+
+	if(NULL!=buf && capacity/4<size)
+	{
+		// A large block gets its own buffer, so that the rest of the current buffer is still used.
+		return AddBuffer(size,false);
 	}
 
+	size_t newCapacity=capacity*2;
+	if(newCapacity<size)
+	{
+		newCapacity=size;
+	}
+	if(newCapacity<MIN_BUFFER_SIZE)
+	{
+		newCapacity=MIN_BUFFER_SIZE;
+	}
+	void *ptr=AddBuffer(newCapacity,true);
+	used=size;
+	return ptr;
+}
+
+void YsPngArena::Reset(void)
+{
+	if(NULL!=buf && NULL!=GetLink(buf))
+	{
+		// The last image did not fit in one buffer.  One buffer for all of it.
+		const size_t total=allocated;
+		Release();
+		AddBuffer(total<MIN_BUFFER_SIZE ? (size_t)MIN_BUFFER_SIZE : total,true);
+	}
+	used=0;
+	allocated=0;
+}
+
+void YsPngArena::Release(void)
+{
+	while(NULL!=buf)
+	{
+		unsigned char *next=GetLink(buf);
+		delete [] buf;
+		buf=next;
+	}
+	top=NULL;
+	capacity=0;
+	used=0;
+	allocated=0;
+}
+
+unsigned char *YsPngArena::AddBuffer(size_t size,bool makeCurrent)
+{
+	// The link to the other buffers is at the beginning, and then there are up to ALIGNMENT-1 bytes before the top.
+	unsigned char *newBuf=new unsigned char [ALIGNMENT*2+size];
+	if(true==makeCurrent)
+	{
+		SetLink(newBuf,buf);
+		buf=newBuf;
+		top=GetTop(newBuf);
+		capacity=size;
+		used=0;
+	}
+	else
+	{
+		SetLink(newBuf,GetLink(buf));
+		SetLink(buf,newBuf);
+	}
+	return GetTop(newBuf);
+}
+
+/* static */ unsigned char *YsPngArena::GetLink(const unsigned char buf[])
+{
+	unsigned char *link;
+	memcpy(&link,buf,sizeof(link));
+	return link;
+}
+
+/* static */ void YsPngArena::SetLink(unsigned char buf[],unsigned char *link)
+{
+	memcpy(buf,&link,sizeof(link));
+}
+
+/* static */ unsigned char *YsPngArena::GetTop(unsigned char buf[])
+{
+	return (unsigned char *)(((uintptr_t)(buf+ALIGNMENT)+ALIGNMENT-1)&~(uintptr_t)(ALIGNMENT-1));
+}
+
+////////////////////////////////////////////////////////////
+
+void YsPngHeader::Decode(const unsigned char dat[])
+{
+	width=PngGetUnsignedInt(dat);
+	height=PngGetUnsignedInt(dat+4);
+	bitDepth=dat[8];
+	colorType=dat[9];
+	compressionMethod=dat[10];
+	filterMethod=dat[11];
+	interlaceMethod=dat[12];
+}
+
+YsPngPalette::YsPngPalette()
+{
+	nEntry=0;
+}
+
+int YsPngPalette::Decode(unsigned length,const unsigned char dat[])
+{
+	if(length%3!=0)
+	{
+		return YSERR;
+	}
+
+	// An index is up to 255.  Entries after that are never used.
+	nEntry=length/3;
+	if(MAX_ENTRY<nEntry)
+	{
+		nEntry=MAX_ENTRY;
+	}
+	memcpy(entry,dat,nEntry*3);
+
 	return YSOK;
 }
 
 ////////////////////////////////////////////////////////////
 
-int YsPngTransparency::Decode(unsigned int length,unsigned char dat[],unsigned int colorType)
+int YsPngTransparency::Decode(unsigned int length,const unsigned char dat[],unsigned int colorType)
 {
 	unsigned int i;
 	switch(colorType)
@@ -259,27 +602,126 @@ size_t YsPngBinaryMemoryStream::GetSize(void) const
 
 size_t YsPngBinaryMemoryStream::Read(unsigned char buf[],size_t readSize)
 {
-	size_t byteCopied=0;
-	for(size_t idx=0; idx<readSize && offset<dataSize; ++idx)
+	size_t byteCopied=dataSize-offset;
+	if(readSize<byteCopied)
 	{
-		buf[idx]=binaryData[offset];
-		++offset;
-		++byteCopied;
+		byteCopied=readSize;
 	}
+	memcpy(buf,binaryData+offset,byteCopied);
+	offset+=byteCopied;
 	return byteCopied;
 }
 
+const unsigned char *YsPngBinaryMemoryStream::ReadInPlace(size_t readSize)
+{
+	if(readSize<=dataSize-offset)
+	{
+		const unsigned char *ptr=binaryData+offset;
+		offset+=readSize;
+		return ptr;
+	}
+	return NULL;
+}
 
+const unsigned char *YsPngGenericBinaryStream::ReadInPlace(size_t)
+{
+	return NULL;
+}
 
 ////////////////////////////////////////////////////////////
 
+// State of the push decoder.  Kept in the decoder for the next image.
+class YsPngPushState
+{
+public:
+	enum
+	{
+		PUSH_IDLE,       // After EndPush.
+		PUSH_SIGNATURE,
+		PUSH_CHUNK_HEADER,
+		PUSH_CHUNK_DATA,
+		PUSH_CHUNK_CRC,
+		PUSH_COMPLETE,
+		PUSH_ERROR,
+
+		KEPT_CHUNK_SIZE=1024  // IHDR, PLTE, tRNS, and gAMA are kept up to this size.
+	};
+
+	unsigned int state;
+	unsigned char headerBuf[8];  // Signature, chunk length and type, or CRC.
+	unsigned int headerFilled;
+
+	unsigned int chunkType;
+	size_t chunkLength,chunkLeft;
+	unsigned int crc;  // Of the chunk type and the data so far.
+	bool keepChunk;
+	unsigned char chunkDat[KEPT_CHUNK_SIZE];
+
+	bool idatBegun,idatEnded;
+	bool outputReady;
+	bool complete;
+	bool iendReached;  // Kept after EndPush until the next Begin.
+
+	YsPngUncompressor uncompressor;
+	YsPngBitReader bits;
+	YsPngByteSpan inSpan;
+	size_t inUsed;
+	unsigned char inBuf[YsGenericPngDecoder::PUSH_BUFFER_SIZE];
+
+	YsPngPushState();
+	void Begin(void);
+};
+
+YsPngPushState::YsPngPushState()
+{
+	Begin();
+}
+
+void YsPngPushState::Begin(void)
+{
+	uncompressor.End();
+	state=PUSH_SIGNATURE;
+	headerFilled=0;
+	chunkType=0;
+	chunkLength=0;
+	chunkLeft=0;
+	crc=0;
+	keepChunk=false;
+	idatBegun=false;
+	idatEnded=false;
+	outputReady=false;
+	complete=false;
+	iendReached=false;
+	bits.Begin(0,NULL);
+	inSpan.dat=inBuf;
+	inSpan.length=0;
+	inUsed=0;
+}
+
 YsGenericPngDecoder::YsGenericPngDecoder()
 {
+	verboseMode=YSFALSE;
+	verifyChecksum=YSTRUE;
+	push=NULL;
+	rowBuf=NULL;
+	rowLength=0;
+	rowFilled=0;
+	rowHei=0;
+	rowAdler=1;
+	rowPass=0;
+	rowY=0;
 	Initialize();
 }
 
+YsGenericPngDecoder::~YsGenericPngDecoder()
+{
+	delete push;
+	EndRow();
+}
+
 void YsGenericPngDecoder::Initialize(void)
 {
+	plt.nEntry=0;
 	gamma=gamma_default;
 	trns.col[0]=0x7fffffff;
 	trns.col[1]=0x7fffffff;
@@ -302,6 +744,8 @@ int YsGenericPngDecoder::ReadChunk(unsigned &length,unsigned char *&buf,unsigned
 {
 	unsigned char dwBuf[4];
 
+	buf=NULL;
+
 	if(binStream.Read(dwBuf,4)<4)
 	{
 		return YSERR;
@@ -314,26 +758,27 @@ int YsGenericPngDecoder::ReadChunk(unsigned &length,unsigned char *&buf,unsigned
 	}
 	chunkType=PngGetUnsignedInt(dwBuf);
 
-	if(YsGenericPngDecoder::verboseMode==YSTRUE)
+	if(verboseMode==YSTRUE)
 	{
 		printf("Chunk name=%c%c%c%c\n",dwBuf[0],dwBuf[1],dwBuf[2],dwBuf[3]);
 	}
 
+	buf=NULL;
 	if(length>0)
 	{
 		buf=new unsigned char [length];
 		if(binStream.Read(buf,length)<length)
 		{
+			delete [] buf;
+			buf=NULL;
 			return YSERR;
 		}
 	}
-	else
-	{
-		buf=NULL;
-	}
 
 	if(binStream.Read(dwBuf,4)<4)
 	{
+		delete [] buf;
+		buf=NULL;
 		return YSERR;
 	}
 	crc=PngGetUnsignedInt(dwBuf);
@@ -343,8 +788,6 @@ int YsGenericPngDecoder::ReadChunk(unsigned &length,unsigned char *&buf,unsigned
 
 ////////////////////////////////////////////////////////////
 
-int YsPngHuffmanTree::leakTracker=0;
-
 YsPngHuffmanTree::YsPngHuffmanTree()
 {
 	zeroOne[0]=NULL;
@@ -352,12 +795,10 @@ YsPngHuffmanTree::YsPngHuffmanTree()
 	dat=0x7fffffff;
 	weight=0;
 	depth=1;
-	leakTracker++;
 }
 
 YsPngHuffmanTree::~YsPngHuffmanTree()
 {
-	leakTracker--;
 }
 
 void YsPngHuffmanTree::DeleteHuffmanTree(YsPngHuffmanTree *node)
@@ -372,615 +813,819 @@ void YsPngHuffmanTree::DeleteHuffmanTree(YsPngHuffmanTree *node)
 
 ////////////////////////////////////////////////////////////
 
-void YsPngUncompressor::MakeFixedHuffmanCode(unsigned hLength[288],unsigned hCode[288])
+void YsPngBitReader::Begin(size_t nSpan,const YsPngByteSpan span[])
 {
-	unsigned i;
-	for(i=0; i<=143; i++)
-	{
-		hLength[i]=8;
-		hCode[i]=0x30+i;
-	}
-	for(i=144; i<=255; i++)
-	{
-		hLength[i]=9;
-		hCode[i]=0x190+(i-144);
-	}
-	for(i=256; i<=279; i++)
-	{
-		hLength[i]=7;
-		hCode[i]=i-256;
-	}
-	for(i=280; i<=287; i++)
+	this->span=span;
+	this->nSpan=nSpan;
+	spanIdx=0;
+	dat=NULL;
+	length=0;
+	bytePtr=0;
+	bitBuf=0;
+	nBit=0;
+	nPadByte=0;
+	morePending=false;
+	if(0<nSpan)
 	{
-		hLength[i]=8;
-		hCode[i]=0xc0+(i-280);
+		dat=span[0].dat;
+		length=span[0].length;
 	}
 }
 
-void YsPngUncompressor::MakeDynamicHuffmanCode(unsigned hLength[],unsigned hCode[],unsigned nLng,unsigned lng[])
+void YsPngBitReader::Continue(size_t nSpan,const YsPngByteSpan span[])
 {
-	unsigned i,maxLng,code,*bl_count,*next_code,bits,n;
-
-	for(i=0; i<nLng; i++)
+	this->span=span;
+	this->nSpan=nSpan;
+	spanIdx=0;
+	dat=NULL;
+	length=0;
+	bytePtr=0;
+	if(0<nSpan)
 	{
-		hLength[i]=lng[i];
-		hCode[i]=0;
+		dat=span[0].dat;
+		length=span[0].length;
 	}
+}
 
-	maxLng=0;
-	for(i=0; i<nLng; i++)
+bool YsPngBitReader::NextSpan(void)
+{
+	while(spanIdx+1<nSpan)
 	{
-		if(maxLng<lng[i])
+		++spanIdx;
+		if(0<span[spanIdx].length)
 		{
-			maxLng=lng[i];
+			dat=span[spanIdx].dat;
+			length=span[spanIdx].length;
+			bytePtr=0;
+			return true;
 		}
 	}
+	return false;
+}
 
-	bl_count=new unsigned [maxLng+1];
-	next_code=new unsigned [maxLng+1];
-	for(i=0; i<maxLng+1; i++)
+void YsPngBitReader::AlignToByte(void)
+{
+	Consume(nBit&7);
+}
+
+bool YsPngBitReader::IsOverrun(void) const
+{
+	return nBit<nPadByte*8;
+}
+
+size_t YsPngBitReader::GetAvailableBits(void) const
+{
+	if(nBit<nPadByte*8)
 	{
-		bl_count[i]=0;
-		next_code[i]=0;
+		return 0;
 	}
-	for(i=0; i<nLng; i++)
+	size_t nByte=length-bytePtr;
+	for(size_t i=spanIdx+1; i<nSpan; ++i)
 	{
-		bl_count[lng[i]]++;
+		nByte+=span[i].length;
 	}
+	return nBit-nPadByte*8+nByte*8;
+}
 
-	// for(i=0; i<maxLng+1; i++)
-	// {
-	// 	printf("bl_count[%d]=%d\n",i,bl_count[i]);
-	// }
+////////////////////////////////////////////////////////////
 
-	// See RFC1951 Specification
-	code=0;
-	bl_count[0]=0;
-	for(bits=1; bits<=maxLng; bits++)
+int YsPngHuffmanTable::Make(unsigned int n,const unsigned int hLength[],unsigned int primaryBits)
+{
+	unsigned int i,len;
+
+	if(MAX_SYMBOLS<n || MAX_PRIMARY_BITS<primaryBits)
 	{
-		code=(code+bl_count[bits-1])<<1;
-		next_code[bits]=code;
+		return YSERR;
 	}
 
-	for(n=0; n<nLng; n++)
+	unsigned int count[MAX_CODE_LENGTH+1];
+	for(len=0; len<=MAX_CODE_LENGTH; len++)
 	{
-		unsigned len;
-		len=lng[n];
-		if(len>0)
+		count[len]=0;
+	}
+	for(i=0; i<n; i++)
+	{
+		if(MAX_CODE_LENGTH<hLength[i])
 		{
-			hCode[n]=next_code[len]++;
+			return YSERR;
 		}
+		count[hLength[i]]++;
 	}
+	count[0]=0;
 
-	if(bl_count!=NULL)
+	// Over-subscribed code lengths cannot make a prefix code.
+	int left=1;
+	for(len=1; len<=MAX_CODE_LENGTH; len++)
 	{
-		delete [] bl_count;
+		left<<=1;
+		left-=(int)count[len];
+		if(left<0)
+		{
+			return YSERR;
+		}
 	}
-	if(next_code!=NULL)
+
+	// See RFC1951 Specification
+	unsigned int nextCode[MAX_CODE_LENGTH+1],code=0;
+	nextCode[0]=0;
+	for(len=1; len<=MAX_CODE_LENGTH; len++)
 	{
-		delete [] next_code;
+		code=(code+count[len-1])<<1;
+		nextCode[len]=code;
 	}
-}
-
-int YsPngUncompressor::DecodeDynamicHuffmanCode
-	   (unsigned int &hLit,unsigned int &hDist,unsigned int &hCLen,
-	    unsigned int *&hLengthLiteral,unsigned int *&hCodeLiteral,
-	    unsigned int *&hLengthDist,unsigned int *&hCodeDist,
-	    unsigned int hLengthBuf[322],unsigned int hCodeBuf[322],
-	    const unsigned char dat[],unsigned int &bytePtr,unsigned int &bitPtr)
-{
-	unsigned int i;
-	hLit=0;
-	hDist=0;
-	hCLen=0;
-
-	hLit=GetNextMultiBit(dat,bytePtr,bitPtr,5);
-	hDist=GetNextMultiBit(dat,bytePtr,bitPtr,5);
-	hCLen=GetNextMultiBit(dat,bytePtr,bitPtr,4);
 
-	if(YsGenericPngDecoder::verboseMode==YSTRUE)
+	// Codes are stored MSB first, but the stream gives the LSB first.  Table is indexed by the reversed code.
+	unsigned int reversed[MAX_SYMBOLS];
+	for(i=0; i<n; i++)
 	{
-		printf("hLit=%d hDist=%d hCLen=%d\n",hLit,hDist,hCLen);
+		reversed[i]=0;
+		if(0<hLength[i])
+		{
+			unsigned int c=nextCode[hLength[i]]++;
+			for(len=0; len<hLength[i]; len++)
+			{
+				reversed[i]=(reversed[i]<<1)|((c>>len)&1);
+			}
+		}
 	}
 
-	const unsigned int codeLengthLen=19;
-	unsigned codeLengthOrder[codeLengthLen]=
-	{
-		16,17,18,0,8,7,9,6,10,5,11,4,12,3,13,2,14,1,15
-	};
-	unsigned codeLengthCode[codeLengthLen];
-	for(i=0; i<codeLengthLen; i++)
+	const unsigned int nPrimary=(1<<primaryBits);
+	const unsigned int primaryMask=nPrimary-1;
+	this->primaryBits=primaryBits;
+	nEntry=nPrimary;
+	for(i=0; i<nPrimary; i++)
 	{
-		codeLengthCode[i]=0;
+		entry[i]=(ENTRY_INVALID<<24);
 	}
-	for(i=0; i<hCLen+4; i++)
+
+	// Subtable of a primary entry is as large as the longest code that starts with it.
+	unsigned char subBits[1<<MAX_PRIMARY_BITS];
+	for(i=0; i<nPrimary; i++)
 	{
-		codeLengthCode[codeLengthOrder[i]]=GetNextMultiBit(dat,bytePtr,bitPtr,3);
-		// printf("Code length code[%d]=%d (for %d)\n",
-		//     codeLengthOrder[i],codeLengthCode[i],codeLengthOrder[i]);
+		subBits[i]=0;
 	}
-
-	unsigned hLengthCode[codeLengthLen],hCodeCode[codeLengthLen];
-	MakeDynamicHuffmanCode(hLengthCode,hCodeCode,codeLengthLen,codeLengthCode);
-
-	if(YSTRUE==YsGenericPngDecoder::verboseMode)
+	for(i=0; i<n; i++)
 	{
-		for(i=0; i<hCLen+4; i++)
+		if(primaryBits<hLength[i])
 		{
-			printf("CodeLengthLen[%3d]=%d  HuffmanCode=%08x\n",i,codeLengthCode[i],hCodeCode[i]);
+			unsigned int prefix=(reversed[i]&primaryMask);
+			if(subBits[prefix]<hLength[i]-primaryBits)
+			{
+				subBits[prefix]=(unsigned char)(hLength[i]-primaryBits);
+			}
 		}
 	}
-
-	// for(i=0; i<codeLengthLen; i++)
-	// {
-	// 	printf("[%d] %08x %08xx\n",i,hLengthCode[i],hCodeCode[i]);
-	// }
-
-	hLengthLiteral=hLengthBuf;
-	hCodeLiteral=hCodeBuf;
-	hLengthDist=hLengthBuf+hLit+257;
-	hCodeDist=hCodeBuf+hLit+257;
-
-	YsPngHuffmanTree *lengthTree,*lengthTreePtr;
-	lengthTree=MakeHuffmanTree(codeLengthLen,hLengthCode,hCodeCode);
-
-	unsigned int nExtr;
-	nExtr=0;
-	lengthTreePtr=lengthTree;
-	while(nExtr<hLit+257+hDist+1)
+	for(i=0; i<nPrimary; i++)
 	{
-		lengthTreePtr=lengthTreePtr->Traverse(GetNextBit(dat,bytePtr,bitPtr));
-		if(lengthTreePtr->Zero()==NULL && lengthTreePtr->One()==NULL)
+		if(0<subBits[i])
 		{
-			unsigned value,copyLength;
-			value=lengthTreePtr->dat;
-
-			// printf("Value=%d\n",value);
-
-			if(value<=15)
+			unsigned int size=(1<<subBits[i]);
+			if(MAX_ENTRIES<nEntry+size)
 			{
-				hLengthBuf[nExtr++]=value;
+				return YSERR;
 			}
-			else if(value==16)
+			entry[i]=(ENTRY_SUBTABLE<<24)|(subBits[i]<<16)|nEntry;
+			for(unsigned int j=0; j<size; j++)
 			{
-				copyLength=3+GetNextMultiBit(dat,bytePtr,bitPtr,2);
-				// printf("copyLength=%d\n",copyLength);
-				while(copyLength>0)
-				{
-					hLengthBuf[nExtr]=hLengthBuf[nExtr-1];
-					nExtr++;
-					copyLength--;
-				}
+				entry[nEntry+j]=(ENTRY_INVALID<<24);
 			}
-			else if(value==17)
+			nEntry+=size;
+		}
+	}
+
+	for(i=0; i<n; i++)
+	{
+		len=hLength[i];
+		if(0<len && len<=primaryBits)
+		{
+			for(unsigned int j=reversed[i]; j<nPrimary; j+=(1<<len))
 			{
-				copyLength=3+GetNextMultiBit(dat,bytePtr,bitPtr,3);
-				// printf("copyLength=%d\n",copyLength);
-				while(copyLength>0)
-				{
-					hLengthBuf[nExtr++]=0;
-					copyLength--;
-				}
+				entry[j]=(ENTRY_SYMBOL<<24)|(len<<16)|i;
 			}
-			else if(value==18)
+		}
+		else if(primaryBits<len)
+		{
+			unsigned int link=entry[reversed[i]&primaryMask];
+			unsigned int size=(1<<((link>>16)&0xff));
+			unsigned int subLen=len-primaryBits;
+			for(unsigned int j=(reversed[i]>>primaryBits); j<size; j+=(1<<subLen))
 			{
-				copyLength=11+GetNextMultiBit(dat,bytePtr,bitPtr,7);
-				// printf("copyLength=%d\n",copyLength);
-				while(copyLength>0)
-				{
-					hLengthBuf[nExtr++]=0;
-					copyLength--;
-				}
+				entry[(link&0xffff)+j]=(ENTRY_SYMBOL<<24)|(subLen<<16)|i;
 			}
+		}
+	}
 
-			lengthTreePtr=lengthTree;
+	return YSOK;
+}
 
-			// printf("nExtr=%d/%d\n",nExtr,hLit+257+hDist+1);
-		}
+////////////////////////////////////////////////////////////
+
+void YsPngUncompressor::MakeFixedHuffmanCode(unsigned hLength[288],unsigned hCode[288])
+{
+	unsigned i;
+	for(i=0; i<=143; i++)
+	{
+		hLength[i]=8;
+		hCode[i]=0x30+i;
+	}
+	for(i=144; i<=255; i++)
+	{
+		hLength[i]=9;
+		hCode[i]=0x190+(i-144);
+	}
+	for(i=256; i<=279; i++)
+	{
+		hLength[i]=7;
+		hCode[i]=i-256;
+	}
+	for(i=280; i<=287; i++)
+	{
+		hLength[i]=8;
+		hCode[i]=0xc0+(i-280);
+	}
+}
+
+void YsPngUncompressor::MakeDynamicHuffmanCode(unsigned hLength[],unsigned hCode[],unsigned nLng,unsigned lng[])
+{
+	unsigned i,maxLng,code,*bl_count,*next_code,bits,n;
+
+	for(i=0; i<nLng; i++)
+	{
+		hLength[i]=lng[i];
+		hCode[i]=0;
 	}
 
-	if(YSTRUE==YsGenericPngDecoder::verboseMode)
+	maxLng=0;
+	for(i=0; i<nLng; i++)
 	{
-		for(i=0; i<hLit+257; i++)
-		{
-			printf("LiteralLength[%3d]=%d\n",i,hLengthLiteral[i]);
-		}
-		for(i=0; i<hDist+1; i++)
+		if(maxLng<lng[i])
 		{
-			printf("Dist [%d] Length %d\n",i,hLengthDist[i]);
+			maxLng=lng[i];
 		}
 	}
 
-	if(YsGenericPngDecoder::verboseMode==YSTRUE)
+	bl_count=new unsigned [maxLng+1];
+	next_code=new unsigned [maxLng+1];
+	for(i=0; i<maxLng+1; i++)
 	{
-		printf("Making Huffman Code from Code Lengths\n");
+		bl_count[i]=0;
+		next_code[i]=0;
+	}
+	for(i=0; i<nLng; i++)
+	{
+		bl_count[lng[i]]++;
 	}
-	MakeDynamicHuffmanCode(hLengthLiteral,hCodeLiteral,hLit+257,hLengthLiteral);
-	MakeDynamicHuffmanCode(hLengthDist,hCodeDist,hDist+1,hLengthDist);
-
-	DeleteHuffmanTree(lengthTree);
 
-	return YSOK;
-}
+	// for(i=0; i<maxLng+1; i++)
+	// {
+	// 	printf("bl_count[%d]=%d\n",i,bl_count[i]);
+	// }
 
-YsPngHuffmanTree *YsPngUncompressor::MakeHuffmanTree(unsigned n,unsigned hLength[],unsigned hCode[])
-{
-	unsigned i,j,mask;
-	YsPngHuffmanTree *root,*ptr;
-	root=new YsPngHuffmanTree;
+	// See RFC1951 Specification
+	code=0;
+	bl_count[0]=0;
+	for(bits=1; bits<=maxLng; bits++)
+	{
+		code=(code+bl_count[bits-1])<<1;
+		next_code[bits]=code;
+	}
 
-	for(i=0; i<n; i++)
+	for(n=0; n<nLng; n++)
 	{
-		if(hLength[i]>0)
+		unsigned len;
+		len=lng[n];
+		if(len>0)
 		{
-			ptr=root;
-			mask=(1<<(hLength[i]-1));
-			for(j=0; j<hLength[i]; j++)
-			{
-				if(hCode[i]&mask)
-				{
-					if(ptr->One()==NULL)
-					{
-						ptr->One()=new YsPngHuffmanTree;
-					}
-					ptr=ptr->One();
-				}
-				else
-				{
-					if(ptr->Zero()==NULL)
-					{
-						ptr->Zero()=new YsPngHuffmanTree;
-					}
-					ptr=ptr->Zero();
-				}
-				mask>>=1;
-			}
-			ptr->dat=i;
+			hCode[n]=next_code[len]++;
 		}
 	}
 
-	return root;
+	if(bl_count!=NULL)
+	{
+		delete [] bl_count;
+	}
+	if(next_code!=NULL)
+	{
+		delete [] next_code;
+	}
 }
 
-void YsPngUncompressor::DeleteHuffmanTree(YsPngHuffmanTree *node)
+int YsPngUncompressor::DecodeDynamicHuffmanCode(YsPngHuffmanTable &literalTable,YsPngHuffmanTable &distTable,YsPngBitReader &bits)
 {
-	YsPngHuffmanTree::DeleteHuffmanTree(node);
-}
+	unsigned int i;
+	unsigned int hLit,hDist,hCLen;
 
-unsigned YsPngUncompressor::GetCopyLength(unsigned value,unsigned char dat[],unsigned &bytePtr,unsigned &bitPtr)
-{
-	unsigned copyLength;
+	hLit=bits.GetBits(5);
+	hDist=bits.GetBits(5);
+	hCLen=bits.GetBits(4);
 
-	if(value<=264)
+	if(verboseMode==YSTRUE)
 	{
-		copyLength=3+(value-257);
+		printf("hLit=%d hDist=%d hCLen=%d\n",hLit,hDist,hCLen);
 	}
-	else if(value>=285)
+
+	const unsigned int codeLengthLen=19;
+	static const unsigned codeLengthOrder[codeLengthLen]=
+	{
+		16,17,18,0,8,7,9,6,10,5,11,4,12,3,13,2,14,1,15
+	};
+	unsigned codeLengthCode[codeLengthLen];
+	for(i=0; i<codeLengthLen; i++)
 	{
-		copyLength=258;
+		codeLengthCode[i]=0;
 	}
-	else
+	for(i=0; i<hCLen+4; i++)
 	{
-		unsigned base,offset,extBits;
-		extBits=1+(value-265)/4;
-		base=(8<<((value-265)/4))+3;
-		offset=((value-265)&3)*(2<<((value-265)/4));
-
-		copyLength=GetNextMultiBit(dat,bytePtr,bitPtr,extBits);
-		copyLength+=base+offset;
+		codeLengthCode[codeLengthOrder[i]]=bits.GetBits(3);
 	}
 
-	return copyLength;
-}
-
-unsigned YsPngUncompressor::GetBackwardDistance
-   (unsigned distCode,unsigned char dat[],unsigned &bytePtr,unsigned &bitPtr)
-{
-	unsigned backDist;
+	if(YSTRUE==verboseMode)
+	{
+		for(i=0; i<hCLen+4; i++)
+		{
+			printf("CodeLengthLen[%3d]=%d\n",i,codeLengthCode[i]);
+		}
+	}
 
-	if(distCode<=3)
+	YsPngHuffmanTable lengthTable;
+	if(lengthTable.Make(codeLengthLen,codeLengthCode,CODE_LENGTH_PRIMARY_BITS)!=YSOK)
 	{
-		backDist=distCode+1;
+		printf("Broken code-length code.\n");
+		return YSERR;
 	}
-	else
+
+	const unsigned int nLength=hLit+257+hDist+1;
+	unsigned int hLengthBuf[288+32];
+	unsigned int nExtr;
+	nExtr=0;
+	while(nExtr<nLength)
 	{
-		unsigned base,offset,extBits;
+		int value=lengthTable.Decode(bits);
+		unsigned copyLength,copyValue;
+		if(value<0)
+		{
+			printf("Broken code-length code.\n");
+			return YSERR;
+		}
+		else if(value<=15)
+		{
+			hLengthBuf[nExtr++]=value;
+			continue;
+		}
+		else if(value==16)
+		{
+			if(nExtr==0)
+			{
+				printf("Code length repeated before the first length.\n");
+				return YSERR;
+			}
+			copyLength=3+bits.GetBits(2);
+			copyValue=hLengthBuf[nExtr-1];
+		}
+		else if(value==17)
+		{
+			copyLength=3+bits.GetBits(3);
+			copyValue=0;
+		}
+		else
+		{
+			copyLength=11+bits.GetBits(7);
+			copyValue=0;
+		}
+
+		if(nLength<nExtr+copyLength)
+		{
+			printf("Too many code lengths.\n");
+			return YSERR;
+		}
+		while(copyLength>0)
+		{
+			hLengthBuf[nExtr++]=copyValue;
+			copyLength--;
+		}
+	}
 
-		base=(4<<((distCode-4)/2))+1;
-		offset=(distCode&1)*(2<<((distCode-4)/2));
-		extBits=(distCode-2)/2;
+	if(YSTRUE==verboseMode)
+	{
+		for(i=0; i<hLit+257; i++)
+		{
+			printf("LiteralLength[%3d]=%d\n",i,hLengthBuf[i]);
+		}
+		for(i=0; i<hDist+1; i++)
+		{
+			printf("Dist [%d] Length %d\n",i,hLengthBuf[hLit+257+i]);
+		}
+	}
 
-		backDist=GetNextMultiBit(dat,bytePtr,bitPtr,extBits);
-		backDist+=base+offset;
+	if(verboseMode==YSTRUE)
+	{
+		printf("Making Huffman Table from Code Lengths\n");
+	}
+	if(literalTable.Make(hLit+257,hLengthBuf,LITERAL_PRIMARY_BITS)!=YSOK ||
+	   distTable.Make(hDist+1,hLengthBuf+hLit+257,DISTANCE_PRIMARY_BITS)!=YSOK)
+	{
+		printf("Broken Huffman code.\n");
+		return YSERR;
 	}
 
-	return backDist;
+	return YSOK;
 }
 
-int YsPngUncompressor::Uncompress(unsigned length,unsigned char dat[])
+static const unsigned short PngLengthBase[29]=
 {
-	unsigned windowUsed;
-	unsigned char *windowBuf;
-	unsigned nByteExtracted;
-
-	YsPngHuffmanTree *codeTree=NULL;
-	YsPngHuffmanTree *distTree=NULL;
+	3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258
+};
+static const unsigned char PngLengthExtraBits[29]=
+{
+	0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0
+};
+static const unsigned short PngDistanceBase[30]=
+{
+	1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,1025,1537,2049,3073,4097,6145,8193,12289,16385,24577
+};
+static const unsigned char PngDistanceExtraBits[30]=
+{
+	0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13
+};
 
+unsigned YsPngUncompressor::GetCopyLength(unsigned value,YsPngBitReader &bits)
+{
+	// value must be 257 to 285.
+	return PngLengthBase[value-257]+bits.GetBits(PngLengthExtraBits[value-257]);
+}
 
-	windowBuf=NULL;
+unsigned YsPngUncompressor::GetBackwardDistance(unsigned distCode,YsPngBitReader &bits)
+{
+	// distCode must be 0 to 29.
+	return PngDistanceBase[distCode]+bits.GetBits(PngDistanceExtraBits[distCode]);
+}
 
-	unsigned bytePtr,bitPtr;
-	bytePtr=0;
-	bitPtr=1;
-	nByteExtracted=0;
+int YsPngUncompressor::Uncompress(unsigned length,unsigned char dat[])
+{
+	YsPngByteSpan span;
+	span.dat=dat;
+	span.length=length;
+	return Uncompress(1,&span);
+}
 
+int YsPngUncompressor::Uncompress(size_t nSpan,const YsPngByteSpan span[])
+{
+	YsPngBitReader bits;
+	bits.Begin(nSpan,span);
 
-	if(YsGenericPngDecoder::verboseMode==YSTRUE)
+	if(verboseMode==YSTRUE)
 	{
-		printf("Begin zLib block length=%d bytePtr=%d bitPtr=0x%02x\n",length,bytePtr,bitPtr);
+		size_t length=0;
+		for(size_t i=0; i<nSpan; ++i)
+		{
+			length+=span[i].length;
+		}
+		printf("Begin zLib block length=%d (%d spans)\n",(int)length,(int)nSpan);
 	}
 
-	unsigned char cmf,flg;
-	cmf=dat[bytePtr++];
-	flg=dat[bytePtr++];
-
-	unsigned cm,cInfo,windowSize;
-	cm=cmf&0x0f;
-	if(cm!=8)
-	{
-		printf("Unsupported compression method! (%d)\n",cm);
-		goto ERREND;
-	}
+	Begin();
+	int res=Run(bits,true);
+	End();
+	return res;
+}
 
-	cInfo=(cmf&0xf0)>>4;
-	windowSize=1<<(cInfo+8);
+YsPngUncompressor::YsPngUncompressor()
+{
+	output=NULL;
+	verboseMode=YSFALSE;
+	arena=NULL;
+	windowBuf=NULL;
+	windowInArena=false;
+	Begin();
+}
 
-	if(YsGenericPngDecoder::verboseMode==YSTRUE)
-	{
-		printf("cInfo=%d, Window Size=%d\n",cInfo,windowSize);
-	}
+YsPngUncompressor::~YsPngUncompressor()
+{
+	End();
+}
 
-	windowBuf=new unsigned char [windowSize];
+void YsPngUncompressor::Begin(void)
+{
+	state=STATE_ZLIB_HEADER;
+	windowSize=0;
 	windowUsed=0;
+	bFinal=0;
+	storedLeft=0;
+	fixedTableReady=false;
+	nByteExtracted=0;
+	codeTable=NULL;
+	distCodeTable=NULL;
+}
 
+bool YsPngUncompressor::IsEnd(void) const
+{
+	return STATE_END==state;
+}
 
-
-	unsigned fCheck,fDict,fLevel;
-	fCheck=(flg&15);
-	fDict=(flg&32)>>5;
-	fLevel=(flg&192)>>6;
-
-	if(YsGenericPngDecoder::verboseMode==YSTRUE)
+void YsPngUncompressor::End(void)
+{
+	if(verboseMode==YSTRUE && NULL!=windowBuf && STATE_END==state)
 	{
-		printf("fCheck=%d fDict=%d fLevel=%d\n",fCheck,fDict,fLevel);
+		printf("End zLib block\n");
+		printf("Output %d bytes.\n",nByteExtracted);
 	}
 
-
-	if(fDict!=0)
+	if(true!=windowInArena)
 	{
-		printf("PNG is not supposed to have a preset dictionary.\n");
-		goto ERREND;
+		delete [] windowBuf;
 	}
+	windowBuf=NULL;
+	windowInArena=false;
+}
 
+int YsPngUncompressor::Run(YsPngBitReader &bits,bool allInput)
+{
+	// The window and the position are kept in local variables while uncompressing.
+	unsigned char *windowBuf=this->windowBuf;
+	unsigned int windowUsed=this->windowUsed;
+	unsigned int windowMask=windowSize-1;
 
-	YsPngHuffmanTree *codeTreePtr;
-	YsPngHuffmanTree *distTreePtr;
-
-	for(;;)
+	while(STATE_END!=state)
 	{
-		unsigned bFinal,bType;
-
-		bFinal=GetNextBit(dat,bytePtr,bitPtr);
-		bType=GetNextMultiBit(dat,bytePtr,bitPtr,2);
-
-		if(bytePtr>=length)
-		{
-			printf("Buffer overflow\n");
-			goto ERREND;
-		}
-
-		if(YsGenericPngDecoder::verboseMode==YSTRUE)
-		{
-			printf("bFinal=%d bType=%d\n",bFinal,bType);
-		}
-
-		if(bType==0) // No Compression
+		if(STATE_ZLIB_HEADER==state)
 		{
-			unsigned len;
-			if(bitPtr!=1)
+			if(true!=allInput && bits.GetAvailableBits()<16)
 			{
-				bitPtr=1;
-				bytePtr++;
+				break;
 			}
-			if(bytePtr>=length)
+
+			unsigned char cmf,flg;
+			cmf=(unsigned char)bits.GetBits(8);
+			flg=(unsigned char)bits.GetBits(8);
+			if(true==bits.IsOverrun())
 			{
 				printf("Buffer overflow\n");
 				goto ERREND;
 			}
 
-			len=dat[bytePtr]+dat[bytePtr+1]*256;
-			bytePtr+=4;
+			unsigned cm,cInfo;
+			cm=cmf&0x0f;
+			if(cm!=8)
+			{
+				printf("Unsupported compression method! (%d)\n",cm);
+				goto ERREND;
+			}
 
-			// Feed len bytes
+			// The window is always 32KB, which is the largest allowed.
+			cInfo=(cmf&0xf0)>>4;
+			if(7<cInfo)
+			{
+				printf("Window size is too large! (cInfo=%d)\n",cInfo);
+				goto ERREND;
+			}
 
-			for(int i=0; i<(int)len; i++)  // 2010/02/08
+			if(verboseMode==YSTRUE)
 			{
-				output->Output(dat[bytePtr+i]);
-				windowBuf[windowUsed++]=dat[bytePtr+i];  // 2014/03/22
-				windowUsed&=(windowSize-1);              // 2014/03/22
+				printf("cInfo=%d, Window Size=%d\n",cInfo,1<<(cInfo+8));
 			}
 
-			bytePtr+=len;
-		}
-		else if(bType==1 || bType==2)
-		{
-			codeTree=NULL;
+			unsigned fCheck,fDict,fLevel;
+			fCheck=(flg&15);
+			fDict=(flg&32)>>5;
+			fLevel=(flg&192)>>6;
 
-			if(bType==1)
+			if(verboseMode==YSTRUE)
 			{
-				unsigned hLength[288],hCode[288];
-				MakeFixedHuffmanCode(hLength,hCode);
-				codeTree=MakeHuffmanTree(288,hLength,hCode);
-				distTree=NULL;
+				printf("fCheck=%d fDict=%d fLevel=%d\n",fCheck,fDict,fLevel);
 			}
-			else
+
+			if(fDict!=0)
 			{
-				unsigned hLit,hDist,hCLen;
-				unsigned *hLengthLiteral,*hCodeLiteral;
-				unsigned *hLengthDist,*hCodeDist;
-				unsigned hLengthBuf[322],hCodeBuf[322];
+				printf("PNG is not supposed to have a preset dictionary.\n");
+				goto ERREND;
+			}
 
-				DecodeDynamicHuffmanCode
-				   (hLit,hDist,hCLen,
-				    hLengthLiteral,hCodeLiteral,hLengthDist,hCodeDist,hLengthBuf,hCodeBuf,
-				    dat,bytePtr,bitPtr);
+			if(YSTRUE==output->verifyChecksum && 0!=((unsigned int)cmf*256+flg)%31)
+			{
+				printf("zLib header check failed.\n");
+				goto ERREND;
+			}
 
-				if(YsGenericPngDecoder::verboseMode==YSTRUE)
-				{
-					printf("Making Huffman Tree\n");
-				}
-				codeTree=MakeHuffmanTree(hLit+257,hLengthLiteral,hCodeLiteral);
-				distTree=MakeHuffmanTree(hDist+1,hLengthDist,hCodeDist);
+			if(NULL==windowBuf)
+			{
+				windowInArena=(NULL!=arena);
+				windowBuf=(true==windowInArena ? (unsigned char *)arena->Alloc(32768) : new unsigned char [32768]);
+				this->windowBuf=windowBuf;
+			}
+			windowSize=32768;
+			windowMask=windowSize-1;
+			windowUsed=0;
+			state=STATE_BLOCK_HEADER;
+		}
+		else if(STATE_BLOCK_HEADER==state)
+		{
+			if(true!=allInput && bits.GetAvailableBits()<MAX_BLOCK_HEADER_BITS)
+			{
+				break;
+			}
+
+			unsigned bType;
+			bFinal=bits.GetBits(1);
+			bType=bits.GetBits(2);
+
+			if(true==bits.IsOverrun())
+			{
+				printf("Buffer overflow\n");
+				goto ERREND;
 			}
 
+			if(verboseMode==YSTRUE)
+			{
+				printf("bFinal=%d bType=%d\n",bFinal,bType);
+			}
 
-			if(YsGenericPngDecoder::verboseMode==YSTRUE)
+			if(bType==0) // No Compression
 			{
-				printf("Huffman table paprared\n");
+				bits.AlignToByte();
+				storedLeft=bits.GetBits(16);
+				bits.GetBits(16);  // One's complement of the length
+				if(true==bits.IsOverrun())
+				{
+					printf("Buffer overflow\n");
+					goto ERREND;
+				}
+				state=STATE_STORED_DATA;
 			}
+			else if(bType==1)
+			{
+				if(true!=fixedTableReady)
+				{
+					unsigned hLength[288],hCode[288];
+					MakeFixedHuffmanCode(hLength,hCode);
+					fixedLiteralTable.Make(288,hLength,LITERAL_PRIMARY_BITS);
 
+					unsigned distLength[32];
+					for(int i=0; i<32; i++)
+					{
+						distLength[i]=5;
+					}
+					fixedDistTable.Make(32,distLength,DISTANCE_PRIMARY_BITS);
+					fixedTableReady=true;
+				}
+				codeTable=&fixedLiteralTable;
+				distCodeTable=&fixedDistTable;
+				state=STATE_HUFFMAN_DATA;
+			}
+			else if(bType==2)
+			{
+				if(DecodeDynamicHuffmanCode(literalTable,distTable,bits)!=YSOK)
+				{
+					goto ERREND;
+				}
+				codeTable=&literalTable;
+				distCodeTable=&distTable;
+				state=STATE_HUFFMAN_DATA;
 
-			codeTreePtr=codeTree;
-			if(codeTree!=NULL)
+				if(verboseMode==YSTRUE)
+				{
+					printf("Huffman table paprared\n");
+				}
+			}
+			else
+			{
+				printf("Unknown compression type (bType=3)\n");
+				goto ERREND;
+			}
+		}
+		else if(STATE_STORED_DATA==state)
+		{
+			// Bytes may continue to the next span.
+			while(0<storedLeft)
+			{
+				if(true!=allInput && bits.GetAvailableBits()<8)
+				{
+					goto SUSPEND;
+				}
+				unsigned char dat=(unsigned char)bits.GetBits(8);
+				if(true==bits.IsOverrun() || output->Feed(dat)!=YSOK)
+				{
+					goto ERREND;
+				}
+				windowBuf[windowUsed++]=dat;  // 2014/03/22
+				windowUsed&=windowMask;       // 2014/03/22
+				--storedLeft;
+			}
+			state=(0!=bFinal ? STATE_ADLER32 : STATE_BLOCK_HEADER);
+		}
+		else if(STATE_HUFFMAN_DATA==state)
+		{
+			const YsPngHuffmanTable *codeTable=this->codeTable;
+			const YsPngHuffmanTable *distCodeTable=this->distCodeTable;
+			for(;;)
 			{
-				for(;;)
+				if(true!=allInput && bits.GetAvailableBits()<MAX_SYMBOL_BITS)
 				{
-					codeTreePtr=codeTreePtr->Traverse(GetNextBit(dat,bytePtr,bitPtr));
+					goto SUSPEND;
+				}
 
-					if(codeTreePtr==NULL)
+				int value=codeTable->Decode(bits);
+				if(value<256)
+				{
+					if(value<0)
 					{
-						printf("Huffman Decompression: Reached NULL node.\n");
+						printf("Huffman Decompression: Unused code.\n");
 						goto ERREND;
 					}
+					windowBuf[windowUsed++]=(unsigned char)value;
+					windowUsed&=windowMask;
+					if(output->Feed((unsigned char)value)!=YSOK)
+					{
+						goto ERREND;
+					}
+					nByteExtracted++;
+				}
+				else if(value==256)
+				{
+					break;
+				}
+				else if(value<=285)
+				{
+					unsigned copyLength,backDist;
+					int distCode;
+					copyLength=GetCopyLength(value,bits);
 
-					if(codeTreePtr->Zero()==NULL && codeTreePtr->One()==NULL)
+					distCode=distCodeTable->Decode(bits);
+					if(distCode<0 || 29<distCode)
 					{
-						// printf("[%d]\n",codeTreePtr->dat);
+						printf("Huffman Decompression: Broken distance code.\n");
+						goto ERREND;
+					}
+					backDist=GetBackwardDistance(distCode,bits);
 
-						unsigned value;
-						value=codeTreePtr->dat;
-						if(value<256)
-						{
-							windowBuf[windowUsed++]=(unsigned char)value;
-							windowUsed&=(windowSize-1);
-							if(output->Output((unsigned char)value)!=YSOK)
-							{
-								goto ERREND;
-							}
-							nByteExtracted++;
-						}
-						else if(value==256)
-						{
-							break;
-						}
-						else if(value<=285)
+					unsigned i;
+					for(i=0; i<copyLength; i++)
+					{
+						unsigned char dat;
+						dat=windowBuf[(windowUsed-backDist)&windowMask];
+						if(output->Feed(dat)!=YSOK)
 						{
-							unsigned copyLength,distCode,backDist;
-							copyLength=GetCopyLength(value,dat,bytePtr,bitPtr);
-							// printf("CopyLength %d\n",copyLength);
-
-							if(bType==1)
-							{
-								distCode=16*GetNextBit(dat,bytePtr,bitPtr);  // 5 bits fixed
-								distCode+=8*GetNextBit(dat,bytePtr,bitPtr);  // Reversed order
-								distCode+=4*GetNextBit(dat,bytePtr,bitPtr);
-								distCode+=2*GetNextBit(dat,bytePtr,bitPtr);
-								distCode+=  GetNextBit(dat,bytePtr,bitPtr);
-							}
-							else
-							{
-								distTreePtr=distTree;
-								while(distTreePtr->Zero()!=NULL || distTreePtr->One()!=NULL)
-								{
-									distTreePtr=distTreePtr->Traverse(GetNextBit(dat,bytePtr,bitPtr));
-								}
-								distCode=distTreePtr->dat;
-							}
-							backDist=GetBackwardDistance(distCode,dat,bytePtr,bitPtr);
-							// printf("DistCode %d BackDist %d\n",distCode,backDist);
-
-
-							unsigned i;
-							for(i=0; i<copyLength; i++)
-							{
-								unsigned char dat;
-								dat=windowBuf[(windowUsed-backDist)&(windowSize-1)];
-								if(output->Output(dat)!=YSOK)
-								{
-									goto ERREND;
-								}
-								nByteExtracted++;
-								windowBuf[windowUsed++]=dat;
-								windowUsed&=(windowSize-1);
-							}
+							goto ERREND;
 						}
-
-						codeTreePtr=codeTree;
+						nByteExtracted++;
+						windowBuf[windowUsed++]=dat;
+						windowUsed&=windowMask;
 					}
+				}
+				else
+				{
+					printf("Huffman Decompression: Broken length code.\n");
+					goto ERREND;
+				}
 
-					if(length<=bytePtr)
-					{
-						goto ERREND;
-					}
+				if(true==bits.IsOverrun())
+				{
+					goto ERREND;
 				}
 			}
-
-
-			DeleteHuffmanTree(codeTree);
-			DeleteHuffmanTree(distTree);
-			codeTree=NULL;
-			distTree=NULL;
+			state=(0!=bFinal ? STATE_ADLER32 : STATE_BLOCK_HEADER);
 		}
-		else
+		else if(STATE_ADLER32==state)
 		{
-			printf("Unknown compression type (bType=3)\n");
-			goto ERREND;
-		}
+			if(true!=allInput && bits.GetAvailableBits()<32+7)
+			{
+				break;
+			}
 
+			bits.AlignToByte();
+			unsigned int adler=0;
+			for(int i=0; i<4; ++i)
+			{
+				adler=(adler<<8)|bits.GetBits(8);
+			}
 
-		if(bFinal!=0)
+			if(YSTRUE==output->verifyChecksum)
+			{
+				if(true==bits.IsOverrun())
+				{
+					printf("Adler-32 is missing.\n");
+					goto ERREND;
+				}
+				if(adler!=output->GetAdler32())
+				{
+					printf("Adler-32 mismatch (%08x, computed %08x)\n",adler,output->GetAdler32());
+					goto ERREND;
+				}
+			}
+			state=STATE_END;
+		}
+		else
 		{
-			break;
+			return YSERR;
 		}
 	}
 
-	delete [] windowBuf;
-	windowBuf=NULL;
-
-
-
-	if(YsGenericPngDecoder::verboseMode==YSTRUE)
-	{
-		printf("End zLib block length=%d bytePtr=%d bitPtr=0x%02x\n",length,bytePtr,bitPtr);
-		printf("Huffman Tree Leak Tracker = %d\n",YsPngHuffmanTree::leakTracker);
-		printf("Output %d bytes.\n",nByteExtracted);
-	}
-
+SUSPEND:
+	this->windowUsed=windowUsed;
 	return YSOK;
 
 ERREND:
-	if(windowBuf!=NULL)
-	{
-		delete [] windowBuf;
-	}
-	if(codeTree!=NULL)
-	{
-		DeleteHuffmanTree(codeTree);
-	}
-	if(distTree!=NULL)
-	{
-		DeleteHuffmanTree(distTree);
-	}
+	this->windowUsed=windowUsed;
+	state=STATE_ERROR;
 	return YSERR;
 }
 
@@ -988,6 +1633,13 @@ ERREND:
 
 int YsGenericPngDecoder::Decode(const char fn[])
 {
+	MappedFile mappedFile;
+	if(true==mappedFile.Open(fn))
+	{
+		YsPngBinaryMemoryStream binStream(mappedFile.GetSize(),mappedFile.GetData());
+		return Decode(binStream);
+	}
+
 	int res=YSERR;
 	FILE *fp=fopen(fn,"rb");
 	if(NULL!=fp)
@@ -1009,1022 +1661,1516 @@ int YsGenericPngDecoder::Decode(FILE *fp)
 	return YSERR;
 }
 
-int YsGenericPngDecoder::Decode(YsPngGenericBinaryStream &binStream)
+// IDAT payloads in the order of the chunks.  The span array is taken from the arena.
+class YsPngIdatChain
+{
+public:
+	YsPngArena &arena;
+	YsPngByteSpan *span;
+	size_t nSpan,nAlloc;
+
+	explicit YsPngIdatChain(YsPngArena &arena);
+	void Add(const unsigned char dat[],size_t length);
+};
+
+YsPngIdatChain::YsPngIdatChain(YsPngArena &arena) : arena(arena)
+{
+	span=NULL;
+	nSpan=0;
+	nAlloc=0;
+}
+
+void YsPngIdatChain::Add(const unsigned char dat[],size_t length)
 {
-	const size_t fileSize=binStream.GetSize();
+	if(nAlloc<=nSpan)
+	{
+		size_t newAlloc=(0<nAlloc ? nAlloc*2 : 16);
+		YsPngByteSpan *newSpan=(YsPngByteSpan *)arena.Alloc(sizeof(YsPngByteSpan)*newAlloc);
+		for(size_t i=0; i<nSpan; ++i)
+		{
+			newSpan[i]=span[i];
+		}
+		span=newSpan;
+		nAlloc=newAlloc;
+	}
+	span[nSpan].dat=dat;
+	span[nSpan].length=length;
+	++nSpan;
+}
 
+int YsGenericPngDecoder::Decode(YsPngGenericBinaryStream &binStream)
+{
 	if(CheckSignature(binStream)!=YSOK)
 	{
 		printf("The file does not have PNG signature.\n");
 		return YSERR;
 	}
 
-	unsigned datBufUsed;
-	unsigned char *datBuf;
+	// The decoder may be used for many images.  Nothing is taken over from the previous image.
+	Initialize();
+	arena.Reset();
+	YsPngIdatChain idat(arena);
 
+	// When the stream cannot be referenced in place, each IDAT chunk is read into its own block of the arena,
+	// and the other chunks into chunkBuf.
+	unsigned char *chunkBuf=NULL;
+	unsigned chunkBufSize=0;
+	const size_t streamSize=binStream.GetSize();
 
-	datBufUsed=0;
-	datBuf=new unsigned char [fileSize];
+	for(;;)
+	{
+		unsigned char dwBuf[8];
+		if(binStream.Read(dwBuf,8)<8)
+		{
+			break;
+		}
 
+		const unsigned length=PngGetUnsignedInt(dwBuf);
+		const unsigned chunkType=PngGetUnsignedInt(dwBuf+4);
+		if(verboseMode==YSTRUE)
+		{
+			printf("Chunk name=%c%c%c%c\n",dwBuf[4],dwBuf[5],dwBuf[6],dwBuf[7]);
+		}
+		if(chunkType==IEND)
+		{
+			break;
+		}
 
-	unsigned char *buf;
-	unsigned length,chunkType,crc;
-	while(ReadChunk(length,buf,chunkType,crc,binStream)==YSOK && chunkType!=IEND)
-	{
-		switch(chunkType)
+		if(streamSize<length)
 		{
-		default:
-			if(buf!=NULL)
-			{
-				delete [] buf;
-			}
+			// Broken length.  Not to allocate for it.
 			break;
-		case IHDR:
-			if(buf!=NULL)
+		}
+
+		const unsigned char *buf=binStream.ReadInPlace(length);
+		if(NULL==buf && 0<length)
+		{
+			if(chunkType==IDAT)
 			{
-				if(length>=13)
-				{
-					hdr.Decode(buf);
-				}
-				delete [] buf;
+				buf=(unsigned char *)arena.Alloc(length);
 			}
-			break;
-		case PLTE:
-			if(buf!=NULL)
+			else
 			{
-				if(plt.Decode(length,buf)!=YSOK)
+				if(chunkBufSize<length)
 				{
-					delete [] buf;
-					return YSERR;
+					chunkBuf=(unsigned char *)arena.Alloc(length);
+					chunkBufSize=length;
 				}
-				delete [] buf;
-			}
-			break;
-		case tRNS:
-			if(buf!=NULL)
-			{
-				trns.Decode(length,buf,hdr.colorType);
-				delete [] buf;
+				buf=chunkBuf;
 			}
-			break;
-		case gAMA:
-			if(buf!=NULL && length>=4)
+			if(binStream.Read((unsigned char *)buf,length)<length)
 			{
-				gamma=PngGetUnsignedInt(buf);
-				if(YsGenericPngDecoder::verboseMode==YSTRUE)
-				{
-					printf("Gamma %d (default=%d)\n",gamma,gamma_default);
-				}
-				delete [] buf;
+				break;
 			}
+		}
+
+		unsigned int crc=0;
+		if(YSTRUE==verifyChecksum)
+		{
+			crc=PngCrc32(PngCrc32(0,dwBuf+4,4),buf,length);
+		}
+
+		if(binStream.Read(dwBuf,4)<4)  // CRC
+		{
 			break;
-		case IDAT:
-			if(buf!=NULL)
+		}
+
+		if(YSTRUE==verifyChecksum && crc!=PngGetUnsignedInt(dwBuf))
+		{
+			printf("CRC error in chunk %c%c%c%c.\n",(chunkType>>24)&255,(chunkType>>16)&255,(chunkType>>8)&255,chunkType&255);
+			return YSERR;
+		}
+
+		if(chunkType==IDAT)
+		{
+			if(length>0)
 			{
-				unsigned i;
-				for(i=0; i<length; i++)
-				{
-					datBuf[datBufUsed+i]=buf[i];
-				}
-				datBufUsed+=length;
-				delete [] buf;
+				idat.Add(buf,length);
 			}
-			break;
+		}
+		else if(DecodeChunk(chunkType,length,buf)!=YSOK)
+		{
+			return YSERR;
 		}
 	}
 
 
 
-	if(PrepareOutput()==YSOK)
+	// Same as BeginPushUncompress.  An image that cannot be output, such as an unsupported format, is an error.
+	int res=YSERR;
+	if(PrepareOutput()==YSOK && BeginRow()==YSOK)
 	{
+		res=YSOK;
 		YsPngUncompressor uncompressor;
 		uncompressor.output=this;
-		uncompressor.Uncompress(datBufUsed,datBuf);
+		uncompressor.verboseMode=verboseMode;
+		uncompressor.arena=&arena;
+		if(uncompressor.Uncompress(idat.nSpan,idat.span)!=YSOK && YSTRUE==verifyChecksum)
+		{
+			// The image may be partly there, but it is not what was saved.
+			res=YSERR;
+		}
 
 		EndOutput();
 	}
+	EndRow();
 
-
-	delete [] datBuf;
-	return YSOK;
-}
-
-int YsGenericPngDecoder::PrepareOutput(void)
-{
-	return YSOK;
-}
-
-int YsGenericPngDecoder::Output(unsigned char)
-{
-	return YSOK;
+	return res;
 }
 
-int YsGenericPngDecoder::EndOutput(void)
+int YsGenericPngDecoder::BeginPush(void)
 {
+	if(NULL==push)
+	{
+		push=new YsPngPushState;
+	}
+	push->Begin();
+	EndRow();
+	Initialize();
+	arena.Reset();
 	return YSOK;
 }
 
-
-
-////////////////////////////////////////////////////////////
-
-static inline unsigned char Paeth(unsigned int ua,unsigned int ub,unsigned int uc)
+int YsGenericPngDecoder::Push(size_t length,const unsigned char dat[])
 {
-	int a,b,c,p,pa,pb,pc;
-
-	a=(int)ua;
-	b=(int)ub;
-	c=(int)uc;
-
-	p=a+b-c;
-	pa=(p>a ? p-a : a-p);
-	pb=(p>b ? p-b : b-p);
-	pc=(p>c ? p-c : c-p);
-
-	if(pa<=pb && pa<=pc)
-	{
-		return (unsigned char)a;
-	}
-	else if(pb<=pc)
+	if(NULL==push || YsPngPushState::PUSH_IDLE==push->state)
 	{
-		return (unsigned char)b;
-	}
-	else
-	{
-		return (unsigned char)c;
+		return YSERR;
 	}
-}
 
-static inline void Filter8(unsigned char curLine[],unsigned char prvLine[],int x,int y,int unitLng,int filter)
-{
-	int i;
-	switch(filter)
+	while(0<length && YsPngPushState::PUSH_COMPLETE!=push->state && YsPngPushState::PUSH_ERROR!=push->state)
 	{
-	case 1:
-		if(x>0)
+		if(YsPngPushState::PUSH_CHUNK_DATA==push->state)
 		{
-			for(i=0; i<unitLng; i++)
+			size_t n=(length<push->chunkLeft ? length : push->chunkLeft);
+			if(YSOK!=PushChunkData(n,dat))
+			{
+				push->state=YsPngPushState::PUSH_ERROR;
+				break;
+			}
+			dat+=n;
+			length-=n;
+			push->chunkLeft-=n;
+			if(0==push->chunkLeft)
 			{
-				curLine[x*unitLng+i]+=curLine[x*unitLng+i-unitLng];
+				push->state=YsPngPushState::PUSH_CHUNK_CRC;
 			}
+			continue;
 		}
-		break;
-	case 2:
-		if(y>0)
+
+		const unsigned int headerSize=(YsPngPushState::PUSH_CHUNK_CRC==push->state ? 4 : 8);
+		while(push->headerFilled<headerSize && 0<length)
 		{
-			for(i=0; i<unitLng; i++)
+			push->headerBuf[push->headerFilled++]=*dat;
+			++dat;
+			--length;
+		}
+		if(push->headerFilled<headerSize)
+		{
+			break;
+		}
+		push->headerFilled=0;
+
+		int res=YSOK;
+		if(YsPngPushState::PUSH_SIGNATURE==push->state)
+		{
+			YsPngBinaryMemoryStream sigStream(8,push->headerBuf);
+			if(CheckSignature(sigStream)!=YSOK)
 			{
-				curLine[x*unitLng+i]+=prvLine[x*unitLng+i];
+				printf("The file does not have PNG signature.\n");
+				res=YSERR;
 			}
+			push->state=YsPngPushState::PUSH_CHUNK_HEADER;
 		}
-		break;
-	case 3:
-		for(i=0; i<unitLng; i++)
+		else if(YsPngPushState::PUSH_CHUNK_HEADER==push->state)
 		{
-			unsigned int a;
-			a=(x>0 ? curLine[x*unitLng+i-unitLng] : 0);
-			a+=(y>0 ? prvLine[x*unitLng+i] : 0);
-			curLine[x*unitLng+i]+=(unsigned char)(a/2);
+			res=PushChunkHeader();
 		}
-		break;
-	case 4:
-		for(i=0; i<unitLng; i++)
+		else
 		{
-			unsigned int a,b,c;
-			a=(x>0 ? curLine[x*unitLng+i-unitLng] : 0);
-			b=(y>0 ? prvLine[x*unitLng+i] : 0);
-			c=((x>0 && y>0) ? prvLine[x*unitLng-unitLng+i] : 0);
-			curLine[x*unitLng+i]+=Paeth(a,b,c);
+			res=PushChunkEnd();
+		}
+		if(YSOK!=res)
+		{
+			push->state=YsPngPushState::PUSH_ERROR;
 		}
-		break;
 	}
-}
 
-YsRawPngDecoder::YsRawPngDecoder()
-{
-	wid=0;
-	hei=0;
-	rgba=NULL;
-	twoLineBuf8=NULL;
+	// Uncompress what has arrived, so that the rows come out as soon as possible.
+	if(YsPngPushState::PUSH_ERROR!=push->state &&
+	   true==push->idatBegun && true!=push->idatEnded &&
+	   YSOK!=RunPushUncompress(false))
+	{
+		push->state=YsPngPushState::PUSH_ERROR;
+	}
 
-	curLine8=NULL;
-	prvLine8=NULL;
-
-	autoDeleteRgbaBuffer=1;
+	if(YsPngPushState::PUSH_ERROR==push->state)
+	{
+		if(true==push->idatBegun && true!=push->idatEnded)
+		{
+			EndPushUncompress();
+		}
+		return YSERR;
+	}
+	return YSOK;
 }
 
-YsRawPngDecoder::~YsRawPngDecoder()
+int YsGenericPngDecoder::EndPush(void)
 {
-	if(autoDeleteRgbaBuffer==1 && rgba!=NULL)
+	if(NULL==push || YsPngPushState::PUSH_IDLE==push->state)
 	{
-		delete [] rgba;
+		return YSERR;
 	}
-	if(twoLineBuf8!=NULL)
+
+	if(YsPngPushState::PUSH_ERROR!=push->state && true!=push->idatEnded)
 	{
-		delete [] twoLineBuf8;
+		// The file ended before IEND, or IEND came without IDAT.
+		if(true!=push->idatBegun)
+		{
+			BeginPushUncompress();
+		}
+		EndPushUncompress();
 	}
+
+	push->state=YsPngPushState::PUSH_IDLE;
+	return (true==push->complete ? YSOK : YSERR);
 }
 
-void YsRawPngDecoder::ShiftTwoLineBuf(void)
+YSBOOL YsGenericPngDecoder::IsPushComplete(void) const
 {
-	if(twoLineBuf8!=NULL)
+	if(NULL!=push && true==push->iendReached)
 	{
-		unsigned char *swap;
-		swap=curLine8;
-		curLine8=prvLine8;
-		prvLine8=swap;
+		return YSTRUE;
 	}
+	return YSFALSE;
 }
 
-int YsRawPngDecoder::PrepareOutput(void)
+int YsGenericPngDecoder::PushChunkHeader(void)
 {
-	int supported;
+	push->chunkLength=PngGetUnsignedInt(push->headerBuf);
+	push->chunkType=PngGetUnsignedInt(push->headerBuf+4);
+	push->chunkLeft=push->chunkLength;
+	push->crc=(YSTRUE==verifyChecksum ? PngCrc32(0,push->headerBuf+4,4) : 0);
 
-	supported=0;
-	switch(hdr.colorType)
+	if(verboseMode==YSTRUE)
 	{
-	case 0:   // Greyscale
-		switch(hdr.bitDepth)
-		{
-		case 8:
-		case 1:
-			supported=1;
-			break;
-		case 2:
-		case 4:
-		case 16:
-			break;
-		}
-		break;
-	case 2:   // Truecolor
-		switch(hdr.bitDepth)
-		{
-		case 8:
-		case 16:
-			supported=1;
-			break;
-		}
-		break;
-	case 3:   // Indexed-color
-		switch(hdr.bitDepth)
-		{
-		case 1:
-		case 2:
-		case 4:
-		case 8:
-			supported=1;
-			break;
-		}
-		break;
-	case 4:   // Greyscale with alpha
-		switch(hdr.bitDepth)
+		printf("Chunk name=%c%c%c%c\n",push->headerBuf[4],push->headerBuf[5],push->headerBuf[6],push->headerBuf[7]);
+	}
+
+	if(push->chunkType!=IDAT && true==push->idatBegun && true!=push->idatEnded)
+	{
+		// IDAT chunks must be consecutive.  No more compressed data.
+		if(YSOK!=EndPushUncompress())
 		{
-		case 8:
-			supported=1;
-			break;
-		case 16:
-			break;
+			return YSERR;
 		}
-		break;
-	case 6:   // Truecolor with alpha
-		switch(hdr.bitDepth)
+	}
+
+	if(push->chunkType==IEND)
+	{
+		if(true!=push->idatBegun)
 		{
-		case 8:
-			supported=1;
-			break;
-		case 16:
-			break;
+			BeginPushUncompress();
+			EndPushUncompress();
 		}
-		break;
+		push->state=YsPngPushState::PUSH_COMPLETE;
+		push->iendReached=true;
+		return YSOK;
 	}
 
-	if(supported==0)
+	if(push->chunkType==IDAT && true!=push->idatBegun && YSOK!=BeginPushUncompress())
 	{
-		printf("Unsupported colorType-bitDepth combination.\n");
-		printf("  Color type=%d\n",hdr.colorType);
-		printf("  Bit deptch=%d\n",hdr.bitDepth);
 		return YSERR;
 	}
 
+	push->keepChunk=((push->chunkType==IHDR || push->chunkType==PLTE || push->chunkType==tRNS || push->chunkType==gAMA) &&
+	                 push->chunkLength<=YsPngPushState::KEPT_CHUNK_SIZE);
+	push->state=(0<push->chunkLength ? YsPngPushState::PUSH_CHUNK_DATA : YsPngPushState::PUSH_CHUNK_CRC);
+	return YSOK;
+}
 
+int YsGenericPngDecoder::PushChunkData(size_t length,const unsigned char dat[])
+{
+	if(YSTRUE==verifyChecksum)
+	{
+		push->crc=PngCrc32(push->crc,dat,length);
+	}
 
-	wid=hdr.width;
-	hei=hdr.height;
-	if(autoDeleteRgbaBuffer==1 && rgba!=NULL)
+	if(true==push->keepChunk)
 	{
-		delete [] rgba;
-		rgba=NULL;
-	}
-	rgba=new unsigned char [wid*hei*4];
-	x=-1;
-	y=0;
-	filter=0;
-	inLineCount=0;
-	inPixelCount=0;
-	firstByte=1;
-	index=0;
-	interlacePass=1;
+		memcpy(push->chunkDat+(push->chunkLength-push->chunkLeft),dat,length);
+	}
+	else if(push->chunkType==IDAT && true!=push->idatEnded)
+	{
+		while(0<length)
+		{
+			size_t n=PUSH_BUFFER_SIZE-push->inUsed;
+			if(length<n)
+			{
+				n=length;
+			}
+			memcpy(push->inBuf+push->inUsed,dat,n);
+			push->inUsed+=n;
+			dat+=n;
+			length-=n;
+			if(PUSH_BUFFER_SIZE==push->inUsed && YSOK!=RunPushUncompress(false))
+			{
+				return YSERR;
+			}
+		}
+	}
+	return YSOK;
+}
 
-	if(twoLineBuf8!=NULL)
+int YsGenericPngDecoder::PushChunkEnd(void)
+{
+	// CRC is in headerBuf.  IDAT data have been uncompressed already, but the error stops the decoding.
+	push->state=YsPngPushState::PUSH_CHUNK_HEADER;
+	if(YSTRUE==verifyChecksum && push->crc!=PngGetUnsignedInt(push->headerBuf))
 	{
-		delete [] twoLineBuf8;
-		twoLineBuf8=NULL;
+		const unsigned int chunkType=push->chunkType;
+		printf("CRC error in chunk %c%c%c%c.\n",(chunkType>>24)&255,(chunkType>>16)&255,(chunkType>>8)&255,chunkType&255);
+		return YSERR;
+	}
+	if(true!=push->keepChunk)
+	{
+		return YSOK;
 	}
 
+	return DecodeChunk(push->chunkType,(unsigned)push->chunkLength,push->chunkDat);
+}
 
-	// See PNG Specification 11.2 for Allowed combinations of color type and bit depth
-	unsigned int twoLineBufLngPerLine=0;
-	switch(hdr.colorType)
+int YsGenericPngDecoder::DecodeChunk(unsigned chunkType,unsigned length,const unsigned char buf[])
+{
+	switch(chunkType)
 	{
 	default:
-		printf("Internal error!  Color type was supposed to be checked in the previous switch/case statement!\n");
-		return YSERR;
-	case 0:   // Greyscale
-		switch(hdr.bitDepth)
-		{
-		case 1:
-			twoLineBufLngPerLine=(hdr.width+7)/8;
-			break;
-		case 2:
-			twoLineBufLngPerLine=(hdr.width+3)/4;
-			break;
-		case 4:
-			twoLineBufLngPerLine=(hdr.width+1)/2;
-			break;
-		case 8:
-			twoLineBufLngPerLine=hdr.width;
-			break;
-		case 16:
-			twoLineBufLngPerLine=hdr.width*2;
-			break;
-		}
 		break;
-	case 2:   // Truecolor
-		switch(hdr.bitDepth)
+	case IHDR:
+		if(length>=13)
 		{
-		case 8:
-			twoLineBufLngPerLine=hdr.width*3;
-			break;
-		case 16:
-			twoLineBufLngPerLine=hdr.width*6;
-			break;
+			hdr.Decode(buf);
+			if(verboseMode==YSTRUE)
+			{
+				printf("Width=%d Height=%d\n",hdr.width,hdr.height);
+				printf("bitDepth=%d\n",hdr.bitDepth);
+				printf("colorType=%d\n",hdr.colorType);
+				printf("compressionMethod=%d\n",hdr.compressionMethod);
+				printf("filterMethod=%d\n",hdr.filterMethod);
+				printf("interlaceMethod=%d\n",hdr.interlaceMethod);
+			}
 		}
 		break;
-	case 3:   // Indexed-color
-		switch(hdr.bitDepth)
+	case PLTE:
+		if(length>0)
 		{
-		case 1:
-			twoLineBufLngPerLine=(hdr.width+7)/8;
-			break;
-		case 2:
-			twoLineBufLngPerLine=(hdr.width+3)/4;
-			break;
-		case 4:
-			twoLineBufLngPerLine=(hdr.width+1)/2;
-			break;
-		case 8:
-			twoLineBufLngPerLine=hdr.width;
-			break;
+			if(plt.Decode(length,buf)!=YSOK)
+			{
+				return YSERR;
+			}
+			if(verboseMode==YSTRUE)
+			{
+				printf("%d palette entries\n",plt.nEntry);
+			}
 		}
 		break;
-	case 4:   // Greyscale with alpha
-		switch(hdr.bitDepth)
+	case tRNS:
+		if(length>0)
 		{
-		case 8:
-			twoLineBufLngPerLine=hdr.width*2;
-			break;
-		case 16:
-			twoLineBufLngPerLine=hdr.width*4;
-			break;
+			trns.Decode(length,buf,hdr.colorType);
 		}
 		break;
-	case 6:   // Truecolor with alpha
-		switch(hdr.bitDepth)
+	case gAMA:
+		if(length>=4)
 		{
-		case 8:
-			twoLineBufLngPerLine=hdr.width*4;
-			break;
-		case 16:
-			twoLineBufLngPerLine=hdr.width*8;
-			break;
+			gamma=PngGetUnsignedInt(buf);
+			if(verboseMode==YSTRUE)
+			{
+				printf("Gamma %d (default=%d)\n",gamma,gamma_default);
+			}
 		}
 		break;
 	}
-
-	twoLineBuf8=new unsigned char [twoLineBufLngPerLine*2];
-	curLine8=twoLineBuf8;
-	prvLine8=twoLineBuf8+twoLineBufLngPerLine;
-
 	return YSOK;
 }
 
-int YsRawPngDecoder::Output(unsigned char dat)
+int YsGenericPngDecoder::BeginPushUncompress(void)
 {
-	unsigned int i;
-	unsigned int colIdx;
-	unsigned int interlaceWid,interlaceHei,interlaceX,interlaceY;
+	push->idatBegun=true;
+	push->outputReady=(PrepareOutput()==YSOK && BeginRow()==YSOK);
+	push->uncompressor.output=this;
+	push->uncompressor.verboseMode=verboseMode;
+	push->uncompressor.arena=&arena;
+	push->uncompressor.Begin();
+	return (true==push->outputReady ? YSOK : YSERR);
+}
 
-	if(y>=hei)
+int YsGenericPngDecoder::RunPushUncompress(bool allInput)
+{
+	if(true!=push->outputReady)
 	{
 		return YSERR;
 	}
-
-	if(x==-1)  // First byte is filter type for the line.  
+	if(true==push->uncompressor.IsEnd())
 	{
-		filter=dat;   // See PNG Specification 4.5.4 Filtering, 9 Filtering
-		inLineCount=0;
-		inPixelCount=0;
-		x++;
-		// printf("y=%d filter=%d\n",y,filter);
+		// Anything after Adler-32 is not used.
+		push->inUsed=0;
 		return YSOK;
 	}
-	else 
+
+	push->inSpan.length=push->inUsed;
+	push->bits.Continue(1,&push->inSpan);
+	push->bits.morePending=(true!=allInput);
+	int res=push->uncompressor.Run(push->bits,allInput);
+
+	// Bytes that have not been loaded to the bit reader go to the top of the buffer.
+	const size_t loaded=push->bits.bytePtr;
+	memmove(push->inBuf,push->inBuf+loaded,push->inUsed-loaded);
+	push->inUsed-=loaded;
+	return res;
+}
+
+int YsGenericPngDecoder::EndPushUncompress(void)
+{
+	int res=YSERR;
+	if(true==push->outputReady)
 	{
-		switch(hdr.interlaceMethod)
+		if(YSOK==RunPushUncompress(true) && true==push->uncompressor.IsEnd())
 		{
-		// Non-Interlace
-		case 0:
-			switch(hdr.colorType)  // See PNG Specification 6.1 Colour types and values
-			{
-			// Grayscale
-			case 0:
-				switch(hdr.bitDepth)
-				{
-				case 1:
-					curLine8[x/8]=dat;
-					Filter8(curLine8,prvLine8,x/8,y,1,filter);
-
-					for(i=0; i<8 && x<wid; i++)
-					{
-						colIdx=(curLine8[x/8]>>(7-i))&1;
-						colIdx=(colIdx<<1)+colIdx;
-						colIdx=(colIdx<<2)+colIdx;
-						colIdx=(colIdx<<4)+colIdx;
-
-						rgba[index  ]=(unsigned char)colIdx;
-						rgba[index+1]=(unsigned char)colIdx;
-						rgba[index+2]=(unsigned char)colIdx;
-						rgba[index+3]=0;
-						x++;
-						index+=4;
-					}
-					break;
+			res=YSOK;
+			push->complete=true;
+		}
+		EndOutput();
+	}
+	EndRow();
+	push->uncompressor.End();
+	push->idatEnded=true;
+	push->outputReady=false;
+	return res;
+}
 
-				case 8:
-					curLine8[x]=dat;
-					Filter8(curLine8,prvLine8,x,y,1,filter);
-					colIdx=curLine8[x];
+// Adam7 passes.  x0, y0, dx, dy.  Pass 0 is for non-interlaced image.
+static const unsigned int PngPassGeometry[8][4]=
+{
+	{0,0,1,1},
+	{0,0,8,8},
+	{4,0,8,8},
+	{0,4,4,8},
+	{2,0,4,4},
+	{0,2,2,4},
+	{1,0,2,2},
+	{0,1,1,2},
+};
+
+/* static */ unsigned int YsGenericPngDecoder::GetBitsPerPixel(unsigned int colorType,unsigned int bitDepth)
+{
+	switch(colorType)
+	{
+	case 0:  // Greyscale
+	case 3:  // Indexed-color
+		return bitDepth;
+	case 2:  // Truecolor
+		return bitDepth*3;
+	case 4:  // Greyscale with alpha
+		return bitDepth*2;
+	case 6:  // Truecolor with alpha
+		return bitDepth*4;
+	}
+	return 0;
+}
 
-					rgba[index  ]=curLine8[x];
-					rgba[index+1]=curLine8[x];
-					rgba[index+2]=curLine8[x];
-					if(curLine8[x]==trns.col[0] || curLine8[x]==trns.col[1] || curLine8[x]==trns.col[2])
-					{
-						rgba[index+3]=0;
-					}
-					else
-					{
-						rgba[index+3]=255;
-					}
+/* static */ void YsGenericPngDecoder::GetPassGeometry(unsigned int &x0,unsigned int &y0,unsigned int &dx,unsigned int &dy,unsigned int pass)
+{
+	x0=PngPassGeometry[pass][0];
+	y0=PngPassGeometry[pass][1];
+	dx=PngPassGeometry[pass][2];
+	dy=PngPassGeometry[pass][3];
+}
 
-					x++;
-					index+=4;
-					break;
-				}
-				break;
+void YsGenericPngDecoder::GetPassSize(unsigned int &passWid,unsigned int &passHei,unsigned int pass) const
+{
+	unsigned int x0,y0,dx,dy;
+	GetPassGeometry(x0,y0,dx,dy,pass);
+	passWid=(x0<hdr.width ? (hdr.width-x0+dx-1)/dx : 0);
+	passHei=(y0<hdr.height ? (hdr.height-y0+dy-1)/dy : 0);
+}
 
+size_t YsGenericPngDecoder::GetRowLength(unsigned int passWid) const
+{
+	return ((size_t)passWid*GetBitsPerPixel(hdr.colorType,hdr.bitDepth)+7)/8;
+}
 
+int YsGenericPngDecoder::BeginRow(void)
+{
+	EndRow();
+	if(0==GetBitsPerPixel(hdr.colorType,hdr.bitDepth))
+	{
+		return YSERR;
+	}
 
-			// True color
-			case 2:
-				switch(hdr.bitDepth)
-				{
-				case 8:
-					curLine8[inLineCount+inPixelCount]=dat;
-					inPixelCount++;
-					if(inPixelCount==3)
-					{
-						Filter8(curLine8,prvLine8,x,y,3,filter);
-						rgba[index  ]=curLine8[inLineCount];
-						rgba[index+1]=curLine8[inLineCount+1];
-						rgba[index+2]=curLine8[inLineCount+2];
-
-						if(curLine8[inLineCount  ]==trns.col[0] && 
-						   curLine8[inLineCount+1]==trns.col[1] && 
-						   curLine8[inLineCount+2]==trns.col[2])
-						{
-							rgba[index+3]=0;
-						}
-						else
-						{
-							rgba[index+3]=255;
-						}
+	rowBuf=(unsigned char *)arena.Alloc(1+GetRowLength(hdr.width));
+	rowFilled=0;
+	rowY=0;
+	rowAdler=1;
 
-						x++;
-						index+=4;
-						inLineCount+=3;
-						inPixelCount=0;
-					}
-					break;
-				case 16:
-					curLine8[inLineCount+inPixelCount]=dat;
-					inPixelCount++;
-					if(inPixelCount==6)
-					{
-						Filter8(curLine8,prvLine8,x,y,6,filter);
-						rgba[index  ]=curLine8[inLineCount  ];
-						rgba[index+1]=curLine8[inLineCount+2];
-						rgba[index+2]=curLine8[inLineCount+4];
-
-						r=curLine8[inLineCount  ]*256+curLine8[inLineCount+1];
-						g=curLine8[inLineCount+2]*256+curLine8[inLineCount+3];
-						b=curLine8[inLineCount+4]*256+curLine8[inLineCount+5];
-						if(r==trns.col[0] && g==trns.col[1] && b==trns.col[2])
-						{
-							rgba[index+3]=0;
-						}
-						else
-						{
-							rgba[index+3]=255;
-						}
-						x++;
-						index+=4;
-						inLineCount+=6;
-						inPixelCount=0;
-					}
-					break;
-				}
-				break;
+	// Empty passes of a small interlaced image have no data, not even the filter type.
+	rowPass=(0==hdr.interlaceMethod ? 0 : 1);
+	for(;;)
+	{
+		unsigned int passWid;
+		GetPassSize(passWid,rowHei,rowPass);
+		if(0<passWid && 0<rowHei)
+		{
+			rowLength=1+GetRowLength(passWid);
+			break;
+		}
+		if(0==rowPass || 7<=rowPass)
+		{
+			rowLength=0;
+			rowHei=0;
+			break;
+		}
+		++rowPass;
+	}
+	return YSOK;
+}
 
+int YsGenericPngDecoder::FlushRow(void)
+{
+	rowFilled=0;
+	if(0==rowLength)
+	{
+		// Data after the last row.
+		return YSERR;
+	}
 
+	if(YSTRUE==verifyChecksum)
+	{
+		rowAdler=PngAdler32(rowAdler,rowBuf,rowLength);
+	}
 
-			// Indexed color
-			case 3:
-				switch(hdr.bitDepth)
+	int res=OutputRow(rowBuf,rowLength);
+	++rowY;
+	if(rowHei<=rowY)
+	{
+		rowY=0;
+		rowLength=0;
+		rowHei=0;
+		while(0!=rowPass && rowPass<7)
+		{
+			unsigned int passWid;
+			++rowPass;
+			GetPassSize(passWid,rowHei,rowPass);
+			if(0<passWid && 0<rowHei)
+			{
+				rowLength=1+GetRowLength(passWid);
+				if(verboseMode==YSTRUE)
 				{
-				case 1:
-					curLine8[x/8]=dat;
-					Filter8(curLine8,prvLine8,x/8,y,1,filter);
+					printf("Interlace Pass %d\n",rowPass);
+				}
+				break;
+			}
+			rowHei=0;
+		}
+	}
+	return res;
+}
 
-					for(i=0; i<8 && x<wid; i++)
-					{
-						colIdx=(curLine8[x/8]>>(7-i))&1;
-						if(colIdx<plt.nEntry)
-						{
-							rgba[index  ]=plt.entry[colIdx*3  ];
-							rgba[index+1]=plt.entry[colIdx*3+1];
-							rgba[index+2]=plt.entry[colIdx*3+2];
-							if(colIdx==trns.col[0] || colIdx==trns.col[1] || colIdx==trns.col[2])
-							{
-								rgba[index+3]=0;
-							}
-							else
-							{
-								rgba[index+3]=255;
-							}
-						}
-						else
-						{
-							printf("Not enough palette entry! (%d)\n",plt.nEntry);
-						}
-						x++;
-						index+=4;
-					}
-					break;
-				case 2:
-					curLine8[x/4]=dat;
-					Filter8(curLine8,prvLine8,x/4,y,1,filter);
+unsigned int YsGenericPngDecoder::GetAdler32(void) const
+{
+	return rowAdler;
+}
 
-					for(i=0; i<4 && x<wid; i++)
-					{
-						colIdx=(curLine8[x/4]>>((3-i)*2))&0x03;
+void YsGenericPngDecoder::EndRow(void)
+{
+	rowBuf=NULL;  // Stays in the arena until the next image.
+	rowLength=0;
+	rowFilled=0;
+	rowHei=0;
+}
 
-						if(colIdx<plt.nEntry)
-						{
-							rgba[index  ]=plt.entry[colIdx*3  ];
-							rgba[index+1]=plt.entry[colIdx*3+1];
-							rgba[index+2]=plt.entry[colIdx*3+2];
-							if(colIdx==trns.col[0] || colIdx==trns.col[1] || colIdx==trns.col[2])
-							{
-								rgba[index+3]=0;
-							}
-							else
-							{
-								rgba[index+3]=255;
-							}
-						}
-						x++;
-						index+=4;
-					}
-					break;
+int YsGenericPngDecoder::PrepareOutput(void)
+{
+	return YSOK;
+}
 
-				case 4:
-					curLine8[x/2]=dat;
-					Filter8(curLine8,prvLine8,x/2,y,1,filter);
+int YsGenericPngDecoder::OutputRow(const unsigned char row[],size_t length)
+{
+	for(size_t i=0; i<length; i++)
+	{
+		if(Output(row[i])!=YSOK)
+		{
+			return YSERR;
+		}
+	}
+	return YSOK;
+}
 
-					for(i=0; i<2 && x<wid; i++)
-					{
-						colIdx=(curLine8[x/2]>>((1-i)*4))&0x0f;
+int YsGenericPngDecoder::Output(unsigned char)
+{
+	return YSOK;
+}
 
-						if(colIdx<plt.nEntry)
-						{
-							rgba[index  ]=plt.entry[colIdx*3  ];
-							rgba[index+1]=plt.entry[colIdx*3+1];
-							rgba[index+2]=plt.entry[colIdx*3+2];
-							if(colIdx==trns.col[0] || colIdx==trns.col[1] || colIdx==trns.col[2])
-							{
-								rgba[index+3]=0;
-							}
-							else
-							{
-								rgba[index+3]=255;
-							}
-						}
-						x++;
-						index+=4;
-					}
-					break;
+int YsGenericPngDecoder::EndOutput(void)
+{
+	return YSOK;
+}
 
-				case 8:
-					curLine8[x]=dat;
-					Filter8(curLine8,prvLine8,x,y,1,filter);
-					colIdx=curLine8[x];
 
-					if(colIdx<plt.nEntry)
-					{
-						rgba[index  ]=plt.entry[colIdx*3  ];
-						rgba[index+1]=plt.entry[colIdx*3+1];
-						rgba[index+2]=plt.entry[colIdx*3+2];
-						if(colIdx==trns.col[0] || colIdx==trns.col[1] || colIdx==trns.col[2])
-						{
-							rgba[index+3]=0;
-						}
-						else
-						{
-							rgba[index+3]=255;
-						}
-					}
-					x++;
-					index+=4;
-					break;
-				}
-				break;
 
+////////////////////////////////////////////////////////////
 
+static inline unsigned char Paeth(unsigned int ua,unsigned int ub,unsigned int uc)
+{
+	int a,b,c,p,pa,pb,pc;
 
-			// Greyscale with alpha
-			case 4:
-				switch(hdr.bitDepth)
-				{
-				case 8:
-					curLine8[inLineCount+inPixelCount]=dat;
-					inPixelCount++;
-					if(inPixelCount==2)
-					{
-						Filter8(curLine8,prvLine8,x,y,2,filter);
-						rgba[index  ]=curLine8[inLineCount  ];
-						rgba[index+1]=curLine8[inLineCount  ];
-						rgba[index+2]=curLine8[inLineCount  ];
-						rgba[index+3]=curLine8[inLineCount+1];
-						index+=4;
-						x++;
-						inLineCount+=2;
-						inPixelCount=0;
-					}
-					break;
-				}
-				break;
+	a=(int)ua;
+	b=(int)ub;
+	c=(int)uc;
 
+	p=a+b-c;
+	pa=(p>a ? p-a : a-p);
+	pb=(p>b ? p-b : b-p);
+	pc=(p>c ? p-c : c-p);
 
+	if(pa<=pb && pa<=pc)
+	{
+		return (unsigned char)a;
+	}
+	else if(pb<=pc)
+	{
+		return (unsigned char)b;
+	}
+	else
+	{
+		return (unsigned char)c;
+	}
+}
 
-			// Truecolor with alpha
-			case 6:
-				switch(hdr.bitDepth)
-				{
-				case 8:
-					curLine8[inLineCount+inPixelCount]=dat;
-					inPixelCount++;
-					if(inPixelCount==4)
-					{
-						Filter8(curLine8,prvLine8,x,y,4,filter);
-						rgba[index  ]=curLine8[inLineCount  ];
-						rgba[index+1]=curLine8[inLineCount+1];
-						rgba[index+2]=curLine8[inLineCount+2];
-						rgba[index+3]=curLine8[inLineCount+3];
-						index+=4;
-						x++;
-						inLineCount+=4;
-						inPixelCount=0;
-					}
-					break;
-				}
-				break;
-			}  // switch(hdr.colorType)
+static void PngUnfilterUp(unsigned char cur[],const unsigned char src[],const unsigned char prv[],size_t length)
+{
+	size_t i=0;
+#ifdef YSPNG_USE_AVX2
+	for(; i+32<=length; i+=32)
+	{
+		__m256i x=_mm256_loadu_si256((const __m256i *)(src+i));
+		__m256i b=_mm256_loadu_si256((const __m256i *)(prv+i));
+		_mm256_storeu_si256((__m256i *)(cur+i),_mm256_add_epi8(x,b));
+	}
+#endif
+#ifdef YSPNG_USE_SSE2
+	for(; i+16<=length; i+=16)
+	{
+		__m128i x=_mm_loadu_si128((const __m128i *)(src+i));
+		__m128i b=_mm_loadu_si128((const __m128i *)(prv+i));
+		_mm_storeu_si128((__m128i *)(cur+i),_mm_add_epi8(x,b));
+	}
+#endif
+	for(; i<length; i++)
+	{
+		cur[i]=src[i]+prv[i];
+	}
+}
 
-			if(x>=wid)
-			{
-				y++;
-				x=-1;
-				ShiftTwoLineBuf();
-			}
+#ifdef YSPNG_USE_SSE2
+// Sub and Paeth depend on the previous pixel.  With 3- or 4-byte pixels, all bytes of a pixel are unfiltered at once.
+// Average is left to the scalar loop, which compilers already make as fast as a pixel-at-a-time SSE2 loop.
+static inline __m128i PngLoadPixel(const unsigned char p[],size_t unitLng)
+{
+	int v=0;
+	memcpy(&v,p,unitLng);
+	return _mm_cvtsi32_si128(v);
+}
 
-			return YSOK;
+static inline void PngStorePixel(unsigned char p[],__m128i pix,size_t unitLng)
+{
+	int v=_mm_cvtsi128_si32(pix);
+	memcpy(p,&v,unitLng);
+}
+
+static inline __m128i PngAbs16(__m128i v)
+{
+#ifdef YSPNG_USE_SSSE3
+	return _mm_abs_epi16(v);
+#else
+	return _mm_max_epi16(v,_mm_sub_epi16(_mm_setzero_si128(),v));
+#endif
+}
+
+static void PngUnfilterSubSSE2(unsigned char cur[],const unsigned char src[],size_t length,size_t unitLng)
+{
+	// Four pixels at a time by prefix sum.  The last pixel is carried to the first pixel of the next four.
+	// A 3-byte pixel step writes 16 bytes, but the last 4 bytes are overwritten by the next step.
+	__m128i carry=_mm_setzero_si128();
+	size_t i=0;
+	if(4==unitLng)
+	{
+		for(; i+16<=length; i+=16)
+		{
+			__m128i x=_mm_add_epi8(_mm_loadu_si128((const __m128i *)(src+i)),carry);
+			x=_mm_add_epi8(x,_mm_slli_si128(x,4));
+			x=_mm_add_epi8(x,_mm_slli_si128(x,8));
+			_mm_storeu_si128((__m128i *)(cur+i),x);
+			carry=_mm_srli_si128(x,12);
+		}
+	}
+	else
+	{
+		for(; i+16<=length; i+=12)
+		{
+			__m128i x=_mm_add_epi8(_mm_loadu_si128((const __m128i *)(src+i)),carry);
+			x=_mm_add_epi8(x,_mm_slli_si128(x,3));
+			x=_mm_add_epi8(x,_mm_slli_si128(x,6));
+			_mm_storeu_si128((__m128i *)(cur+i),x);
+			carry=_mm_srli_si128(_mm_slli_si128(x,4),13);
+		}
+	}
+	for(; i+unitLng<=length; i+=unitLng)
+	{
+		carry=_mm_add_epi8(carry,PngLoadPixel(src+i,unitLng));
+		PngStorePixel(cur+i,carry,unitLng);
+	}
+}
+
+static inline __m128i PngPaethSSE2(__m128i a,__m128i b,__m128i c)
+{
+	// In 16-bit lanes.  With p=a+b-c, pa=|p-a|=|b-c|, pb=|p-b|=|a-c|, pc=|p-c|=|(b-c)+(a-c)|.
+	__m128i bc=_mm_sub_epi16(b,c);
+	__m128i ac=_mm_sub_epi16(a,c);
+	__m128i pa=PngAbs16(bc);
+	__m128i pb=PngAbs16(ac);
+	__m128i pc=PngAbs16(_mm_add_epi16(bc,ac));
+	__m128i smallest=_mm_min_epi16(pc,_mm_min_epi16(pa,pb));
+
+	// a if pa is the smallest, b if pb is, c otherwise.  Same tie-breaking as Paeth().
+	__m128i useA=_mm_cmpeq_epi16(pa,smallest);
+	__m128i useB=_mm_cmpeq_epi16(pb,smallest);
+	__m128i bOrC=_mm_or_si128(_mm_and_si128(useB,b),_mm_andnot_si128(useB,c));
+	return _mm_or_si128(_mm_and_si128(useA,a),_mm_andnot_si128(useA,bOrC));
+}
+
+static void PngUnfilterPaethSSE2(unsigned char cur[],const unsigned char src[],const unsigned char prv[],size_t length,size_t unitLng)
+{
+	const __m128i zero=_mm_setzero_si128();
+	const __m128i lowByte=_mm_set1_epi16(0xff);
+	__m128i a=zero,c=zero;
+	size_t i=0;
+
+	// While 4 bytes are left, a 3-byte pixel is read and written as 4 bytes.  The extra byte is written over by the next pixel.
+	for(; i+4<=length; i+=unitLng)
+	{
+		__m128i b=_mm_unpacklo_epi8(PngLoadPixel(prv+i,4),zero);
+		__m128i x=_mm_unpacklo_epi8(PngLoadPixel(src+i,4),zero);
+		a=_mm_and_si128(_mm_add_epi16(x,PngPaethSSE2(a,b,c)),lowByte);
+		c=b;
+		PngStorePixel(cur+i,_mm_packus_epi16(a,a),4);
+	}
+	for(; i+unitLng<=length; i+=unitLng)
+	{
+		__m128i b=_mm_unpacklo_epi8(PngLoadPixel(prv+i,unitLng),zero);
+		__m128i x=_mm_unpacklo_epi8(PngLoadPixel(src+i,unitLng),zero);
+		a=_mm_and_si128(_mm_add_epi16(x,PngPaethSSE2(a,b,c)),lowByte);
+		c=b;
+		PngStorePixel(cur+i,_mm_packus_epi16(a,a),unitLng);
+	}
+}
+#endif
+
+// Unfilters a row from src to cur.  prv is the previous row of the pass, which is zero for the first row.
+static void PngUnfilterRow(unsigned int filter,unsigned char cur[],const unsigned char src[],const unsigned char prv[],size_t length,size_t unitLng)
+{
+#ifdef YSPNG_USE_SSE2
+	if(3==unitLng || 4==unitLng)
+	{
+		switch(filter)
+		{
+		case 1:
+			PngUnfilterSubSSE2(cur,src,length,unitLng);
+			return;
+		case 4:
+			PngUnfilterPaethSSE2(cur,src,prv,length,unitLng);
+			return;
+		}
+	}
+#endif
+
+	size_t i;
+	switch(filter)
+	{
+	default:
+		memcpy(cur,src,length);
+		break;
+	case 1:
+		for(i=0; i<unitLng && i<length; i++)
+		{
+			cur[i]=src[i];
+		}
+		for(i=unitLng; i<length; i++)
+		{
+			cur[i]=src[i]+cur[i-unitLng];
+		}
+		break;
+	case 2:
+		PngUnfilterUp(cur,src,prv,length);
+		break;
+	case 3:
+		for(i=0; i<unitLng && i<length; i++)
+		{
+			cur[i]=src[i]+prv[i]/2;
+		}
+		for(i=unitLng; i<length; i++)
+		{
+			cur[i]=src[i]+(unsigned char)(((unsigned int)cur[i-unitLng]+(unsigned int)prv[i])/2);
+		}
+		break;
+	case 4:
+		for(i=0; i<unitLng && i<length; i++)
+		{
+			cur[i]=src[i]+prv[i];
+		}
+		for(i=unitLng; i<length; i++)
+		{
+			cur[i]=src[i]+Paeth(cur[i-unitLng],prv[i],prv[i-unitLng]);
+		}
+		break;
+	}
+}
+
+////////////////////////////////////////////////////////////
+
+static inline unsigned char PngGrayAlpha(const YsGenericPngDecoder &dec,unsigned int v)
+{
+	return ((v==dec.trns.col[0] || v==dec.trns.col[1] || v==dec.trns.col[2]) ? 0 : 255);
+}
+
+static inline void PngPaletteToRgba(const YsGenericPngDecoder &dec,unsigned char dst[],unsigned int colIdx)
+{
+	if(colIdx<dec.plt.nEntry)
+	{
+		dst[0]=dec.plt.entry[colIdx*3  ];
+		dst[1]=dec.plt.entry[colIdx*3+1];
+		dst[2]=dec.plt.entry[colIdx*3+2];
+		dst[3]=PngGrayAlpha(dec,colIdx);
+	}
+	else
+	{
+		dst[0]=0;
+		dst[1]=0;
+		dst[2]=0;
+		dst[3]=0;
+	}
+}
+
+static void PngConvertGray1(const YsGenericPngDecoder &,unsigned char dst[],const unsigned char src[],unsigned int nPixel,unsigned int dstStep)
+{
+	for(unsigned int i=0; i<nPixel; i++)
+	{
+		unsigned char v=(0!=((src[i>>3]>>(7-(i&7)))&1) ? 255 : 0);
+		dst[0]=v;
+		dst[1]=v;
+		dst[2]=v;
+		dst[3]=0;
+		dst+=dstStep;
+	}
+}
+
+static void PngConvertGray8(const YsGenericPngDecoder &dec,unsigned char dst[],const unsigned char src[],unsigned int nPixel,unsigned int dstStep)
+{
+	for(unsigned int i=0; i<nPixel; i++)
+	{
+		dst[0]=src[i];
+		dst[1]=src[i];
+		dst[2]=src[i];
+		dst[3]=PngGrayAlpha(dec,src[i]);
+		dst+=dstStep;
+	}
+}
+
+static void PngConvertTruecolor8(const YsGenericPngDecoder &dec,unsigned char dst[],const unsigned char src[],unsigned int nPixel,unsigned int dstStep)
+{
+	for(unsigned int i=0; i<nPixel; i++)
+	{
+		dst[0]=src[0];
+		dst[1]=src[1];
+		dst[2]=src[2];
+		if(src[0]==dec.trns.col[0] && src[1]==dec.trns.col[1] && src[2]==dec.trns.col[2])
+		{
+			dst[3]=0;
+		}
+		else
+		{
+			dst[3]=255;
+		}
+		src+=3;
+		dst+=dstStep;
+	}
+}
+
+static void PngConvertTruecolor16(const YsGenericPngDecoder &dec,unsigned char dst[],const unsigned char src[],unsigned int nPixel,unsigned int dstStep)
+{
+	for(unsigned int i=0; i<nPixel; i++)
+	{
+		dst[0]=src[0];
+		dst[1]=src[2];
+		dst[2]=src[4];
+
+		unsigned int r,g,b;
+		r=src[0]*256+src[1];
+		g=src[2]*256+src[3];
+		b=src[4]*256+src[5];
+		if(r==dec.trns.col[0] && g==dec.trns.col[1] && b==dec.trns.col[2])
+		{
+			dst[3]=0;
+		}
+		else
+		{
+			dst[3]=255;
+		}
+		src+=6;
+		dst+=dstStep;
+	}
+}
+
+static void PngConvertIndexed(const YsGenericPngDecoder &dec,unsigned char dst[],const unsigned char src[],unsigned int nPixel,unsigned int dstStep)
+{
+	// 1, 2, or 4 bits
+	const unsigned int bitDepth=dec.hdr.bitDepth;
+	const unsigned int perByte=8/bitDepth;
+	const unsigned int mask=(1<<bitDepth)-1;
+	for(unsigned int i=0; i<nPixel; i++)
+	{
+		unsigned int colIdx=(src[i/perByte]>>((perByte-1-i%perByte)*bitDepth))&mask;
+		PngPaletteToRgba(dec,dst,colIdx);
+		dst+=dstStep;
+	}
+}
+
+static void PngConvertIndexed8(const YsGenericPngDecoder &dec,unsigned char dst[],const unsigned char src[],unsigned int nPixel,unsigned int dstStep)
+{
+	for(unsigned int i=0; i<nPixel; i++)
+	{
+		PngPaletteToRgba(dec,dst,src[i]);
+		dst+=dstStep;
+	}
+}
+
+static void PngConvertGrayAlpha8(const YsGenericPngDecoder &,unsigned char dst[],const unsigned char src[],unsigned int nPixel,unsigned int dstStep)
+{
+	for(unsigned int i=0; i<nPixel; i++)
+	{
+		dst[0]=src[0];
+		dst[1]=src[0];
+		dst[2]=src[0];
+		dst[3]=src[1];
+		src+=2;
+		dst+=dstStep;
+	}
+}
+
+static void PngConvertTruecolorAlpha8(const YsGenericPngDecoder &,unsigned char dst[],const unsigned char src[],unsigned int nPixel,unsigned int dstStep)
+{
+	if(4==dstStep)
+	{
+		memcpy(dst,src,nPixel*4);
+		return;
+	}
+	for(unsigned int i=0; i<nPixel; i++)
+	{
+		dst[0]=src[0];
+		dst[1]=src[1];
+		dst[2]=src[2];
+		dst[3]=src[3];
+		src+=4;
+		dst+=dstStep;
+	}
+}
+
+// Packs nPixel RGBA pixels to pixelFormat.  dstStep is the bytes between the pixels in dst.
+static void PngPackRow(unsigned int pixelFormat,unsigned char dst[],const unsigned char rgba[],unsigned int nPixel,unsigned int dstStep)
+{
+	switch(pixelFormat)
+	{
+	case YsRawPngDecoder::PIXEL_BGRA8:
+		for(unsigned int i=0; i<nPixel; i++)
+		{
+			dst[0]=rgba[2];
+			dst[1]=rgba[1];
+			dst[2]=rgba[0];
+			dst[3]=rgba[3];
+			rgba+=4;
+			dst+=dstStep;
+		}
+		break;
+	case YsRawPngDecoder::PIXEL_RGB8:
+		for(unsigned int i=0; i<nPixel; i++)
+		{
+			dst[0]=rgba[0];
+			dst[1]=rgba[1];
+			dst[2]=rgba[2];
+			rgba+=4;
+			dst+=dstStep;
+		}
+		break;
+	case YsRawPngDecoder::PIXEL_GRAY8:
+		for(unsigned int i=0; i<nPixel; i++)
+		{
+			// ITU-R BT.601 weights in 1/256.  They add up to 256, so that gray stays the same.
+			dst[0]=(unsigned char)((rgba[0]*77+rgba[1]*150+rgba[2]*29)>>8);
+			rgba+=4;
+			dst+=dstStep;
+		}
+		break;
+	}
+}
+
+// dst gets a[0],b[0],a[1],b[1],... in 32-bit pixels.  na is nb or nb+1.  dst must not overlap a or b.
+static void PngInterleave32(unsigned char dst[],const unsigned char a[],unsigned int na,const unsigned char b[],unsigned int nb)
+{
+	unsigned int i=0;
+#ifdef YSPNG_USE_SSE2
+	for(; i+4<=nb; i+=4)
+	{
+		const __m128i va=_mm_loadu_si128((const __m128i *)(a+i*4));
+		const __m128i vb=_mm_loadu_si128((const __m128i *)(b+i*4));
+		_mm_storeu_si128((__m128i *)(dst+i*8),_mm_unpacklo_epi32(va,vb));
+		_mm_storeu_si128((__m128i *)(dst+i*8+16),_mm_unpackhi_epi32(va,vb));
+	}
+#endif
+	for(; i<nb; i++)
+	{
+		memcpy(dst+i*8,a+i*4,4);
+		memcpy(dst+i*8+4,b+i*4,4);
+	}
+	if(nb<na)
+	{
+		memcpy(dst+nb*8,a+nb*4,4);
+	}
+}
+
+YsRawPngDecoder::YsRawPngDecoder()
+{
+	wid=0;
+	hei=0;
+	rgba=NULL;
+	twoLineBuf8=NULL;
+
+	curLine8=NULL;
+	prvLine8=NULL;
+
+	convertRow=NULL;
+	bytePerPixel=1;
+
+	autoDeleteRgbaBuffer=1;
+
+	outputBuffer=NULL;
+	outputBufferSize=0;
+	outputStride=0;
+	outputFormat=PIXEL_RGBA8;
+	outputBottomUp=YSFALSE;
+
+	outputTop=NULL;
+	stride=0;
+	rgbaRow=NULL;
+
+	for(int pass=0; pass<7; pass++)
+	{
+		passRgba[pass]=NULL;
+		passWid[pass]=0;
+		passFilled[pass]=0;
+	}
+	zeroRow=NULL;
+	expandBuf=NULL;
+	expandedY=0;
+}
 
+YsRawPngDecoder::~YsRawPngDecoder()
+{
+	if(autoDeleteRgbaBuffer==1 && rgba!=NULL)
+	{
+		delete [] rgba;
+	}
+}
 
-		// Interlace
-		case 1:
-			//   1 6 4 6 2 6 4 6
-			//   7 7 7 7 7 7 7 7
-			//   5 6 5 6 5 6 5 6
-			//   7 7 7 7 7 7 7 7
-			//   3 6 4 6 3 6 4 6
-			//   7 7 7 7 7 7 7 7
-			//   5 6 5 6 5 6 5 6
-			//   7 7 7 7 7 7 7 7
-			switch(interlacePass)
-			{
-			case 1:
-				interlaceWid=(wid+7)/8;
-				interlaceHei=(hei+7)/8;
-				interlaceX=x*8;
-				interlaceY=y*8;
-				break;
-			case 2:
-				interlaceWid=(wid+3)/8;
-				interlaceHei=(hei+7)/8;
-				interlaceX=4+x*8;
-				interlaceY=y*8;
-				break;
-			case 3:
-				interlaceWid=(wid+3)/4;
-				interlaceHei=(hei+3)/8;
-				interlaceX=x*4;
-				interlaceY=4+y*8;
-				break;
-			case 4:
-				interlaceWid=(wid+1)/4;
-				interlaceHei=(hei+3)/4;
-				interlaceX=2+x*4;
-				interlaceY=y*4;
-				break;
-			case 5:
-				interlaceWid=(wid+1)/2;
-				interlaceHei=(hei+1)/4;
-				interlaceX=x*2;
-				interlaceY=2+y*4;
-				break;
-			case 6:
-				interlaceWid=(wid  )/2;
-				interlaceHei=(hei+1)/2;
-				interlaceX=1+x*2;
-				interlaceY=y*2;
-				break;
-			case 7:
-				interlaceWid=wid;
-				interlaceHei=hei/2;
-				interlaceX=x;
-				interlaceY=1+y*2;
-				break;
-			default:
-				return YSERR;
-			} // switch(interlacePass)
+/* static */ unsigned int YsRawPngDecoder::GetBytePerPixel(unsigned int pixelFormat)
+{
+	switch(pixelFormat)
+	{
+	case PIXEL_RGBA8:
+	case PIXEL_BGRA8:
+		return 4;
+	case PIXEL_RGB8:
+		return 3;
+	case PIXEL_GRAY8:
+		return 1;
+	}
+	return 0;
+}
 
-			switch(hdr.colorType)  // See PNG Specification 6.1 Colour types and values
-			{
-			// Grayscale
-			case 0:
-				switch(hdr.bitDepth)
-				{
-				case 8:
-					curLine8[inLineCount]=dat;
-					Filter8(curLine8,prvLine8,x,y,1,filter);
-
-					index=interlaceX*4+interlaceY*wid*4;
-					rgba[index  ]=curLine8[inLineCount];
-					rgba[index+1]=curLine8[inLineCount];
-					rgba[index+2]=curLine8[inLineCount];
-
-					if(curLine8[inLineCount]==trns.col[0] || 
-					   curLine8[inLineCount]==trns.col[1] || 
-					   curLine8[inLineCount]==trns.col[2])
-					{
-						rgba[index+3]=0;
-					}
-					else
-					{
-						rgba[index+3]=255;
-					}
+size_t YsRawPngDecoder::GetStride(void) const
+{
+	return stride;
+}
 
-					x++;
-					inLineCount++;
-					break;
-				}
-				break;
+void YsRawPngDecoder::ShiftTwoLineBuf(void)
+{
+	if(twoLineBuf8!=NULL)
+	{
+		unsigned char *swap;
+		swap=curLine8;
+		curLine8=prvLine8;
+		prvLine8=swap;
+	}
+}
 
+YsGenericPngDecoder::RowConverter YsGenericPngDecoder::GetRgbaConverter(void) const
+{
+	// See PNG Specification 11.2 for Allowed combinations of color type and bit depth
+	switch(hdr.colorType)
+	{
+	case 0:   // Greyscale
+		switch(hdr.bitDepth)
+		{
+		case 1:
+			return PngConvertGray1;
+		case 8:
+			return PngConvertGray8;
+		}
+		break;
+	case 2:   // Truecolor
+		switch(hdr.bitDepth)
+		{
+		case 8:
+			return PngConvertTruecolor8;
+		case 16:
+			return PngConvertTruecolor16;
+		}
+		break;
+	case 3:   // Indexed-color
+		switch(hdr.bitDepth)
+		{
+		case 1:
+		case 2:
+		case 4:
+			return PngConvertIndexed;
+		case 8:
+			return PngConvertIndexed8;
+		}
+		break;
+	case 4:   // Greyscale with alpha
+		switch(hdr.bitDepth)
+		{
+		case 8:
+			return PngConvertGrayAlpha8;
+		}
+		break;
+	case 6:   // Truecolor with alpha
+		switch(hdr.bitDepth)
+		{
+		case 8:
+			return PngConvertTruecolorAlpha8;
+		}
+		break;
+	}
+	return NULL;
+}
 
-			// True color
-			case 2:
-				switch(hdr.bitDepth)
-				{
-				case 8:
-					curLine8[inLineCount+inPixelCount]=dat;
-					inPixelCount++;
-					if(inPixelCount==3)
-					{
-						Filter8(curLine8,prvLine8,x,y,3,filter);
+int YsRawPngDecoder::PrepareOutput(void)
+{
+	convertRow=GetRgbaConverter();
+	if(NULL==convertRow)
+	{
+		printf("Unsupported colorType-bitDepth combination.\n");
+		printf("  Color type=%d\n",hdr.colorType);
+		printf("  Bit deptch=%d\n",hdr.bitDepth);
+		return YSERR;
+	}
 
-						index=interlaceX*4+interlaceY*wid*4;
-						rgba[index  ]=curLine8[inLineCount  ];
-						rgba[index+1]=curLine8[inLineCount+1];
-						rgba[index+2]=curLine8[inLineCount+2];
 
-						if(curLine8[inLineCount  ]==trns.col[0] && 
-						   curLine8[inLineCount+1]==trns.col[1] && 
-						   curLine8[inLineCount+2]==trns.col[2])
-						{
-							rgba[index+3]=0;
-						}
-						else
-						{
-							rgba[index+3]=255;
-						}
 
-						x++;
-						inLineCount+=3;
-						inPixelCount=0;
-					}
-					break;
+	const unsigned int outputBytePerPixel=GetBytePerPixel(outputFormat);
+	if(0==outputBytePerPixel)
+	{
+		printf("Unknown output pixel format.\n");
+		return YSERR;
+	}
 
-				case 16:
-					curLine8[inLineCount+inPixelCount]=dat;
-					inPixelCount++;
-					if(inPixelCount==6)
-					{
-						Filter8(curLine8,prvLine8,x,y,6,filter);
-						index=interlaceX*4+interlaceY*wid*4;
-						rgba[index  ]=curLine8[inLineCount  ];
-						rgba[index+1]=curLine8[inLineCount+2];
-						rgba[index+2]=curLine8[inLineCount+4];
-
-						r=curLine8[inLineCount  ]*256+curLine8[inLineCount+1];
-						g=curLine8[inLineCount+2]*256+curLine8[inLineCount+3];
-						b=curLine8[inLineCount+4]*256+curLine8[inLineCount+5];
-
-						if(r==trns.col[0] && g==trns.col[1] && b==trns.col[2])
-						// Fixed based on a bug report from a viewer.  Thanks for the good catch!
-						//   Report received 09/10/2010
-						//   Fixed           09/18/2010
-						{
-							rgba[index+3]=0;
-						}
-						else
-						{
-							rgba[index+3]=255;
-						}
+	wid=hdr.width;
+	hei=hdr.height;
+	const size_t rowBytes=(size_t)wid*outputBytePerPixel;
+	stride=(0<outputStride ? outputStride : rowBytes);
+	if(stride<rowBytes)
+	{
+		printf("Output stride is smaller than a row.\n");
+		return YSERR;
+	}
 
-						x++;
-						inLineCount+=6;
-						inPixelCount=0;
-					}
-					break;
-				}
-				break;
+	if(autoDeleteRgbaBuffer==1 && rgba!=NULL)
+	{
+		delete [] rgba;
+	}
+	rgba=NULL;
 
+	if(NULL!=outputBuffer)
+	{
+		if(0<hei && outputBufferSize<stride*(hei-1)+rowBytes)
+		{
+			printf("Output buffer is too small.\n");
+			return YSERR;
+		}
+		outputTop=outputBuffer;
+	}
+	else
+	{
+		rgba=new unsigned char [stride*hei];
+		outputTop=rgba;
+	}
 
+	// Line buffers are in the arena, and released at the next image.
+	rgbaRow=NULL;
+	if(PIXEL_RGBA8!=outputFormat)
+	{
+		rgbaRow=(unsigned char *)arena.Alloc((size_t)wid*4);
+	}
 
-			// Indexed color
-			case 3:
-				switch(hdr.bitDepth)
-				{
-				case 8:
-					curLine8[inLineCount]=dat;
-					Filter8(curLine8,prvLine8,x,y,1,filter);
+	const unsigned int bitsPerPixel=GetBitsPerPixel(hdr.colorType,hdr.bitDepth);
+	bytePerPixel=(8<=bitsPerPixel ? bitsPerPixel/8 : 1);
 
-					index=interlaceX*4+interlaceY*wid*4;
-					colIdx=curLine8[inLineCount  ];
-					if(colIdx<plt.nEntry)
-					{
-						rgba[index  ]=plt.entry[colIdx*3  ];
-						rgba[index+1]=plt.entry[colIdx*3+1];
-						rgba[index+2]=plt.entry[colIdx*3+2];
-						if(colIdx==trns.col[0] || colIdx==trns.col[1] || colIdx==trns.col[2])
-						{
-							rgba[index+3]=0;
-						}
-						else
-						{
-							rgba[index+3]=255;
-						}
-					}
+	const size_t twoLineBufLngPerLine=GetRowLength(hdr.width);
+	twoLineBuf8=(unsigned char *)arena.Alloc(twoLineBufLngPerLine*2);
+	curLine8=twoLineBuf8;
+	prvLine8=twoLineBuf8+twoLineBufLngPerLine;
 
-					x++;
-					inLineCount++;
-					break;
-				}
-				break;
+	for(int pass=0; pass<7; pass++)
+	{
+		passRgba[pass]=NULL;
+		passWid[pass]=0;
+		passFilled[pass]=0;
+	}
+	zeroRow=NULL;
+	expandBuf=NULL;
+	expandedY=0;
+	if(0!=hdr.interlaceMethod)
+	{
+		// Passes 1 to 6 are a half of the pixels.  Not cleared, because only the rows that came are read.
+		for(unsigned int pass=1; pass<7; pass++)
+		{
+			unsigned int passHei;
+			GetPassSize(passWid[pass],passHei,pass);
+			passRgba[pass]=(unsigned char *)arena.Alloc((size_t)passWid[pass]*passHei*4);
+		}
+		zeroRow=(unsigned char *)arena.Alloc((size_t)passWid[5]*4);
+		memset(zeroRow,0,(size_t)passWid[5]*4);
+		expandBuf=(unsigned char *)arena.Alloc((size_t)wid*8);
+	}
 
+	return YSOK;
+}
 
+unsigned char *YsRawPngDecoder::GetOutputRow(unsigned int y) const
+{
+	return outputTop+stride*(YSTRUE==outputBottomUp ? hei-1-y : y);
+}
 
-			// Greyscale with alpha
-			case 4:
-				switch(hdr.bitDepth)
-				{
-				case 8:
-					curLine8[inLineCount+inPixelCount]=dat;
-					inPixelCount++;
-					if(inPixelCount==2)
-					{
-						Filter8(curLine8,prvLine8,x,y,2,filter);
+const unsigned char *YsRawPngDecoder::GetPassRow(unsigned int pass,unsigned int passY) const
+{
+	if(passY<passFilled[pass])
+	{
+		return passRgba[pass]+(size_t)passY*passWid[pass]*4;
+	}
+	return zeroRow;
+}
 
-						index=interlaceX*4+interlaceY*wid*4;
-						rgba[index  ]=curLine8[inLineCount  ];
-						rgba[index+1]=curLine8[inLineCount  ];
-						rgba[index+2]=curLine8[inLineCount  ];
-						rgba[index+3]=curLine8[inLineCount+1];
+void YsRawPngDecoder::ExpandEvenRows(unsigned int yEnd)
+{
+	while(expandedY<yEnd)
+	{
+		ExpandEvenRow(expandedY);
+		expandedY+=2;
+	}
+}
 
-						x++;
-						inLineCount+=2;
-						inPixelCount=0;
-					}
-					break;
-				}
-				break;
+void YsRawPngDecoder::ExpandEvenRow(unsigned int y)
+{
+	// Odd columns of an even row are pass 6.  Even columns are pass 5 if y%4==2.  Otherwise, columns x%4==2
+	// are pass 4, and columns x%4==0 are pass 3 if y%8==4, or passes 1 and 2 if y%8==0.
+	const unsigned char *even;
+	if(2==y%4)
+	{
+		even=GetPassRow(5,y/4);
+	}
+	else
+	{
+		unsigned char *quarter=expandBuf,*half=expandBuf+(size_t)wid*4;
+		const unsigned char *x4;
+		if(4==y%8)
+		{
+			x4=GetPassRow(3,y/8);
+		}
+		else
+		{
+			PngInterleave32(quarter,GetPassRow(1,y/8),passWid[1],GetPassRow(2,y/8),passWid[2]);
+			x4=quarter;
+		}
+		PngInterleave32(half,x4,passWid[3],GetPassRow(4,y/4),passWid[4]);
+		even=half;
+	}
 
+	unsigned char *dst=GetOutputRow(y);
+	if(PIXEL_RGBA8==outputFormat)
+	{
+		PngInterleave32(dst,even,passWid[5],GetPassRow(6,y/2),passWid[6]);
+	}
+	else
+	{
+		PngInterleave32(rgbaRow,even,passWid[5],GetPassRow(6,y/2),passWid[6]);
+		PngPackRow(outputFormat,dst,rgbaRow,wid,GetBytePerPixel(outputFormat));
+	}
+}
 
+int YsRawPngDecoder::OutputRow(const unsigned char row[],size_t length)
+{
+	const size_t lineLength=length-1;
+	if(0==rowY)
+	{
+		// The first row of a pass is unfiltered against zero.
+		memset(prvLine8,0,lineLength);
+	}
+	PngUnfilterRow(row[0],curLine8,row+1,prvLine8,lineLength,bytePerPixel);
 
-			// Truecolor with alpha
-			case 6:
-				switch(hdr.bitDepth)
-				{
-				case 8:
-					curLine8[inLineCount+inPixelCount]=dat;
-					inPixelCount++;
-					if(inPixelCount==4)
-					{
-						Filter8(curLine8,prvLine8,x,y,4,filter);
+	if(0<rowPass && rowPass<7)
+	{
+		(*convertRow)(*this,passRgba[rowPass]+(size_t)rowY*passWid[rowPass]*4,curLine8,passWid[rowPass],4);
+		passFilled[rowPass]=rowY+1;
+	}
+	else
+	{
+		// A row of a non-interlaced image or pass 7 is a whole row.
+		const unsigned int y=(0==rowPass ? rowY : rowY*2+1);
+		if(7==rowPass)
+		{
+			ExpandEvenRows(y);
+		}
+		unsigned char *dst=GetOutputRow(y);
+		if(PIXEL_RGBA8==outputFormat)
+		{
+			(*convertRow)(*this,dst,curLine8,wid,4);
+		}
+		else
+		{
+			(*convertRow)(*this,rgbaRow,curLine8,wid,4);
+			PngPackRow(outputFormat,dst,rgbaRow,wid,GetBytePerPixel(outputFormat));
+		}
+	}
 
-						index=interlaceX*4+interlaceY*wid*4;
-						rgba[index  ]=curLine8[inLineCount  ];
-						rgba[index+1]=curLine8[inLineCount+1];
-						rgba[index+2]=curLine8[inLineCount+2];
-						rgba[index+3]=curLine8[inLineCount+3];
+	ShiftTwoLineBuf();
+	return YSOK;
+}
 
-						x++;
-						inLineCount+=4;
-						inPixelCount=0;
-					}
-					break;
-				}
-			break;
-			} // switch(hdr.colorType)
+int YsRawPngDecoder::EndOutput(void)
+{
+	if(verboseMode==YSTRUE)
+	{
+		printf("Final Position (pass %d, row %d)\n",rowPass,rowY);
+	}
 
-			if(x>=(int)interlaceWid)
+	if(0!=hdr.interlaceMethod)
+	{
+		// Even rows that pass 7 did not reach.  If the file is cut, up to the last row that has a pixel.
+		unsigned int yEnd=0;
+		for(unsigned int pass=1; pass<7; pass++)
+		{
+			if(0<passFilled[pass])
 			{
-				y++;
-				x=-1;
-				ShiftTwoLineBuf();
-				if(y>=(int)interlaceHei)
+				unsigned int x0,y0,dx,dy;
+				GetPassGeometry(x0,y0,dx,dy,pass);
+				const unsigned int lastY=y0+(passFilled[pass]-1)*dy;
+				if(yEnd<=lastY)
 				{
-					y=0;
-					interlacePass++;
-
-					if(YsGenericPngDecoder::verboseMode==YSTRUE)
-					{
-						printf("Interlace Pass %d\n",interlacePass);
-					}
+					yEnd=lastY+1;
 				}
 			}
-
-			return YSOK;
-		default:
-			printf("Unsupported interlace method.\n");
-			return YSERR;
 		}
+		ExpandEvenRows(yEnd);
 	}
-	// return YSERR;
+	return YSOK;
 }
 
-int YsRawPngDecoder::EndOutput(void)
+void YsRawPngDecoder::Flip(void)  // For drawing in OpenGL
 {
-	if(YsGenericPngDecoder::verboseMode==YSTRUE)
+	// Set outputBottomUp=YSTRUE before decoding not to need this.
+	if(NULL==rgba || hei<2)
 	{
-		printf("Final Position (%d,%d)\n",x,y);
+		return;
 	}
+	const size_t bytePerLine=(0<stride ? stride : (size_t)wid*4);
+	unsigned char *swp=(unsigned char *)arena.Alloc(bytePerLine);
+	for(int y=0; y<hei/2; y++)
+	{
+		unsigned char *top=rgba+y*bytePerLine;
+		unsigned char *bottom=rgba+(hei-1-y)*bytePerLine;
+		memcpy(swp,top,bytePerLine);
+		memcpy(top,bottom,bytePerLine);
+		memcpy(bottom,swp,bytePerLine);
+	}
+}
+
+////////////////////////////////////////////////////////////
+
+YsRowPngDecoder::YsRowPngDecoder()
+{
+	convertRow=NULL;
+	bytePerPixel=1;
+	twoLineBuf8=NULL;
+	curLine8=NULL;
+	prvLine8=NULL;
+	rgbaRow=NULL;
+}
+
+YsRowPngDecoder::~YsRowPngDecoder()
+{
+}
+
+int YsRowPngDecoder::PrepareOutput(void)
+{
+	convertRow=GetRgbaConverter();
+	if(NULL==convertRow)
+	{
+		printf("Unsupported colorType-bitDepth combination.\n");
+		printf("  Color type=%d\n",hdr.colorType);
+		printf("  Bit deptch=%d\n",hdr.bitDepth);
+		return YSERR;
+	}
+
+	const unsigned int bitsPerPixel=GetBitsPerPixel(hdr.colorType,hdr.bitDepth);
+	bytePerPixel=(8<=bitsPerPixel ? bitsPerPixel/8 : 1);
+
+	const size_t lineLength=GetRowLength(hdr.width);
+	twoLineBuf8=(unsigned char *)arena.Alloc(lineLength*2);
+	curLine8=twoLineBuf8;
+	prvLine8=twoLineBuf8+lineLength;
+	rgbaRow=(unsigned char *)arena.Alloc((size_t)hdr.width*4);
+
 	return YSOK;
 }
 
-void YsRawPngDecoder::Flip(void)  // For drawing in OpenGL
+int YsRowPngDecoder::OutputRow(const unsigned char row[],size_t length)
 {
-	int x,y,bytePerLine;
-	unsigned int swp;
-	bytePerLine=wid*4;
-	for(y=0; y<hei/2; y++)
+	const size_t lineLength=length-1;
+	if(0==rowY)
 	{
-		for(x=0; x<bytePerLine; x++)
-		{
-			swp=rgba[y*bytePerLine+x];
-			rgba[y*bytePerLine+x]=rgba[(hei-1-y)*bytePerLine+x];
-			rgba[(hei-1-y)*bytePerLine+x]=(unsigned char)swp;
-		}
+		// The first row of a pass is unfiltered against zero.
+		memset(prvLine8,0,lineLength);
 	}
+	PngUnfilterRow(row[0],curLine8,row+1,prvLine8,lineLength,bytePerPixel);
+
+	unsigned int x0,y0,dx,dy,passWid,passHei;
+	GetPassGeometry(x0,y0,dx,dy,rowPass);
+	GetPassSize(passWid,passHei,rowPass);
+	(*convertRow)(*this,rgbaRow,curLine8,passWid,4);
+
+	unsigned char *swap=curLine8;
+	curLine8=prvLine8;
+	prvLine8=swap;
+
+	return OutputRgbaRow(y0+rowY*dy,x0,dx,passWid,rgbaRow);
 }
@@ -65,7 +65,6 @@ public:
 	~YsPngHuffmanTree();
 	unsigned int dat;
 	unsigned int weight,depth;
-	static int leakTracker;
 
 	static void DeleteHuffmanTree(YsPngHuffmanTree *node);
 
@@ -83,55 +82,293 @@ public:
 	}
 };
 
-class YsPngUncompressor
+/*! Part of a byte stream.  The zlib stream of a PNG is given to the uncompressor as a chain of spans,
+    so that the payloads of IDAT chunks can be used where they are, without being joined.
+*/
+class YsPngByteSpan
 {
 public:
-	class YsGenericPngDecoder *output;
+	const unsigned char *dat;
+	size_t length;
+};
 
-	inline unsigned int GetNextBit(const unsigned char dat[],unsigned &bytePtr,unsigned &bitPtr)
+/*! Bit stream of deflate.  Bits are taken from the LSB of each byte.
+    Up to 64 bits are kept in bitBuf, and refilled 8 bytes at a time while there are enough bytes left in the span.
+    Near the end of a span, bytes are loaded one by one, and continue from the next span.
+    Zero bytes are fed after the end of the last span, and IsOverrun tells if any of them have been used.
+    While morePending is true, more data will follow, and Refill stops at the end of the last span instead.
+*/
+class YsPngBitReader
+{
+public:
+	const YsPngByteSpan *span;
+	size_t nSpan;
+	size_t spanIdx;            // Span that dat points to.
+	const unsigned char *dat;  // Bytes of the current span.
+	size_t length;
+	size_t bytePtr;            // Next byte in the current span to be loaded to bitBuf.
+	unsigned long long bitBuf; // LSB is the next bit.
+	unsigned int nBit;         // Number of valid bits in bitBuf.
+	size_t nPadByte;           // Number of zero bytes loaded after the end of the data.
+	bool morePending;
+
+	void Begin(size_t nSpan,const YsPngByteSpan span[]);
+
+	/*! Continues with new spans, keeping the bits in bitBuf.  Bytes of the last span that have not been
+	    loaded (from bytePtr) must be at the top of the new spans.
+	*/
+	void Continue(size_t nSpan,const YsPngByteSpan span[]);
+
+	/*! Moves to the next non-empty span.  Returns false if there is no more.
+	*/
+	bool NextSpan(void);
+
+	/*! After Refill, at least 56 bits are in bitBuf.
+	*/
+	inline void Refill(void)
 	{
-		unsigned a;
-		a=dat[bytePtr]&bitPtr;
-		bitPtr<<=1;
-		if(bitPtr>=256)
+		if(bytePtr+8<=length)
 		{
-			bitPtr=1;
-			bytePtr++;
+			const unsigned char *p=dat+bytePtr;
+			unsigned long long v=
+			     (unsigned long long)p[0]     |((unsigned long long)p[1]<<8) |
+			    ((unsigned long long)p[2]<<16)|((unsigned long long)p[3]<<24)|
+			    ((unsigned long long)p[4]<<32)|((unsigned long long)p[5]<<40)|
+			    ((unsigned long long)p[6]<<48)|((unsigned long long)p[7]<<56);
+			// Bits above nBit that do not make a whole byte are loaded again next time.  They are the same bits.
+			bitBuf|=(v<<nBit);
+			bytePtr+=(63-nBit)>>3;
+			nBit|=56;
 		}
-		return (a!=0 ? 1 : 0);
-	}
-	inline unsigned int GetNextMultiBit(const unsigned char dat[],unsigned &bytePtr,unsigned &bitPtr,unsigned n)
-	{
-		unsigned value,mask,i;
-		value=0;
-		mask=1;
-		for(i=0; i<n; i++)
+		else
 		{
-			if(GetNextBit(dat,bytePtr,bitPtr))
+			while(nBit<=56)
 			{
-				value|=mask;
+				unsigned long long b=0;
+				if(bytePtr<length || true==NextSpan())
+				{
+					b=dat[bytePtr++];
+				}
+				else if(true==morePending)
+				{
+					break;
+				}
+				else
+				{
+					++nPadByte;
+				}
+				bitBuf|=(b<<nBit);
+				nBit+=8;
 			}
-			mask<<=1;
 		}
+	}
+	inline unsigned int Peek(unsigned int n) const
+	{
+		return (unsigned int)(bitBuf&((1ULL<<n)-1));
+	}
+	inline void Consume(unsigned int n)
+	{
+		bitBuf>>=n;
+		nBit-=n;
+	}
+	/*! n must be 32 or less.
+	*/
+	inline unsigned int GetBits(unsigned int n)
+	{
+		if(nBit<n)
+		{
+			Refill();
+		}
+		unsigned int value=Peek(n);
+		Consume(n);
 		return value;
 	}
 
+	void AlignToByte(void);
+
+	/*! Returns true if bits after the end of the data have been used.
+	*/
+	bool IsOverrun(void) const;
+
+	/*! Returns the number of bits left before the end of the data.
+	*/
+	size_t GetAvailableBits(void) const;
+};
+
+/*! Canonical Huffman code of deflate as lookup tables.
+    The next primaryBits bits of the stream index the primary table.  A code longer than primaryBits
+    continues in a subtable linked from the primary-table entry, which is indexed by the following bits.
+    Each entry is (type<<24)|(nBits<<16)|value.  nBits is the number of bits consumed by the entry.
+    value is the symbol, or the offset of the subtable.
+*/
+class YsPngHuffmanTable
+{
+public:
+	enum
+	{
+		MAX_CODE_LENGTH=15,
+		MAX_SYMBOLS=288,
+		MAX_PRIMARY_BITS=10,
+		MAX_ENTRIES=2048,     // Complete code of 288 symbols with 10-bit primary table takes up to 1332 entries.
+
+		ENTRY_SYMBOL=0,
+		ENTRY_SUBTABLE=1,
+		ENTRY_INVALID=2
+	};
+
+	unsigned int primaryBits;
+	unsigned int nEntry;
+	unsigned int entry[MAX_ENTRIES];
+
+	/*! Makes the table from the code lengths.  Returns YSERR if the lengths do not make a prefix code.
+	    Incomplete code is accepted, and unused codes decode to -1.
+	*/
+	int Make(unsigned int n,const unsigned int hLength[],unsigned int primaryBits);
+
+	/*! Returns the symbol, or -1 for an unused code.
+	*/
+	inline int Decode(YsPngBitReader &bits) const
+	{
+		bits.Refill();
+		unsigned int e=entry[bits.Peek(primaryBits)];
+		if(ENTRY_SUBTABLE==(e>>24))
+		{
+			bits.Consume(primaryBits);
+			e=entry[(e&0xffff)+bits.Peek((e>>16)&0xff)];
+		}
+		if(ENTRY_SYMBOL!=(e>>24))
+		{
+			return -1;
+		}
+		bits.Consume((e>>16)&0xff);
+		return (int)(e&0xffff);
+	}
+};
+
+/*! Scratch memory of a decoder.  Alloc takes blocks from a buffer one after another, and Reset releases all of them at once.
+    When an image needs more than the buffer, a larger buffer is added, or a large block gets a buffer of its own.
+    The next Reset replaces the buffers with one buffer of the total size, so that the next image of the same size is
+    decoded without allocating memory from the system.
+*/
+class YsPngArena
+{
+public:
+	enum
+	{
+		ALIGNMENT=32,           // For AVX2.
+		MIN_BUFFER_SIZE=65536
+	};
+
+private:
+	unsigned char *buf;       // Current buffer allocated by new [].  The first bytes link to the other buffers.
+	unsigned char *top;       // Aligned top of the usable bytes of buf.
+	size_t capacity,used;
+	size_t allocated;         // Bytes given by Alloc since Reset.
+
+	YsPngArena(const YsPngArena &);
+	YsPngArena &operator=(const YsPngArena &);
+
+public:
+	YsPngArena();
+	~YsPngArena();
+
+	/*! Returns size bytes aligned to ALIGNMENT.  The bytes are valid until Reset or Release.
+	*/
+	void *Alloc(size_t size);
+
+	/*! Releases all the blocks.  The memory is kept for the next image.
+	*/
+	void Reset(void);
+
+	/*! Returns all the memory to the system.
+	*/
+	void Release(void);
+
+private:
+	unsigned char *AddBuffer(size_t size,bool makeCurrent);
+	static unsigned char *GetLink(const unsigned char buf[]);
+	static void SetLink(unsigned char buf[],unsigned char *link);
+	static unsigned char *GetTop(unsigned char buf[]);
+};
+
+/*! Inflater of the zlib stream.  Uncompress takes the whole stream at once.
+    For incremental uncompression, call Begin, and then Run every time more data arrives in the bit reader.
+    Run stops before a step that may need more bits than available, and continues from there next time.
+*/
+class YsPngUncompressor
+{
+public:
+	enum
+	{
+		LITERAL_PRIMARY_BITS=10,
+		DISTANCE_PRIMARY_BITS=8,
+		CODE_LENGTH_PRIMARY_BITS=7,
+
+		MAX_SYMBOL_BITS=15+5+15+13,               // Length code, extra bits, distance code, extra bits.
+		MAX_BLOCK_HEADER_BITS=3+14+19*3+316*14,   // Block header, and the code lengths of the dynamic Huffman code.
+
+		STATE_ZLIB_HEADER=0,
+		STATE_BLOCK_HEADER,
+		STATE_STORED_DATA,
+		STATE_HUFFMAN_DATA,
+		STATE_ADLER32,
+		STATE_END,
+		STATE_ERROR
+	};
+
+	class YsGenericPngDecoder *output;
+	unsigned int verboseMode;
+	YsPngArena *arena;  // The window is taken from arena if not NULL.
+
+	YsPngUncompressor();
+	~YsPngUncompressor();
+
 	void MakeFixedHuffmanCode(unsigned hLength[288],unsigned hCode[288]);
 	static void MakeDynamicHuffmanCode(unsigned hLength[288],unsigned hCode[288],unsigned nLng,unsigned lng[]);
-	int DecodeDynamicHuffmanCode
-	   (unsigned int &hLit,unsigned int &hDist,unsigned int &hCLen,
-	    unsigned int *&hLengthLiteral,unsigned int *&hCodeLiteral,
-	    unsigned int *&hLengthDist,unsigned int *&hCodeDist,
-	    unsigned int hLengthBuf[322],unsigned int hCodeBuf[322],
-	    const unsigned char dat[],unsigned int &bytePtr,unsigned int &bitPtr);
-
-	YsPngHuffmanTree *MakeHuffmanTree(unsigned n,unsigned hLength[],unsigned hCode[]);
-	void DeleteHuffmanTree(YsPngHuffmanTree *node);
+	int DecodeDynamicHuffmanCode(YsPngHuffmanTable &literalTable,YsPngHuffmanTable &distTable,YsPngBitReader &bits);
 
-	unsigned GetCopyLength(unsigned value,unsigned char dat[],unsigned &bytePtr,unsigned &bitPtr);
-	unsigned GetBackwardDistance(unsigned distCode,unsigned char dat[],unsigned &bytePtr,unsigned &bitPtr);
+	unsigned GetCopyLength(unsigned value,YsPngBitReader &bits);
+	unsigned GetBackwardDistance(unsigned distCode,YsPngBitReader &bits);
 
 	int Uncompress(unsigned length,unsigned char dat[]);
+
+	/*! Uncompresses a zlib stream split into nSpan spans.
+	*/
+	int Uncompress(size_t nSpan,const YsPngByteSpan span[]);
+
+	/*! Starts incremental uncompression.
+	*/
+	void Begin(void);
+
+	/*! Uncompresses as far as the bits available.  If allInput is true, the stream is supposed to end in bits,
+	    and running out of bits is an error.  Returns YSERR if the stream is broken, or if output returns YSERR.
+	*/
+	int Run(YsPngBitReader &bits,bool allInput);
+
+	/*! Returns true when the final block and the Adler-32 after it are over.
+	*/
+	bool IsEnd(void) const;
+
+	/*! Releases the window.  The window taken from the arena stays in the arena.
+	*/
+	void End(void);
+
+private:
+	YsPngUncompressor(const YsPngUncompressor &);
+	YsPngUncompressor &operator=(const YsPngUncompressor &);
+
+	unsigned int state;
+	unsigned char *windowBuf;
+	bool windowInArena;
+	unsigned int windowSize,windowUsed;
+	unsigned int bFinal;
+	unsigned int storedLeft;
+	bool fixedTableReady;
+	unsigned int nByteExtracted;
+	const YsPngHuffmanTable *codeTable,*distCodeTable;
+
+	YsPngHuffmanTable literalTable,distTable;
+	YsPngHuffmanTable fixedLiteralTable,fixedDistTable;
 };
 
 ////////////////////////////////////////////////////////////
@@ -143,18 +380,22 @@ public:
 	unsigned int bitDepth,colorType;
 	unsigned int compressionMethod,filterMethod,interlaceMethod;
 
-	void Decode(unsigned char dat[]);
+	void Decode(const unsigned char dat[]);
 };
 
 class YsPngPalette
 {
 public:
+	enum
+	{
+		MAX_ENTRY=256
+	};
+
 	unsigned int nEntry;
-	unsigned char *entry;
+	unsigned char entry[MAX_ENTRY*3];
 
 	YsPngPalette();
-	~YsPngPalette();
-	int Decode(unsigned length,unsigned char dat[]);
+	int Decode(unsigned length,const unsigned char dat[]);
 };
 
 class YsPngTransparency
@@ -163,7 +404,7 @@ public:
 	unsigned int col[3];
 
 	// For color type 3, up to three transparent colors is supported.
-	int Decode(unsigned length,unsigned char dat[],unsigned int colorType);
+	int Decode(unsigned length,const unsigned char dat[],unsigned int colorType);
 };
 
 class YsPngGenericBinaryStream
@@ -171,6 +412,12 @@ class YsPngGenericBinaryStream
 public:
 	virtual size_t GetSize(void) const=0;
 	virtual size_t Read(unsigned char buf[],size_t readSize)=0;
+
+	/*! Returns the pointer to the next readSize bytes and moves past them, if the stream is in memory and
+	    the bytes can be used in place.  The pointer must stay valid until the decoding is over.
+	    Returns NULL without moving if not.  Then the decoder uses Read.
+	*/
+	virtual const unsigned char *ReadInPlace(size_t readSize);
 };
 
 class YsPngBinaryFileStream : public YsPngGenericBinaryStream
@@ -193,6 +440,7 @@ public:
 	YsPngBinaryMemoryStream(size_t dataSize,const unsigned char binaryData[]);
 	virtual size_t GetSize(void) const;
 	virtual size_t Read(unsigned char buf[],size_t readSize);
+	virtual const unsigned char *ReadInPlace(size_t readSize);
 };
 
 class YsGenericPngDecoder
@@ -200,27 +448,137 @@ class YsGenericPngDecoder
 public:
 	enum
 	{
-		gamma_default=100000
+		gamma_default=100000,
+		PUSH_BUFFER_SIZE=16384  // Compressed bytes kept by the push decoder.
 	};
 
+	/*! Converts nPixel pixels of an unfiltered row to RGBA.  dstStep is the bytes between the pixels in dst.
+	*/
+	typedef void (*RowConverter)(const YsGenericPngDecoder &dec,unsigned char dst[],const unsigned char src[],unsigned int nPixel,unsigned int dstStep);
+
 	YsPngHeader hdr;
 	YsPngPalette plt;
 	YsPngTransparency trns;
 	unsigned int gamma;
 
-	static unsigned int verboseMode;
+	unsigned int verboseMode;  // Per decoder, so that decoders can run in different threads.
+
+	/*! If YSTRUE (default), the CRC of each chunk and the Adler-32 of the uncompressed data are checked, and
+	    Decode and Push return YSERR on a mismatch.  Can be set to YSFALSE to skip the checks for trusted assets.
+	*/
+	YSBOOL verifyChecksum;
+
+	/*! Scratch memory of the decoding.  The window, compressed data read from a file stream, and row buffers are
+	    taken from here, and it is reset at the beginning of each image.  The memory is kept for the next image
+	    until arena.Release() is called.
+	*/
+	YsPngArena arena;
+
+	unsigned int rowPass;  // Pass of the row given to OutputRow.  0 for non-interlaced image, 1 to 7 for Adam7.
+	unsigned int rowY;     // Row in the pass.
+
+private:
+	unsigned char *rowBuf;
+	size_t rowLength,rowFilled;  // rowLength includes the filter-type byte.
+	unsigned int rowHei;         // Rows in the pass.
+	unsigned int rowAdler;       // Adler-32 of the rows so far.
+
+	class YsPngPushState *push;
+
+	YsGenericPngDecoder(const YsGenericPngDecoder &);
+	YsGenericPngDecoder &operator=(const YsGenericPngDecoder &);
 
+public:
 	YsGenericPngDecoder();
+	virtual ~YsGenericPngDecoder();
 	void Initialize(void);
 	int CheckSignature(YsPngGenericBinaryStream &binStream);
+
+	/*! buf is allocated by new [] and must be deleted by the caller.  buf is NULL if the chunk is empty, or if it fails.
+	*/
 	int ReadChunk(unsigned &length,unsigned char *&buf,unsigned &chunkType,unsigned &crc,YsPngGenericBinaryStream &binStream);
+
+	/*! The file is memory-mapped if possible, so that IDAT chunks are uncompressed without being copied.
+	    Returns YSERR if the file is broken, or if PrepareOutput fails, for example for an unsupported format.
+	*/
 	int Decode(const char fn[]);
 	int Decode(FILE *fp);
+
+	/*! If the stream supports ReadInPlace, IDAT payloads are given to the uncompressor where they are.
+	    Otherwise, each IDAT chunk is read once into its own buffer, and other chunks into one buffer that is reused.
+	*/
 	int Decode(YsPngGenericBinaryStream &binStream);
 
+	/*! Incremental decoding.  After BeginPush, give the bytes of the file to Push as they arrive, in pieces of any size.
+	    Rows are given to OutputRow as soon as they are uncompressed.  Up to PUSH_BUFFER_SIZE bytes of compressed data
+	    and the 32KB window are kept, so that the memory does not depend on the size of the file.
+	    Push returns YSERR once the file turns out to be broken.
+	    EndPush finishes the image even if IEND has not come yet, and returns YSOK if the compressed data was complete.
+	*/
+	int BeginPush(void);
+	int Push(size_t length,const unsigned char dat[]);
+	int EndPush(void);
+
+	/*! Returns YSTRUE once IEND has been pushed.  It stays YSTRUE after EndPush until the next BeginPush.
+	*/
+	YSBOOL IsPushComplete(void) const;
+
+	/*! Returns the converter from the unfiltered row of hdr to RGBA, or NULL if the color type and bit depth are not supported.
+	*/
+	RowConverter GetRgbaConverter(void) const;
+
+	static unsigned int GetBitsPerPixel(unsigned int colorType,unsigned int bitDepth);
+
+	/*! First pixel and pixel spacing of the pass.  Pass 0 is the whole non-interlaced image.
+	*/
+	static void GetPassGeometry(unsigned int &x0,unsigned int &y0,unsigned int &dx,unsigned int &dy,unsigned int pass);
+
+	/*! Number of pixels of the pass in the image of hdr.
+	*/
+	void GetPassSize(unsigned int &passWid,unsigned int &passHei,unsigned int pass) const;
+
+	/*! Bytes of a row of passWid pixels excluding the filter-type byte.
+	*/
+	size_t GetRowLength(unsigned int passWid) const;
+
+	/*! Adler-32 of the decompressed bytes that have made rows, if verifyChecksum is YSTRUE.
+	*/
+	unsigned int GetAdler32(void) const;
+
+	/*! Takes a decompressed byte.  OutputRow is called when a row is complete.
+	*/
+	inline int Feed(unsigned char dat)
+	{
+		rowBuf[rowFilled++]=dat;
+		if(rowFilled<rowLength)
+		{
+			return YSOK;
+		}
+		return FlushRow();
+	}
+
 	virtual int PrepareOutput(void);
+
+	/*! Called for each row after PrepareOutput.  row[0] is the filter type, and row[1] to row[length-1] are
+	    the filtered bytes of the row.  rowPass and rowY tell where the row is.
+	    The default implementation gives the bytes to Output one by one.
+	*/
+	virtual int OutputRow(const unsigned char row[],size_t length);
 	virtual int Output(unsigned char dat);
 	virtual int EndOutput(void);
+
+private:
+	int BeginRow(void);
+	int FlushRow(void);
+	void EndRow(void);
+
+	int DecodeChunk(unsigned chunkType,unsigned length,const unsigned char buf[]);
+	int PushChunkHeader(void);
+	int PushChunkData(size_t length,const unsigned char dat[]);
+	int PushChunkEnd(void);
+	int BeginPushUncompress(void);
+	int RunPushUncompress(bool allInput);
+	int EndPushUncompress(void);
 };
 
 
@@ -242,6 +600,14 @@ private:
 	YsRawPngDecoder &operator=(const YsRawPngDecoder &);
 
 public:
+	enum
+	{
+		PIXEL_RGBA8,
+		PIXEL_BGRA8,
+		PIXEL_RGB8,
+		PIXEL_GRAY8   // Luminance.  Alpha is dropped as in PIXEL_RGB8.
+	};
+
 	YsRawPngDecoder();
 	~YsRawPngDecoder();
 
@@ -250,14 +616,27 @@ public:
 	unsigned char *rgba;  // Raw data of R,G,B,A
 	int autoDeleteRgbaBuffer;
 
+	/* Output options.  By default, the image is RGBA, top row first, in rgba allocated by the decoder.
+	   If outputBuffer is not NULL, the image is written there instead, and rgba is NULL after decoding.
+	   outputBuffer must be at least outputStride*(hei-1)+wid*(bytes per pixel) bytes.  If the size is not
+	   known in advance, override PrepareOutput, and set the buffer from hdr before calling YsRawPngDecoder::PrepareOutput.
+	   outputFormat and outputBottomUp also apply to rgba allocated by the decoder.  Then rgba is outputStride*hei bytes.
+	*/
+	unsigned char *outputBuffer;
+	size_t outputBufferSize;
+	size_t outputStride;          // Bytes from a row to the next.  0 for wid times bytes per pixel.
+	unsigned int outputFormat;    // PIXEL_RGBA8, PIXEL_BGRA8, PIXEL_RGB8, or PIXEL_GRAY8
+	YSBOOL outputBottomUp;        // YSTRUE to store the bottom row first, as OpenGL takes it.  Flip is not needed then.
+
+	static unsigned int GetBytePerPixel(unsigned int pixelFormat);
+
+	/*! Bytes from a row to the next in the last decoded image.
+	*/
+	size_t GetStride(void) const;
 
-	int filter,x,y,firstByte;
-	int inLineCount;
-	int inPixelCount;
-	unsigned int r,g,b,msb;  // msb for reading 16 bit depth
-	unsigned int index;
 
-	unsigned int interlacePass;
+	RowConverter convertRow;
+	unsigned int bytePerPixel;  // For unfiltering.  1 if a pixel is smaller than a byte.
 
 	// For filtering
 	unsigned char *twoLineBuf8,*curLine8,*prvLine8;
@@ -265,13 +644,65 @@ public:
 	void ShiftTwoLineBuf(void);
 
 	virtual int PrepareOutput(void);
-	virtual int Output(unsigned char dat);
+	virtual int OutputRow(const unsigned char row[],size_t length);
 	virtual int EndOutput(void);
 
+private:
+	unsigned char *outputTop;     // outputBuffer or rgba
+	size_t stride;
+	unsigned char *rgbaRow;       // Row converted to RGBA before packing to outputFormat.
+
+	/* Adam7.  Passes 1 to 6 are kept as small RGBA images in the arena, and pass 7 goes straight to the odd rows.
+	   An even row is made from the passes just before the odd row below it comes.
+	   Index 0 is not used.
+	*/
+	unsigned char *passRgba[7];
+	unsigned int passWid[7],passFilled[7];  // passFilled is the rows of the pass decoded so far.
+	unsigned char *zeroRow;                 // In place of the rows that did not come in a broken file.
+	unsigned char *expandBuf;               // Two rows for interleaving the passes.
+	unsigned int expandedY;                 // Even rows above this are done.
+
+	unsigned char *GetOutputRow(unsigned int y) const;
+	const unsigned char *GetPassRow(unsigned int pass,unsigned int passY) const;
+	void ExpandEvenRows(unsigned int yEnd);
+	void ExpandEvenRow(unsigned int y);
+
+public:
 	void Flip(void);  // For drawing in OpenGL
 };
 
 
 
+/*! Gives the image to OutputRgbaRow a row at a time, instead of making the whole image.
+    Only two unfiltered rows and one RGBA row are kept.  With BeginPush/Push/EndPush, an image of any size can be
+    decoded in a fixed memory.
+    Rows of an interlaced image are given pass by pass.  A row of a pass has pixels x0, x0+dx, x0+dx*2, ... of row y.
+*/
+class YsRowPngDecoder : public YsGenericPngDecoder
+{
+private:
+	// Don't copy.
+	YsRowPngDecoder(const YsRowPngDecoder &);
+	YsRowPngDecoder &operator=(const YsRowPngDecoder &);
+
+	RowConverter convertRow;
+	unsigned int bytePerPixel;
+	unsigned char *twoLineBuf8,*curLine8,*prvLine8;
+	unsigned char *rgbaRow;
+
+public:
+	YsRowPngDecoder();
+	~YsRowPngDecoder();
+
+	virtual int PrepareOutput(void);
+	virtual int OutputRow(const unsigned char row[],size_t length);
+
+	/*! nPixel pixels of R,G,B,A.
+	*/
+	virtual int OutputRgbaRow(unsigned int y,unsigned int x0,unsigned int dx,unsigned int nPixel,const unsigned char rgba[])=0;
+};
+
+
+
 /* } */
 #endif